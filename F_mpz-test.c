@@ -32,6 +32,7 @@ Copyright (C) 2009, Andy Novocin
 #include <gmp.h>
 #include <mpfr.h>
 #include <time.h>
+#include <pthread.h>
 #include "flint.h"
 #include "memory-manager.h"
 #include "long_extras.h"
@@ -3309,6 +3310,117 @@ int test_F_mpz_multi_CRT_ui()
   return result;
 }
 
+#define F_MPZ_TEST_THREADS 4
+#define F_MPZ_TEST_VALS 100
+
+typedef struct
+{
+   F_mpz * vals; // F_mpz's allocated by the main thread, released by the worker
+	ulong seed;
+	int result;
+} F_mpz_thread_arg_t;
+
+void * F_mpz_test_thread(void * arg_void)
+{
+   F_mpz_thread_arg_t * arg = (F_mpz_thread_arg_t *) arg_void;
+	gmp_randstate_t state; // the global test randstate is not thread safe
+	F_mpz_t f, g, h;
+	mpz_t m1, m2, m3;
+	
+	gmp_randinit_default(state);
+	gmp_randseed_ui(state, arg->seed);
+	mpz_init(m1);
+	mpz_init(m2);
+	mpz_init(m3);
+	F_mpz_init(f);
+	F_mpz_init(g);
+	F_mpz_init(h);
+
+	for (ulong count1 = 0; (count1 < 20000*ITER) && (arg->result == 1); count1++)
+	{
+		mpz_rrandomb(m1, state, gmp_urandomm_ui(state, 200) + 1);
+		mpz_rrandomb(m2, state, gmp_urandomm_ui(state, 200) + 1);
+		if (gmp_urandomm_ui(state, 2)) mpz_neg(m1, m1);
+
+		F_mpz_set_mpz(f, m1);
+		F_mpz_set_mpz(g, m2);
+		F_mpz_mul2(h, f, g);
+		F_mpz_add(h, h, f);
+		
+		mpz_mul(m3, m1, m2);
+		mpz_add(m3, m3, m1);
+		F_mpz_get_mpz(m1, h);
+
+		arg->result = (mpz_cmp(m1, m3) == 0);
+		if (!arg->result)
+		{
+			gmp_printf("Error: m1 = %Zd, m3 = %Zd\n", m1, m3);
+		}
+	}
+	
+	// read and release values allocated in another thread's pool
+	for (ulong i = 0; (i < F_MPZ_TEST_VALS) && (arg->result == 1); i++)
+	{
+		F_mpz_get_mpz(m1, arg->vals + i);
+		mpz_set_ui(m2, i + 1);
+		mpz_mul_2exp(m2, m2, 100 + i);
+
+		arg->result = (mpz_cmp(m1, m2) == 0);
+		if (!arg->result)
+		{
+			gmp_printf("Error: m1 = %Zd, m2 = %Zd\n", m1, m2);
+		}
+		F_mpz_clear(arg->vals + i);
+	}
+
+	F_mpz_clear(f);
+	F_mpz_clear(g);
+	F_mpz_clear(h);
+	mpz_clear(m1);
+	mpz_clear(m2);
+	mpz_clear(m3);
+	gmp_randclear(state);
+
+	_F_mpz_cleanup_thread();
+
+	return NULL;
+}
+
+int test_F_mpz_threads()
+{
+   pthread_t threads[F_MPZ_TEST_THREADS];
+	F_mpz_thread_arg_t args[F_MPZ_TEST_THREADS];
+	int result = 1;
+
+	for (ulong count1 = 0; (count1 < 5*ITER) && (result == 1); count1++)
+	{
+		for (ulong t = 0; t < F_MPZ_TEST_THREADS; t++)
+		{
+			args[t].vals = (F_mpz *) flint_heap_alloc(F_MPZ_TEST_VALS);
+			for (ulong i = 0; i < F_MPZ_TEST_VALS; i++)
+			{
+				F_mpz_init(args[t].vals + i);
+				F_mpz_set_ui(args[t].vals + i, i + 1);
+				F_mpz_mul_2exp(args[t].vals + i, args[t].vals + i, 100 + i);
+			}
+			args[t].seed = z_randbits(FLINT_BITS);
+			args[t].result = 1;
+		}
+
+		for (ulong t = 0; t < F_MPZ_TEST_THREADS; t++)
+			pthread_create(threads + t, NULL, F_mpz_test_thread, args + t);
+
+		for (ulong t = 0; t < F_MPZ_TEST_THREADS; t++)
+		{
+			pthread_join(threads[t], NULL);
+			result &= args[t].result;
+			flint_heap_free(args[t].vals);
+		}
+	}
+
+	return result;
+}
+
 int test_F_mpz_pow_ui()
 {
    F_mpz_t f, g;
@@ -3441,6 +3553,7 @@ void F_mpz_poly_test_all()
    RUN_TEST(F_mpz_comb_init_clear); 
 	RUN_TEST(F_mpz_multi_CRT_ui_unsigned);
 	RUN_TEST(F_mpz_multi_CRT_ui);
+	RUN_TEST(F_mpz_threads);
 	
    printf(all_success ? "\nAll tests passed\n" :
                         "\nAt least one test FAILED!\n");
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <gmp.h>
 #include <mpfr.h>
 
@@ -46,68 +47,169 @@
 
 ================================================================================*/
 
-// The array of mpz's used by the F_mpz type
-__mpz_struct * F_mpz_arr;
+// The pools of mpz's used by the F_mpz type
+F_mpz_pool_struct * F_mpz_pools[F_MPZ_MAX_POOLS];
 
-// Total number of mpz's initialised in F_mpz_arr;
-ulong F_mpz_allocated;
+// Total number of pools created
+ulong F_mpz_num_pools;
 
-// An array of indices of mpz's which are not being used presently. These are stored with the second
-// most significant bit set so that they are a valid index as per the F_mpz_t type below.
-F_mpz * F_mpz_unused_arr;
+// Pools which are not presently owned by any thread
+F_mpz_pool_struct * F_mpz_idle_pools;
 
-// The number of mpz's not being used presently
-ulong F_mpz_num_unused;
+// Protects F_mpz_num_pools and F_mpz_idle_pools, only taken when a thread first needs a pool
+pthread_mutex_t F_mpz_pool_lock = PTHREAD_MUTEX_INITIALIZER;
 
-F_mpz _F_mpz_new_mpz(void)
+// The pool owned by the current thread
+static FLINT_TLS F_mpz_pool_struct * F_mpz_pool;
+
+/*
+   Attach the calling thread to an idle pool, or to a new pool if there are none.
+*/
+F_mpz_pool_struct * _F_mpz_pool_attach(void)
 {
-	if (!F_mpz_num_unused) // time to allocate MPZ_BLOCK more mpz_t's
+	F_mpz_pool_struct * pool;
+	
+	pthread_mutex_lock(&F_mpz_pool_lock);
+	
+	if (F_mpz_idle_pools) // reuse a pool released by a thread which has finished
 	{
-	   if (F_mpz_allocated) // realloc mpz_t's and unused array
-		{
-			F_mpz_arr = (__mpz_struct *) flint_heap_realloc_bytes(F_mpz_arr, (F_mpz_allocated + MPZ_BLOCK)*sizeof(__mpz_struct));
-			F_mpz_unused_arr = (F_mpz *) flint_heap_realloc_bytes(F_mpz_unused_arr, (F_mpz_allocated + MPZ_BLOCK)*sizeof(F_mpz));
-		} else // first time alloc of mpz_t's and unused array
+		pool = F_mpz_idle_pools;
+		F_mpz_idle_pools = pool->next;
+	} else
+	{
+		if (F_mpz_num_pools == F_MPZ_MAX_POOLS)
 		{
-			F_mpz_arr = (__mpz_struct*) flint_heap_alloc_bytes(MPZ_BLOCK*sizeof(__mpz_struct));	
-			F_mpz_unused_arr = (F_mpz *) flint_heap_alloc_bytes(MPZ_BLOCK*sizeof(F_mpz));
-		   F_mpz_num_unused = 0;
+			printf("Error: too many threads using F_mpz's in _F_mpz_new_mpz\n");
+			abort();
 		}
 		
-		// initialise the new mpz_t's and unused array
-		for (ulong i = 0; i < MPZ_BLOCK; i++)
-		{
-			mpz_init(F_mpz_arr + F_mpz_allocated + i);
-			F_mpz_unused_arr[F_mpz_num_unused] = OFF_TO_COEFF(F_mpz_allocated + i);
-         F_mpz_num_unused++;
-		}
-		F_mpz_allocated += MPZ_BLOCK;
-	   
-		F_mpz_num_unused--;
-	} else // unused mpz's are available
+		pool = (F_mpz_pool_struct *) flint_heap_alloc_bytes(sizeof(F_mpz_pool_struct));
+		memset(pool, 0, sizeof(F_mpz_pool_struct));
+		pool->num = F_mpz_num_pools;
+		F_mpz_pools[F_mpz_num_pools] = pool;
+		F_mpz_num_pools++;
+	}
+
+	pool->next = NULL;
+	
+	pthread_mutex_unlock(&F_mpz_pool_lock);
+
+	F_mpz_pool = pool;
+
+	return pool;
+}
+
+/*
+   Append a new block of mpz's to the pool, twice the size of the previous block.
+	Existing blocks are not moved.
+*/
+void _F_mpz_pool_grow(F_mpz_pool_struct * pool)
+{
+	ulong n = (MPZ_BLOCK<<pool->num_blocks);
+	
+	if (pool->num_blocks == F_MPZ_POOL_BLOCKS)
 	{
-		F_mpz_num_unused--;
+		printf("Error: too many mpz's allocated in _F_mpz_new_mpz\n");
+		abort();
+	}
+
+	if (pool->num_unused + n > pool->unused_alloc)
+	{
+		pool->unused_alloc = FLINT_MAX(pool->num_unused + n, 2*pool->unused_alloc);
+		if (pool->unused_arr)
+			pool->unused_arr = (F_mpz *) flint_heap_realloc_bytes(pool->unused_arr, pool->unused_alloc*sizeof(F_mpz));
+		else
+			pool->unused_arr = (F_mpz *) flint_heap_alloc_bytes(pool->unused_alloc*sizeof(F_mpz));
 	}
-	F_mpz ret = F_mpz_unused_arr[F_mpz_num_unused];
 	
-	return ret;
+	__mpz_struct * block = (__mpz_struct *) flint_heap_alloc_bytes(n*sizeof(__mpz_struct));
+	for (ulong i = 0; i < n; i++)
+		mpz_init(block + i);
+	
+	pool->blocks[pool->num_blocks] = block;
+	pool->num_blocks++;
+
+	// push the indices in reverse so that the lowest is handed out first
+	ulong base = (pool->num<<F_MPZ_POOL_OFF_BITS) + pool->allocated;
+	for (long i = n - 1; i >= 0; i--)
+	{
+		pool->unused_arr[pool->num_unused] = OFF_TO_COEFF(base + i);
+		pool->num_unused++;
+	}
+	
+	pool->allocated += n;
+}
+
+F_mpz _F_mpz_new_mpz(void)
+{
+	F_mpz_pool_struct * pool = F_mpz_pool;
+	
+	if (!pool) pool = _F_mpz_pool_attach();
+
+	if (!pool->num_unused) // time to allocate another block of mpz_t's
+		_F_mpz_pool_grow(pool);
+	
+	pool->num_unused--;
+	
+	return pool->unused_arr[pool->num_unused];
 }
 
 void _F_mpz_clear_mpz(F_mpz f)
 {
-   F_mpz_unused_arr[F_mpz_num_unused] = f;
-   F_mpz_num_unused++;	
+	F_mpz_pool_struct * pool = F_mpz_pool;
+	
+	if (!pool) pool = _F_mpz_pool_attach();
+
+	if (pool->num_unused == pool->unused_alloc) // mpz's from other pools have been released to this one
+	{
+		pool->unused_alloc = FLINT_MAX(2*pool->unused_alloc, MPZ_BLOCK);
+		if (pool->unused_arr)
+			pool->unused_arr = (F_mpz *) flint_heap_realloc_bytes(pool->unused_arr, pool->unused_alloc*sizeof(F_mpz));
+		else
+			pool->unused_arr = (F_mpz *) flint_heap_alloc_bytes(pool->unused_alloc*sizeof(F_mpz));
+	}
+   
+	pool->unused_arr[pool->num_unused] = f;
+   pool->num_unused++;	
+}
+
+void _F_mpz_cleanup_thread(void)
+{
+	F_mpz_pool_struct * pool = F_mpz_pool;
+
+	if (!pool) return;
+
+	pthread_mutex_lock(&F_mpz_pool_lock);
+	pool->next = F_mpz_idle_pools;
+	F_mpz_idle_pools = pool;
+	pthread_mutex_unlock(&F_mpz_pool_lock);
+
+	F_mpz_pool = NULL;
 }
 
 void _F_mpz_cleanup(void)
 {
-	for (long i = 0; i < F_mpz_num_unused; i++)
+	// unused mpz's may sit in any pool, so clear them all before freeing any block
+	for (ulong p = 0; p < F_mpz_num_pools; p++)
 	{
-		mpz_clear(F_mpz_arr + COEFF_TO_OFF(F_mpz_unused_arr[i]));
-   }
+		F_mpz_pool_struct * pool = F_mpz_pools[p];
+		for (ulong i = 0; i < pool->num_unused; i++)
+		   mpz_clear(COEFF_TO_PTR(pool->unused_arr[i]));
+	}
+
+	for (ulong p = 0; p < F_mpz_num_pools; p++)
+	{
+		F_mpz_pool_struct * pool = F_mpz_pools[p];
+		for (ulong b = 0; b < pool->num_blocks; b++)
+		   flint_heap_free(pool->blocks[b]);
+		if (pool->unused_alloc) flint_heap_free(pool->unused_arr);
+		flint_heap_free(pool);
+		F_mpz_pools[p] = NULL;
+	}
 	
-   if (F_mpz_num_unused) free(F_mpz_unused_arr);
-	if (F_mpz_allocated) free(F_mpz_arr);
+	F_mpz_num_pools = 0;
+	F_mpz_idle_pools = NULL;
+	F_mpz_pool = NULL;
 }
 
 /*===============================================================================
@@ -121,7 +223,7 @@ __mpz_struct * _F_mpz_promote(F_mpz_t f)
    if (!COEFF_IS_MPZ(*f)) *f = _F_mpz_new_mpz(); // f is small so promote it first
 	// if f is large already, just return the pointer
       
-   return F_mpz_arr + COEFF_TO_OFF(*f);
+   return COEFF_TO_PTR(*f);
 }
 
 __mpz_struct * _F_mpz_promote_val(F_mpz_t f)
@@ -130,16 +232,16 @@ __mpz_struct * _F_mpz_promote_val(F_mpz_t f)
 	if (!COEFF_IS_MPZ(c)) // f is small so promote it
 	{
 	   *f = _F_mpz_new_mpz();
-	   __mpz_struct * mpz_ptr = F_mpz_arr + COEFF_TO_OFF(*f);
+	   __mpz_struct * mpz_ptr = COEFF_TO_PTR(*f);
 		mpz_set_si(mpz_ptr, c);
 		return mpz_ptr;
 	} else // f is large already, just return the pointer
-      return F_mpz_arr + COEFF_TO_OFF(*f);
+      return COEFF_TO_PTR(*f);
 }
 
 void _F_mpz_demote_val(F_mpz_t f)
 {
-   __mpz_struct * mpz_ptr = F_mpz_arr + COEFF_TO_OFF(*f);
+   __mpz_struct * mpz_ptr = COEFF_TO_PTR(*f);
 
 	long size = mpz_ptr->_mp_size;
 	
@@ -179,7 +281,7 @@ void F_mpz_init2(F_mpz_t f, ulong limbs)
 	{
 		
 		*f = _F_mpz_new_mpz();
-		_mpz_realloc(F_mpz_arr + COEFF_TO_OFF(*f), limbs);
+		_mpz_realloc(COEFF_TO_PTR(*f), limbs);
 		
 		return;
 	} else 
@@ -303,7 +405,7 @@ long F_mpz_get_si(const F_mpz_t f)
 {
    if (!COEFF_IS_MPZ(*f)) return *f; // value is small
 	
-	long ret = mpz_get_si(F_mpz_arr + COEFF_TO_OFF(*f)); // value is large
+	long ret = mpz_get_si(COEFF_TO_PTR(*f)); // value is large
 	
 	return ret;
 }
@@ -316,7 +418,7 @@ ulong F_mpz_get_ui(const F_mpz_t f)
 		else return *f;
 	}
 	
-	ulong ret = mpz_get_ui(F_mpz_arr + COEFF_TO_OFF(*f)); // value is large
+	ulong ret = mpz_get_ui(COEFF_TO_PTR(*f)); // value is large
 	
 	return ret;
 }
@@ -327,7 +429,7 @@ void F_mpz_get_mpz(mpz_t x, const F_mpz_t f)
 	else 
 	{
 		
-		mpz_set(x, F_mpz_arr + COEFF_TO_OFF(*f)); // set x to large value
+		mpz_set(x, COEFF_TO_PTR(*f)); // set x to large value
 		
 	}	
 }
@@ -352,7 +454,7 @@ double F_mpz_get_d_2exp(long * exp, const F_mpz_t f)
    } else 
 	{
 		
-		double ret = mpz_get_d_2exp(exp, F_mpz_arr + COEFF_TO_OFF(d));
+		double ret = mpz_get_d_2exp(exp, COEFF_TO_PTR(d));
 		
 		return ret;
 	}
@@ -404,7 +506,7 @@ void F_mpz_get_mpfr(mpfr_t x, const F_mpz_t f)
       return;
    } else
    {
-      mpfr_set_z(x, F_mpz_arr + COEFF_TO_OFF(d), GMP_RNDN);
+      mpfr_set_z(x, COEFF_TO_PTR(d), GMP_RNDN);
       return;
    }
 }
@@ -429,7 +531,7 @@ void F_mpz_set_mpfr(F_mpz_t f, const mpfr_t x)
       return;
    } else // f is large
    {
-      mpfr_get_z(F_mpz_arr + COEFF_TO_OFF(d), x, GMP_RNDN);
+      mpfr_get_z(COEFF_TO_PTR(d), x, GMP_RNDN);
 
       _F_mpz_demote_val(f); // may actually be small
       return;
@@ -446,7 +548,7 @@ int F_mpz_set_mpfr_2exp(F_mpz_t f, const mpfr_t x)
       __mpz_struct * mpz_ptr = _F_mpz_promote(f);
       exp = mpfr_get_z_exp(mpz_ptr, x);
    } else
-      exp = mpfr_get_z_exp(F_mpz_arr + COEFF_TO_OFF(d), x);
+      exp = mpfr_get_z_exp(COEFF_TO_PTR(d), x);
    
    _F_mpz_demote_val(f); // x may have been small
       
@@ -492,6 +594,34 @@ ulong F_mpz_get_limbs(mp_limb_t * x, const F_mpz_t f)
 	return limbs;
 }
 
+void F_mpz_set_limbs_signed(F_mpz_t f, const mp_limb_t * x, const ulong limbs)
+{
+   if ((mp_limb_signed_t) x[limbs - 1] >= 0L) // x is nonnegative
+   {
+      ulong size = limbs;
+      while (size && !x[size - 1]) size--;
+      F_mpz_set_limbs(f, x, size);
+      return;
+   }
+
+   mp_limb_t * temp = (mp_limb_t *) flint_stack_alloc(limbs);
+   F_mpn_negate(temp, (mp_limb_t *) x, limbs);
+   
+   ulong size = limbs;
+   while (size && !temp[size - 1]) size--;
+   F_mpz_set_limbs(f, temp, size);
+   F_mpz_neg(f, f);
+   
+   flint_stack_release();
+}
+
+void F_mpz_get_limbs_signed(mp_limb_t * x, const F_mpz_t f, const ulong limbs)
+{
+   F_mpn_clear(x, limbs);
+   F_mpz_get_limbs(x, f);
+   if (F_mpz_sgn(f) < 0) F_mpn_negate(x, x, limbs);
+}
+
 void F_mpz_set(F_mpz_t f, const F_mpz_t g)
 {
 	if (f == g) return; // aliased inputs
@@ -506,7 +636,7 @@ void F_mpz_set(F_mpz_t f, const F_mpz_t g)
 	{
 	   
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f);
-		mpz_set(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(*g));
+		mpz_set(mpz_ptr, COEFF_TO_PTR(*g));
 		
 	}
 }
@@ -527,7 +657,7 @@ void F_mpz_swap(F_mpz_t f, F_mpz_t g)
 			F_mpz t = *f;
 			
 		   __mpz_struct * mpz_ptr = _F_mpz_promote(f);
-			mpz_set(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(*g));
+			mpz_set(mpz_ptr, COEFF_TO_PTR(*g));
 			_F_mpz_demote(g);
 			
          *g = t;
@@ -539,14 +669,14 @@ void F_mpz_swap(F_mpz_t f, F_mpz_t g)
          F_mpz t = *g;
 			
 		   __mpz_struct * mpz_ptr = _F_mpz_promote(g);
-			mpz_set(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(*f));
+			mpz_set(mpz_ptr, COEFF_TO_PTR(*f));
 			_F_mpz_demote(f);
 			
          *f = t;
 		} else // both values are large
 		{
 			
-		   mpz_swap(F_mpz_arr + COEFF_TO_OFF(*f), F_mpz_arr + COEFF_TO_OFF(*g));
+		   mpz_swap(COEFF_TO_PTR(*f), COEFF_TO_PTR(*g));
 			
 		}
 	}
@@ -567,7 +697,7 @@ int F_mpz_equal(const F_mpz_t f, const F_mpz_t g)
 	else 
 	{
 		
-		int ret = (mpz_cmp(F_mpz_arr + COEFF_TO_OFF(*f), F_mpz_arr + COEFF_TO_OFF(*g)) == 0); 
+		int ret = (mpz_cmp(COEFF_TO_PTR(*f), COEFF_TO_PTR(*g)) == 0); 
 		
 		return ret;
 	}
@@ -590,7 +720,7 @@ int F_mpz_cmpabs(const F_mpz_t f, const F_mpz_t g)
 	else 
 	{
 		
-		int ret = mpz_cmpabs(F_mpz_arr + COEFF_TO_OFF(*f), F_mpz_arr + COEFF_TO_OFF(*g)); 
+		int ret = mpz_cmpabs(COEFF_TO_PTR(*f), COEFF_TO_PTR(*g)); 
 		
 		return ret;
 	}
@@ -610,7 +740,7 @@ int F_mpz_cmp(const F_mpz_t f, const F_mpz_t g)
 		{
 			int ret = -1;
 			
-		   if (mpz_sgn(F_mpz_arr + COEFF_TO_OFF(*g)) < 0) ret = 1; // g is a large negative 
+		   if (mpz_sgn(COEFF_TO_PTR(*g)) < 0) ret = 1; // g is a large negative 
 			
 			return ret; // g is a large positive
 		}
@@ -618,13 +748,13 @@ int F_mpz_cmp(const F_mpz_t f, const F_mpz_t g)
 	{
 		int ret = 1;
 		
-		if (mpz_sgn(F_mpz_arr + COEFF_TO_OFF(*f)) < 0) ret = -1; // f is large negative
+		if (mpz_sgn(COEFF_TO_PTR(*f)) < 0) ret = -1; // f is large negative
 		
 		return ret; // f is large positive
 	} else // both f and g are large 
 	{
 		
-		int ret = mpz_cmp(F_mpz_arr + COEFF_TO_OFF(*f), F_mpz_arr + COEFF_TO_OFF(*g)); 
+		int ret = mpz_cmp(COEFF_TO_PTR(*f), COEFF_TO_PTR(*g)); 
 		
 		return ret;
 	}
@@ -647,7 +777,7 @@ ulong F_mpz_size(const F_mpz_t f)
 	}
 
 	
-   ulong ret = mpz_size(F_mpz_arr + COEFF_TO_OFF(d));
+   ulong ret = mpz_size(COEFF_TO_PTR(d));
 	
 	return ret;
 }
@@ -664,7 +794,7 @@ int F_mpz_sgn(const F_mpz_t f)
 	}
 
 	
-   int ret = mpz_sgn(F_mpz_arr + COEFF_TO_OFF(d));
+   int ret = mpz_sgn(COEFF_TO_PTR(d));
 	
 	return ret;
 }
@@ -679,14 +809,14 @@ ulong F_mpz_bits(const F_mpz_t f)
 	}
 
 	
-   ulong ret = mpz_sizeinbase(F_mpz_arr + COEFF_TO_OFF(d), 2);
+   ulong ret = mpz_sizeinbase(COEFF_TO_PTR(d), 2);
 	
 	return ret;
 }
 
 __mpz_struct * F_mpz_ptr_mpz(F_mpz f)
 {
-	return F_mpz_arr + COEFF_TO_OFF(f);
+	return COEFF_TO_PTR(f);
 }
 
 /*===============================================================================
@@ -733,7 +863,7 @@ void F_mpz_neg(F_mpz_t f1, const F_mpz_t f2)
 	   // No need to retain value in promotion, as if aliased, both already large
 		
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f1);
-		mpz_neg(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(*f2));
+		mpz_neg(mpz_ptr, COEFF_TO_PTR(*f2));
 		
 	}
 }
@@ -752,7 +882,7 @@ void F_mpz_abs(F_mpz_t f1, const F_mpz_t f2)
 	   // No need to retain value in promotion, as if aliased, both already large
 		
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f1);
-		mpz_abs(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(*f2));
+		mpz_abs(mpz_ptr, COEFF_TO_PTR(*f2));
 		
 	}
 }
@@ -771,7 +901,7 @@ void F_mpz_add(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
          
 		   __mpz_struct * mpz3 = _F_mpz_promote(f); // g is saved and h is large
-			__mpz_struct * mpz2 = F_mpz_arr + COEFF_TO_OFF(c2);
+			__mpz_struct * mpz2 = COEFF_TO_PTR(c2);
 			if (c1 < 0L) mpz_sub_ui(mpz3, mpz2, -c1);	
 		   else mpz_add_ui(mpz3, mpz2, c1);
 			_F_mpz_demote_val(f); // may have cancelled
@@ -783,7 +913,7 @@ void F_mpz_add(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
          
 		   __mpz_struct * mpz3 = _F_mpz_promote(f); // h is saved and g is large
-			__mpz_struct * mpz1 = F_mpz_arr + COEFF_TO_OFF(c1);
+			__mpz_struct * mpz1 = COEFF_TO_PTR(c1);
 			if (c2 < 0L) mpz_sub_ui(mpz3, mpz1, -c2);	
 			else mpz_add_ui(mpz3, mpz1, c2);
 			_F_mpz_demote_val(f); // may have cancelled
@@ -792,8 +922,8 @@ void F_mpz_add(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
          
 		   __mpz_struct * mpz3 = _F_mpz_promote(f); // aliasing means f is already large
-			__mpz_struct * mpz1 = F_mpz_arr + COEFF_TO_OFF(c1);
-			__mpz_struct * mpz2 = F_mpz_arr + COEFF_TO_OFF(c2);
+			__mpz_struct * mpz1 = COEFF_TO_PTR(c1);
+			__mpz_struct * mpz2 = COEFF_TO_PTR(c2);
 			mpz_add(mpz3, mpz1, mpz2);
 			_F_mpz_demote_val(f); // may have cancelled
 			
@@ -817,7 +947,7 @@ void F_mpz_add_mpz(F_mpz_t f, const F_mpz_t g, mpz_t h)
 	{
 		
 		__mpz_struct * mpz3 = _F_mpz_promote(f); // aliasing means f is already large
-		__mpz_struct * mpz1 = F_mpz_arr + COEFF_TO_OFF(c1);
+		__mpz_struct * mpz1 = COEFF_TO_PTR(c1);
 		mpz_add(mpz3, mpz1, h);
 		_F_mpz_demote_val(f); // may have cancelled
 		
@@ -838,7 +968,7 @@ void F_mpz_sub(F_mpz_t f, const F_mpz_t g, F_mpz_t h)
 		{
          
 		   __mpz_struct * mpz3 = _F_mpz_promote(f); // g is saved and h is large
-			__mpz_struct * mpz2 = F_mpz_arr + COEFF_TO_OFF(c2);
+			__mpz_struct * mpz2 = COEFF_TO_PTR(c2);
 			if (c1 < 0L) 
 			{
 				mpz_add_ui(mpz3, mpz2, -c1);
@@ -853,7 +983,7 @@ void F_mpz_sub(F_mpz_t f, const F_mpz_t g, F_mpz_t h)
 		{
          
 		   __mpz_struct * mpz3 = _F_mpz_promote(f); // h is saved and g is large
-			__mpz_struct * mpz1 = F_mpz_arr + COEFF_TO_OFF(c1);
+			__mpz_struct * mpz1 = COEFF_TO_PTR(c1);
 			if (c2 < 0L) mpz_add_ui(mpz3, mpz1, -c2);	
 			else mpz_sub_ui(mpz3, mpz1, c2);
 			_F_mpz_demote_val(f); // may have cancelled
@@ -862,8 +992,8 @@ void F_mpz_sub(F_mpz_t f, const F_mpz_t g, F_mpz_t h)
 		{
          
 		   __mpz_struct * mpz3 = _F_mpz_promote(f); // aliasing means f is already large
-			__mpz_struct * mpz1 = F_mpz_arr + COEFF_TO_OFF(c1);
-			__mpz_struct * mpz2 = F_mpz_arr + COEFF_TO_OFF(c2);
+			__mpz_struct * mpz1 = COEFF_TO_PTR(c1);
+			__mpz_struct * mpz2 = COEFF_TO_PTR(c2);
 			mpz_sub(mpz3, mpz1, mpz2);
 			_F_mpz_demote_val(f); // may have cancelled
 			
@@ -903,7 +1033,7 @@ void F_mpz_mul_ui(F_mpz_t f, const F_mpz_t g, const ulong x)
 	{
       
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f); // promote without val as if aliased both are large
-      mpz_mul_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c2), x);
+      mpz_mul_ui(mpz_ptr, COEFF_TO_PTR(c2), x);
 		
 	}
 }
@@ -941,7 +1071,7 @@ void F_mpz_mul_si(F_mpz_t f, const F_mpz_t g, const long x)
 	{
       
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f); // ok without val as if aliased both are large
-      mpz_mul_si(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c2), x);
+      mpz_mul_si(mpz_ptr, COEFF_TO_PTR(c2), x);
 		
 	}
 }
@@ -968,9 +1098,9 @@ void F_mpz_mul2(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
    __mpz_struct * mpz_ptr = _F_mpz_promote(f); // h is saved, g is already large
 		
 	if (!COEFF_IS_MPZ(c2)) // g is large, h is small
-	   mpz_mul_si(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), c2);
+	   mpz_mul_si(mpz_ptr, COEFF_TO_PTR(c1), c2);
    else // c1 and c2 are large
-	   F_mpz_mul(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+	   F_mpz_mul(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 	
 }
 
@@ -1003,7 +1133,7 @@ void F_mpz_mul_2exp(F_mpz_t f, const F_mpz_t g, const ulong exp)
 	{
       
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f); // g is already large
-      mpz_mul_2exp(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(d), exp);   
+      mpz_mul_2exp(mpz_ptr, COEFF_TO_PTR(d), exp);   
 		
 	}
 }
@@ -1019,7 +1149,7 @@ void F_mpz_div_2exp(F_mpz_t f, const F_mpz_t g, const ulong exp)
 	{
       
 		__mpz_struct * mpz_ptr = _F_mpz_promote(f); // g is already large
-		mpz_div_2exp(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(d), exp);   
+		mpz_div_2exp(mpz_ptr, COEFF_TO_PTR(d), exp);   
 		_F_mpz_demote_val(f); // division may make value small
 		
 	}
@@ -1055,7 +1185,7 @@ void F_mpz_add_ui(F_mpz_t f, const F_mpz_t g, const ulong x)
 	{
 		
 		__mpz_struct * mpz_ptr2 = _F_mpz_promote(f); // g is already large
-		__mpz_struct * mpz_ptr = F_mpz_arr + COEFF_TO_OFF(c);
+		__mpz_struct * mpz_ptr = COEFF_TO_PTR(c);
 		mpz_add_ui(mpz_ptr2, mpz_ptr, x);
 		_F_mpz_demote_val(f); // cancellation may have occurred
 		
@@ -1099,7 +1229,7 @@ void F_mpz_sub_ui(F_mpz_t f, const F_mpz_t g, const ulong x)
 	{
 		
 		__mpz_struct * mpz_ptr2 = _F_mpz_promote(f); // g is already large
-		__mpz_struct * mpz_ptr = F_mpz_arr + COEFF_TO_OFF(c);
+		__mpz_struct * mpz_ptr = COEFF_TO_PTR(c);
 		mpz_sub_ui(mpz_ptr2, mpz_ptr, x);
 		_F_mpz_demote_val(f); // cancellation may have occurred
 		
@@ -1160,7 +1290,7 @@ void F_mpz_addmul_ui(F_mpz_t f, const F_mpz_t g, const ulong x)
       
 		__mpz_struct * mpz_ptr = _F_mpz_promote_val(f);
 		
-      mpz_addmul_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), x);
+      mpz_addmul_ui(mpz_ptr, COEFF_TO_PTR(c1), x);
 		_F_mpz_demote_val(f); // cancellation may have occurred
 		
 	}
@@ -1220,7 +1350,7 @@ void F_mpz_submul_ui(F_mpz_t f, const F_mpz_t g, const ulong x)
       
 		__mpz_struct * mpz_ptr = _F_mpz_promote_val(f);
 		
-      mpz_submul_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), x);
+      mpz_submul_ui(mpz_ptr, COEFF_TO_PTR(c1), x);
 		_F_mpz_demote_val(f); // cancellation may have occurred
 		
 	}
@@ -1250,7 +1380,7 @@ void F_mpz_addmul(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
    
    __mpz_struct * mpz_ptr = _F_mpz_promote_val(f);
 	
-   mpz_addmul(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+   mpz_addmul(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 	_F_mpz_demote_val(f); // cancellation may have occurred	
 }
 
@@ -1278,7 +1408,7 @@ void F_mpz_submul(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
    
 	__mpz_struct * mpz_ptr = _F_mpz_promote_val(f);
 	
-   mpz_submul(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+   mpz_submul(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 	_F_mpz_demote_val(f); // cancellation may have occurred
 	
 }
@@ -1314,7 +1444,7 @@ void F_mpz_pow_ui(F_mpz_t f, const F_mpz_t g, const ulong exp)
    {
 	   __mpz_struct * mpz_ptr = _F_mpz_promote_val(f);
       
-      mpz_pow_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), exp);
+      mpz_pow_ui(mpz_ptr, COEFF_TO_PTR(c1), exp);
       // no need to demote as it can't get smaller
    }
 }
@@ -1337,7 +1467,7 @@ ulong F_mpz_mod_ui(F_mpz_t f, const F_mpz_t g, const ulong h)
 	} else // g is large
 	{
 		
-		r = mpz_fdiv_ui(F_mpz_arr + COEFF_TO_OFF(c1), h);
+		r = mpz_fdiv_ui(COEFF_TO_PTR(c1), h);
 		
 		F_mpz_set_ui(f, r);
 		return r;
@@ -1375,11 +1505,11 @@ void F_mpz_mod(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 	{
       if (!COEFF_IS_MPZ(c2)) // h is small
 		{
-			if (c2 < 0L) F_mpz_set_si(f, mpz_fdiv_ui(F_mpz_arr + COEFF_TO_OFF(c1), -c2));
+			if (c2 < 0L) F_mpz_set_si(f, mpz_fdiv_ui(COEFF_TO_PTR(c1), -c2));
 			else 
 			{
 				
-				ulong r = mpz_fdiv_ui(F_mpz_arr + COEFF_TO_OFF(c1), c2);
+				ulong r = mpz_fdiv_ui(COEFF_TO_PTR(c1), c2);
 				
 				F_mpz_set_ui(f, r);
 			}
@@ -1387,7 +1517,7 @@ void F_mpz_mod(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
 			
 			__mpz_struct * mpz_ptr = _F_mpz_promote(f);
-			mpz_mod(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+			mpz_mod(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(f); // reduction mod h may result in small value
 			
 		}	
@@ -1420,7 +1550,7 @@ void F_mpz_gcd(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
       {
          __mpz_struct * mpz_ptr = _F_mpz_promote(f); // aliasing fine as g, h already large
 
-         mpz_gcd(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+         mpz_gcd(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
          _F_mpz_demote_val(f); // gcd may be small
       }
    }
@@ -1461,7 +1591,7 @@ int F_mpz_invert(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 			}
 			
 			__mpz_struct * mpz_ptr = _F_mpz_promote(f);
-			val = mpz_invert(mpz_ptr, &temp, F_mpz_arr + COEFF_TO_OFF(c2));
+			val = mpz_invert(mpz_ptr, &temp, COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(f); // inverse mod h may result in small value
 			
 			return val;
@@ -1475,7 +1605,7 @@ int F_mpz_invert(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 			if (c2 == 1L) return 0; // special case not handled by z_gcd_invert
 			// reduce g mod h first
 			
-			ulong r = mpz_fdiv_ui(F_mpz_arr + COEFF_TO_OFF(c1), c2);
+			ulong r = mpz_fdiv_ui(COEFF_TO_PTR(c1), c2);
 			
 			long gcd = z_gcd_invert(&inv, r, c2);
 			if (gcd == 1L) 
@@ -1487,7 +1617,7 @@ int F_mpz_invert(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
 			
 			__mpz_struct * mpz_ptr = _F_mpz_promote(f);
-			val = mpz_invert(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+			val = mpz_invert(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(f); // reduction mod h may result in small value
 			
 			return val;
@@ -1512,19 +1642,19 @@ void F_mpz_divexact(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
 		   if (c2 > 0) // h > 0
 			{
-            mpz_divexact_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), c2);
+            mpz_divexact_ui(mpz_ptr, COEFF_TO_PTR(c1), c2);
 			   _F_mpz_demote_val(f); // division by h may result in small value
 				
 			} else
 			{
-            mpz_divexact_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), -c2);
+            mpz_divexact_ui(mpz_ptr, COEFF_TO_PTR(c1), -c2);
 			   _F_mpz_demote_val(f); // division by h may result in small value
 				
 				F_mpz_neg(f, f);
 			}
 		} else // both are large
 		{
-			mpz_divexact(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+			mpz_divexact(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(f); // division by h may result in small value
 			
 		}	
@@ -1565,19 +1695,19 @@ void F_mpz_cdiv_q(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
 		   if (c2 > 0) // h > 0
 			{
-            mpz_cdiv_q_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), c2);
+            mpz_cdiv_q_ui(mpz_ptr, COEFF_TO_PTR(c1), c2);
 			   _F_mpz_demote_val(f); // division by h may result in small value
 				
 			} else
 			{
-            mpz_fdiv_q_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), -c2);
+            mpz_fdiv_q_ui(mpz_ptr, COEFF_TO_PTR(c1), -c2);
 			   _F_mpz_demote_val(f); // division by h may result in small value
 				
 				F_mpz_neg(f, f);
 			}
 		} else // both are large
 		{
-			mpz_cdiv_q(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+			mpz_cdiv_q(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(f); // division by h may result in small value
 			
 		}	
@@ -1618,19 +1748,19 @@ void F_mpz_fdiv_q(F_mpz_t f, const F_mpz_t g, const F_mpz_t h)
 		{
 		   if (c2 > 0) // h > 0
 			{
-            mpz_fdiv_q_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), c2);
+            mpz_fdiv_q_ui(mpz_ptr, COEFF_TO_PTR(c1), c2);
 			   _F_mpz_demote_val(f); // division by h may result in small value
 				
 			} else
 			{
-            mpz_cdiv_q_ui(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), -c2);
+            mpz_cdiv_q_ui(mpz_ptr, COEFF_TO_PTR(c1), -c2);
 			   _F_mpz_demote_val(f); // division by h may result in small value
 				
 				F_mpz_neg(f, f);
 			}
 		} else // both are large
 		{
-			mpz_fdiv_q(mpz_ptr, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+			mpz_fdiv_q(mpz_ptr, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(f); // division by h may result in small value
 			
 		}	
@@ -1695,12 +1825,12 @@ void F_mpz_fdiv_qr(F_mpz_t q, F_mpz_t r, const F_mpz_t g, const F_mpz_t h)
 		{
 		   if (c2 > 0) // h > 0
 			{
-            cr = mpz_fdiv_qr_ui(mpz_ptr, &temp, F_mpz_arr + COEFF_TO_OFF(c1), c2);
+            cr = mpz_fdiv_qr_ui(mpz_ptr, &temp, COEFF_TO_PTR(c1), c2);
 			   _F_mpz_demote_val(q); // division by h may result in small value
 				F_mpz_set_ui(r, cr);
 			} else
 			{
-            cr = mpz_cdiv_qr_ui(mpz_ptr, &temp, F_mpz_arr + COEFF_TO_OFF(c1), -c2);
+            cr = mpz_cdiv_qr_ui(mpz_ptr, &temp, COEFF_TO_PTR(c1), -c2);
 			   _F_mpz_demote_val(q); // division by h may result in small value
 				
 				F_mpz_neg(q, q);
@@ -1709,7 +1839,7 @@ void F_mpz_fdiv_qr(F_mpz_t q, F_mpz_t r, const F_mpz_t g, const F_mpz_t h)
 		} else // both are large
 		{
 			__mpz_struct * mpz_ptr2 = _F_mpz_promote(r);
-         mpz_fdiv_qr(mpz_ptr, mpz_ptr2, F_mpz_arr + COEFF_TO_OFF(c1), F_mpz_arr + COEFF_TO_OFF(c2));
+         mpz_fdiv_qr(mpz_ptr, mpz_ptr2, COEFF_TO_PTR(c1), COEFF_TO_PTR(c2));
 			_F_mpz_demote_val(q); // division by h may result in small value
 			_F_mpz_demote_val(r); // r in fact may be a small value
 		}	
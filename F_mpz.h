@@ -46,12 +46,32 @@
 	The F_mpz_t is a signed integer of FLINT_BITS-2 bits, sign extended to FLINT_BITS bits, unless the most 
 	significant bit is zero and the second most significant bit is 1, in which case the bottom FLINT_BITS-2
 	bits are an index into the array F_mpz_arr of mpz's.
+
+	The "array" F_mpz_arr is split into pools, one per thread that uses F_mpz's. The top 
+	F_MPZ_POOL_BITS bits of the index give the pool, the remaining bits an offset into that pool.
+	A pool consists of blocks of MPZ_BLOCK, 2*MPZ_BLOCK, 4*MPZ_BLOCK, ... mpz's, which are never
+	moved once allocated, so an index remains valid (in any thread) for as long as it is in use.
 */
 
 typedef long F_mpz;
 typedef F_mpz F_mpz_t[1];
 
-#define MPZ_BLOCK 10 // number of additional mpz_t's to initialise at a time
+#define MPZ_BLOCK_BITS 4
+#define MPZ_BLOCK (1L<<MPZ_BLOCK_BITS) // number of mpz_t's in the first block of each pool
+
+#if FLINT_BITS == 64
+#define F_MPZ_POOL_BITS 10 // at most 2^F_MPZ_POOL_BITS threads can use F_mpz's at once
+#else
+#define F_MPZ_POOL_BITS 5
+#endif
+
+#define F_MPZ_MAX_POOLS (1L<<F_MPZ_POOL_BITS)
+
+// number of bits of an index giving the offset within a pool
+#define F_MPZ_POOL_OFF_BITS (FLINT_BITS - 2 - F_MPZ_POOL_BITS)
+
+// maximum number of blocks in a pool
+#define F_MPZ_POOL_BLOCKS (F_MPZ_POOL_OFF_BITS - MPZ_BLOCK_BITS)
 
 // maximum positive value a small coefficient can have
 #define COEFF_MAX ((1L<<(FLINT_BITS-2))-1L)
@@ -67,6 +87,37 @@ typedef F_mpz F_mpz_t[1];
 
 #define COEFF_IS_MPZ(xxx) ((xxx>>(FLINT_BITS-2)) == 1L) // is xxx an index into F_mpz_arr?
 
+// returns a pointer to the mpz_t that the F_mpz_t style index xxx refers to
+#define COEFF_TO_PTR(xxx) _F_mpz_off_to_ptr(COEFF_TO_OFF(xxx))
+
+typedef struct F_mpz_pool_s
+{
+   __mpz_struct * blocks[F_MPZ_POOL_BLOCKS]; // block i contains MPZ_BLOCK*2^i mpz's
+   ulong num_blocks; 
+   ulong allocated; // total number of mpz's initialised in this pool
+   F_mpz * unused_arr; // indices of mpz's which are not in use, possibly from other pools
+   ulong num_unused;
+   ulong unused_alloc;
+   ulong num; // the number of the pool, i.e. the top F_MPZ_POOL_BITS bits of its indices
+   struct F_mpz_pool_s * next; // next pool in the list of pools not owned by any thread
+} F_mpz_pool_struct;
+
+// The pools of mpz's used by the F_mpz type, indexed by pool number
+extern F_mpz_pool_struct * F_mpz_pools[F_MPZ_MAX_POOLS];
+
+/*
+   Returns a pointer to the mpz_t at the given offset in F_mpz_arr. 
+*/
+static inline
+__mpz_struct * _F_mpz_off_to_ptr(ulong off)
+{
+   F_mpz_pool_struct * pool = F_mpz_pools[off >> F_MPZ_POOL_OFF_BITS];
+	ulong i = (off & ((1L<<F_MPZ_POOL_OFF_BITS) - 1L)) + MPZ_BLOCK;
+	ulong b = FLINT_BIT_COUNT(i) - MPZ_BLOCK_BITS - 1; 
+
+	return pool->blocks[b] + (i - (MPZ_BLOCK<<b));
+}
+
 static gmp_randstate_t F_mpz_state; // Used for random generation in F_mpz_randomm only
 
 typedef struct
@@ -91,23 +142,34 @@ typedef F_mpz_comb_struct F_mpz_comb_t[1];
  
 /** 
    \fn     F_mpz_t _F_mpz_new_mpz(void)
-   \brief  Return a new mpz F_mpz_t. The mpz_t's are allocated and initialised
-	        in blocks of size MPZ_BLOCK. 
+   \brief  Return a new mpz F_mpz_t from the calling thread's pool. The mpz_t's are 
+	        allocated and initialised in blocks, the first of size MPZ_BLOCK, each
+			  subsequent block being twice the size of the previous one. 
 */
 F_mpz _F_mpz_new_mpz(void);
 
 /** 
    \fn     void _F_mpz_clear_mpz(F_mpz_t f)
-   \brief  Release the mpz associated to f to the array of unused mpz's. 
-	        Assumes f actually represents an mpz.
+   \brief  Release the mpz associated to f to the calling thread's array of unused 
+	        mpz's. Assumes f actually represents an mpz. The mpz need not have been
+			  allocated by the calling thread.
 */
 void _F_mpz_clear_mpz(F_mpz f);
 
+/** 
+   \fn     void _F_mpz_cleanup_thread(void)
+   \brief  Detach the calling thread from its pool of mpz's. The pool is kept, along
+	        with its unused mpz's, and handed to the next thread which needs one. 
+			  Should be called by worker threads before they exit.
+*/
+void _F_mpz_cleanup_thread(void);
+
 /** 
    \fn     void _F_mpz_cleanup(void)
    \brief  Clear any mpz's still held onto by the F_mpz_t memory management
            and free all structures used to manage F_mpz allocations. Should 
-		   only be called at the end of a program.
+		   only be called at the end of a program, once no other threads are
+			using F_mpz's.
 */
 void _F_mpz_cleanup(void);
 
@@ -307,6 +369,20 @@ void F_mpz_set_limbs(F_mpz_t f, const mp_limb_t * x, const ulong limbs);
 */
 ulong F_mpz_get_limbs(mp_limb_t * x, const F_mpz_t f);
 
+/** 
+   \fn     void F_mpz_set_limbs_signed(F_mpz_t f, const mp_limb_t * x, const ulong limbs)
+   \brief  Sets f to the signed integer stored in two's complement in the 
+	        given number of limbs at x, least significant limb first.
+*/
+void F_mpz_set_limbs_signed(F_mpz_t f, const mp_limb_t * x, const ulong limbs);
+
+/** 
+   \fn     void F_mpz_get_limbs_signed(mp_limb_t * x, const F_mpz_t f, const ulong limbs)
+   \brief  Stores f in two's complement in the given number of limbs at x, 
+	        least significant limb first. It is assumed that f fits.
+*/
+void F_mpz_get_limbs_signed(mp_limb_t * x, const F_mpz_t f, const ulong limbs);
+
 /** 
    \fn     void F_mpz_set(F_mpz_t f, F_mpz_t g)
    \brief  Sets f to the value of g. 
@@ -32,6 +32,7 @@
 #include "F_mpz.h"
 #include "F_mpz_mat.h"
 #include "F_mpz_LLL_fast_d.h"
+#include "F_mpz_LLL_heuristic_mpfr.h"
 #include "test-support.h"
 
 /* 
@@ -303,8 +304,8 @@ int main(int argc, char *argv[])
 {
    gmp_randinit_default(F_mpz_state);
    
-   int d = 0, i, j, n, bits, bits2 = 0, decal;
-   double alpha;
+   int d = 0, i, j, n, bits, bits2 = 0, decal, ladder = 0, rec = 0;
+   double alpha, ctt, halfplus;
    F_mpz_mat_t B;
    char c = 0;
    argc = argc;
@@ -332,7 +333,17 @@ int main(int argc, char *argv[])
       decal+=2;
    }
 
-   onedothalfplus = 1.0+halfplus;
+   if (strcmp(argv[decal],"-auto")==0)
+   {
+      ladder = 1;
+      decal++;
+   }
+
+   if (strcmp(argv[decal],"-rec")==0)
+   {
+      rec = 1;
+      decal++;
+   }
 
    if ((ctt >=1.0 ) || (ctt <=0.25) || (halfplus <=0.5) || (halfplus>=sqrt(ctt)))
    {
@@ -440,7 +451,9 @@ int main(int argc, char *argv[])
    }  */
     
    F_mpz_mat_print(B); printf("\n");
-   LLL(B);
+   if (rec) F_mpz_mat_LLL_recursive(B);
+   else if (ladder) F_mpz_mat_LLL_auto(B);
+   else LLL(B);
    F_mpz_mat_print(B); printf("\n");
    
    F_mpz_mat_clear(B);
@@ -44,10 +44,9 @@
 #include "flint.h"
 #include "F_mpz_mat.h"
 #include "F_mpz_LLL_fast_d.h"
+#include "F_mpz_LLL_heuristic_mpfr.h"
 #include "d_mat.h"
 
-#define LOOPS_BABAI 10
-
 /* Computes the largest number of non-zero entries after the diagonal. */
 
 ulong getShift(F_mpz_mat_t B)
@@ -81,64 +80,47 @@ ulong getShift(F_mpz_mat_t B)
 	Updates B(kappa).
    
 	The algorithm is the iterative Babai algorithm of the paper.
+
+   Returns 0 if the size reduction stalls, i.e. the precision is 
+   insufficient, otherwise returns 1.
 */
 
-void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
+int Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
        double **appB, int *expo, double **appSP, 
-       int a, int zeros, int kappamax, int n)
+       int a, int zeros, int kappamax, int n, double halfplus)
 {
    int i, j, k, test, aa, exponent;
    signed long xx;
-   double tmp, rtmp;
+   int stalls = 0, min_expo = expo[kappa];
+   double tmp;
    
    aa = (a > zeros) ? a : zeros + 1;
   
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double onedothalfplus = 1.0 + halfplus;
 
 
    do
    {
       test = 0;
       
-#ifdef DEBUG
-      if (loops++ > LOOPS_BABAI) 
-      {
-	      printf("INFINITE LOOP?\n"); 
-	      abort();
-      }
-#endif 
-      
       /* ************************************** */
       /* Step2: compute the GSO for stage kappa */
       /* ************************************** */
       
       for (j = aa; j < kappa; j++)
-	   {	  
-	      if (appSP[kappa][j] != appSP[kappa][j]) // if appSP[kappa][j] == NAN
-	      {
-	         appSP[kappa][j] = d_vec_scalar_product(appB[kappa], appB[j], n);
-	      }
-	  	  
-         if (j > zeros + 2)
-	      {
-	         tmp = mu[j][zeros+1] * r[kappa][zeros+1];
-	         rtmp = appSP[kappa][j] - tmp;
-	         for (k = zeros + 2; k < j - 1; k++)
-		      {
-		         tmp = mu[j][k] * r[kappa][k];
-		         rtmp = rtmp - tmp;
-		      }
-	         tmp = mu[j][j-1] * r[kappa][j-1];
-	         r[kappa][j] = rtmp - tmp;
-         } else if (j == zeros+2)
-	      {
-	         tmp = mu[j][zeros+1] * r[kappa][zeros+1];
-	         r[kappa][j] = appSP[kappa][j] - tmp;
-	      } else r[kappa][j] = appSP[kappa][j];
-
-	      mu[kappa][j] = r[kappa][j] / r[j][j];
+      {
+         if (appSP[kappa][j] != appSP[kappa][j]) // if appSP[kappa][j] == NAN
+         {
+            appSP[kappa][j] = d_vec_scalar_product(appB[kappa], appB[j], n);
+         }
+         
+         if (j > zeros + 1)
+            r[kappa][j] = appSP[kappa][j] - d_vec_scalar_product(mu[j] + zeros + 1, 
+                                                 r[kappa] + zeros + 1, j - zeros - 1);
+         else 
+            r[kappa][j] = appSP[kappa][j];
+
+         mu[kappa][j] = r[kappa][j] / r[j][j];
       }
       
       /* **************************** */
@@ -162,21 +144,13 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
 		      {		  
 		         if (mu[kappa][j] >= 0)   /* in this case, X is 1 */
                {
-		            for (k = zeros + 1; k < j; k++)
-			         {
-			            tmp = ldexp (mu[j][k], exponent);
-			            mu[kappa][k] =  mu[kappa][k] - tmp; 
-			         }
+		            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, 1.0, exponent, j - zeros - 1);
 		      
 		            F_mpz_mat_row_sub(B, kappa, B, kappa, B, j, 0, n);
 		  
 		         } else          /* otherwise X is -1 */ 
                {
-                  for (k=zeros+1; k<j; k++)
-			         {
-			            tmp = ldexp (mu[j][k], exponent);
-			            mu[kappa][k] = mu[kappa][k] + tmp;
-			         }
+                  d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, -1.0, exponent, j - zeros - 1);
 		      
                   F_mpz_mat_row_add(B, kappa, B, kappa, B, j, 0, n); 
                }
@@ -188,12 +162,7 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
 		         {
 		            tmp = rint (tmp); 
 		      
-		            for (k = zeros + 1; k < j; k++)
-			         {
-			            rtmp = tmp * mu[j][k];
-			            rtmp = ldexp (rtmp, exponent);
-			            mu[kappa][k] = mu[kappa][k] - rtmp;
-			         }
+		            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, tmp, exponent, j - zeros - 1);
 
 		            xx = (long) tmp;
 		      
@@ -225,12 +194,7 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
                         F_mpz_mat_row_addmul_ui(B, kappa, B, j, 0, n, -xx);  
                      }
               			    
-			            for (k = zeros + 1; k < j; k++)
-			            {
-                        rtmp = ((double) xx) * mu[j][k];
-			               rtmp = ldexp (rtmp, expo[j] - expo[kappa]);
-			               mu[kappa][k] = mu[kappa][k] - rtmp;
-			            }
+			            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, (double) xx, expo[j] - expo[kappa], j - zeros - 1);
 			         } else
 			         {
 			            if (xx > 0)
@@ -240,12 +204,7 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
                      {
                         F_mpz_mat_row_addmul_2exp_ui(B, kappa, B, j, 0, n, (ulong) -xx, exponent);  
                      }
-			            for (k = zeros + 1; k < j; k++)
-			            {
-			               rtmp = ((double) xx) * mu[j][k];
-			               rtmp = ldexp (rtmp, exponent + expo[j] - expo[kappa]);
-			               mu[kappa][k] = mu[kappa][k] - rtmp;
-					      }
+			            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, (double) xx, exponent + expo[j] - expo[kappa], j - zeros - 1);
 				      }	    
 			      }
 		      }
@@ -255,6 +214,11 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
       if (test)   /* Anything happened? */
 	   {
 	      expo[kappa] = F_mpz_mat_set_line_d(appB[kappa], B, kappa, n);
+	      if (expo[kappa] < min_expo) /* compare with the smallest so far, as it may oscillate */
+	      {
+	         stalls = 0;
+	         min_expo = expo[kappa];
+	      } else if (++stalls > LOOPS_BABAI) return 0; /* rounding errors dominate */
 	      aa = zeros + 1;
 	      for (i = zeros + 1; i <= kappa; i++) 
 	         appSP[kappa][i] = NAN;//0.0/0.0;
@@ -274,6 +238,8 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
       tmp = mu[kappa][k] * r[kappa][k];
       s[k+1] = s[k] - tmp;
    }
+
+   return 1;
 }
 
 /***********************************/
@@ -294,65 +260,45 @@ void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s,
 */
 
 //### This is different -------
-void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
+int Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
        double **appB, int *expo, double **appSP, 
-       int a, int zeros, int kappamax, int n)
+       int a, int zeros, int kappamax, int n, double halfplus)
 //-----------------------------
 {
    int i, j, k, test, aa, exponent;
    signed long xx;
-   double tmp, rtmp;
+   int stalls = 0, min_expo = expo[kappa];
+   double tmp;
    
    aa = (a > zeros) ? a : zeros + 1;
   
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double onedothalfplus = 1.0 + halfplus;
 
 
    do
    {
       test = 0;
       
-#ifdef DEBUG
-      if (loops++ > LOOPS_BABAI) 
-      {
-	      printf("INFINITE LOOP?\n"); 
-	      abort();
-      }
-#endif 
-      
       /* ************************************** */
       /* Step2: compute the GSO for stage kappa */
       /* ************************************** */
       
       for (j = aa; j < kappa; j++)
-	   {	  
-	      if (appSP[kappa][j] != appSP[kappa][j]) // if appSP[kappa][j] == NAN
-	      {
+      {
+         if (appSP[kappa][j] != appSP[kappa][j]) // if appSP[kappa][j] == NAN
+         {
 //### This is different -----
             appSP[kappa][j] = d_vec_scalar_product_heuristic(appB[kappa], appB[j], n, B, kappa, j, expo[kappa]+expo[j]);
 //---------------------------
          }
-	  	  
-         if (j > zeros + 2)
-	      {
-	         tmp = mu[j][zeros+1] * r[kappa][zeros+1];
-	         rtmp = appSP[kappa][j] - tmp;
-	         for (k = zeros + 2; k < j - 1; k++)
-		      {
-		         tmp = mu[j][k] * r[kappa][k];
-		         rtmp = rtmp - tmp;
-		      }
-	         tmp = mu[j][j-1] * r[kappa][j-1];
-	         r[kappa][j] = rtmp - tmp;
-         } else if (j == zeros+2)
-	      {
-	         tmp = mu[j][zeros+1] * r[kappa][zeros+1];
-	         r[kappa][j] = appSP[kappa][j] - tmp;
-	      } else r[kappa][j] = appSP[kappa][j];
-
-	      mu[kappa][j] = r[kappa][j] / r[j][j];
+         
+         if (j > zeros + 1)
+            r[kappa][j] = appSP[kappa][j] - d_vec_scalar_product(mu[j] + zeros + 1, 
+                                                 r[kappa] + zeros + 1, j - zeros - 1);
+         else 
+            r[kappa][j] = appSP[kappa][j];
+
+         mu[kappa][j] = r[kappa][j] / r[j][j];
       }
       
       /* **************************** */
@@ -376,21 +322,13 @@ void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, doubl
 		      {		  
 		         if (mu[kappa][j] >= 0)   /* in this case, X is 1 */
                {
-		            for (k = zeros + 1; k < j; k++)
-			         {
-			            tmp = ldexp (mu[j][k], exponent);
-			            mu[kappa][k] =  mu[kappa][k] - tmp; 
-			         }
+		            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, 1.0, exponent, j - zeros - 1);
 		      
 		            F_mpz_mat_row_sub(B, kappa, B, kappa, B, j, 0, n);
 		  
 		         } else          /* otherwise X is -1 */ 
                {
-                  for (k=zeros+1; k<j; k++)
-			         {
-			            tmp = ldexp (mu[j][k], exponent);
-			            mu[kappa][k] = mu[kappa][k] + tmp;
-			         }
+                  d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, -1.0, exponent, j - zeros - 1);
 		      
                   F_mpz_mat_row_add(B, kappa, B, kappa, B, j, 0, n); 
                }
@@ -402,12 +340,7 @@ void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, doubl
 		         {
 		            tmp = rint (tmp); 
 		      
-		            for (k = zeros + 1; k < j; k++)
-			         {
-			            rtmp = tmp * mu[j][k];
-			            rtmp = ldexp (rtmp, exponent);
-			            mu[kappa][k] = mu[kappa][k] - rtmp;
-			         }
+		            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, tmp, exponent, j - zeros - 1);
 
 		            xx = (long) tmp;
 		      
@@ -439,12 +372,7 @@ void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, doubl
                         F_mpz_mat_row_addmul_ui(B, kappa, B, j, 0, n, -xx);  
                      }
               			    
-			            for (k = zeros + 1; k < j; k++)
-			            {
-                        rtmp = ((double) xx) * mu[j][k];
-			               rtmp = ldexp (rtmp, expo[j] - expo[kappa]);
-			               mu[kappa][k] = mu[kappa][k] - rtmp;
-			            }
+			            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, (double) xx, expo[j] - expo[kappa], j - zeros - 1);
 			         } else
 			         {
 			            if (xx > 0)
@@ -454,12 +382,7 @@ void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, doubl
                      {
                         F_mpz_mat_row_addmul_2exp_ui(B, kappa, B, j, 0, n, (ulong) -xx, exponent);  
                      }
-			            for (k = zeros + 1; k < j; k++)
-			            {
-			               rtmp = ((double) xx) * mu[j][k];
-			               rtmp = ldexp (rtmp, exponent + expo[j] - expo[kappa]);
-			               mu[kappa][k] = mu[kappa][k] - rtmp;
-					      }
+			            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, (double) xx, exponent + expo[j] - expo[kappa], j - zeros - 1);
 				      }	    
 			      }
 		      }
@@ -469,6 +392,11 @@ void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, doubl
       if (test)   /* Anything happened? */
 	   {
 	      expo[kappa] = F_mpz_mat_set_line_d(appB[kappa], B, kappa, n);
+	      if (expo[kappa] < min_expo) /* compare with the smallest so far, as it may oscillate */
+	      {
+	         stalls = 0;
+	         min_expo = expo[kappa];
+	      } else if (++stalls > LOOPS_BABAI) return 0; /* rounding errors dominate */
 	      aa = zeros + 1;
 	      for (i = zeros + 1; i <= kappa; i++) 
 	         appSP[kappa][i] = NAN;//0.0/0.0;
@@ -490,68 +418,50 @@ void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, doubl
       tmp = mu[kappa][k] * r[kappa][k];
       s[k+1] = s[k] - tmp;
    }
+
+   return 1;
 }
 
 //### This is different -------
-void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
+int Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
        double **appB, int *expo, double **appSP, 
-       int a, int zeros, int kappamax, int n, int *cexpo)
+       int a, int zeros, int kappamax, int n, int *cexpo, double halfplus)
 //-----------------------------
 {
    int i, j, k, test, aa, exponent;
    signed long xx;
-   double tmp, rtmp;
+   int stalls = 0, min_expo = expo[kappa];
+   double tmp;
    
    aa = (a > zeros) ? a : zeros + 1;
   
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double onedothalfplus = 1.0 + halfplus;
 
 
    do
    {
       test = 0;
       
-#ifdef DEBUG
-      if (loops++ > LOOPS_BABAI) 
-      {
-	      printf("INFINITE LOOP?\n"); 
-	      abort();
-      }
-#endif 
-      
       /* ************************************** */
       /* Step2: compute the GSO for stage kappa */
       /* ************************************** */
       
       for (j = aa; j < kappa; j++)
-	   {	  
-	      if (appSP[kappa][j] != appSP[kappa][j]) // if appSP[kappa][j] == NAN
-	      {
+      {
+         if (appSP[kappa][j] != appSP[kappa][j]) // if appSP[kappa][j] == NAN
+         {
 //### This is different -----
             appSP[kappa][j] = d_2exp_vec_scalar_product(appB[kappa], appB[j], n, cexpo, B, kappa, j);
 //---------------------------
          }
-	  	  
-         if (j > zeros + 2)
-	      {
-	         tmp = mu[j][zeros+1] * r[kappa][zeros+1];
-	         rtmp = appSP[kappa][j] - tmp;
-	         for (k = zeros + 2; k < j - 1; k++)
-		      {
-		         tmp = mu[j][k] * r[kappa][k];
-		         rtmp = rtmp - tmp;
-		      }
-	         tmp = mu[j][j-1] * r[kappa][j-1];
-	         r[kappa][j] = rtmp - tmp;
-         } else if (j == zeros+2)
-	      {
-	         tmp = mu[j][zeros+1] * r[kappa][zeros+1];
-	         r[kappa][j] = appSP[kappa][j] - tmp;
-	      } else r[kappa][j] = appSP[kappa][j];
-
-	      mu[kappa][j] = r[kappa][j] / r[j][j];
+         
+         if (j > zeros + 1)
+            r[kappa][j] = appSP[kappa][j] - d_vec_scalar_product(mu[j] + zeros + 1, 
+                                                 r[kappa] + zeros + 1, j - zeros - 1);
+         else 
+            r[kappa][j] = appSP[kappa][j];
+
+         mu[kappa][j] = r[kappa][j] / r[j][j];
       }
       
       /* **************************** */
@@ -575,21 +485,13 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
 		      {		  
 		         if (mu[kappa][j] >= 0)   /* in this case, X is 1 */
                {
-		            for (k = zeros + 1; k < j; k++)
-			         {
-			            tmp = ldexp (mu[j][k], exponent);
-			            mu[kappa][k] =  mu[kappa][k] - tmp; 
-			         }
+		            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, 1.0, exponent, j - zeros - 1);
 		      
 		            F_mpz_mat_row_sub(B, kappa, B, kappa, B, j, 0, n);
 		  
 		         } else          /* otherwise X is -1 */ 
                {
-                  for (k=zeros+1; k<j; k++)
-			         {
-			            tmp = ldexp (mu[j][k], exponent);
-			            mu[kappa][k] = mu[kappa][k] + tmp;
-			         }
+                  d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, -1.0, exponent, j - zeros - 1);
 		      
                   F_mpz_mat_row_add(B, kappa, B, kappa, B, j, 0, n); 
                }
@@ -601,12 +503,7 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
 		         {
 		            tmp = rint (tmp); 
 		      
-		            for (k = zeros + 1; k < j; k++)
-			         {
-			            rtmp = tmp * mu[j][k];
-			            rtmp = ldexp (rtmp, exponent);
-			            mu[kappa][k] = mu[kappa][k] - rtmp;
-			         }
+		            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, tmp, exponent, j - zeros - 1);
 
 		            xx = (long) tmp;
 		      
@@ -638,12 +535,7 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
                         F_mpz_mat_row_addmul_ui(B, kappa, B, j, 0, n, -xx);  
                      }
               			    
-			            for (k = zeros + 1; k < j; k++)
-			            {
-                        rtmp = ((double) xx) * mu[j][k];
-			               rtmp = ldexp (rtmp, expo[j] - expo[kappa]);
-			               mu[kappa][k] = mu[kappa][k] - rtmp;
-			            }
+			            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, (double) xx, expo[j] - expo[kappa], j - zeros - 1);
 			         } else
 			         {
 			            if (xx > 0)
@@ -653,12 +545,7 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
                      {
                         F_mpz_mat_row_addmul_2exp_ui(B, kappa, B, j, 0, n, (ulong) -xx, exponent);  
                      }
-			            for (k = zeros + 1; k < j; k++)
-			            {
-			               rtmp = ((double) xx) * mu[j][k];
-			               rtmp = ldexp (rtmp, exponent + expo[j] - expo[kappa]);
-			               mu[kappa][k] = mu[kappa][k] - rtmp;
-					      }
+			            d_vec_submul_2exp(mu[kappa] + zeros + 1, mu[j] + zeros + 1, (double) xx, exponent + expo[j] - expo[kappa], j - zeros - 1);
 				      }	    
 			      }
 		      }
@@ -668,6 +555,11 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
       if (test)   /* Anything happened? */
 	   {
 	      expo[kappa] = F_mpz_mat_set_line_d(appB[kappa], B, kappa, n);
+	      if (expo[kappa] < min_expo) /* compare with the smallest so far, as it may oscillate */
+	      {
+	         stalls = 0;
+	         min_expo = expo[kappa];
+	      } else if (++stalls > LOOPS_BABAI) return 0; /* rounding errors dominate */
 	      aa = zeros + 1;
 	      for (i = zeros + 1; i <= kappa; i++) 
 	         appSP[kappa][i] = NAN;//0.0/0.0;
@@ -689,6 +581,8 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
       tmp = mu[kappa][k] * r[kappa][k];
       s[k+1] = s[k] - tmp;
    }
+
+   return 1;
 }
 
 /* ****************** */
@@ -697,8 +591,9 @@ void Babai_heuristic_d_2exp (int kappa, F_mpz_mat_t B, double **mu, double **r,
 
 /* LLL-reduces the integer matrix B "in place" */
 
-void LLL(F_mpz_mat_t B)
+int LLL(F_mpz_mat_t B)
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    double ** mu, ** r, ** appB, ** appSP;
    double * s, * mutmp, * appBtmp, * appSPtmp;
@@ -709,9 +604,7 @@ void LLL(F_mpz_mat_t B)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -764,8 +657,12 @@ void LLL(F_mpz_mat_t B)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n)); 
+      if (!Babai(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n), halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -883,6 +780,8 @@ void LLL(F_mpz_mat_t B)
    d_mat_clear(appSP);
    free(s);
    free(appSPtmp);
+
+   return !stalled;
 }
 
 /* LLL-reduces the integer matrix B "in place" 
@@ -892,9 +791,10 @@ void LLL(F_mpz_mat_t B)
 */
 
 //### This is different ------
-void LLL_heuristic_d_2exp(F_mpz_mat_t B, int *cexpo)
+int LLL_heuristic_d_2exp(F_mpz_mat_t B, int *cexpo)
 //----------------------------
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    double ** mu, ** r, ** appB, ** appSP;
    double * s, * mutmp, * appBtmp, * appSPtmp;
@@ -905,9 +805,7 @@ void LLL_heuristic_d_2exp(F_mpz_mat_t B, int *cexpo)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -963,8 +861,12 @@ void LLL_heuristic_d_2exp(F_mpz_mat_t B, int *cexpo)
       /* ********************************** */   
 
 //### This is different -----
-      Babai_heuristic_d_2exp(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n), cexpo); 
+      if (!Babai_heuristic_d_2exp(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n), cexpo, halfplus))
+      {
+         stalled = 1;
+         break;
+      }
 //---------------------------
 
       /* ************************************ */
@@ -1085,6 +987,8 @@ void LLL_heuristic_d_2exp(F_mpz_mat_t B, int *cexpo)
    d_mat_clear(appSP);
    free(s);
    free(appSPtmp);
+
+   return !stalled;
 }
 
 /* 
@@ -1097,6 +1001,7 @@ void LLL_heuristic_d_2exp(F_mpz_mat_t B, int *cexpo)
 int LLL_heuristic_d_2exp_with_removal(F_mpz_mat_t B, int *cexpo, F_mpz_t gs_B)
 //----------------------------
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    double ** mu, ** r, ** appB, ** appSP;
    double * s, * mutmp, * appBtmp, * appSPtmp;
@@ -1107,9 +1012,7 @@ int LLL_heuristic_d_2exp_with_removal(F_mpz_mat_t B, int *cexpo, F_mpz_t gs_B)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -1162,8 +1065,12 @@ int LLL_heuristic_d_2exp_with_removal(F_mpz_mat_t B, int *cexpo, F_mpz_t gs_B)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai_heuristic_d_2exp(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n), cexpo); 
+      if (!Babai_heuristic_d_2exp(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n), cexpo, halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -1273,6 +1180,21 @@ int LLL_heuristic_d_2exp_with_removal(F_mpz_mat_t B, int *cexpo, F_mpz_t gs_B)
 	   }
    }
 
+
+   if (stalled) /* doubles are not precise enough, finish in multiprecision */
+   {
+      free(alpha);
+      free(expo);
+      d_mat_clear(mu);
+      d_mat_clear(r);
+      d_mat_clear(appB);
+      d_mat_clear(appSP);
+      free(s);
+      free(appSPtmp);
+
+      return _LLL_heuristic_with_removal_ladder(B, cexpo, gs_B);
+   }
+
 //### This is different --------
    F_mpz_t tmp_gs;
    F_mpz_init(tmp_gs);
@@ -1311,6 +1233,7 @@ int LLL_heuristic_d_2exp_with_removal(F_mpz_mat_t B, int *cexpo, F_mpz_t gs_B)
 int LLL_heuristic_d_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
 //----------------------------
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    double ** mu, ** r, ** appB, ** appSP;
    double * s, * mutmp, * appBtmp, * appSPtmp;
@@ -1321,9 +1244,7 @@ int LLL_heuristic_d_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -1378,8 +1299,12 @@ int LLL_heuristic_d_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai_heuristic_d(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n)); 
+      if (!Babai_heuristic_d(kappa, B, mu, r, s, appB, expo, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n), halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -1491,6 +1416,21 @@ int LLL_heuristic_d_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
 	   }
    }
 
+
+   if (stalled) /* doubles are not precise enough, finish in multiprecision */
+   {
+      free(alpha);
+      free(expo);
+      d_mat_clear(mu);
+      d_mat_clear(r);
+      d_mat_clear(appB);
+      d_mat_clear(appSP);
+      free(s);
+      free(appSPtmp);
+
+      return _LLL_heuristic_with_removal_ladder(B, NULL, gs_B);
+   }
+
 //### This is different --------
     int ok = 1;
    int newd = d;
@@ -46,8 +46,6 @@
 #define NAN (0.0/0.0)
 #endif 
 
-double halfplus, onedothalfplus, ctt;
-
 #if FLINT_BITS == 32
 #define CPU_SIZE_1 31
 #define MAX_LONG 0x1p31
@@ -63,23 +61,36 @@ double halfplus, onedothalfplus, ctt;
 #define DELTA 0.99
 #endif
 
+/* 
+   Babai gives up once this many successive size reductions fail to 
+   shrink the largest entry of b_kappa below the smallest it has been
+*/
+#define LOOPS_BABAI 10
+
 ulong getShift(F_mpz_mat_t B);
 
-void Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
+int Babai (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
                             double **appB, int *expo, double **appSP, 
-                         int a, int zeros, int kappamax, int n);
+                         int a, int zeros, int kappamax, int n, double halfplus);
 
-void Babai_heuristic_d_2exp(int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
+int Babai_heuristic_d_2exp(int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
                             double **appB, int *expo, double **appSP, 
-                         int a, int zeros, int kappamax, int n, int *cexpo);
+                         int a, int zeros, int kappamax, int n, int *cexpo, double halfplus);
 
-void Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
+int Babai_heuristic_d (int kappa, F_mpz_mat_t B, double **mu, double **r, double *s, 
        double **appB, int *expo, double **appSP, 
-       int a, int zeros, int kappamax, int n);
+       int a, int zeros, int kappamax, int n, double halfplus);
                          
-void LLL (F_mpz_mat_t B);
+/*
+   LLL and LLL_heuristic_d_2exp return 0 if doubles turned out to be too
+   imprecise to size reduce B, in which case B is left partially reduced, 
+   otherwise they return 1. The _with_removal variants instead finish the
+   reduction in multiprecision through _LLL_heuristic_with_removal_ladder,
+   and return -1 if even that stalls.
+*/
+int LLL (F_mpz_mat_t B);
 
-void LLL_heuristic_d_2exp (F_mpz_mat_t B, int *cexpo);
+int LLL_heuristic_d_2exp (F_mpz_mat_t B, int *cexpo);
 
 int LLL_heuristic_d_2exp_with_removal(F_mpz_mat_t B, int *cexpo, F_mpz_t gs_B);
 
@@ -47,11 +47,194 @@
 #include "F_mpz_LLL_fast_d.h"
 #include "F_mpz_LLL_heuristic_mpfr.h"
 #include "mpfr_mat.h"
+#include "thread-support.h"
 #include "gmp.h"
 
-#define LOOPS_BABAI 10
+/* Returns the number of bits of the largest of the first n entries of row r */
+static ulong _F_mpz_mat_row_bits(F_mpz_mat_t B, ulong r, int n)
+{
+   ulong bits = 0, b;
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      b = F_mpz_bits(B->rows[r] + i);
+      if (b > bits) bits = b;
+   }
+
+   return bits;
+}
+
+/* 
+   Workspace of the multithreaded size reduction: three mpfr temporaries 
+   per thread, initialised at the precision of the calling thread, and the
+   row operations b_kappa -= c[i]*2^exp[i]*b_{j[i]} of the current sweep,
+   which are applied together once all the X_j are known.
+*/
+typedef struct
+{
+   ulong threads;
+   mpfr_t * tmp;
+   F_mpz * c;
+   ulong * exp;
+   int * j;
+   int num;
+   void * args;
+} LLL_mpfr_ws_struct;
+
+typedef struct
+{
+   F_mpz_mat_struct * B;
+   mpfr_t ** appB;
+   mpfr_t ** appSP;
+   mpfr_t * tmp;
+   LLL_mpfr_ws_struct * ws;
+   int kappa, n, start, stop, step;
+} LLL_mpfr_arg_t;
+
+static LLL_mpfr_ws_struct * _LLL_mpfr_ws_init(int d, ulong threads)
+{
+   LLL_mpfr_ws_struct * ws = (LLL_mpfr_ws_struct *) malloc(sizeof(LLL_mpfr_ws_struct));
+   ulong i;
+
+   ws->threads = threads;
+   ws->tmp = (mpfr_t *) malloc(3*threads*sizeof(mpfr_t));
+   for (i = 0; i < 3*threads; i++)
+      mpfr_init(ws->tmp[i]);
+   ws->c = (F_mpz *) malloc(d*sizeof(F_mpz));
+   for (i = 0; i < d; i++)
+      F_mpz_init(ws->c + i);
+   ws->exp = (ulong *) malloc(d*sizeof(ulong));
+   ws->j = (int *) malloc(d*sizeof(int));
+   ws->num = 0;
+   ws->args = malloc(threads*sizeof(LLL_mpfr_arg_t));
+
+   return ws;
+}
+
+static void _LLL_mpfr_ws_clear(LLL_mpfr_ws_struct * ws, int d)
+{
+   ulong i;
+
+   for (i = 0; i < 3*ws->threads; i++)
+      mpfr_clear(ws->tmp[i]);
+   free(ws->tmp);
+   for (i = 0; i < d; i++)
+      F_mpz_clear(ws->c + i);
+   free(ws->c);
+   free(ws->exp);
+   free(ws->j);
+   free(ws->args);
+   free(ws);
+}
 
+static void _LLL_mpfr_push(LLL_mpfr_ws_struct * ws, int j, F_mpz_t c, ulong exp)
+{
+   F_mpz_set(ws->c + ws->num, c);
+   ws->exp[ws->num] = exp;
+   ws->j[ws->num] = j;
+   ws->num++;
+}
+
+static void _LLL_mpfr_push_si(LLL_mpfr_ws_struct * ws, int j, long c)
+{
+   F_mpz_set_si(ws->c + ws->num, c);
+   ws->exp[ws->num] = 0;
+   ws->j[ws->num] = j;
+   ws->num++;
+}
+
+/* Fills in appSP[kappa][j] for j = start, start + step, ... < stop where it is NAN */
+static void _LLL_mpfr_SP_worker(void * arg_ptr)
+{
+   LLL_mpfr_arg_t * arg = (LLL_mpfr_arg_t *) arg_ptr;
+   int j, kappa = arg->kappa;
+   F_mpz_t ztmp;
+
+   F_mpz_init(ztmp);
+   for (j = arg->start; j < arg->stop; j += arg->step)
+   {
+      if (mpfr_nan_p(arg->appSP[kappa][j]) 
+         && !_mpfr_vec_scalar_product(arg->appSP[kappa][j], arg->appB[kappa], arg->appB[j], arg->n, arg->tmp))
+      {
+         F_mpz_mat_row_scalar_product(ztmp, arg->B, kappa, arg->B, j, 0, arg->n);
+         F_mpz_get_mpfr(arg->appSP[kappa][j], ztmp);
+      }
+   }
+   F_mpz_clear(ztmp);
+}
 
+/* Applies the pending row operations to columns start to stop - 1 of b_kappa */
+static void _LLL_mpfr_row_worker(void * arg_ptr)
+{
+   LLL_mpfr_arg_t * arg = (LLL_mpfr_arg_t *) arg_ptr;
+   LLL_mpfr_ws_struct * ws = arg->ws;
+   int i;
+
+   for (i = 0; i < ws->num; i++)
+   {
+      if (ws->exp[i]) 
+         F_mpz_mat_row_submul_2exp_F_mpz(arg->B, arg->kappa, arg->B, ws->j[i], 
+                           arg->start, arg->stop - arg->start, ws->c + i, ws->exp[i]);
+      else
+         F_mpz_mat_row_submul(arg->B, arg->kappa, arg->B, ws->j[i], 
+                           arg->start, arg->stop - arg->start, ws->c + i);
+   }
+}
+
+/* 
+   Splits the scalar products <b_kappa, b_j>, aa <= j < kappa, between the
+   threads, if there is enough work. Any left NAN are computed by the caller.
+*/
+static void _LLL_mpfr_SP(LLL_mpfr_ws_struct * ws, F_mpz_mat_t B, mpfr_t ** appB, 
+                                     mpfr_t ** appSP, int kappa, int aa, int n)
+{
+   LLL_mpfr_arg_t * args = (LLL_mpfr_arg_t *) ws->args;
+   ulong i, num = ((ulong) (kappa - aa)*n)/LLL_MPFR_THREAD_CUTOFF;
+   
+   if (num > ws->threads) num = ws->threads;
+   if (num < 2) return;
+
+   for (i = 0; i < num; i++)
+   {
+      args[i].B = B;
+      args[i].appB = appB;
+      args[i].appSP = appSP;
+      args[i].tmp = ws->tmp + 3*i;
+      args[i].kappa = kappa;
+      args[i].n = n;
+      args[i].start = aa + i;
+      args[i].stop = kappa;
+      args[i].step = num;
+   }
+
+   flint_parallel_do(_LLL_mpfr_SP_worker, args, sizeof(LLL_mpfr_arg_t), num);
+}
+
+/* Applies the pending row operations to b_kappa, splitting its columns between the threads */
+static void _LLL_mpfr_row_ops(LLL_mpfr_ws_struct * ws, F_mpz_mat_t B, int kappa, int n)
+{
+   LLL_mpfr_arg_t * args = (LLL_mpfr_arg_t *) ws->args;
+   ulong i, num = ((ulong) ws->num*n)/LLL_MPFR_THREAD_CUTOFF;
+   
+   if (num > ws->threads) num = ws->threads;
+   if (num > n) num = n;
+   if (num < 1) num = 1;
+
+   for (i = 0; i < num; i++)
+   {
+      args[i].B = B;
+      args[i].ws = ws;
+      args[i].kappa = kappa;
+      args[i].start = (i*n)/num;
+      args[i].stop = ((i + 1)*n)/num;
+   }
+
+   if (num == 1) _LLL_mpfr_row_worker(args);
+   else flint_parallel_do(_LLL_mpfr_row_worker, args, sizeof(LLL_mpfr_arg_t), num);
+
+   ws->num = 0;
+}
 
 /***********************************/
 /* Babai's Nearest Plane algorithm */
@@ -70,35 +253,31 @@
 	The algorithm is the iterative Babai algorithm of the paper.
 */
 
-void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
-       mpfr_t **appB, mpfr_t **appSP, 
-       int a, int zeros, int kappamax, int n, mpfr_t tmp, mpfr_t rtmp)
+static int _Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
+       mpfr_t **appB, mpfr_t **appSP, int a, int zeros, int kappamax, int n, 
+       mpfr_t tmp, mpfr_t rtmp, LLL_mpfr_ws_struct * ws, double halfplus)
 {
    int i, j, k, test, aa, exponent;
    signed long xx;
    F_mpz_t ztmp, X;
    F_mpz_init(ztmp);
    F_mpz_init(X);
+   ulong stalls = 0, min_bits = _F_mpz_mat_row_bits(B, kappa, n), bits;
    
    aa = (a > zeros) ? a : zeros + 1;
   
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
-
-   long loops = 0;
+   const double onedothalfplus = 1.0 + halfplus;
 
    do
    {
       test = 0;
-      loops++;
-      if (loops > 2000)
-         abort();
 
       /* ************************************** */
       /* Step2: compute the GSO for stage kappa */
       /* ************************************** */
       
+      if (ws) _LLL_mpfr_SP(ws, B, appB, appSP, kappa, aa, n);
+
       for (j = aa; j < kappa; j++)
 	   {	  
 	      if ( mpfr_nan_p(appSP[kappa][j]) ) // if appSP[kappa][j] == NAN
@@ -153,7 +332,8 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
                      mpfr_sub(mu[kappa][k], mu[kappa][k], mu[j][k], GMP_RNDN);
 			         }
 		      
-		            F_mpz_mat_row_sub(B, kappa, B, kappa, B, j, 0, n);
+		            if (ws) _LLL_mpfr_push_si(ws, j, 1L);
+		            else F_mpz_mat_row_sub(B, kappa, B, kappa, B, j, 0, n);
 		  
 		         } else          /* otherwise X is -1 */ 
                {
@@ -162,7 +342,8 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
 			            mpfr_add(mu[kappa][k], mu[kappa][k], mu[j][k], GMP_RNDN);
 			         }
 		      
-                  F_mpz_mat_row_add(B, kappa, B, kappa, B, j, 0, n); 
+                  if (ws) _LLL_mpfr_push_si(ws, j, -1L);
+                  else F_mpz_mat_row_add(B, kappa, B, kappa, B, j, 0, n); 
                }
 		      } else   /* we must have |X| >= 2 */
 		      {
@@ -177,7 +358,8 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
 		         {
                   /* X is stored in a long signed int */
                   xx = mpfr_get_si(tmp, GMP_RNDN);		      
-                  if (xx > 0L)
+                  if (ws) _LLL_mpfr_push_si(ws, j, xx);
+                  else if (xx > 0L)
                   { 
                      F_mpz_mat_row_submul_ui(B, kappa, B, j, 0, n, (ulong) xx);  
                   } else
@@ -189,10 +371,12 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
                   exponent = F_mpz_set_mpfr_2exp(ztmp, tmp);
                   if (exponent <= 0){
                      F_mpz_div_2exp(ztmp, ztmp, -exponent);
-                     F_mpz_mat_row_submul(B, kappa, B, j, 0, n, ztmp);
+                     if (ws) _LLL_mpfr_push(ws, j, ztmp, 0);
+                     else F_mpz_mat_row_submul(B, kappa, B, j, 0, n, ztmp);
                   }
                   else{
-                     F_mpz_mat_row_submul_2exp_F_mpz(B, kappa, B, j, 0, n, ztmp, exponent);
+                     if (ws) _LLL_mpfr_push(ws, j, ztmp, exponent);
+                     else F_mpz_mat_row_submul_2exp_F_mpz(B, kappa, B, j, 0, n, ztmp, exponent);
                   }
 			      }
 		      }
@@ -201,7 +385,19 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
 
       if (test)   /* Anything happened? */
 	   {
+	      if (ws) _LLL_mpfr_row_ops(ws, B, kappa, n);
 	      F_mpz_mat_set_line_mpfr(appB[kappa], B, kappa, n);
+	      bits = _F_mpz_mat_row_bits(B, kappa, n);
+	      if (bits < min_bits) /* compare with the smallest so far, as it may oscillate */
+	      {
+	         stalls = 0;
+	         min_bits = bits;
+	      } else if (++stalls > LOOPS_BABAI) /* rounding errors dominate */
+	      {
+	         F_mpz_clear(ztmp);
+	         F_mpz_clear(X);
+	         return 0;
+	      }
 	      aa = zeros + 1;
 	      for (i = zeros + 1; i <= kappa; i++) 
 	         mpfr_set_nan(appSP[kappa][i]);//0.0/0.0;
@@ -229,6 +425,16 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
 
    F_mpz_clear(ztmp);
    F_mpz_clear(X);
+
+   return 1;
+}
+
+int Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
+       mpfr_t **appB, mpfr_t **appSP, 
+       int a, int zeros, int kappamax, int n, mpfr_t tmp, mpfr_t rtmp, double halfplus)
+{
+   return _Babai_heuristic(kappa, B, mu, r, s, appB, appSP, a, zeros, 
+                                          kappamax, n, tmp, rtmp, NULL, halfplus);
 }
 
 /* ****************** */
@@ -237,8 +443,9 @@ void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *
 
 /* LLL-reduces the integer matrix B "in place" */
 
-void LLL_heuristic(F_mpz_mat_t B)
+static int _LLL_heuristic(F_mpz_mat_t B, ulong threads)
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    mpfr_t ** mu, ** r, ** appB, ** appSP;
    mpfr_t * s, * mutmp, * appBtmp, * appSPtmp;
@@ -250,14 +457,15 @@ void LLL_heuristic(F_mpz_mat_t B)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
    alpha = (int *) malloc((d + 1) * sizeof(int)); 
 
+   LLL_mpfr_ws_struct * ws = NULL;
+   if (threads > 1) ws = _LLL_mpfr_ws_init(d, threads);
+
    F_mpz_init(ztmp);
    mpfr_init(rtmp);
    mpfr_init(tmp);
@@ -315,8 +523,12 @@ void LLL_heuristic(F_mpz_mat_t B)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai_heuristic(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp); 
+      if (!_Babai_heuristic(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp, ws, halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -421,6 +633,7 @@ void LLL_heuristic(F_mpz_mat_t B)
    } 
   
    free(alpha);
+   if (ws) _LLL_mpfr_ws_clear(ws, d);
 
    F_mpz_clear(ztmp);
    mpfr_clear(rtmp);
@@ -438,6 +651,18 @@ void LLL_heuristic(F_mpz_mat_t B)
    mpfr_mat_clear(appSP, d, d);
    free(s);
    free(appSPtmp);
+
+   return !stalled;
+}
+
+int LLL_heuristic(F_mpz_mat_t B)
+{
+   return _LLL_heuristic(B, 1);
+}
+
+int LLL_heuristic_mt(F_mpz_mat_t B)
+{
+   return _LLL_heuristic(B, flint_get_num_threads());
 }
 
 
@@ -449,6 +674,7 @@ void LLL_heuristic(F_mpz_mat_t B)
 
 long LLL_heuristic_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    mpfr_t ** mu, ** r, ** appB, ** appSP;
    mpfr_t * s, * mutmp, * appBtmp, * appSPtmp;
@@ -460,9 +686,7 @@ long LLL_heuristic_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -525,8 +749,12 @@ long LLL_heuristic_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai_heuristic(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp); 
+      if (!Babai_heuristic(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp, halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -630,8 +858,8 @@ long LLL_heuristic_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
 	   }
    } 
 
-   int ok = 1;
-   long newd = d;
+   int ok = !stalled; // a stalled reduction removes nothing and returns -1
+   long newd = stalled ? -1L : d;
 
    F_mpz_get_mpfr(tmp, gs_B);
 
@@ -687,21 +915,20 @@ long LLL_heuristic_with_removal(F_mpz_mat_t B, F_mpz_t gs_B)
 	The algorithm is the iterative Babai algorithm of the paper.
 */
 
-void Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
+int Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
        mpfr_t **appB, mpfr_t **appSP, 
-       int a, int zeros, int kappamax, int n, mpfr_t tmp, mpfr_t rtmp, int * cexpo)
+       int a, int zeros, int kappamax, int n, mpfr_t tmp, mpfr_t rtmp, int * cexpo, double halfplus)
 {
    int i, j, k, test, aa, exponent;
    signed long xx;
    F_mpz_t ztmp, X;
    F_mpz_init(ztmp);
    F_mpz_init(X);
+   ulong stalls = 0, min_bits = _F_mpz_mat_row_bits(B, kappa, n), bits;
    
    aa = (a > zeros) ? a : zeros + 1;
   
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double onedothalfplus = 1.0 + halfplus;
 
    do
    {
@@ -814,6 +1041,17 @@ void Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpf
       if (test)   /* Anything happened? */
 	   {
 	      F_mpz_mat_set_line_mpfr_2exp(appB[kappa], B, kappa, n, cexpo);
+	      bits = _F_mpz_mat_row_bits(B, kappa, n);
+	      if (bits < min_bits) /* compare with the smallest so far, as it may oscillate */
+	      {
+	         stalls = 0;
+	         min_bits = bits;
+	      } else if (++stalls > LOOPS_BABAI) /* rounding errors dominate */
+	      {
+	         F_mpz_clear(ztmp);
+	         F_mpz_clear(X);
+	         return 0;
+	      }
 	      aa = zeros + 1;
 	      for (i = zeros + 1; i <= kappa; i++) 
 	         mpfr_set_nan(appSP[kappa][i]);//0.0/0.0;
@@ -841,6 +1079,8 @@ void Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpf
 
    F_mpz_clear(ztmp);
    F_mpz_clear(X);
+
+   return 1;
 }
 
 /* ****************** */
@@ -849,8 +1089,9 @@ void Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpf
 
 /* LLL-reduces the integer matrix B "in place" */
 
-void LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo)
+int LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo)
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    mpfr_t ** mu, ** r, ** appB, ** appSP;
    mpfr_t * s, * mutmp, * appBtmp, * appSPtmp;
@@ -862,9 +1103,7 @@ void LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -927,8 +1166,12 @@ void LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai_heuristic_2exp(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp, cexpo); 
+      if (!Babai_heuristic_2exp(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp, cexpo, halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -1050,6 +1293,8 @@ void LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo)
    mpfr_mat_clear(appSP, d, d);
    free(s);
    free(appSPtmp);
+
+   return !stalled;
 }
 
 
@@ -1061,6 +1306,7 @@ void LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo)
 
 long LLL_heuristic_2exp_with_removal(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B)
 {
+   int stalled = 0;
    int kappa, kappa2, d, n, i, j, zeros, kappamax;
    mpfr_t ** mu, ** r, ** appB, ** appSP;
    mpfr_t * s, * mutmp, * appBtmp, * appSPtmp;
@@ -1072,9 +1318,7 @@ long LLL_heuristic_2exp_with_removal(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B)
    n = B->c;
    d = B->r;
 
-   ctt = DELTA;
-   halfplus = ETA;
-   onedothalfplus = 1.0+halfplus;
+   const double ctt = DELTA, halfplus = ETA;
 	
 	ulong shift = getShift(B);
 
@@ -1137,8 +1381,12 @@ long LLL_heuristic_2exp_with_removal(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B)
       /* Step3: Call to the Babai algorithm */
       /* ********************************** */   
 
-      Babai_heuristic_2exp(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
-			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp, cexpo); 
+      if (!Babai_heuristic_2exp(kappa, B, mu, r, s, appB, appSP, alpha[kappa], zeros, 
+			                        kappamax, FLINT_MIN(kappamax + 1 + shift, n),  tmp, rtmp, cexpo, halfplus))
+      {
+         stalled = 1;
+         break;
+      }
       
       /* ************************************ */
       /* Step4: Success of Lovasz's condition */
@@ -1242,10 +1490,10 @@ long LLL_heuristic_2exp_with_removal(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B)
 	   }
    } 
  
-   int ok = 1;
+   int ok = !stalled; // a stalled reduction removes nothing and returns -1
    int gok = 1;
    int gap = 1;
-   long newd = d;
+   long newd = stalled ? -1L : d;
 
    F_mpz_get_mpfr(tmp, gs_B);
 
@@ -1283,4 +1531,184 @@ long LLL_heuristic_2exp_with_removal(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B)
    return newd;
 }
 
+long _LLL_heuristic_with_removal_ladder(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B)
+{
+   long newd = -1L;
+   mpfr_prec_t prec, max_prec, old_prec;
+
+   max_prec = 2*(FLINT_ABS(F_mpz_mat_max_bits(B)) + B->r);
+   if (max_prec < LLL_MPFR_PREC) max_prec = LLL_MPFR_PREC;
+
+   old_prec = mpfr_get_default_prec();
+   for (prec = LLL_MPFR_PREC; newd < 0L; prec *= 2)
+   {
+      if (prec > max_prec) prec = max_prec;
+      mpfr_set_default_prec(prec);
+      if (cexpo) newd = LLL_heuristic_2exp_with_removal(B, cexpo, gs_B);
+      else newd = LLL_heuristic_with_removal(B, gs_B);
+      if (prec == max_prec) break;
+   }
+   mpfr_set_default_prec(old_prec);
+
+   return newd;
+}
+
+int F_mpz_mat_LLL_auto(F_mpz_mat_t B)
+{
+   int * cexpo;
+   int i, ok;
+   mpfr_prec_t prec, max_prec, old_prec;
+
+   if (LLL(B)) return 1;
+
+   cexpo = (int *) malloc(B->c * sizeof(int));
+   for (i = 0; i < B->c; i++)
+      cexpo[i] = 0;
+   ok = LLL_heuristic_d_2exp(B, cexpo);
+   free(cexpo);
+   if (ok) return 1;
+
+   max_prec = 2*(FLINT_ABS(F_mpz_mat_max_bits(B)) + B->r);
+   if (max_prec < LLL_MPFR_PREC) max_prec = LLL_MPFR_PREC;
+
+   old_prec = mpfr_get_default_prec();
+   ok = 0;
+   for (prec = LLL_MPFR_PREC; !ok; prec *= 2)
+   {
+      if (prec > max_prec) prec = max_prec;
+      mpfr_set_default_prec(prec);
+      ok = LLL_heuristic_mt(B);
+      if (prec == max_prec) break;
+   }
+   mpfr_set_default_prec(old_prec);
+
+   return ok;
+}
+
+/****************************************************************************
+
+   Recursive LLL
+
+****************************************************************************/
 
+typedef struct
+{
+   F_mpz_mat_struct * B;
+   ulong start;
+   ulong stop;
+} LLL_block_arg_t;
+
+/*
+   LLL-reduces rows [start, stop) of B in place, as a lattice in its own 
+   right. The window shares its row pointers with B, so that the rows are 
+   permuted in B itself, and blocks reduced at the same time must not overlap.
+   Only doubles are used, as the whole of B is reduced again afterwards.
+*/
+static void _LLL_block_worker(void * arg_ptr)
+{
+   LLL_block_arg_t * arg = (LLL_block_arg_t *) arg_ptr;
+   F_mpz_mat_struct W;
+
+   W.entries = NULL;
+   W.rows = arg->B->rows + arg->start;
+   W.r = W.r_alloc = arg->stop - arg->start;
+   W.c = W.c_alloc = arg->B->c;
+
+   LLL(&W);
+}
+
+/*
+   Splits the rows of B into num blocks and reduces them in parallel. If 
+   shifted is set, the num - 1 blocks straddling the boundaries of the 
+   unshifted blocks are reduced instead, so that the two passes overlap.
+*/
+static void _LLL_blocks(F_mpz_mat_t B, ulong num, int shifted)
+{
+   LLL_block_arg_t * args = (LLL_block_arg_t *) malloc(num*sizeof(LLL_block_arg_t));
+   ulong d = B->r;
+
+   if (shifted) num--;
+   for (ulong i = 0; i < num; i++)
+   {
+      args[i].B = B;
+      args[i].start = shifted ? ((2*i + 1)*d)/(2*num + 2) : (i*d)/num;
+      args[i].stop = shifted ? ((2*i + 3)*d)/(2*num + 2) : ((i + 1)*d)/num;
+   }
+
+   flint_parallel_do(_LLL_block_worker, args, sizeof(LLL_block_arg_t), num);
+
+   free(args);
+}
+
+/*
+   Replaces B by U*B, where U is the transformation which reduces [I | T],
+   T being B cut down to its top LLL_TRUNC_BITS bits by F_mpz_mat_upper_trunc_n.
+   Zero columns of T do not change the reduction and are dropped.
+   Returns the number of bits of the entries of B afterwards.
+*/
+static ulong _LLL_truncated(F_mpz_mat_t B)
+{
+   ulong d = B->r, n = B->c;
+   F_mpz_mat_t T, M, U;
+
+   F_mpz_mat_init(T, d, n);
+   F_mpz_mat_upper_trunc_n(T, B, LLL_TRUNC_BITS);
+
+   // Columns of T which are zero, e.g. all but one for a knapsack, are left out of M
+   ulong * cols = (ulong *) malloc(n*sizeof(ulong));
+   ulong nz = 0;
+   for (ulong j = 0; j < n; j++)
+   {
+      ulong i;
+      for (i = 0; (i < d) && F_mpz_is_zero(T->rows[i] + j); i++) ;
+      if (i < d) cols[nz++] = j;
+   }
+
+   F_mpz_mat_init(M, d, d + nz);
+   for (ulong i = 0; i < d; i++)
+   {
+      F_mpz_set_ui(M->rows[i] + i, 1L);
+      for (ulong j = 0; j < nz; j++)
+         F_mpz_swap(M->rows[i] + d + j, T->rows[i] + cols[j]);
+   }
+   F_mpz_mat_clear(T);
+   free(cols);
+
+   F_mpz_mat_LLL_recursive(M);
+
+   F_mpz_mat_init(U, d, d);
+   F_mpz_mat_get_U(U, M, d);
+   F_mpz_mat_clear(M);
+
+   F_mpz_mat_mul(B, U, B);
+   F_mpz_mat_clear(U);
+
+   return FLINT_ABS(F_mpz_mat_max_bits(B));
+}
+
+int F_mpz_mat_LLL_recursive(F_mpz_mat_t B)
+{
+   ulong d = B->r;
+   ulong threads = flint_get_num_threads();
+   ulong bits, new_bits, num;
+
+   if (d > LLL_RECURSIVE_CUTOFF)
+   {
+      bits = FLINT_ABS(F_mpz_mat_max_bits(B));
+      while (bits > 2*LLL_TRUNC_BITS)
+      {
+         new_bits = _LLL_truncated(B);
+         if (new_bits >= bits) break;
+         bits = new_bits;
+      }
+
+      num = FLINT_MIN(threads, d/LLL_RECURSIVE_CUTOFF);
+      if (num > 1)
+      {
+         _LLL_blocks(B, num, 0);
+         _LLL_blocks(B, num, 1);
+      }
+   }
+
+   return F_mpz_mat_LLL_auto(B);
+}
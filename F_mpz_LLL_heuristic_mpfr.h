@@ -50,8 +50,6 @@
 #define NAN (0.0/0.0)
 #endif 
 
-double halfplus, onedothalfplus, ctt;
-
 #if FLINT_BITS == 32
 #define CPU_SIZE_1 31
 #define MAX_LONG 0x1p31
@@ -67,22 +65,91 @@ double halfplus, onedothalfplus, ctt;
 #define DELTA 0.99
 #endif
 
-void Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
+/* The first precision tried once doubles have failed */
+#ifndef LLL_MPFR_PREC
+#define LLL_MPFR_PREC 106
+#endif
+
+/* 
+   LLL_heuristic_mt only hands out work in chunks of at least this many 
+   mpfr or F_mpz operations per thread
+*/
+#ifndef LLL_MPFR_THREAD_CUTOFF
+#define LLL_MPFR_THREAD_CUTOFF 1000
+#endif
+
+int Babai_heuristic(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
        mpfr_t **appB, mpfr_t **appSP, int a, int zeros, int kappamax, 
-       int n, mpfr_t tmp, mpfr_t rtmp);
+       int n, mpfr_t tmp, mpfr_t rtmp, double halfplus);
                          
-void LLL_heuristic(F_mpz_mat_t B);
+int LLL_heuristic(F_mpz_mat_t B);
 
+/*
+   As LLL_heuristic, but with up to flint_get_num_threads() threads. In each
+   size reduction sweep of b_kappa the scalar products with the earlier rows
+   are computed in parallel and, once all the X_j are known, the columns of
+   b_kappa are split between the threads to subtract X_j*b_j. The result is 
+   identical to that of LLL_heuristic.
+*/
+int LLL_heuristic_mt(F_mpz_mat_t B);
+
+/*
+   LLL_heuristic_with_removal and LLL_heuristic_2exp_with_removal return 
+   the number of rows of the reduced B whose Gram-Schmidt lengths are at 
+   most gs_B, or -1 if B could not be size reduced at the current default
+   mpfr precision, in which case B is left partially reduced.
+*/
 long LLL_heuristic_with_removal(F_mpz_mat_t B, F_mpz_t gs_B);
 
-void Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
+int Babai_heuristic_2exp(int kappa, F_mpz_mat_t B, mpfr_t **mu, mpfr_t **r, mpfr_t *s, 
        mpfr_t **appB, mpfr_t **appSP, 
-       int a, int zeros, int kappamax, int n, mpfr_t tmp, mpfr_t rtmp, int * cexpo);
+       int a, int zeros, int kappamax, int n, mpfr_t tmp, mpfr_t rtmp, int * cexpo, double halfplus);
 
-void LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo);
+int LLL_heuristic_2exp(F_mpz_mat_t B, int * cexpo);
 
 long LLL_heuristic_2exp_with_removal(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B);
 
+/*
+   Runs LLL_heuristic_2exp_with_removal, or LLL_heuristic_with_removal if 
+   cexpo is NULL, with the same ladder of precisions as F_mpz_mat_LLL_auto,
+   each run carrying on from the basis the last left. Returns -1 only if 
+   the top of the ladder stalls as well.
+*/
+long _LLL_heuristic_with_removal_ladder(F_mpz_mat_t B, int * cexpo, F_mpz_t gs_B);
+
+/*
+   LLL-reduces B in place, starting with LLL and escalating to 
+   LLL_heuristic_d_2exp and then to LLL_heuristic_mt with a default mpfr 
+   precision of LLL_MPFR_PREC bits, doubled each time a stage stalls.
+   Each stage carries on from the partially reduced basis left by the 
+   last. Returns 1 if B was reduced, 0 if even a precision of twice the 
+   number of bits of the entries plus the dimension did not suffice.
+*/
+int F_mpz_mat_LLL_auto(F_mpz_mat_t B);
+
+/*
+   F_mpz_mat_LLL_recursive reduces bases of at most LLL_RECURSIVE_CUTOFF 
+   vectors directly, and makes its early reductions on the top 
+   LLL_TRUNC_BITS bits of the entries.
+*/
+#ifndef LLL_RECURSIVE_CUTOFF
+#define LLL_RECURSIVE_CUTOFF 32
+#endif
+#ifndef LLL_TRUNC_BITS
+#define LLL_TRUNC_BITS 256
+#endif
+
+/*
+   LLL-reduces B in place, for large dimensions. While the entries have 
+   more than 2*LLL_TRUNC_BITS bits, B is multiplied by the transformation 
+   which reduces [I | T], T being B truncated by F_mpz_mat_upper_trunc_n, 
+   [I | T] itself being reduced recursively. With more than one thread, 
+   blocks of rows are then reduced in parallel, followed by blocks which 
+   straddle the boundaries of the first. Finally B is reduced by 
+   F_mpz_mat_LLL_auto, whose return value is returned.
+*/
+int F_mpz_mat_LLL_recursive(F_mpz_mat_t B);
+
 
 #ifdef __cplusplus
  }
@@ -33,8 +33,11 @@ Copyright (C) 2008, William Hart
 #include "long_extras.h"
 #include "mpz_mat.h"
 #include "F_mpz_mat.h"
+#include "F_mpz_LLL_fast_d.h"
+#include "F_mpz_LLL_heuristic_mpfr.h"
 #include "memory-manager.h"
 #include "test-support.h"
+#include "thread-support.h"
 
 #define VARY_BITS 1 // random entries have random number of bits up to the limit given
 #define SIGNS 1 // random entries will be randomly signed
@@ -1690,6 +1693,369 @@ int test_F_mpz_mat_mul_classical()
       mpz_mat_clear(res2); 
    }
    return result;
+}
+
+/*
+   Checks F_mpz_mat_mul against F_mpz_mat_mul_classical for entry sizes either 
+   side of a small F_mpz and of F_MPZ_MAT_MULTI_MOD_BITS, and for dimensions 
+   either side of each of the cutoffs at which F_mpz_mat_mul changes algorithm.
+*/
+int test_F_mpz_mat_mul()
+{
+   mpz_mat_t m_mat1, m_mat2;
+   F_mpz_mat_t F_mat1, F_mat2, F_res1, F_res2;
+   int result = 1;
+   ulong bits1, bits2, r1, c1, c2, dim;
+   
+   ulong bits[6] = {FLINT_BITS/2, FLINT_BITS - 2, FLINT_BITS - 1, 
+                    F_MPZ_MAT_MULTI_MOD_BITS/2, F_MPZ_MAT_MULTI_MOD_BITS/2 + 1, 300};
+   ulong dims[4] = {0, F_MPZ_MAT_MULTI_MOD_CUTOFF, 
+                    F_MPZ_MAT_MULTI_MOD_CUTOFF_LARGE, F_MPZ_MAT_STRASSEN_CUTOFF};
+   
+   for (ulong count1 = 0; (count1 < 8*ITER) && (result == 1) ; count1++)
+   {
+      for (ulong i = 0; (i < 6) && (result == 1); i++)
+      {
+         for (ulong j = 0; (j < 4) && (result == 1); j++)
+         {
+            bits1 = z_randint(bits[i]) + 1;
+            bits2 = bits[i];
+            if (z_randint(2)) 
+            {
+               ulong t = bits1; 
+               bits1 = bits2; 
+               bits2 = t;
+            }
+            
+            // Strassen is only used for small entries
+            if ((dims[j] == F_MPZ_MAT_STRASSEN_CUTOFF) && (bits[i] > FLINT_BITS - 2)) 
+               continue;
+            
+            dim = (dims[j] == 0) ? z_randint(30) + 2 : dims[j];
+            r1 = dim + z_randint(4) - 1;
+            c1 = dim + z_randint(4) - 1;
+            c2 = dim + z_randint(4) - 1;
+            
+            flint_set_num_threads(z_randint(4) + 1);
+
+            F_mpz_mat_init(F_mat1, r1, c1);
+            F_mpz_mat_init(F_mat2, c1, c2);
+            F_mpz_mat_init(F_res1, r1, c2);
+            F_mpz_mat_init(F_res2, r1, c2);
+
+            mpz_mat_init(m_mat1, r1, c1); 
+            mpz_mat_init(m_mat2, c1, c2); 
+
+            mpz_randmat(m_mat1, r1, c1, bits1);
+            mpz_randmat(m_mat2, c1, c2, bits2);
+           
+            mpz_mat_to_F_mpz_mat(F_mat1, m_mat1);
+            mpz_mat_to_F_mpz_mat(F_mat2, m_mat2);
+
+            F_mpz_mat_mul_classical(F_res1, F_mat1, F_mat2);
+            F_mpz_mat_mul(F_res2, F_mat1, F_mat2);
+
+            result = F_mpz_mat_equal(F_res1, F_res2); 
+
+            if (result && (r1 == c1)) // check aliasing
+            {
+               F_mpz_mat_mul(F_mat2, F_mat1, F_mat2);
+               result = F_mpz_mat_equal(F_res1, F_mat2); 
+            }
+
+            if (!result) 
+            {
+               printf("Error: bits1 = %ld, bits2 = %ld, r1 = %ld, c1 = %ld, c2 = %ld\n", bits1, bits2, r1, c1, c2);
+            }
+          
+            F_mpz_mat_clear(F_mat1);
+            F_mpz_mat_clear(F_mat2);
+            F_mpz_mat_clear(F_res1);
+            F_mpz_mat_clear(F_res2);
+            mpz_mat_clear(m_mat1); 
+            mpz_mat_clear(m_mat2);
+         }
+      }
+   }
+
+   flint_set_num_threads(1);
+
+   return result;
+}
+
+/*
+   Reduces bases L*U of Z^d, with L and U unit lower and upper triangular 
+   with large entries. Doubles stall on most of these, so this runs the mpfr
+   precision ladder, and the result must be a signed permutation matrix.
+*/
+int test_LLL_heuristic_d_2exp_with_removal()
+{
+   F_mpz_mat_t L, U, B, C;
+   F_mpz_t gs_B;
+   int * cexpo;
+   int result = 1;
+   ulong d, bits, stalls = 0;
+   long newd;
+   
+   F_mpz_init(gs_B);
+   F_mpz_set_ui(gs_B, 2L);
+   
+   for (ulong count1 = 0; (count1 < 20*ITER) && (result == 1) ; count1++)
+   {
+      d = z_randint(6) + 4;
+      bits = z_randint(100) + 100;
+      
+      F_mpz_mat_init(L, d, d);
+      F_mpz_mat_init(U, d, d);
+      F_mpz_mat_init(B, d, d);
+      F_mpz_mat_init(C, d, d);
+
+      F_mpz_randmat(L, d, d, bits);
+      F_mpz_randmat(U, d, d, bits);
+      for (ulong i = 0; i < d; i++)
+      {
+         F_mpz_set_ui(L->rows[i] + i, 1L);
+         F_mpz_set_ui(U->rows[i] + i, 1L);
+         for (ulong j = i + 1; j < d; j++)
+         {
+            F_mpz_zero(L->rows[i] + j);
+            F_mpz_zero(U->rows[j] + i);
+         }
+      }
+      F_mpz_mat_mul_classical(B, L, U);
+      
+      cexpo = (int *) calloc(d, sizeof(int));
+
+      F_mpz_mat_set(C, B);
+      if (!LLL_heuristic_d_2exp(C, cexpo)) stalls++;
+
+      newd = LLL_heuristic_d_2exp_with_removal(B, cexpo, gs_B);
+      
+      // B must now be a signed permutation matrix
+      result = (newd == (long) d);
+      for (ulong j = 0; (j < d) && result; j++) 
+      {
+         ulong nonzero = 0;
+         for (ulong i = 0; i < d; i++)
+         {
+            if (F_mpz_is_zero(B->rows[i] + j)) continue;
+            nonzero++;
+            result &= (F_mpz_is_one(B->rows[i] + j) || F_mpz_is_m1(B->rows[i] + j));
+         }
+         result &= (nonzero == 1);
+      }
+
+      if (!result) 
+      {
+         printf("Error: d = %ld, bits = %ld, newd = %ld\n", d, bits, newd);
+         F_mpz_mat_print_pretty(B); printf("\n");
+      }
+          
+      free(cexpo);
+      F_mpz_mat_clear(L);
+      F_mpz_mat_clear(U);
+      F_mpz_mat_clear(B);
+      F_mpz_mat_clear(C);
+   }
+
+   F_mpz_clear(gs_B);
+   
+   if (result && (stalls == 0))
+   {
+      printf("Error: doubles never stalled, the precision ladder was not tested\n");
+      result = 0;
+   }
+
+   return result;
+}
+
+/*
+   Knapsack lattices of dimension 56 to 60 reduced by LLL_heuristic_mt with 
+   1 to 4 threads must give exactly the basis LLL_heuristic does. At these 
+   sizes (kappa - aa)*n gets past 2*LLL_MPFR_THREAD_CUTOFF, so that the 
+   scalar products and the row operations are both split between threads.
+*/
+int test_LLL_heuristic_mt()
+{
+   F_mpz_mat_t B, C, D;
+   mpz_t x;
+   int result = 1;
+   ulong d, bits;
+   
+   mpz_init(x);
+   
+   for (ulong count1 = 0; (count1 < ITER) && (result == 1) ; count1++)
+   {
+      d = z_randint(5) + 56;
+      bits = z_randint(50) + 200;
+      
+      F_mpz_mat_init(B, d, d + 1);
+      F_mpz_mat_init(C, d, d + 1);
+      F_mpz_mat_init(D, d, d + 1);
+      
+      for (ulong i = 0; i < d; i++)
+      {
+         mpz_urandomb(x, randstate, bits);
+         F_mpz_set_mpz(B->rows[i], x);
+         F_mpz_set_ui(B->rows[i] + i + 1, 1L);
+      }
+      
+      F_mpz_mat_set(C, B);
+      LLL_heuristic(C);
+      
+      for (ulong threads = 1; (threads <= 4) && (result == 1); threads++)
+      {
+         flint_set_num_threads(threads);
+         F_mpz_mat_set(D, B);
+         LLL_heuristic_mt(D);
+         
+         result = F_mpz_mat_equal(C, D);
+         if (!result) printf("Error: d = %ld, bits = %ld, threads = %ld\n", d, bits, threads);
+      }
+      
+      F_mpz_mat_clear(B);
+      F_mpz_mat_clear(C);
+      F_mpz_mat_clear(D);
+   }
+   
+   flint_set_num_threads(1);
+   mpz_clear(x);
+   
+   return result;
+}
+
+/*
+   Checks that the d x (d + 1) basis B of the lattice spanned by the rows 
+   [a_i | e_i] is a basis of that lattice, i.e. that the first entry of each
+   row is the sum of the a_i weighted by the rest of the row, and that the
+   d x d matrix formed by the rest of the rows is unimodular, which is 
+   checked modulo a prime.
+*/
+int check_knapsack_basis(F_mpz_mat_t B, mpz_t * a)
+{
+   ulong d = B->r;
+   mpz_t p, s, t, det;
+   mpz_t ** U = (mpz_t **) malloc(d*sizeof(mpz_t *));
+   int ok = 1;
+
+   mpz_init(p);
+   mpz_init(s);
+   mpz_init(t);
+   mpz_init_set_ui(det, 1L);
+   mpz_ui_pow_ui(p, 2L, 61L);
+   mpz_sub_ui(p, p, 1L);
+
+   for (ulong i = 0; i < d; i++)
+   {
+      U[i] = (mpz_t *) malloc(d*sizeof(mpz_t));
+      mpz_set_ui(s, 0L);
+      for (ulong j = 0; j < d; j++)
+      {
+         mpz_init(U[i][j]);
+         F_mpz_get_mpz(U[i][j], B->rows[i] + j + 1);
+         mpz_addmul(s, U[i][j], a[j]);
+         mpz_mod(U[i][j], U[i][j], p);
+      }
+      F_mpz_get_mpz(t, B->rows[i]);
+      if (mpz_cmp(s, t)) ok = 0;
+   }
+
+   for (ulong j = 0; (j < d) && ok; j++)
+   {
+      ulong k;
+      for (k = j; (k < d) && !mpz_sgn(U[k][j]); k++) ;
+      if (k == d)
+      {
+         ok = 0;
+         break;
+      }
+      if (k != j)
+      {
+         mpz_t * r = U[k]; U[k] = U[j]; U[j] = r;
+         mpz_neg(det, det);
+      }
+      mpz_mul(det, det, U[j][j]);
+      mpz_mod(det, det, p);
+      mpz_invert(t, U[j][j], p);
+      for (k = j + 1; k < d; k++)
+      {
+         mpz_mul(s, U[k][j], t);
+         mpz_mod(s, s, p);
+         for (ulong l = j; l < d; l++)
+         {
+            mpz_submul(U[k][l], s, U[j][l]);
+            mpz_mod(U[k][l], U[k][l], p);
+         }
+      }
+   }
+   mpz_add_ui(t, det, 1L);
+   if (ok) ok = (!mpz_cmp_ui(det, 1L) || !mpz_cmp(t, p));
+
+   for (ulong i = 0; i < d; i++)
+   {
+      for (ulong j = 0; j < d; j++) mpz_clear(U[i][j]);
+      free(U[i]);
+   }
+   free(U);
+   mpz_clear(p);
+   mpz_clear(s);
+   mpz_clear(t);
+   mpz_clear(det);
+
+   return ok;
+}
+
+int test_F_mpz_mat_LLL_recursive()
+{
+   F_mpz_mat_t B, C;
+   mpz_t * a;
+   int result = 1;
+   ulong d, bits;
+   
+   for (ulong count1 = 0; (count1 < ITER) && (result == 1) ; count1++)
+   {
+      for (ulong threads = 1; (threads <= 4) && (result == 1); threads++)
+      {
+         d = z_randint(16) + 64;
+         bits = z_randint(300) + 600;
+         
+         F_mpz_mat_init(B, d, d + 1);
+         F_mpz_mat_init(C, d, d + 1);
+         a = (mpz_t *) malloc(d*sizeof(mpz_t));
+         
+         for (ulong i = 0; i < d; i++)
+         {
+            mpz_init(a[i]);
+            mpz_urandomb(a[i], randstate, bits);
+            F_mpz_set_mpz(B->rows[i], a[i]);
+            F_mpz_set_ui(B->rows[i] + i + 1, 1L);
+         }
+         
+         flint_set_num_threads(threads);
+         result = F_mpz_mat_LLL_recursive(B);
+         
+         if (result) result = check_knapsack_basis(B, a);
+         
+         // A reduced basis is left as it is by a further reduction
+         if (result)
+         {
+            F_mpz_mat_set(C, B);
+            F_mpz_mat_LLL_auto(C);
+            result = F_mpz_mat_equal(B, C);
+         }
+         if (!result) printf("Error: d = %ld, bits = %ld, threads = %ld\n", d, bits, threads);
+         
+         for (ulong i = 0; i < d; i++) mpz_clear(a[i]);
+         free(a);
+         F_mpz_mat_clear(B);
+         F_mpz_mat_clear(C);
+      }
+   }
+   
+   flint_set_num_threads(1);
+   
+   return result;
+}
 
 int test_F_mpz_mat_row_submul_2exp_F_mpz()
 {
@@ -1933,8 +2299,12 @@ void F_mpz_mat_test_all()
    RUN_TEST(F_mpz_mat_row_addmul_2exp_ui); 
    RUN_TEST(F_mpz_mat_row_submul_2exp_ui); 
    RUN_TEST(F_mpz_mat_mul_classical);
+   RUN_TEST(F_mpz_mat_mul);
    RUN_TEST(F_mpz_mat_row_submul_2exp_F_mpz); 
    RUN_TEST(F_mpz_mat_row_scalar_mul); 
+   RUN_TEST(LLL_heuristic_d_2exp_with_removal);
+   RUN_TEST(LLL_heuristic_mt);
+   RUN_TEST(F_mpz_mat_LLL_recursive);
    
    printf(all_success ? "\nAll tests passed\n" :
                         "\nAt least one test FAILED!\n");
@@ -38,6 +38,8 @@
 #include "F_mpz.h"
 #include "F_mpz_mat.h"
 #include "mpz_mat.h"
+#include "F_zmod_mat.h"
+#include "thread-support.h"
 
 /*===============================================================================
 
@@ -968,13 +970,454 @@ void _F_mpz_mat_mul_classical(F_mpz_mat_t res, const F_mpz_mat_t mat1, const F_m
    if (c1!=r2)
       return; //dimensions don't match up
 
-   F_mpz_mat_init(res,r1,c2);
-
    for (ulong i = 0; i < r1; i++) // add up to the length of the shorter mat
       for (ulong j = 0; j < c2; j++)
+      {
+         F_mpz_zero(res->rows[i] + j);
          for (ulong c=0; c<c1;c++)
             F_mpz_addmul(res->rows[i] + j, mat1->rows[i]+c, mat2->rows[c]+j);   
+      }
+}
+
+/*============================================================================
+
+   Multiplication
+
+=============================================================================*/
+
+/*
+   Add (or if neg is nonzero, subtract) the two limb unsigned value hi:lo, 
+   which is less than 2^(2*FLINT_BITS - 4), to the signed three limb 
+   accumulator acc.
+*/
+#define F_MPZ_MAT_ACC3(acc, hi, lo, neg) \
+   do { \
+      mp_limb_t __cy; \
+      if (neg) \
+      { \
+         sub_ddmmss(__cy, (acc)[0], 0L, (acc)[0], 0L, (lo)); \
+         sub_ddmmss((acc)[2], (acc)[1], (acc)[2], (acc)[1], 0L, (hi) - __cy); \
+      } else \
+      { \
+         add_ssaaaa(__cy, (acc)[0], 0L, (acc)[0], 0L, (lo)); \
+         add_ssaaaa((acc)[2], (acc)[1], (acc)[2], (acc)[1], 0L, (hi) + __cy); \
+      } \
+   } while (0)
+
+void _F_mpz_mat_mul_small(F_mpz_mat_t res, const F_mpz_mat_t mat1, const F_mpz_mat_t mat2)
+{
+   ulong r1 = mat1->r;
+   ulong c1 = mat1->c;
+   ulong c2 = mat2->c;
+
+   mp_limb_t * acc = (mp_limb_t *) flint_stack_alloc(3*F_MPZ_MAT_MUL_BLOCK);
+
+   // work on blocks of columns of mat2 so that each block stays in cache
+   for (ulong j0 = 0; j0 < c2; j0 += F_MPZ_MAT_MUL_BLOCK)
+   {
+      ulong n = FLINT_MIN(F_MPZ_MAT_MUL_BLOCK, c2 - j0);
+
+      for (ulong i = 0; i < r1; i++)
+      {
+         F_mpn_clear(acc, 3*n);
+
+         for (ulong k = 0; k < c1; k++)
+         {
+            F_mpz a = mat1->rows[i][k];
+            if (a == 0L) continue;
+
+            mp_limb_t ua = FLINT_ABS(a);
+            F_mpz * b = mat2->rows[k] + j0;
+
+            for (ulong j = 0; j < n; j++)
+            {
+               mp_limb_t hi, lo;
+               umul_ppmm(hi, lo, ua, (mp_limb_t) FLINT_ABS(b[j]));
+               F_MPZ_MAT_ACC3(acc + 3*j, hi, lo, (a ^ b[j]) < 0L);
+            }
+         }
+
+         F_mpz * r = res->rows[i] + j0;
+         for (ulong j = 0; j < n; j++)
+         {
+            mp_limb_t * t = acc + 3*j;
+            mp_limb_t s = (mp_limb_t) (((long) t[0]) >> (FLINT_BITS - 1)); // sign extension of t[0]
+            if ((t[1] == s) && (t[2] == s)) F_mpz_set_si(r + j, (long) t[0]);
+            else F_mpz_set_limbs_signed(r + j, t, 3);
+         }
+      }
+   }
+
+   flint_stack_release();
+}
+
+typedef struct
+{
+   F_mpz_mat_struct * mat;
+   F_zmod_mat_struct * mod;
+   F_zmod_mat_struct * mod2;
+   F_zmod_mat_struct * out;
+   F_mpz_comb_struct * comb;
+   ulong start;
+   ulong stop;
+} F_mpz_mat_modular_arg_t;
+
+/*
+   Reduce rows [start, stop) of mat modulo each of the primes in the comb. 
+   Rows of an F_zmod_mat start on a limb boundary, so threads working on 
+   different rows never write to the same limb.
+*/
+void _F_mpz_mat_modular_reduce_worker(void * arg_void)
+{
+   F_mpz_mat_modular_arg_t * arg = (F_mpz_mat_modular_arg_t *) arg_void;
+   F_mpz_comb_struct * comb = arg->comb;
+   ulong num_primes = comb->num_primes;
+   ulong c = arg->mat->c;
+
+   F_mpz ** comb_temp = F_mpz_comb_temp_init(comb);
+   F_mpz_t temp;
+   F_mpz_init(temp);
+   ulong * res = (ulong *) flint_heap_alloc(num_primes);
+
+   for (ulong i = arg->start; i < arg->stop; i++)
+   {
+      for (ulong j = 0; j < c; j++)
+      {
+         F_mpz_multi_mod_ui(res, arg->mat->rows[i] + j, comb, comb_temp, temp);
+         for (ulong k = 0; k < num_primes; k++)
+            PV_SET_ENTRY(arg->mod[k].arr, arg->mod[k].rows[i] + j, res[k]);
+      }
+   }
+
+   flint_heap_free(res);
+   F_mpz_clear(temp);
+   F_mpz_comb_temp_free(comb, comb_temp);
+}
+
+void _F_mpz_mat_modular_mul_worker(void * arg_void)
+{
+   F_mpz_mat_modular_arg_t * arg = (F_mpz_mat_modular_arg_t *) arg_void;
+
+   for (ulong k = arg->start; k < arg->stop; k++)
+      F_zmod_mat_mul_classical(arg->out + k, arg->mod + k, arg->mod2 + k);
+}
+
+void _F_mpz_mat_modular_CRT_worker(void * arg_void)
+{
+   F_mpz_mat_modular_arg_t * arg = (F_mpz_mat_modular_arg_t *) arg_void;
+   F_mpz_comb_struct * comb = arg->comb;
+   ulong num_primes = comb->num_primes;
+   ulong c = arg->mat->c;
+
+   F_mpz ** comb_temp = F_mpz_comb_temp_init(comb);
+   F_mpz_t temp, temp2;
+   F_mpz_init(temp);
+   F_mpz_init(temp2);
+   ulong * res = (ulong *) flint_heap_alloc(num_primes);
+
+   for (ulong i = arg->start; i < arg->stop; i++)
+   {
+      for (ulong j = 0; j < c; j++)
+      {
+         for (ulong k = 0; k < num_primes; k++)
+            PV_GET_ENTRY(res[k], arg->out[k].arr, arg->out[k].rows[i] + j);
+         F_mpz_multi_CRT_ui(arg->mat->rows[i] + j, res, comb, comb_temp, temp, temp2);
+      }
+   }
+
+   flint_heap_free(res);
+   F_mpz_clear(temp2);
+   F_mpz_clear(temp);
+   F_mpz_comb_temp_free(comb, comb_temp);
+}
+
+/*
+   Split the range [0, total) into at most the given number of pieces, filling 
+   in start and stop in each of the args (whose other fields must be set) and
+   call fn on each piece in parallel.
+*/
+void _F_mpz_mat_modular_run(void (*fn)(void *), F_mpz_mat_modular_arg_t * args, 
+                             ulong threads, ulong total)
+{
+   if (threads > total) threads = total;
+
+   for (ulong t = 0; t < threads; t++)
+   {
+      if (t) args[t] = args[0];
+      args[t].start = (total*t)/threads;
+      args[t].stop = (total*(t + 1))/threads;
+   }
 
+   flint_parallel_do(fn, args, sizeof(F_mpz_mat_modular_arg_t), threads);
+}
+
+void _F_mpz_mat_mul_multi_mod(F_mpz_mat_t res, const F_mpz_mat_t mat1, 
+                                               const F_mpz_mat_t mat2, ulong threads)
+{
+   ulong r1 = mat1->r;
+   ulong c1 = mat1->c;
+   ulong c2 = mat2->c;
+
+   ulong log_length = 0;
+   while ((1L<<log_length) < c1) log_length++;
+   ulong bits = FLINT_ABS(F_mpz_mat_max_bits(mat1)) 
+              + FLINT_ABS(F_mpz_mat_max_bits(mat2)) + log_length + 1;
+
+   /* 
+      As for F_mpz_poly_mul_modular, each prime is at least 2^(FLINT_BITS - 2) 
+      and the signed entries of the product need bits + 1 bits.
+   */
+   ulong num_primes = (bits + 1)/(FLINT_BITS - 2) + 1;
+   if (num_primes < 2) num_primes = 2;
+
+   ulong * primes = (ulong *) flint_heap_alloc(num_primes);
+   primes[0] = z_nextprime(1L << (FLINT_BITS - 2), 0);
+   for (ulong i = 1; i < num_primes; i++)
+      primes[i] = z_nextprime(primes[i - 1], 0);
+
+   F_mpz_comb_t comb;
+   F_mpz_comb_init(comb, primes, num_primes);
+
+   F_zmod_mat_struct * mod1 = (F_zmod_mat_struct *) 
+                 flint_heap_alloc_bytes(3*num_primes*sizeof(F_zmod_mat_struct));
+   F_zmod_mat_struct * mod2 = mod1 + num_primes;
+   F_zmod_mat_struct * out = mod2 + num_primes;
+   for (ulong k = 0; k < num_primes; k++)
+   {
+      F_zmod_mat_init(mod1 + k, primes[k], r1, c1);
+      F_zmod_mat_init_precomp(mod2 + k, primes[k], mod1[k].p_inv, c1, c2);
+      F_zmod_mat_init_precomp(out + k, primes[k], mod1[k].p_inv, r1, c2);
+   }
+
+   if (threads < 1) threads = 1;
+   F_mpz_mat_modular_arg_t * args = (F_mpz_mat_modular_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(F_mpz_mat_modular_arg_t));
+
+   // reduce inputs modulo each of the primes
+   args[0].comb = comb;
+   args[0].mat = (F_mpz_mat_struct *) mat1;
+   args[0].mod = mod1;
+   _F_mpz_mat_modular_run(_F_mpz_mat_modular_reduce_worker, args, threads, r1);
+
+   args[0].mat = (F_mpz_mat_struct *) mat2;
+   args[0].mod = mod2;
+   _F_mpz_mat_modular_run(_F_mpz_mat_modular_reduce_worker, args, threads, c1);
+
+   // multiply modulo each prime
+   args[0].mod = mod1;
+   args[0].mod2 = mod2;
+   args[0].out = out;
+   _F_mpz_mat_modular_run(_F_mpz_mat_modular_mul_worker, args, threads, num_primes);
+
+   // recombine the entries of the product
+   args[0].mat = res;
+   _F_mpz_mat_modular_run(_F_mpz_mat_modular_CRT_worker, args, threads, r1);
+
+   flint_heap_free(args);
+   for (ulong k = 0; k < num_primes; k++)
+   {
+      F_zmod_mat_clear(out + k);
+      F_zmod_mat_clear(mod2 + k);
+      F_zmod_mat_clear(mod1 + k);
+   }
+   flint_heap_free(mod1);
+   F_mpz_comb_clear(comb);
+   flint_heap_free(primes);
+}
+
+/*
+   Set W to a window onto rows [r0, r1) and columns [c0, c1) of M. The window 
+   shares the entries of M and must be released with _F_mpz_mat_window_clear.
+*/
+static inline
+void _F_mpz_mat_window_init(F_mpz_mat_t W, const F_mpz_mat_t M, 
+                                          ulong r0, ulong c0, ulong r1, ulong c1)
+{
+   W->entries = NULL;
+   W->rows = (F_mpz **) flint_heap_alloc(FLINT_MAX(r1 - r0, 1));
+   for (ulong i = r0; i < r1; i++)
+      W->rows[i - r0] = M->rows[i] + c0;
+   W->r = W->r_alloc = r1 - r0;
+   W->c = W->c_alloc = c1 - c0;
+}
+
+static inline
+void _F_mpz_mat_window_clear(F_mpz_mat_t W)
+{
+   flint_heap_free(W->rows);
+}
+
+/*
+   Strassen-Winograd multiplication. Each of the seven half size products is 
+   done with _F_mpz_mat_mul, so the recursion continues until the dimensions
+   drop below F_MPZ_MAT_STRASSEN_CUTOFF. Odd rows and columns are dealt with 
+   separately at the end.
+*/
+void _F_mpz_mat_mul_strassen(F_mpz_mat_t C, const F_mpz_mat_t A, const F_mpz_mat_t B)
+{
+   ulong a = A->r;
+   ulong b = A->c;
+   ulong c = B->c;
+
+   if ((a <= 4) || (b <= 4) || (c <= 4))
+   {
+      _F_mpz_mat_mul_classical(C, A, B);
+      return;
+   }
+
+   ulong anr = a/2;
+   ulong anc = b/2;
+   ulong bnr = anc;
+   ulong bnc = c/2;
+
+   F_mpz_mat_t A11, A12, A21, A22, B11, B12, B21, B22;
+   F_mpz_mat_t C11, C12, C21, C22, X1, X2;
+
+   _F_mpz_mat_window_init(A11, A, 0, 0, anr, anc);
+   _F_mpz_mat_window_init(A12, A, 0, anc, anr, 2*anc);
+   _F_mpz_mat_window_init(A21, A, anr, 0, 2*anr, anc);
+   _F_mpz_mat_window_init(A22, A, anr, anc, 2*anr, 2*anc);
+
+   _F_mpz_mat_window_init(B11, B, 0, 0, bnr, bnc);
+   _F_mpz_mat_window_init(B12, B, 0, bnc, bnr, 2*bnc);
+   _F_mpz_mat_window_init(B21, B, bnr, 0, 2*bnr, bnc);
+   _F_mpz_mat_window_init(B22, B, bnr, bnc, 2*bnr, 2*bnc);
+
+   _F_mpz_mat_window_init(C11, C, 0, 0, anr, bnc);
+   _F_mpz_mat_window_init(C12, C, 0, bnc, anr, 2*bnc);
+   _F_mpz_mat_window_init(C21, C, anr, 0, 2*anr, bnc);
+   _F_mpz_mat_window_init(C22, C, anr, bnc, 2*anr, 2*bnc);
+
+   ulong xc = FLINT_MAX(bnc, anc);
+   F_mpz_mat_init(X1, anr, xc);
+   F_mpz_mat_init(X2, anc, bnc);
+
+   X1->c = anc; // X1 is used as an anr x anc matrix first
+
+   F_mpz_mat_sub(X1, A11, A21);
+   F_mpz_mat_sub(X2, B22, B12);
+   _F_mpz_mat_mul(C21, X1, X2);
+
+   F_mpz_mat_add(X1, A21, A22);
+   F_mpz_mat_sub(X2, B12, B11);
+   _F_mpz_mat_mul(C22, X1, X2);
+
+   F_mpz_mat_sub(X1, X1, A11);
+   F_mpz_mat_sub(X2, B22, X2);
+   _F_mpz_mat_mul(C12, X1, X2);
+
+   F_mpz_mat_sub(X1, A12, X1);
+   _F_mpz_mat_mul(C11, X1, B22);
+
+   X1->c = bnc; // and then as an anr x bnc matrix
+
+   _F_mpz_mat_mul(X1, A11, B11);
+
+   F_mpz_mat_add(C12, X1, C12);
+   F_mpz_mat_add(C21, C12, C21);
+   F_mpz_mat_add(C12, C12, C22);
+   F_mpz_mat_add(C22, C21, C22);
+   F_mpz_mat_add(C12, C12, C11);
+   F_mpz_mat_sub(X2, X2, B21);
+   _F_mpz_mat_mul(C11, A22, X2);
+
+   F_mpz_mat_sub(C21, C21, C11);
+   _F_mpz_mat_mul(C11, A12, B21);
+
+   F_mpz_mat_add(C11, X1, C11);
+
+   X1->c = xc; // so that F_mpz_mat_clear releases all the entries
+   F_mpz_mat_clear(X1);
+   F_mpz_mat_clear(X2);
+
+   _F_mpz_mat_window_clear(A11);
+   _F_mpz_mat_window_clear(A12);
+   _F_mpz_mat_window_clear(A21);
+   _F_mpz_mat_window_clear(A22);
+   _F_mpz_mat_window_clear(B11);
+   _F_mpz_mat_window_clear(B12);
+   _F_mpz_mat_window_clear(B21);
+   _F_mpz_mat_window_clear(B22);
+   _F_mpz_mat_window_clear(C11);
+   _F_mpz_mat_window_clear(C12);
+   _F_mpz_mat_window_clear(C21);
+   _F_mpz_mat_window_clear(C22);
+
+   if (c > 2*bnc) // last column of B gives the last column of C
+   {
+      F_mpz_mat_t Bc, Cc;
+      _F_mpz_mat_window_init(Bc, B, 0, 2*bnc, b, c);
+      _F_mpz_mat_window_init(Cc, C, 0, 2*bnc, a, c);
+      _F_mpz_mat_mul(Cc, A, Bc);
+      _F_mpz_mat_window_clear(Cc);
+      _F_mpz_mat_window_clear(Bc);
+   }
+
+   if (a > 2*anr) // last row of A gives the last row of C
+   {
+      F_mpz_mat_t Ar, Cr;
+      _F_mpz_mat_window_init(Ar, A, 2*anr, 0, a, b);
+      _F_mpz_mat_window_init(Cr, C, 2*anr, 0, a, c);
+      _F_mpz_mat_mul(Cr, Ar, B);
+      _F_mpz_mat_window_clear(Cr);
+      _F_mpz_mat_window_clear(Ar);
+   }
+
+   if (b > 2*anc) // add the last column of A times the last row of B
+   {
+      for (ulong i = 0; i < 2*anr; i++)
+      {
+         F_mpz * ai = A->rows[i] + 2*anc;
+         if (*ai == 0L) continue;
+         for (ulong j = 0; j < 2*bnc; j++)
+            F_mpz_addmul(C->rows[i] + j, ai, B->rows[2*bnr] + j);
+      }
+   }
+}
+
+void _F_mpz_mat_mul(F_mpz_mat_t res, const F_mpz_mat_t mat1, const F_mpz_mat_t mat2)
+{
+   ulong r1 = mat1->r;
+   ulong c1 = mat1->c;
+   ulong c2 = mat2->c;
+
+   if (c1 != mat2->r)
+   {
+      printf("Error: invalid matrix multiplication in F_mpz_mat_mul!\n");
+      abort();
+   }
+
+   if ((r1 == 0) || (c2 == 0)) return;
+
+   if (c1 == 0)
+   {
+      for (ulong i = 0; i < r1; i++)
+         for (ulong j = 0; j < c2; j++)
+            F_mpz_zero(res->rows[i] + j);
+      return;
+   }
+
+   ulong dim = FLINT_MIN(FLINT_MIN(r1, c1), c2);
+   ulong bits1 = FLINT_ABS(F_mpz_mat_max_bits(mat1));
+   ulong bits2 = FLINT_ABS(F_mpz_mat_max_bits(mat2));
+
+   ulong cutoff = (bits1 + bits2 <= F_MPZ_MAT_MULTI_MOD_BITS) ? 
+                  F_MPZ_MAT_MULTI_MOD_CUTOFF : F_MPZ_MAT_MULTI_MOD_CUTOFF_LARGE;
+
+   if ((bits1 <= FLINT_BITS - 2) && (bits2 <= FLINT_BITS - 2))
+   {
+      /* 
+         Strassen only pays off for small entries, larger ones are better 
+         served by the multimodular algorithm
+      */
+      if (dim >= F_MPZ_MAT_STRASSEN_CUTOFF)
+         _F_mpz_mat_mul_strassen(res, mat1, mat2);
+      else
+         _F_mpz_mat_mul_small(res, mat1, mat2);
+   } else if (dim >= cutoff)
+      _F_mpz_mat_mul_multi_mod(res, mat1, mat2, flint_get_num_threads());
+   else
+      _F_mpz_mat_mul_classical(res, mat1, mat2);
 }
 
 /*============================================================================
@@ -1240,7 +1683,7 @@ int _F_mpz_mat_next_col(F_mpz_mat_t M, F_mpz_t P, F_mpz_mat_t col, long exp){
    F_mpz_mat_t temp_col;
    F_mpz_mat_init(temp_col, M->r, 1);
 //full precision column for deciding truncation levels
-   F_mpz_mat_mul_classical(temp_col, U, col);
+   F_mpz_mat_mul(temp_col, U, col);
    F_mpz_mat_smod(temp_col, temp_col, P);
    long mbts = FLINT_ABS(F_mpz_mat_max_bits(temp_col));
 //bare minimum of data above the bound
@@ -1285,7 +1728,7 @@ int _F_mpz_mat_next_col(F_mpz_mat_t M, F_mpz_t P, F_mpz_mat_t col, long exp){
    F_mpz_mat_t trunc_col;
    F_mpz_mat_init(trunc_col, r, 1);
    F_mpz_mat_scalar_div_2exp(trunc_col, col, take_away);
-   F_mpz_mat_mul_classical(temp_col, U, trunc_col);
+   F_mpz_mat_mul(temp_col, U, trunc_col);
    F_mpz_t trunc_P;
    F_mpz_init(trunc_P);
    F_mpz_div_2exp(trunc_P, P, take_away);
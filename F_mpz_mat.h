@@ -428,6 +428,7 @@ void F_mpz_mat_row_neg(F_mpz_mat_t mat1, ulong r1, F_mpz_mat_t mat2,
 
 	\brief  Classical multiplication of F_mpz_mat_t's mat1 and mat2 set result to res
                                                   not alias safe	        
+	        res must already be initialised to the dimensions of the product
 */
 void _F_mpz_mat_mul_classical(F_mpz_mat_t res, const F_mpz_mat_t mat1,
                                                   const F_mpz_mat_t mat2);
@@ -456,6 +457,101 @@ void F_mpz_mat_mul_classical(F_mpz_mat_t P, const F_mpz_mat_t A,const F_mpz_mat_
 	   return _F_mpz_mat_mul_classical(P, A, B);
 }
 
+/* ======================================================================================================
+  Multiplication
+
+=========================================================================================================*/
+
+/*
+   Number of columns of mat2 whose three limb accumulators are kept at once by 
+   _F_mpz_mat_mul_small.
+*/
+#define F_MPZ_MAT_MUL_BLOCK 64
+
+/*
+   Smallest dimension for which _F_mpz_mat_mul uses the multimodular algorithm,
+   when the largest entries of the two operands have at most 
+   F_MPZ_MAT_MULTI_MOD_BITS bits between them and when they are larger.
+*/
+#define F_MPZ_MAT_MULTI_MOD_CUTOFF 32
+#define F_MPZ_MAT_MULTI_MOD_CUTOFF_LARGE 96
+#define F_MPZ_MAT_MULTI_MOD_BITS 256
+
+/*
+   Smallest dimension for which _F_mpz_mat_mul switches to Strassen's algorithm.
+*/
+#define F_MPZ_MAT_STRASSEN_CUTOFF 128
+
+/** 
+   \fn     void _F_mpz_mat_mul_small(F_mpz_mat_t res, const F_mpz_mat_t mat1,
+                                                  const F_mpz_mat_t mat2)
+
+	\brief  Sets res to mat1*mat2, where no entry of mat1 or mat2 may be an mpz_t.
+	        Each entry of the product is accumulated in three limbs. The 
+	        dimensions must be compatible, res must be initialised to the 
+	        dimensions of the product and must not alias mat1 or mat2.
+*/
+void _F_mpz_mat_mul_small(F_mpz_mat_t res, const F_mpz_mat_t mat1, 
+                                                   const F_mpz_mat_t mat2);
+
+/** 
+   \fn     void _F_mpz_mat_mul_multi_mod(F_mpz_mat_t res, const F_mpz_mat_t mat1,
+                                        const F_mpz_mat_t mat2, ulong threads)
+
+	\brief  Sets res to mat1*mat2 by multiplying modulo sufficiently many 
+	        word sized primes and recombining using the CRT. The given number 
+	        of threads are used. The same conditions apply as for
+	        _F_mpz_mat_mul_small, except that the entries may be of any size.
+*/
+void _F_mpz_mat_mul_multi_mod(F_mpz_mat_t res, const F_mpz_mat_t mat1, 
+                                         const F_mpz_mat_t mat2, ulong threads);
+
+/** 
+   \fn     void _F_mpz_mat_mul_strassen(F_mpz_mat_t res, const F_mpz_mat_t mat1,
+                                                  const F_mpz_mat_t mat2)
+
+	\brief  Sets res to mat1*mat2 using the Strassen-Winograd algorithm, with the 
+	        subproducts done by _F_mpz_mat_mul. The same conditions apply as 
+	        for _F_mpz_mat_mul_multi_mod.
+*/
+void _F_mpz_mat_mul_strassen(F_mpz_mat_t res, const F_mpz_mat_t mat1, 
+                                                   const F_mpz_mat_t mat2);
+
+/** 
+   \fn     void _F_mpz_mat_mul(F_mpz_mat_t res, const F_mpz_mat_t mat1,
+                                                  const F_mpz_mat_t mat2)
+
+	\brief  Sets res to mat1*mat2, choosing between the Strassen, small entry, 
+	        multimodular and classical algorithms according to the dimensions
+	        and the sizes of the entries. res must be initialised to the 
+	        dimensions of the product and must not alias mat1 or mat2. An 
+	        exception is raised if the dimensions are incompatible.
+*/
+void _F_mpz_mat_mul(F_mpz_mat_t res, const F_mpz_mat_t mat1, 
+                                                   const F_mpz_mat_t mat2);
+
+/** 
+   \fn     static inline
+           void F_mpz_mat_mul(F_mpz_mat_t P, const F_mpz_mat_t A,
+                                                  const F_mpz_mat_t B)
+
+	\brief  Sets P to A*B. P must be initialised to the dimensions of the 
+	        product, but may alias A or B.
+*/
+static inline
+void F_mpz_mat_mul(F_mpz_mat_t P, const F_mpz_mat_t A, const F_mpz_mat_t B)
+{
+	if ((P == A) || (P == B))
+	{
+		F_mpz_mat_t Pa;
+		F_mpz_mat_init(Pa, P->r, P->c);
+      _F_mpz_mat_mul(Pa, A, B);
+		F_mpz_mat_set(P, Pa);
+		F_mpz_mat_clear(Pa);
+	} else
+	   _F_mpz_mat_mul(P, A, B);
+}
+
 /*===========================================================
 
    assorted new functions
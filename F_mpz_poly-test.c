@@ -36,6 +36,7 @@ Copyright (C) 2008, William Hart
 #include "ZmodF_poly.h"
 #include "test-support.h"
 #include "zmod_poly.h"
+#include "thread-support.h"
 
 #define VARY_BITS 1 // random coefficients have random number of bits up to the limit given
 #define SIGNS 1 // random coefficients will be randomly signed
@@ -927,6 +928,53 @@ int test_F_mpz_poly_tofromstring()
    return result; 
 }
 
+#if TESTFILE
+int test_F_mpz_poly_fwrite_fread_binary()
+{
+   mpz_poly_t test_poly;
+   F_mpz_poly_t test_F_mpz_poly, test_F_mpz_poly2;
+   int result = 1;
+   unsigned long bits, length;
+   
+   mpz_poly_init(test_poly); 
+   
+   for (unsigned long count1 = 1; (count1 < 200) && (result == 1) ; count1++)
+   {
+      bits = z_randint(200)+ 1;
+      
+      F_mpz_poly_init(test_F_mpz_poly);
+      F_mpz_poly_init(test_F_mpz_poly2);
+      FILE * testfile; 
+      
+      for (unsigned long count2 = 0; (count2 < 10) && (result == 1); count2++)
+      { 
+          length = z_randint(3000);        
+#if DEBUG
+          printf("length = %ld, bits = %ld\n",length, bits);
+#endif
+          mpz_randpoly(test_poly, length, bits); 
+          mpz_poly_to_F_mpz_poly(test_F_mpz_poly, test_poly);
+          
+          testfile = fopen("testfile", "wb");
+          F_mpz_poly_fwrite_binary(test_F_mpz_poly, testfile);
+          fclose(testfile);
+          testfile = fopen("testfile", "rb");
+          int OK = F_mpz_poly_fread_binary(test_F_mpz_poly2, testfile);
+          fclose(testfile);
+          result = F_mpz_poly_equal(test_F_mpz_poly2, test_F_mpz_poly) && OK;
+      }
+      remove("testfile");
+            
+      F_mpz_poly_clear(test_F_mpz_poly);
+      F_mpz_poly_clear(test_F_mpz_poly2);         
+   }
+   
+   mpz_poly_clear(test_poly);
+   
+   return result; 
+}
+#endif
+
 int test_F_mpz_poly_neg()
 {
    F_mpz_poly_t F_poly1, F_poly2, F_poly3, F_poly4;
@@ -2283,6 +2331,40 @@ int test_F_mpz_poly_mul()
 		F_mpz_poly_clear(res);
    }
    
+   // long polynomials with enough threads to be multiplied multimodularly
+	for (ulong count1 = 0; (count1 < 5*ITER) && (result == 1) ; count1++)
+   {
+      F_mpz_poly_init(F_poly1);
+      F_mpz_poly_init(F_poly2);
+      F_mpz_poly_init(res);
+
+		bits1 = z_randint(100) + 240;
+      bits2 = z_randint(100) + 240;
+      length1 = z_randint(500) + F_MPZ_POLY_MODULAR_LENGTH;
+		length2 = z_randint(500) + F_MPZ_POLY_MODULAR_LENGTH;
+      mpz_randpoly(m_poly1, length1, bits1);
+      mpz_randpoly(m_poly2, length2, bits2);
+     
+      mpz_poly_to_F_mpz_poly(F_poly1, m_poly1);
+      mpz_poly_to_F_mpz_poly(F_poly2, m_poly2);
+      
+      flint_set_num_threads(F_MPZ_POLY_MODULAR_THREADS + z_randint(2));
+		F_mpz_poly_mul(res, F_poly1, F_poly2);
+      flint_set_num_threads(1);
+		F_mpz_poly_to_mpz_poly(res2, res);
+      mpz_poly_mul(res1, m_poly1, m_poly2);
+		    
+      result = mpz_poly_equal(res1, res2); 
+		if (!result) 
+		{
+			printf("Error: length1 = %ld, bits1 = %ld, length2 = %ld, bits2 = %ld\n", length1, bits1, length2, bits2);
+		}
+          
+      F_mpz_poly_clear(F_poly1);
+		F_mpz_poly_clear(F_poly2);
+		F_mpz_poly_clear(res);
+   }
+   
 	mpz_poly_clear(res1);
    mpz_poly_clear(res2);
    mpz_poly_clear(m_poly1);
@@ -3471,6 +3553,157 @@ int test_F_mpz_poly_mul_SS()
    return result;
 }
 
+int test_F_mpz_poly_mul_modular()
+{
+   mpz_poly_t m_poly1, m_poly2, res1, res2;
+   F_mpz_poly_t F_poly1, F_poly2, res;
+   int result = 1;
+   ulong bits1, bits2, length1, length2, threads;
+   
+   mpz_poly_init(m_poly1); 
+   mpz_poly_init(m_poly2); 
+   mpz_poly_init(res1); 
+   mpz_poly_init(res2); 
+
+   for (ulong count1 = 0; (count1 < 2000*ITER) && (result == 1) ; count1++)
+   {
+      F_mpz_poly_init(F_poly1);
+      F_mpz_poly_init(F_poly2);
+      F_mpz_poly_init(res);
+
+		bits1 = z_randint(300) + 1;
+      bits2 = z_randint(300) + 1;
+      length1 = z_randint(200);
+      length2 = z_randint(200);
+      threads = z_randint(4) + 1;
+      
+		mpz_randpoly(m_poly1, length1, bits1);
+		mpz_randpoly(m_poly2, length2, bits2);
+           
+      mpz_poly_to_F_mpz_poly(F_poly2, m_poly2);
+      mpz_poly_to_F_mpz_poly(F_poly1, m_poly1);
+      
+		F_mpz_poly_mul_modular_threads(res, F_poly1, F_poly2, threads);			
+		F_mpz_poly_to_mpz_poly(res2, res);
+      mpz_poly_mul_naive_KS(res1, m_poly1, m_poly2);		
+		    
+      result = mpz_poly_equal(res1, res2); 
+		if (!result) 
+		{
+			printf("Error: length1 = %ld, bits1 = %ld, length2 = %ld, bits2 = %ld, threads = %ld\n", length1, bits1, length2, bits2, threads);
+         mpz_poly_print_pretty(res1, "x"); printf("\n");
+         mpz_poly_print_pretty(res2, "x"); printf("\n");
+		}
+          
+      F_mpz_poly_clear(F_poly1);
+		F_mpz_poly_clear(F_poly2);
+		F_mpz_poly_clear(res);
+   }
+   
+	// try squaring with aliased output
+	for (ulong count1 = 0; (count1 < 500*ITER) && (result == 1) ; count1++)
+   {
+      F_mpz_poly_init(F_poly1);
+
+		bits1 = z_randint(300) + 1;
+      length1 = z_randint(200);
+      threads = z_randint(4) + 1;
+      
+		mpz_randpoly(m_poly1, length1, bits1);
+      mpz_poly_to_F_mpz_poly(F_poly1, m_poly1);
+      
+		F_mpz_poly_mul_modular_threads(F_poly1, F_poly1, F_poly1, threads);			
+		F_mpz_poly_to_mpz_poly(res2, F_poly1);
+      mpz_poly_mul_naive_KS(res1, m_poly1, m_poly1);		
+		    
+      result = mpz_poly_equal(res1, res2); 
+		if (!result) 
+		{
+			printf("Error: length1 = %ld, bits1 = %ld, threads = %ld\n", length1, bits1, threads);
+         mpz_poly_print_pretty(res1, "x"); printf("\n");
+         mpz_poly_print_pretty(res2, "x"); printf("\n");
+		}
+          
+      F_mpz_poly_clear(F_poly1);
+   }
+   
+   mpz_poly_clear(res1);
+   mpz_poly_clear(res2);
+   mpz_poly_clear(m_poly1);
+   mpz_poly_clear(m_poly2);
+   
+   return result;
+}
+
+int test_F_mpz_poly_mul_limb_file()
+{
+   mpz_poly_t m_poly1, m_poly2;
+   F_mpz_poly_t F_poly1, F_poly2, res1, res2;
+   int result = 1;
+   ulong bits1, bits2, length1, length2, limbs1, limbs2, limbs_out, trunc;
+   size_t memory;
+   
+   mpz_poly_init(m_poly1); 
+   mpz_poly_init(m_poly2); 
+
+   for (ulong count1 = 0; (count1 < 100*ITER) && (result == 1) ; count1++)
+   {
+      F_mpz_poly_init(F_poly1);
+      F_mpz_poly_init(F_poly2);
+      F_mpz_poly_init(res1);
+      F_mpz_poly_init(res2);
+
+		bits1 = z_randint(200) + 1;
+      bits2 = z_randint(200) + 1;
+      length1 = z_randint(1000);
+      length2 = z_randint(1000);
+      trunc = z_randint(length1 + length2 + 10);
+      memory = z_randint(100000) + 1; // small enough that the inputs get split
+      
+		mpz_randpoly(m_poly1, length1, bits1);
+		mpz_randpoly(m_poly2, length2, bits2);
+           
+      mpz_poly_to_F_mpz_poly(F_poly1, m_poly1);
+      mpz_poly_to_F_mpz_poly(F_poly2, m_poly2);
+      
+      limbs1 = bits1/FLINT_BITS + 1;
+      limbs2 = bits2/FLINT_BITS + 1 + z_randint(2);
+
+      F_mpz_poly_write_limb_file("F_mpz_poly_test_1.dat", F_poly1, limbs1);
+      F_mpz_poly_write_limb_file("F_mpz_poly_test_2.dat", F_poly2, limbs2);
+      
+      limbs_out = F_mpz_poly_mul_limb_file("F_mpz_poly_test_3.dat", "F_mpz_poly_test_1.dat", 
+                        limbs1, "F_mpz_poly_test_2.dat", limbs2, trunc, memory, ".");
+      F_mpz_poly_read_limb_file(res2, "F_mpz_poly_test_3.dat", limbs_out);
+		
+      F_mpz_poly_mul(res1, F_poly1, F_poly2);
+      F_mpz_poly_truncate(res1, trunc);
+		    
+      result = F_mpz_poly_equal(res1, res2); 
+		if (!result) 
+		{
+			printf("Error: length1 = %ld, bits1 = %ld, length2 = %ld, bits2 = %ld, trunc = %ld, memory = %ld\n", 
+                                               length1, bits1, length2, bits2, trunc, memory);
+         F_mpz_poly_print(res1); printf("\n");
+         F_mpz_poly_print(res2); printf("\n");
+		}
+          
+      F_mpz_poly_clear(F_poly1);
+		F_mpz_poly_clear(F_poly2);
+		F_mpz_poly_clear(res1);
+		F_mpz_poly_clear(res2);
+   }
+   
+   remove("F_mpz_poly_test_1.dat");
+   remove("F_mpz_poly_test_2.dat");
+   remove("F_mpz_poly_test_3.dat");
+
+   mpz_poly_clear(m_poly1);
+   mpz_poly_clear(m_poly2);
+   
+   return result;
+}
+
 int test_F_mpz_poly_pack_bytes()
 {
    mpz_poly_t m_poly, m_poly2;
@@ -4465,6 +4698,8 @@ void F_mpz_poly_test_all()
    printf("FLINT_BITS = %ld\n", FLINT_BITS);
 
 #if TESTFILE
+   RUN_TEST(F_mpz_poly_fwrite_fread_binary); 
+   RUN_TEST(F_mpz_poly_mul_limb_file); 
 #endif
 	
    RUN_TEST(F_mpz_poly_convert); 
@@ -4500,6 +4735,7 @@ void F_mpz_poly_test_all()
    RUN_TEST(F_mpz_poly_mul_KS); 
    RUN_TEST(F_mpz_poly_mul_KS2);
    RUN_TEST(F_mpz_poly_mul_SS); 
+   RUN_TEST(F_mpz_poly_mul_modular); 
    RUN_TEST(F_mpz_poly_mul); 
    RUN_TEST(F_mpz_poly_mul_trunc_left); 
    RUN_TEST(F_mpz_poly_pack_bytes); 
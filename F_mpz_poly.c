@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <math.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -44,6 +45,8 @@
 #include "memory-manager.h"
 #include "ZmodF_poly.h"
 #include "long_extras.h"
+#include "thread-support.h"
+#include "binary-io.h"
 #include "zmod_poly.h"
 #include "F_mpz_mat.h"
 #include "F_mpz_LLL_fast_d.h"
@@ -427,6 +430,81 @@ int F_mpz_poly_fread(F_mpz_poly_t poly, FILE* f)
    return ok;
 }
 
+/*
+   The payload consists of the coefficients in the limb file format (see 
+   F_mpz_poly_write_limb_file), with just enough limbs to store the largest
+   coefficient in two's complement. We convert this many coefficients at a 
+   time.
+*/
+#define F_MPZ_POLY_BINARY_CHUNK 1024
+
+int F_mpz_poly_fwrite_binary(const F_mpz_poly_t poly, FILE* f)
+{
+   flint_binary_header_t header;
+   long bits = F_mpz_poly_max_bits(poly);
+   ulong limbs = FLINT_ABS(bits)/FLINT_BITS + 1;
+
+   header->type = FLINT_BINARY_F_MPZ_POLY;
+   header->length = poly->length;
+   header->bits = bits;
+   header->modulus = 0L;
+   header->limbs = limbs;
+
+   if (!flint_binary_header_fwrite(header, f)) return 0;
+   
+   mp_limb_t * buf = (mp_limb_t *) flint_heap_alloc(F_MPZ_POLY_BINARY_CHUNK*limbs);
+   int ok = 1;
+
+   for (ulong i = 0; (i < poly->length) && ok; i += F_MPZ_POLY_BINARY_CHUNK)
+   {
+      ulong n = FLINT_MIN(F_MPZ_POLY_BINARY_CHUNK, poly->length - i);
+      for (ulong j = 0; j < n; j++)
+         F_mpz_get_limbs_signed(buf + j*limbs, poly->coeffs + i + j, limbs);
+      ok = flint_binary_limbs_fwrite(buf, n*limbs, f);
+   }
+
+   flint_heap_free(buf);
+
+   return ok;
+}
+
+int F_mpz_poly_fread_binary(F_mpz_poly_t poly, FILE* f)
+{
+   flint_binary_header_t header;
+
+   if (!flint_binary_header_fread(header, f)) return 0;
+   if ((header->type != FLINT_BINARY_F_MPZ_POLY) || (header->limbs == 0)) return 0;
+
+   ulong limbs = header->limbs;
+   
+   F_mpz_poly_fit_length(poly, header->length);
+   
+   mp_limb_t * buf = (mp_limb_t *) flint_heap_alloc(F_MPZ_POLY_BINARY_CHUNK*limbs);
+   int ok = 1;
+   
+   for (ulong i = 0; (i < header->length) && ok; i += F_MPZ_POLY_BINARY_CHUNK)
+   {
+      ulong n = FLINT_MIN(F_MPZ_POLY_BINARY_CHUNK, header->length - i);
+      ok = flint_binary_limbs_fread(buf, n*limbs, f);
+      for (ulong j = 0; (j < n) && ok; j++)
+         F_mpz_set_limbs_signed(poly->coeffs + i + j, buf + j*limbs, limbs);
+   }
+
+   flint_heap_free(buf);
+   
+   _F_mpz_poly_set_length(poly, header->length);
+   
+   if (!ok) // release any coefficients which were read
+   {
+      F_mpz_poly_zero(poly);
+      return 0;
+   }
+   
+   _F_mpz_poly_normalise(poly);
+
+   return 1;
+}
+
 /*===============================================================================
 
 	Assignment/swap
@@ -4125,6 +4203,640 @@ void F_mpz_poly_mul_SS(F_mpz_poly_t res, const F_mpz_poly_t poly1, const F_mpz_p
 	}		
 }
 
+/*===============================================================================
+
+	Multimodular multiplication
+
+================================================================================*/
+
+/*
+   Work description for a single thread of _F_mpz_poly_mul_modular. Threads 
+   reducing coefficients or recombining them by CRT deal with coefficients
+   [start, stop), threads multiplying deal with primes [start, stop).
+*/
+typedef struct
+{
+   F_mpz_poly_struct * poly; // polynomial being reduced or reconstructed
+   ulong * residues; // residues, stored as one array of length len for each prime
+   ulong len;
+   ulong * in1; // reduced inputs and output for the multiplication phase
+   ulong len1;
+   ulong * in2;
+   ulong len2;
+   ulong * out;
+   F_mpz_comb_struct * comb;
+   ulong start;
+   ulong stop;
+} F_mpz_poly_modular_arg_t;
+
+void _F_mpz_poly_modular_reduce_worker(void * arg_void)
+{
+   F_mpz_poly_modular_arg_t * arg = (F_mpz_poly_modular_arg_t *) arg_void;
+   F_mpz_comb_struct * comb = arg->comb;
+   ulong num_primes = comb->num_primes;
+   
+   F_mpz ** comb_temp = F_mpz_comb_temp_init(comb);
+   F_mpz_t temp;
+   F_mpz_init(temp);
+   ulong * res = (ulong *) flint_heap_alloc(num_primes);
+   
+   for (ulong i = arg->start; i < arg->stop; i++)
+   {
+      F_mpz_multi_mod_ui(res, arg->poly->coeffs + i, comb, comb_temp, temp);
+      for (ulong j = 0; j < num_primes; j++)
+         arg->residues[j*arg->len + i] = res[j];
+   }
+
+   flint_heap_free(res);
+   F_mpz_clear(temp);
+   F_mpz_comb_temp_free(comb, comb_temp);
+}
+
+void _F_mpz_poly_modular_mul_worker(void * arg_void)
+{
+   F_mpz_poly_modular_arg_t * arg = (F_mpz_poly_modular_arg_t *) arg_void;
+   ulong len_out = arg->len1 + arg->len2 - 1;
+   
+   for (ulong j = arg->start; j < arg->stop; j++)
+   {
+      ulong * in2 = (arg->in1 == arg->in2) ? arg->in1 + j*arg->len1 : arg->in2 + j*arg->len2;
+      zn_array_mul(arg->out + j*len_out, arg->in1 + j*arg->len1, arg->len1, 
+                                         in2, arg->len2, arg->comb->mod[j]);
+   }
+}
+
+void _F_mpz_poly_modular_CRT_worker(void * arg_void)
+{
+   F_mpz_poly_modular_arg_t * arg = (F_mpz_poly_modular_arg_t *) arg_void;
+   F_mpz_comb_struct * comb = arg->comb;
+   ulong num_primes = comb->num_primes;
+   
+   F_mpz ** comb_temp = F_mpz_comb_temp_init(comb);
+   F_mpz_t temp, temp2;
+   F_mpz_init(temp);
+   F_mpz_init(temp2);
+   ulong * res = (ulong *) flint_heap_alloc(num_primes);
+   
+   for (ulong i = arg->start; i < arg->stop; i++)
+   {
+      for (ulong j = 0; j < num_primes; j++)
+         res[j] = arg->residues[j*arg->len + i];
+      F_mpz_multi_CRT_ui(arg->poly->coeffs + i, res, comb, comb_temp, temp, temp2);
+   }
+
+   flint_heap_free(res);
+   F_mpz_clear(temp2);
+   F_mpz_clear(temp);
+   F_mpz_comb_temp_free(comb, comb_temp);
+}
+
+/*
+   Split the range [0, total) into at most the given number of pieces, filling 
+   in start and stop in each of the args (whose other fields must be set) and
+   call fn on each piece in parallel.
+*/
+void _F_mpz_poly_modular_run(void (*fn)(void *), F_mpz_poly_modular_arg_t * args, 
+                             ulong threads, ulong total)
+{
+   if (threads > total) threads = total;
+
+   for (ulong t = 0; t < threads; t++)
+   {
+      if (t) args[t] = args[0];
+      args[t].start = (total*t)/threads;
+      args[t].stop = (total*(t + 1))/threads;
+   }
+
+   flint_parallel_do(fn, args, sizeof(F_mpz_poly_modular_arg_t), threads);
+}
+
+void _F_mpz_poly_mul_modular(F_mpz_poly_t output, const F_mpz_poly_t input1, 
+                   const F_mpz_poly_t input2, const long bits_in, ulong threads)
+{
+   ulong len1 = input1->length;
+   ulong len2 = input2->length;
+
+   if ((len1 == 0) || (len2 == 0)) 
+   {
+      F_mpz_poly_zero(output);
+      return;
+   }
+   
+   if (len1 < len2) // zn_array_mul requires the longer input first
+   {
+      const F_mpz_poly_struct * t = input1;
+      input1 = input2;
+      input2 = t;
+      len1 = input1->length;
+      len2 = input2->length;
+   }
+
+   ulong len_out = len1 + len2 - 1;
+   ulong bits;
+
+   if (bits_in) bits = FLINT_ABS(bits_in);
+   else
+   {
+      ulong log_length = 0;
+      while ((1L<<log_length) < len2) log_length++;
+      bits = FLINT_ABS(F_mpz_poly_max_bits(input1)) 
+           + FLINT_ABS(F_mpz_poly_max_bits(input2)) + log_length + 1;
+   }
+
+   /* 
+      Each prime is at least 2^(FLINT_BITS - 2) and the signed output 
+      coefficients need bits + 1 bits. We always use at least two primes so
+      that the comb is non-trivial.
+   */
+   ulong num_primes = (bits + 1)/(FLINT_BITS - 2) + 1;
+   if (num_primes < 2) num_primes = 2;
+   
+   ulong * primes = (ulong *) flint_heap_alloc(num_primes);
+   primes[0] = z_nextprime(1L << (FLINT_BITS - 2), 0);
+   for (ulong i = 1; i < num_primes; i++)
+      primes[i] = z_nextprime(primes[i - 1], 0);
+
+   F_mpz_comb_t comb;
+   F_mpz_comb_init(comb, primes, num_primes);
+   
+   if (threads < 1) threads = 1;
+   F_mpz_poly_modular_arg_t * args = (F_mpz_poly_modular_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(F_mpz_poly_modular_arg_t));
+   
+   ulong * in1 = (ulong *) flint_heap_alloc(num_primes*len1);
+   ulong * in2 = (input1 == input2) ? in1 : (ulong *) flint_heap_alloc(num_primes*len2);
+   ulong * out = (ulong *) flint_heap_alloc(num_primes*len_out);
+   
+   // reduce inputs modulo each of the primes
+   args[0].comb = comb;
+   args[0].poly = (F_mpz_poly_struct *) input1;
+   args[0].residues = in1;
+   args[0].len = len1;
+   _F_mpz_poly_modular_run(_F_mpz_poly_modular_reduce_worker, args, threads, len1);
+   
+   if (input1 != input2)
+   {
+      args[0].poly = (F_mpz_poly_struct *) input2;
+      args[0].residues = in2;
+      args[0].len = len2;
+      _F_mpz_poly_modular_run(_F_mpz_poly_modular_reduce_worker, args, threads, len2);
+   }
+
+   // multiply modulo each prime
+   args[0].in1 = in1;
+   args[0].len1 = len1;
+   args[0].in2 = in2;
+   args[0].len2 = len2;
+   args[0].out = out;
+   _F_mpz_poly_modular_run(_F_mpz_poly_modular_mul_worker, args, threads, num_primes);
+   
+   // recombine the output coefficients
+   F_mpz_poly_fit_length(output, len_out);
+   args[0].poly = output;
+   args[0].residues = out;
+   args[0].len = len_out;
+   _F_mpz_poly_modular_run(_F_mpz_poly_modular_CRT_worker, args, threads, len_out);
+
+   _F_mpz_poly_set_length(output, len_out);
+   _F_mpz_poly_normalise(output);
+
+   flint_heap_free(out);
+   if (input1 != input2) flint_heap_free(in2);
+   flint_heap_free(in1);
+   flint_heap_free(args);
+   F_mpz_comb_clear(comb);
+   flint_heap_free(primes);
+}
+
+void F_mpz_poly_mul_modular_threads(F_mpz_poly_t res, const F_mpz_poly_t poly1, 
+                                   const F_mpz_poly_t poly2, ulong threads)
+{
+	if ((poly1->length == 0) || (poly2->length == 0)) // special case if either poly is zero
+   {
+      F_mpz_poly_zero(res);
+      return;
+   }
+
+	if ((poly1 == res) || (poly2 == res)) // aliased inputs
+	{
+		F_mpz_poly_t output; // create temporary
+		F_mpz_poly_init2(output, poly1->length + poly2->length - 1);
+		_F_mpz_poly_mul_modular(output, poly1, poly2, 0, threads);
+		F_mpz_poly_swap(output, res); // swap temporary with real output
+		F_mpz_poly_clear(output);
+	} else // ordinary case
+	{
+		_F_mpz_poly_mul_modular(res, poly1, poly2, 0, threads);
+	}		
+}
+
+void F_mpz_poly_mul_modular(F_mpz_poly_t res, const F_mpz_poly_t poly1, const F_mpz_poly_t poly2)
+{
+   F_mpz_poly_mul_modular_threads(res, poly1, poly2, flint_get_num_threads());
+}
+
+/*===============================================================================
+
+	Out-of-core multiplication
+
+================================================================================*/
+
+/*
+   Smallest length of the pieces into which the polynomials are split in 
+   F_mpz_poly_mul_limb_file when the memory budget is too small to do the
+   product modulo each prime in one go.
+*/
+#define F_MPZ_POLY_FILE_MIN_BLOCK 256
+
+/*
+   Open (and if create is set, create or truncate) the given file. If size is 
+   nonzero the file is extended to that many bytes.
+*/
+int _F_mpz_poly_file_open(const char * name, size_t size, int create)
+{
+   int fd;
+   
+   if (create) fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   else fd = open(name, O_RDONLY);
+   
+   if (fd < 0)
+   {
+      printf("Error: unable to open file %s\n", name);
+      abort();
+   }
+
+   if (size)
+   {
+      char zero = 0;
+      if ((lseek(fd, size - 1, SEEK_SET) == (off_t) -1) || (write(fd, &zero, 1) != 1))
+      {
+         printf("Error: unable to extend file %s\n", name);
+         abort();
+      }
+   }
+
+   return fd;
+}
+
+/*
+   Create a file of the given size in dir for scratch space. It is unlinked 
+   immediately so that it disappears when closed.
+*/
+int _F_mpz_poly_scratch_open(const char * dir, size_t size)
+{
+   char * name = (char *) flint_heap_alloc_bytes(strlen(dir) + 64);
+   int fd;
+
+   for (ulong k = 0; ; k++)
+   {
+      sprintf(name, "%s/flint-scratch-%ld-%ld", dir, (long) getpid(), k);
+      fd = open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (fd >= 0) break;
+      if (errno != EEXIST)
+      {
+         printf("Error: unable to create scratch file %s\n", name);
+         abort();
+      }
+   }
+   
+   unlink(name);
+   flint_heap_free(name);
+   
+   char zero = 0;
+   if ((lseek(fd, size - 1, SEEK_SET) == (off_t) -1) || (write(fd, &zero, 1) != 1))
+   {
+      printf("Error: unable to extend scratch file in %s\n", dir);
+      abort();
+   }
+
+   return fd;
+}
+
+void * _F_mpz_poly_file_map(int fd, size_t size, int writeable)
+{
+   void * map = mmap(NULL, size, writeable ? (PROT_READ | PROT_WRITE) : PROT_READ, 
+                                                                MAP_SHARED, fd, 0);
+   if (map == MAP_FAILED)
+   {
+      printf("Error: unable to map file\n");
+      abort();
+   }
+   
+   return map;
+}
+
+void F_mpz_poly_write_limb_file(const char * name, const F_mpz_poly_t poly, ulong limbs)
+{
+   size_t size = poly->length*limbs*sizeof(mp_limb_t);
+   int fd = _F_mpz_poly_file_open(name, size, 1);
+   
+   if (size)
+   {
+      mp_limb_t * map = (mp_limb_t *) _F_mpz_poly_file_map(fd, size, 1);
+      
+      for (ulong i = 0; i < poly->length; i++)
+      {
+         if (F_mpz_bits(poly->coeffs + i) >= FLINT_BITS*limbs)
+         {
+            printf("Error: coefficient does not fit in %ld limbs\n", limbs);
+            abort();
+         }
+         F_mpz_get_limbs_signed(map + i*limbs, poly->coeffs + i, limbs);
+      }
+
+      munmap(map, size);
+   }
+
+   close(fd);
+}
+
+void F_mpz_poly_read_limb_file(F_mpz_poly_t poly, const char * name, ulong limbs)
+{
+   int fd = _F_mpz_poly_file_open(name, 0, 0);
+   size_t size = lseek(fd, 0, SEEK_END);
+   ulong length = size/(limbs*sizeof(mp_limb_t));
+   
+   F_mpz_poly_fit_length(poly, length);
+   
+   if (length)
+   {
+      mp_limb_t * map = (mp_limb_t *) _F_mpz_poly_file_map(fd, size, 0);
+      for (ulong i = 0; i < length; i++)
+         F_mpz_set_limbs_signed(poly->coeffs + i, map + i*limbs, limbs);
+
+      munmap(map, size);
+   }
+
+   close(fd);
+   
+   _F_mpz_poly_set_length(poly, length);
+   _F_mpz_poly_normalise(poly);
+}
+
+/*
+   Work description for a single thread of F_mpz_poly_mul_limb_file. Threads 
+   reducing or recombining coefficients deal with coefficients [start, stop), 
+   threads multiplying deal with primes [start, stop).
+*/
+typedef struct
+{
+   mp_limb_t * coeffs; // mapped coefficient file and limbs per coefficient
+   ulong limbs;
+   ulong * residues; // mapped residues, one row of length len for each prime
+   ulong len;
+   ulong * in1; // mapped residues of inputs and output for multiplication
+   ulong len1;
+   ulong * in2;
+   ulong len2;
+   ulong * out;
+   ulong trunc;
+   ulong block; // length of pieces to split inputs into
+   F_mpz_comb_struct * comb;
+   ulong start;
+   ulong stop;
+} F_mpz_poly_file_arg_t;
+
+void _F_mpz_poly_file_reduce_worker(void * arg_void)
+{
+   F_mpz_poly_file_arg_t * arg = (F_mpz_poly_file_arg_t *) arg_void;
+   F_mpz_comb_struct * comb = arg->comb;
+   ulong num_primes = comb->num_primes;
+   
+   F_mpz ** comb_temp = F_mpz_comb_temp_init(comb);
+   F_mpz_t temp, c;
+   F_mpz_init(temp);
+   F_mpz_init(c);
+   ulong * res = (ulong *) flint_heap_alloc(num_primes);
+   
+   for (ulong i = arg->start; i < arg->stop; i++)
+   {
+      F_mpz_set_limbs_signed(c, arg->coeffs + i*arg->limbs, arg->limbs);
+      F_mpz_multi_mod_ui(res, c, comb, comb_temp, temp);
+      for (ulong j = 0; j < num_primes; j++)
+         arg->residues[j*arg->len + i] = res[j];
+   }
+
+   flint_heap_free(res);
+   F_mpz_clear(c);
+   F_mpz_clear(temp);
+   F_mpz_comb_temp_free(comb, comb_temp);
+}
+
+void _F_mpz_poly_file_mul_worker(void * arg_void)
+{
+   F_mpz_poly_file_arg_t * arg = (F_mpz_poly_file_arg_t *) arg_void;
+   ulong block = arg->block;
+   ulong trunc = arg->trunc;
+   ulong * temp = (ulong *) flint_heap_alloc(2*block);
+   
+   for (ulong j = arg->start; j < arg->stop; j++)
+   {
+      ulong * in1 = arg->in1 + j*arg->len1;
+      ulong * in2 = arg->in2 + j*arg->len2;
+      ulong * out = arg->out + j*trunc;
+      const zn_mod_struct * mod = arg->comb->mod[j];
+      
+      // multiply each piece of in1 by each piece of in2 and accumulate
+      for (ulong i1 = 0; i1 < arg->len1; i1 += block)
+      {
+         for (ulong i2 = 0; (i2 < arg->len2) && (i1 + i2 < trunc); i2 += block)
+         {
+            ulong n1 = FLINT_MIN(block, arg->len1 - i1);
+            ulong n2 = FLINT_MIN(block, arg->len2 - i2);
+            
+            if (n1 >= n2) zn_array_mul(temp, in1 + i1, n1, in2 + i2, n2, mod);
+            else zn_array_mul(temp, in2 + i2, n2, in1 + i1, n1, mod);
+            
+            ulong n = FLINT_MIN(n1 + n2 - 1, trunc - i1 - i2);
+            for (ulong k = 0; k < n; k++)
+               out[i1 + i2 + k] = zn_mod_add(out[i1 + i2 + k], temp[k], mod);
+         }
+      }
+   }
+
+   flint_heap_free(temp);
+}
+
+void _F_mpz_poly_file_CRT_worker(void * arg_void)
+{
+   F_mpz_poly_file_arg_t * arg = (F_mpz_poly_file_arg_t *) arg_void;
+   F_mpz_comb_struct * comb = arg->comb;
+   ulong num_primes = comb->num_primes;
+   
+   F_mpz ** comb_temp = F_mpz_comb_temp_init(comb);
+   F_mpz_t temp, temp2, c;
+   F_mpz_init(temp);
+   F_mpz_init(temp2);
+   F_mpz_init(c);
+   ulong * res = (ulong *) flint_heap_alloc(num_primes);
+   
+   for (ulong i = arg->start; i < arg->stop; i++)
+   {
+      for (ulong j = 0; j < num_primes; j++)
+         res[j] = arg->residues[j*arg->len + i];
+      F_mpz_multi_CRT_ui(c, res, comb, comb_temp, temp, temp2);
+      F_mpz_get_limbs_signed(arg->coeffs + i*arg->limbs, c, arg->limbs);
+   }
+
+   flint_heap_free(res);
+   F_mpz_clear(c);
+   F_mpz_clear(temp2);
+   F_mpz_clear(temp);
+   F_mpz_comb_temp_free(comb, comb_temp);
+}
+
+/*
+   Split the range [0, total) into at most the given number of pieces, filling 
+   in start and stop in each of the args (whose other fields must be set) and
+   call fn on each piece in parallel.
+*/
+void _F_mpz_poly_file_run(void (*fn)(void *), F_mpz_poly_file_arg_t * args, 
+                          ulong threads, ulong total)
+{
+   if (threads > total) threads = total;
+
+   for (ulong t = 0; t < threads; t++)
+   {
+      if (t) args[t] = args[0];
+      args[t].start = (total*t)/threads;
+      args[t].stop = (total*(t + 1))/threads;
+   }
+
+   flint_parallel_do(fn, args, sizeof(F_mpz_poly_file_arg_t), threads);
+}
+
+/*
+   Reduce the coefficients in the file fd, of the given length and number of
+   limbs, modulo the primes in comb. The residues are written to a new scratch 
+   file in dir, one row of length entries for each prime, which is returned
+   mapped in *residues.
+*/
+int _F_mpz_poly_file_reduce(ulong ** residues, int fd, ulong length, ulong limbs, 
+                 F_mpz_comb_t comb, const char * dir, F_mpz_poly_file_arg_t * args, ulong threads)
+{
+   size_t size = length*limbs*sizeof(mp_limb_t);
+   size_t res_size = comb->num_primes*length*sizeof(ulong);
+   
+   int res_fd = _F_mpz_poly_scratch_open(dir, res_size);
+   (*residues) = (ulong *) _F_mpz_poly_file_map(res_fd, res_size, 1);
+   
+   args[0].coeffs = (mp_limb_t *) _F_mpz_poly_file_map(fd, size, 0);
+   args[0].limbs = limbs;
+   args[0].residues = *residues;
+   args[0].len = length;
+   args[0].comb = comb;
+   _F_mpz_poly_file_run(_F_mpz_poly_file_reduce_worker, args, threads, length);
+   
+   munmap(args[0].coeffs, size);
+
+   return res_fd;
+}
+
+ulong F_mpz_poly_mul_limb_file(const char * out_name, const char * name1, ulong limbs1,
+              const char * name2, ulong limbs2, ulong trunc, size_t memory, const char * dir)
+{
+   int fd1 = _F_mpz_poly_file_open(name1, 0, 0);
+   int fd2 = _F_mpz_poly_file_open(name2, 0, 0);
+   ulong len1 = lseek(fd1, 0, SEEK_END)/(limbs1*sizeof(mp_limb_t));
+   ulong len2 = lseek(fd2, 0, SEEK_END)/(limbs2*sizeof(mp_limb_t));
+   
+   /* 
+      Each input coefficient has absolute value less than 2^(FLINT_BITS*limbs - 1)
+      so the output coefficients need this many bits, including a sign bit.
+   */
+   ulong log_length = 0;
+   while ((1L<<log_length) < FLINT_MIN(len1, len2)) log_length++;
+   ulong bits = FLINT_BITS*(limbs1 + limbs2) - 1 + log_length;
+   ulong limbs_out = (bits - 1)/FLINT_BITS + 1;
+
+   if ((len1 == 0) || (len2 == 0) || (trunc == 0)) // product is zero
+   {
+      close(_F_mpz_poly_file_open(out_name, 0, 1));
+      close(fd1);
+      close(fd2);
+      return limbs_out;
+   }
+
+   ulong len_out = len1 + len2 - 1;
+   if (trunc > len_out) trunc = len_out;
+      
+   // primes of FLINT_BITS - 1 bits, as for _F_mpz_poly_mul_modular
+   ulong num_primes = bits/(FLINT_BITS - 2) + 1;
+   if (num_primes < 2) num_primes = 2;
+   
+   ulong * primes = (ulong *) flint_heap_alloc(num_primes);
+   primes[0] = z_nextprime(1L << (FLINT_BITS - 2), 0);
+   for (ulong i = 1; i < num_primes; i++)
+      primes[i] = z_nextprime(primes[i - 1], 0);
+
+   F_mpz_comb_t comb;
+   F_mpz_comb_init(comb, primes, num_primes);
+   
+   ulong threads = flint_get_num_threads();
+   F_mpz_poly_file_arg_t * args = (F_mpz_poly_file_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(F_mpz_poly_file_arg_t));
+   
+   // reduce the inputs into scratch files
+   ulong * res1, * res2, * res_out;
+   int res1_fd = _F_mpz_poly_file_reduce(&res1, fd1, len1, limbs1, comb, dir, args, threads);
+   int res2_fd = _F_mpz_poly_file_reduce(&res2, fd2, len2, limbs2, comb, dir, args, threads);
+   close(fd1);
+   close(fd2);
+
+   /*
+      Each thread doing products needs roughly 8*block words for the product 
+      of two pieces of length block and zn_poly's scratch space. Use as many 
+      threads as the memory budget allows, then split the inputs into pieces
+      as long as the remaining budget allows.
+   */
+   ulong mul_threads = FLINT_MIN(threads, num_primes);
+   ulong max_threads = memory/(8*sizeof(ulong)*F_MPZ_POLY_FILE_MIN_BLOCK);
+   if (mul_threads > max_threads) mul_threads = FLINT_MAX(max_threads, 1L);
+   ulong block = memory/(8*sizeof(ulong)*mul_threads);
+   if (block < F_MPZ_POLY_FILE_MIN_BLOCK) block = F_MPZ_POLY_FILE_MIN_BLOCK;
+   if (block > FLINT_MAX(len1, len2)) block = FLINT_MAX(len1, len2);
+
+   size_t res_out_size = num_primes*trunc*sizeof(ulong);
+   int res_out_fd = _F_mpz_poly_scratch_open(dir, res_out_size);
+   res_out = (ulong *) _F_mpz_poly_file_map(res_out_fd, res_out_size, 1);
+   
+   // multiply modulo each prime
+   args[0].in1 = res1;
+   args[0].len1 = len1;
+   args[0].in2 = res2;
+   args[0].len2 = len2;
+   args[0].out = res_out;
+   args[0].trunc = trunc;
+   args[0].block = block;
+   _F_mpz_poly_file_run(_F_mpz_poly_file_mul_worker, args, mul_threads, num_primes);
+   
+   munmap(res1, num_primes*len1*sizeof(ulong));
+   munmap(res2, num_primes*len2*sizeof(ulong));
+   close(res1_fd);
+   close(res2_fd);
+
+   // recombine into the output file
+   size_t out_size = trunc*limbs_out*sizeof(mp_limb_t);
+   int out_fd = _F_mpz_poly_file_open(out_name, out_size, 1);
+   
+   args[0].coeffs = (mp_limb_t *) _F_mpz_poly_file_map(out_fd, out_size, 1);
+   args[0].limbs = limbs_out;
+   args[0].residues = res_out;
+   args[0].len = trunc;
+   _F_mpz_poly_file_run(_F_mpz_poly_file_CRT_worker, args, threads, trunc);
+   
+   munmap(args[0].coeffs, out_size);
+   close(out_fd);
+   munmap(res_out, res_out_size);
+   close(res_out_fd);
+
+   flint_heap_free(args);
+   F_mpz_comb_clear(comb);
+   flint_heap_free(primes);
+
+   return limbs_out;
+}
+
 /*===============================================================================
 
 	Multiplication
@@ -4188,6 +4900,13 @@ void _F_mpz_poly_mul(F_mpz_poly_t output, const F_mpz_poly_t input1, const F_mpz
       return;
    } 
    
+   ulong threads = flint_get_num_threads();
+   if ((threads >= F_MPZ_POLY_MODULAR_THREADS) && (length >= F_MPZ_POLY_MODULAR_LENGTH))
+   {
+      _F_mpz_poly_mul_modular(output, input1, input2, bits, threads);
+      return;
+   }
+
    _F_mpz_poly_mul_KS(output, input1, input2, bits);     
 }
 
@@ -7146,6 +7865,11 @@ int F_mpz_poly_factor_sq_fr_vHN(F_mpz_poly_factor_t final_fac, F_mpz_poly_factor
             cexpo[r + col_cnt] = ok;
 //         F_mpz_mat_print_pretty(M);
             newd = LLL_heuristic_d_2exp_with_removal(M, cexpo, B);
+            if (newd < 0L)
+            {
+               printf("Error: LLL failed to reduce the knapsack lattice in F_mpz_poly_factor\n");
+               abort();
+            }
             F_mpz_mat_resize(M, newd, M->c);
             col_cnt++;
 //         This next line is what makes it 'gradual'... could try to prove that doing the same column twice won't add another P
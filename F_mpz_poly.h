@@ -466,6 +466,20 @@ void F_mpz_poly_print_pretty(const F_mpz_poly_t poly, const char * x);
 */
 int F_mpz_poly_fread(F_mpz_poly_t poly, FILE* f);
 
+/** 
+   \fn     int F_mpz_poly_fwrite_binary(const F_mpz_poly_t poly, FILE* f)
+   \brief  Writes poly to the file stream f in the binary format described in 
+           binary-io.h. Returns 1 on success, 0 on failure.
+*/
+int F_mpz_poly_fwrite_binary(const F_mpz_poly_t poly, FILE* f);
+
+/** 
+   \fn     int F_mpz_poly_fread_binary(F_mpz_poly_t poly, FILE* f)
+   \brief  Reads poly from the file stream f in the binary format described in 
+           binary-io.h. Returns 1 on success, 0 on failure.
+*/
+int F_mpz_poly_fread_binary(F_mpz_poly_t poly, FILE* f);
+
 /**
    \fn     void F_mpz_poly_print(F_mpz_poly_t poly)
    \brief  Print a polynomial to stdout. Format is an integer
@@ -921,6 +935,80 @@ void F_mpz_poly_mul_KS2(F_mpz_poly_t res, const F_mpz_poly_t poly1, const F_mpz_
 */
 void F_mpz_poly_mul_SS(F_mpz_poly_t res, const F_mpz_poly_t poly1, const F_mpz_poly_t poly2);
 
+/*
+   Serially the multimodular algorithm is slower than KS, but the products
+   modulo each prime are independent, so for long polynomials F_mpz_poly_mul
+   uses it once this many threads are set and the shorter input is at least
+   this long.
+*/
+#define F_MPZ_POLY_MODULAR_THREADS 4
+#define F_MPZ_POLY_MODULAR_LENGTH 4096
+
+/**
+   \fn     void F_mpz_poly_mul_modular_threads(F_mpz_poly_t res, const F_mpz_poly_t poly1,
+                                            const F_mpz_poly_t poly2, ulong threads)
+   \brief  Multiply poly1 by poly2 and set res to the result, by multiplying modulo
+           sufficiently many word sized primes and recombining with the Chinese
+           remainder theorem. Reduction, the products modulo each prime and
+           recombination are each split among the given number of threads.
+*/
+void _F_mpz_poly_mul_modular(F_mpz_poly_t output, const F_mpz_poly_t input1,
+                   const F_mpz_poly_t input2, const long bits_in, ulong threads);
+void F_mpz_poly_mul_modular_threads(F_mpz_poly_t res, const F_mpz_poly_t poly1,
+                                   const F_mpz_poly_t poly2, ulong threads);
+
+/**
+   \fn     void F_mpz_poly_mul_modular(F_mpz_poly_t res, const F_mpz_poly_t poly1,
+                                                    const F_mpz_poly_t poly2)
+   \brief  As for F_mpz_poly_mul_modular_threads, using the number of threads set by
+           flint_set_num_threads.
+*/
+void F_mpz_poly_mul_modular(F_mpz_poly_t res, const F_mpz_poly_t poly1, const F_mpz_poly_t poly2);
+
+/*===============================================================================
+
+	Out-of-core multiplication
+
+   A limb file stores the coefficients of a polynomial, constant coefficient
+   first, each in two's complement in a fixed number of limbs, least
+   significant limb first, in native byte order.
+
+================================================================================*/
+
+/**
+   \fn     void F_mpz_poly_write_limb_file(const char * name, const F_mpz_poly_t poly,
+                                                                   ulong limbs)
+   \brief  Write poly to the given limb file, with the given number of limbs per
+           coefficient. Every coefficient must fit in a signed integer of that size.
+*/
+void F_mpz_poly_write_limb_file(const char * name, const F_mpz_poly_t poly, ulong limbs);
+
+/**
+   \fn     void F_mpz_poly_read_limb_file(F_mpz_poly_t poly, const char * name, ulong limbs)
+   \brief  Set poly to the polynomial stored in the given limb file, which has the
+           given number of limbs per coefficient.
+*/
+void F_mpz_poly_read_limb_file(F_mpz_poly_t poly, const char * name, ulong limbs);
+
+/**
+   \fn     ulong F_mpz_poly_mul_limb_file(const char * out_name, const char * name1,
+                    ulong limbs1, const char * name2, ulong limbs2, ulong trunc,
+                                               size_t memory, const char * dir)
+   \brief  Multiply the polynomials in the limb files name1 and name2, with limbs1
+           and limbs2 limbs per coefficient respectively, and write the first trunc
+           coefficients of the product to the limb file out_name. The number of
+           limbs per output coefficient is returned.
+
+           The inputs are reduced modulo word sized primes into memory mapped
+           scratch files in the directory dir, which are multiplied modulo each
+           prime and recombined by CRT into the output file. The polynomials need
+           not fit in memory. The heap memory used for the products modulo each
+           prime is kept to roughly the given number of bytes, by limiting the
+           number of threads working on them and splitting the inputs into pieces.
+*/
+ulong F_mpz_poly_mul_limb_file(const char * out_name, const char * name1, ulong limbs1,
+              const char * name2, ulong limbs2, ulong trunc, size_t memory, const char * dir);
+
 /** 
    \fn     void F_mpz_poly_mul(F_mpz_poly_t res, const F_mpz_poly_t poly1, const F_mpz_poly_t poly2)
    \brief  Multiply poly1 by poly2 and set res to the result. An attempt is made to choose the 
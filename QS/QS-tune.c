@@ -0,0 +1,292 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/*
+   QS-tune
+
+   Program for tuning mpQS.
+
+   This program writes to standard output an automatically tuned version of
+   QS/QS-tuning.h. SIEVE_BLOCK is set from the size of the L2 cache. Each
+   row of prime_tab up to the given number of bits (default 200) is tuned
+   by timing the factorisation of random semiprimes of that size, changing
+   one parameter at a time for as long as that makes it faster. Rows for
+   larger sizes are copied unchanged.
+
+   Usage: QS-tune [max_bits]
+
+   (If DEBUG is set, it also writes logging info to standard error.)
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <gmp.h>
+
+#include "../flint.h"
+#include "../long_extras.h"
+#include "../test-support.h"
+#include "../profiler.h"
+
+#include "common.h"
+#include "mpQS.h"
+#include "mp_factor_base.h"
+
+
+#define DEBUG 1
+
+#define TUNE_MAX_BITS 200 // Default largest bitsize to tune
+
+#define TUNE_GAIN 0.97 // A change is kept if it takes at most this fraction of the time
+
+#define TUNE_STEPS 4 // Most times a parameter is changed in the same direction
+
+
+/*
+   Returns the size in bytes of the data or unified cache at the given level,
+   or 0 if it cannot be determined.
+*/
+unsigned long cache_size(unsigned long level)
+{
+   long size = 0;
+
+#ifdef _SC_LEVEL2_CACHE_SIZE
+   if (level == 1) size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+   if (level == 2) size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+
+   // otherwise look through the caches listed by Linux
+   for (unsigned long i = 0; (size <= 0) && (i < 8); i++)
+   {
+      char name[64], type[16];
+      unsigned long l, kb;
+      FILE * file;
+      int ok;
+
+      sprintf(name, "/sys/devices/system/cpu/cpu0/cache/index%ld/level", i);
+      if ((file = fopen(name, "r")) == NULL) break;
+      ok = (fscanf(file, "%lu", &l) == 1);
+      fclose(file);
+
+      sprintf(name, "/sys/devices/system/cpu/cpu0/cache/index%ld/type", i);
+      if ((file = fopen(name, "r")) == NULL) break;
+      ok = ok && (fscanf(file, "%15s", type) == 1);
+      fclose(file);
+
+      sprintf(name, "/sys/devices/system/cpu/cpu0/cache/index%ld/size", i);
+      if ((file = fopen(name, "r")) == NULL) break;
+      ok = ok && (fscanf(file, "%luK", &kb) == 1);
+      fclose(file);
+
+      if (ok && (l == level) && (type[0] != 'I')) size = kb*1024;
+   }
+
+   return (size > 0) ? size : 0;
+}
+
+
+/*
+   Sets N to a random product of two primes of about half the given number
+   of bits, with exactly that many bits.
+*/
+void random_semiprime(mpz_t N, unsigned long bits)
+{
+   mpz_t p, q;
+   mpz_init(p);
+   mpz_init(q);
+
+   do
+   {
+      mpz_urandomb(p, randstate, bits/2);
+      mpz_setbit(p, bits/2 - 1);
+      mpz_nextprime(p, p);
+      mpz_urandomb(q, randstate, bits - bits/2);
+      mpz_setbit(q, bits - bits/2 - 1);
+      mpz_nextprime(q, q);
+      mpz_mul(N, p, q);
+   } while (mpz_sizeinbase(N, 2) != bits);
+
+   mpz_clear(p);
+   mpz_clear(q);
+}
+
+
+/*
+   Returns the wall time in ms taken to factor the num numbers in N with
+   the parameters in row, or -1 if any of them is not factored. The output
+   of mpQS is discarded.
+*/
+long time_row(unsigned long * row, mpz_t * N, unsigned long num)
+{
+   F_mpz_factor_t factors;
+   unsigned long table[1][5];
+   timeit_t t0;
+   int ok = 1;
+
+   for (unsigned long i = 0; i < 5; i++) table[0][i] = row[i];
+   qs_set_tuning((const unsigned long (*)[5]) table, 1);
+
+   factors.fact = (mpz_t *) malloc(64*sizeof(mpz_t));
+   for (unsigned long i = 0; i < 64; i++) mpz_init(factors.fact[i]);
+   factors.num = 0;
+
+   fflush(stdout);
+   int saved = dup(1);
+   int null = open("/dev/null", O_WRONLY);
+   dup2(null, 1);
+   close(null);
+
+   timeit_start(t0);
+   for (unsigned long i = 0; (i < num) && ok; i++)
+      ok = (F_mpz_factor_mpQS(&factors, N[i], 0) != 0);
+   timeit_stop(t0);
+
+   fflush(stdout);
+   dup2(saved, 1);
+   close(saved);
+
+   for (unsigned long i = 0; i < 64; i++) mpz_clear(factors.fact[i]);
+   free(factors.fact);
+   qs_set_tuning(NULL, 0);
+
+   return ok ? t0->wall : -1L;
+}
+
+
+/*
+   Tunes num_primes, sieve_size, small_primes and the large prime multiplier
+   of the given row of prime_tab, one at a time.
+*/
+void tune_row(unsigned long * row, FILE * f)
+{
+   const unsigned long num = (row[0] < 160) ? 16 : 2;
+   mpz_t N[16];
+   long best, time;
+   unsigned long trial[5];
+
+   for (unsigned long i = 0; i < num; i++)
+   {
+      mpz_init(N[i]);
+      random_semiprime(N[i], row[0] + 4); // kn lands inside the row
+   }
+
+   best = time_row(row, N, num);
+
+#if DEBUG
+   fprintf(f, "bits = %ld: {%ld, %ld, %ld, %ld} takes %ld ms\n",
+           row[0], row[1], row[2], row[3], row[4], best);
+#endif
+
+   for (unsigned long param = 1; param < 5; param++)
+   {
+      for (int up = 1; up >= 0; up--)
+      {
+         unsigned long steps;
+
+         for (steps = 0; steps < TUNE_STEPS; steps++)
+         {
+            for (unsigned long i = 0; i < 5; i++) trial[i] = row[i];
+
+            switch (param)
+            {
+               case 1: trial[1] = up ? (trial[1]*5)/4 : (trial[1]*4)/5; break;
+               case 2: trial[2] = up ? trial[2]*2 : trial[2]/2; break;
+               case 3: trial[3] = up ? trial[3] + 1 : trial[3] - 1; break;
+               case 4: trial[4] = up ? trial[4]*2 : trial[4]/2; break;
+            }
+            if ((trial[1] < 2*trial[3]) || (trial[2] < 1000) || (trial[3] < 3) || (trial[4] < 1))
+               break;
+
+            time = time_row(trial, N, num);
+
+#if DEBUG
+            fprintf(f, "   {%ld, %ld, %ld, %ld} takes %ld ms\n",
+                    trial[1], trial[2], trial[3], trial[4], time);
+#endif
+
+            if ((time < 0) || (best >= 0 && time > TUNE_GAIN*best)) break;
+
+            for (unsigned long i = 0; i < 5; i++) row[i] = trial[i];
+            best = time;
+         }
+
+         if (steps) break; // no need to try the other direction
+      }
+   }
+
+   for (unsigned long i = 0; i < num; i++) mpz_clear(N[i]);
+}
+
+
+int main(int argc, char* argv[])
+{
+   FILE* fout = stdout;
+   FILE* flog = stderr;
+   unsigned long max_bits = (argc > 1) ? atol(argv[1]) : TUNE_MAX_BITS;
+   unsigned long table[PTABSIZE][5];
+
+   test_support_init();
+
+   // The sieve is split into blocks of an eighth of the L2 cache, which
+   // gives the old value of 64000 for 512 kB. The medium primes, sieved a
+   // block at a time, are those up to the block size, of which about half
+   // are in the factor base. Larger primes are bucket sieved
+
+   unsigned long l2 = cache_size(2);
+   if (l2 == 0) l2 = 512*1024;
+   unsigned long sieve_block = FLINT_MIN(FLINT_MAX(l2/8192, 32), 256)*1000;
+   unsigned long second_prime = 0;
+   for (unsigned long p = 2; p < sieve_block; p = z_nextprime(p, 0)) second_prime++;
+   second_prime = second_prime/200*100;
+
+#if DEBUG
+   fprintf(flog, "L1 cache %ld kB, L2 cache %ld kB\n", cache_size(1)/1024, l2/1024);
+#endif
+
+   for (unsigned long i = 0; i < PTABSIZE; i++)
+   {
+      for (unsigned long j = 0; j < 5; j++) table[i][j] = prime_tab[i][j];
+      if ((table[i][0] + 4 > TINY_BITS) && (table[i][0] <= max_bits))
+         tune_row(table[i], flog);
+   }
+
+   fprintf(fout, "/*\n");
+   fprintf(fout, "   Tuning values for mpQS\n");
+   fprintf(fout, "\n");
+   fprintf(fout, "   Automatically generated by QS-tune program\n");
+   fprintf(fout, "*/\n\n");
+   fprintf(fout, "#ifndef QS_TUNING_H\n");
+   fprintf(fout, "#define QS_TUNING_H\n\n");
+   fprintf(fout, "#define SIEVE_BLOCK %ld // L2 cache %ld kB\n\n", sieve_block, l2/1024);
+   fprintf(fout, "#define SECOND_PRIME %ld\n\n", second_prime);
+   fprintf(fout, "// For each bitsize, this table stores, in order:\n");
+   fprintf(fout, "// bitsize, num_primes, sieve_size, small_primes and large_prime/factor_base[num_primes-1]\n\n");
+   fprintf(fout, "static const unsigned long prime_tab[][5] =\n{\n");
+   for (unsigned long i = 0; i < PTABSIZE; i++)
+      fprintf(fout, "   {%ld, %ld, %ld, %ld, %ld}%s\n", table[i][0], table[i][1],
+              table[i][2], table[i][3], table[i][4], (i + 1 < PTABSIZE) ? "," : "");
+   fprintf(fout, "};\n\n");
+   fprintf(fout, "#endif\n");
+
+   test_support_cleanup();
+   return 0;
+}
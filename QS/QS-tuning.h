@@ -0,0 +1,65 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/*
+   Tuning values for mpQS
+
+   Automatically generated by QS-tune program
+*/
+
+#ifndef QS_TUNING_H
+#define QS_TUNING_H
+
+#define SIEVE_BLOCK 64000 // L2 cache 512 kB
+
+#define SECOND_PRIME 3000
+
+// For each bitsize, this table stores, in order:
+// bitsize, num_primes, sieve_size, small_primes and large_prime/factor_base[num_primes-1]
+
+static const unsigned long prime_tab[][5] =
+{
+   {32, 30, 2500, 4, 1},
+   {40, 50, 3000, 4, 1},
+   {50, 80, 3500, 5, 1},
+   {60, 100, 4000, 5, 1},
+   {70, 300, 6000, 6, 1},
+   {80, 400, 8000, 6, 1},
+   {90, 500, 10000, 7, 1},
+   {100, 650, 13000, 7, 1},
+   {110, 800, 15000, 7, 1}, // 31 digits
+   {120, 1000, 20000, 7, 2},
+   {130, 800, 32000, 9, 1}, // 41 digits
+   {140, 1200, 28000, 8, 10}, 
+   {150, 1800, 32000, 8, 10},
+   {160, 2000, 40000, 8, 30}, 
+   {170, 2200, 64000, 9, 1}, // 50 digits 
+   {180, 2400, 64000, 9, 35},
+   {190, 2700, 64000, 10, 40}, 
+   {200, 3600, 64000, 10, 60}, // 60 digits
+   {210, 6000, 64000, 12, 60},
+   {220, 7500, 64000, 15, 70},
+   {230, 8500, 64000, 17, 80}, // 70 digits
+   {240, 18000, 64000, 19, 80}, 
+   {250, 24000, 64000, 19, 80}, // 75 digits
+   {260, 55000, 128000, 25, 100}, // 80 digits
+   {270, 64000, 128000, 27, 100}
+};
+
+#endif
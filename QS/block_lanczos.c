@@ -41,6 +41,7 @@ The following modifications were made by William Hart:
 
 #include "../flint.h"
 #include "../memory-manager.h"
+#include "../thread-support.h"
  
 #define NUM_EXTRA_RELATIONS 64
 
@@ -71,9 +72,10 @@ uint64_t random32(void) {
 
    /* Poor man's random number generator. It satisfies no 
       particularly good randomness properties, but is good
-      enough for this application */
+      enough for this application. The state is per thread as 
+      the linear algebra may run in several threads at once */
       
-    static unsigned long randval = 4035456057U;
+    static FLINT_TLS unsigned long randval = 4035456057U;
     randval = ((uint64_t)randval*1025416097U+286824428U)%(uint64_t)4294967291U;
     
     return (unsigned long)randval;
@@ -575,6 +577,270 @@ void mul_trans_MxN_Nx64(unsigned long dense_rows, unsigned long ncols,
 	}
 }
 
+/*-------------------------------------------------------------------*/
+/* For the multithreaded matrix products in block_lanczos, the
+   matrix is packed by columns into a compact layout, with the 
+   first PACKED_DENSE_ROWS rows (the small primes, which occur in
+   most relations) held as one bitmask per column and the remaining
+   row indices stored as 32-bit words, column after column. The 
+   dense rows then form an N x 64 matrix, which is multiplied using
+   the same table lookups as the other N x 64 products here. The 
+   columns are split into one block per thread, of roughly equal 
+   weight */
+
+#define PACKED_DENSE_ROWS 64
+
+#define LANCZOS_THREAD_COLS 8000 /* use threads from this many columns */
+
+#define LANCZOS_MAX_THREADS 64
+
+typedef struct {
+	unsigned long ncols;
+	unsigned long vsize;
+	unsigned long num_threads;
+	uint64_t *dense;	/* rows < PACKED_DENSE_ROWS of each column */
+	unsigned long *start;	/* column i is entries[start[i]..start[i+1]-1] */
+	uint32_t *entries;	/* the remaining row indices */
+	unsigned long *block;	/* thread t does columns block[t]..block[t+1]-1 */
+	uint64_t **acc;		/* accumulators for threads 1 and up */
+	uint64_t *table;	/* 8 x 256 table for the dense rows */
+} packed_matrix_t;
+
+typedef struct {
+	packed_matrix_t *A;
+	unsigned long t;
+	uint64_t *x;
+	uint64_t *b;
+} packed_mul_arg_t;
+
+static void pack_matrix(packed_matrix_t *A, unsigned long vsize,
+			unsigned long ncols, la_col_t *B) {
+
+	unsigned long i, j, t, weight, total;
+	unsigned long num_threads = flint_get_num_threads();
+
+	if (ncols < LANCZOS_THREAD_COLS)
+		num_threads = 1;
+	if (num_threads > LANCZOS_MAX_THREADS)
+		num_threads = LANCZOS_MAX_THREADS;
+
+	A->ncols = ncols;
+	A->vsize = vsize;
+	A->num_threads = num_threads;
+	A->dense = (uint64_t *)malloc(ncols * sizeof(uint64_t));
+	A->start = (unsigned long *)malloc((ncols + 1) * sizeof(unsigned long));
+
+	for (i = total = 0; i < ncols; i++)
+		total += B[i].weight;
+	A->entries = (uint32_t *)malloc((total + 1) * sizeof(uint32_t));
+
+	for (i = j = 0; i < ncols; i++) {
+		la_col_t *col = B + i;
+		uint64_t dense = 0;
+
+		A->start[i] = j;
+		for (t = 0; t < col->weight; t++) {
+			if (col->data[t] < PACKED_DENSE_ROWS)
+				dense ^= bitmask[col->data[t]];
+			else
+				A->entries[j++] = (uint32_t)col->data[t];
+		}
+		A->dense[i] = dense;
+	}
+	A->start[ncols] = j;
+
+	/* split the columns into blocks of about equal weight */
+
+	A->block = (unsigned long *)malloc((num_threads + 1) * sizeof(unsigned long));
+	A->block[0] = 0;
+	for (i = weight = 0, t = 1; t < num_threads; t++) {
+		while (i < ncols && weight * num_threads < total * t)
+			weight += B[i++].weight;
+		A->block[t] = i;
+	}
+	A->block[num_threads] = ncols;
+
+	A->table = (uint64_t *)malloc(8 * 256 * sizeof(uint64_t));
+	A->acc = (uint64_t **)malloc(num_threads * sizeof(uint64_t *));
+	for (t = 1; t < num_threads; t++)
+		A->acc[t] = (uint64_t *)malloc(vsize * sizeof(uint64_t));
+}
+
+static void clear_packed_matrix(packed_matrix_t *A) {
+
+	unsigned long t;
+
+	for (t = 1; t < A->num_threads; t++)
+		free(A->acc[t]);
+	free(A->acc);
+	free(A->table);
+	free(A->block);
+	free(A->entries);
+	free(A->start);
+	free(A->dense);
+}
+
+/*-------------------------------------------------------------------*/
+static void packed_mul_thread(void *arg_void) {
+
+	/* XOR column block t of A times x into the accumulator 
+	   for thread t, which for thread 0 is b itself */
+
+	packed_mul_arg_t *arg = (packed_mul_arg_t *)arg_void;
+	packed_matrix_t *A = arg->A;
+	unsigned long t = arg->t;
+	uint64_t *x = arg->x;
+	uint64_t *acc = (t == 0) ? arg->b : A->acc[t];
+	uint64_t dense_acc[PACKED_DENSE_ROWS];
+	uint64_t c[8 * 256];
+	unsigned long i, j, end;
+
+	memset(acc, 0, A->vsize * sizeof(uint64_t));
+
+	for (i = A->block[t]; i < A->block[t + 1]; i++) {
+		uint64_t tmp = x[i];
+
+		end = A->start[i + 1];
+		for (j = A->start[i]; j < end; j++)
+			acc[A->entries[j]] ^= tmp;
+	}
+
+	/* the dense rows are transpose(dense) * x */
+
+	mul_64xN_Nx64(A->dense + A->block[t], x + A->block[t], c, 
+			dense_acc, A->block[t + 1] - A->block[t]);
+
+	end = FLINT_MIN(A->vsize, PACKED_DENSE_ROWS);
+	for (j = 0; j < end; j++)
+		acc[j] ^= dense_acc[j];
+}
+
+static void packed_combine_thread(void *arg_void) {
+
+	/* Combine a slice of the accumulators of threads 1 and 
+	   up into b */
+
+	packed_mul_arg_t *arg = (packed_mul_arg_t *)arg_void;
+	packed_matrix_t *A = arg->A;
+	unsigned long n = A->num_threads;
+	unsigned long lo = (A->vsize * arg->t) / n;
+	unsigned long hi = (A->vsize * (arg->t + 1)) / n;
+	unsigned long i, t;
+
+	for (t = 1; t < n; t++) {
+		uint64_t *acc = A->acc[t];
+		for (i = lo; i < hi; i++)
+			arg->b[i] ^= acc[i];
+	}
+}
+
+static void packed_mul_trans_thread(void *arg_void) {
+
+	/* Compute the entries of b = transpose(A) * x for 
+	   column block t */
+
+	packed_mul_arg_t *arg = (packed_mul_arg_t *)arg_void;
+	packed_matrix_t *A = arg->A;
+	uint64_t *x = arg->x;
+	uint64_t *b = arg->b;
+	uint64_t *c = A->table;
+	unsigned long i, j, end;
+
+	for (i = A->block[arg->t]; i < A->block[arg->t + 1]; i++) {
+		uint64_t accum = 0;
+		uint64_t word = A->dense[i];
+
+		end = A->start[i + 1];
+		for (j = A->start[i]; j < end; j++)
+			accum ^= x[A->entries[j]];
+
+		b[i] = accum ^ c[ 0*256 + ((word>> 0) & 0xff) ]
+			     ^ c[ 1*256 + ((word>> 8) & 0xff) ]
+			     ^ c[ 2*256 + ((word>>16) & 0xff) ]
+			     ^ c[ 3*256 + ((word>>24) & 0xff) ]
+			     ^ c[ 4*256 + ((word>>32) & 0xff) ]
+			     ^ c[ 5*256 + ((word>>40) & 0xff) ]
+			     ^ c[ 6*256 + ((word>>48) & 0xff) ]
+			     ^ c[ 7*256 + ((word>>56)       ) ];
+	}
+}
+
+static void packed_run(packed_matrix_t *A, void (*fn)(void *),
+			uint64_t *x, uint64_t *b) {
+
+	packed_mul_arg_t args[LANCZOS_MAX_THREADS];
+	unsigned long t, n = A->num_threads;
+
+	if (n == 1) {
+		args[0].A = A;
+		args[0].t = 0;
+		args[0].x = x;
+		args[0].b = b;
+		fn(args);
+		return;
+	}
+
+	for (t = 0; t < n; t++) {
+		args[t].A = A;
+		args[t].t = t;
+		args[t].x = x;
+		args[t].b = b;
+	}
+	flint_parallel_do(fn, args, sizeof(packed_mul_arg_t), n);
+}
+
+static void packed_mul_MxN_Nx64(packed_matrix_t *A, 
+				uint64_t *x, uint64_t *b) {
+
+	/* b = A * x, with each thread accumulating the 
+	   product for its block of columns separately */
+
+	packed_run(A, packed_mul_thread, x, b);
+	if (A->num_threads > 1)
+		packed_run(A, packed_combine_thread, x, b);
+}
+
+static void packed_mul_trans_MxN_Nx64(packed_matrix_t *A, 
+				uint64_t *x, uint64_t *b) {
+
+	/* b = transpose(A) * x. The dense rows contribute
+	   dense * x[0..63], for which a table is precomputed */
+
+	uint64_t x_dense[PACKED_DENSE_ROWS];
+	unsigned long n = FLINT_MIN(A->vsize, PACKED_DENSE_ROWS);
+
+	memset(x_dense, 0, sizeof(x_dense));
+	memcpy(x_dense, x, n * sizeof(uint64_t));
+	precompute_Nx64_64x64(x_dense, A->table);
+
+	packed_run(A, packed_mul_trans_thread, x, b);
+}
+
+/*-------------------------------------------------------------------*/
+static void mul_B(packed_matrix_t *P, unsigned long vsize, 
+		unsigned long dense_rows, unsigned long ncols, 
+		la_col_t *B, uint64_t *x, uint64_t *b) {
+
+	/* b = B * x, using the packed copy P of B if not NULL */
+
+	if (P != NULL)
+		packed_mul_MxN_Nx64(P, x, b);
+	else
+		mul_MxN_Nx64(vsize, dense_rows, ncols, B, x, b);
+}
+
+static void mul_trans_B(packed_matrix_t *P, unsigned long dense_rows, 
+		unsigned long ncols, la_col_t *B, uint64_t *x, uint64_t *b) {
+
+	/* b = transpose(B) * x, using the packed copy P of B 
+	   if not NULL */
+
+	if (P != NULL)
+		packed_mul_trans_MxN_Nx64(P, x, b);
+	else
+		mul_trans_MxN_Nx64(dense_rows, ncols, B, x, b);
+}
+
 /*-----------------------------------------------------------------------*/
 static void transpose_vector(unsigned long ncols, uint64_t *v, uint64_t **trans) {
 
@@ -737,6 +1003,7 @@ uint64_t * block_lanczos(unsigned long nrows,
 	unsigned long dim0, dim1;
 	uint64_t mask0, mask1;
 	unsigned long vsize;
+	packed_matrix_t packed, *P = NULL;
 
 	/* allocate all of the size-n variables. Note that because
 	   B has been preprocessed to ignore singleton rows, the
@@ -767,6 +1034,14 @@ uint64_t * block_lanczos(unsigned long nrows,
 	f = (uint64_t *)malloc(64 * sizeof(uint64_t));
 	f2 = (uint64_t *)malloc(64 * sizeof(uint64_t));
 
+	/* pack B for the matrix multiplies (the packed layout 
+	   has its own dense rows) */
+
+	if (dense_rows == 0) {
+		pack_matrix(&packed, vsize, ncols, B);
+		P = &packed;
+	}
+
 	/* The iterations computes v[0], vt_a_v[0],
 	   vt_a2_v[0], s[0] and winv[0]. Subscripts larger
 	   than zero represent past versions of these
@@ -797,8 +1072,8 @@ uint64_t * block_lanczos(unsigned long nrows,
 		          (uint64_t)(random32());
 
 	memcpy(x, v[0], vsize * sizeof(uint64_t));
-	mul_MxN_Nx64(vsize, dense_rows, ncols, B, v[0], scratch);
-	mul_trans_MxN_Nx64(dense_rows, ncols, B, scratch, v[0]);
+	mul_B(P, vsize, dense_rows, ncols, B, v[0], scratch);
+	mul_trans_B(P, dense_rows, ncols, B, scratch, v[0]);
 	memcpy(v0, v[0], vsize * sizeof(uint64_t));
 
 	/* perform the iteration */
@@ -810,8 +1085,8 @@ uint64_t * block_lanczos(unsigned long nrows,
 		   version of B, or B'B (apostrophe means 
 		   transpose). Use "A" to refer to B'B  */
 
-		mul_MxN_Nx64(vsize, dense_rows, ncols, B, v[0], scratch);
-		mul_trans_MxN_Nx64(dense_rows, ncols, B, scratch, vnext);
+		mul_B(P, vsize, dense_rows, ncols, B, v[0], scratch);
+		mul_trans_B(P, dense_rows, ncols, B, scratch, vnext);
 
 		/* compute v0'*A*v0 and (A*v0)'(A*v0) */
 
@@ -943,6 +1218,8 @@ uint64_t * block_lanczos(unsigned long nrows,
 #ifdef ERRORS
 		printf("linear algebra failed; retrying...\n");
 #endif
+		if (P != NULL)
+			clear_packed_matrix(P);
 		free(x);
 		free(v[0]);
 		free(v[1]);
@@ -953,14 +1230,16 @@ uint64_t * block_lanczos(unsigned long nrows,
 	/* convert the output of the iteration to an actual
 	   collection of nullspace vectors */
 
-	mul_MxN_Nx64(vsize, dense_rows, ncols, B, x, v[1]);
-	mul_MxN_Nx64(vsize, dense_rows, ncols, B, v[0], v[2]);
+	mul_B(P, vsize, dense_rows, ncols, B, x, v[1]);
+	mul_B(P, vsize, dense_rows, ncols, B, v[0], v[2]);
 
 	combine_cols(ncols, x, v[0], v[1], v[2]);
 
 	/* verify that these really are linear dependencies of B */
 
-	mul_MxN_Nx64(vsize, dense_rows, ncols, B, x, v[0]);
+	mul_B(P, vsize, dense_rows, ncols, B, x, v[0]);
+	if (P != NULL)
+		clear_packed_matrix(P);
 	
 	for (i = 0; i < ncols; i++) {
 		if (v[0][i] != 0)
@@ -30,41 +30,12 @@
 #define QS_COMMON_H
 
 #include <stdint.h>
+#include <time.h>
 
 #include "../fmpz.h"
 #include "../flint.h"
 
-// For each bitsize, this table stores, in order:
-// bitsize, num_primes, sieve_size, small_primes and large_prime/factor_base[num_primes-1]
-
-static const unsigned long prime_tab[][5] =
-{
-   {32, 30, 2500, 4, 1},
-   {40, 50, 3000, 4, 1},
-   {50, 80, 3500, 5, 1},
-   {60, 100, 4000, 5, 1},
-   {70, 300, 6000, 6, 1},
-   {80, 400, 8000, 6, 1},
-   {90, 500, 10000, 7, 1},
-   {100, 650, 13000, 7, 1},
-   {110, 800, 15000, 7, 1}, // 31 digits
-   {120, 1000, 20000, 7, 2},
-   {130, 800, 32000, 9, 1}, // 41 digits
-   {140, 1200, 28000, 8, 10}, 
-   {150, 1800, 32000, 8, 10},
-   {160, 2000, 40000, 8, 30}, 
-   {170, 2200, 64000, 9, 1}, // 50 digits 
-   {180, 2400, 64000, 9, 35},
-   {190, 2700, 64000, 10, 40}, 
-   {200, 3600, 64000, 10, 60}, // 60 digits
-   {210, 6000, 64000, 12, 60},
-   {220, 7500, 64000, 15, 70},
-   {230, 8500, 64000, 17, 80}, // 70 digits
-   {240, 18000, 64000, 19, 80}, 
-   {250, 24000, 64000, 19, 80}, // 75 digits
-   {260, 55000, 128000, 25, 100}, // 80 digits
-   {270, 64000, 128000, 27, 100}
-};
+#include "QS-tuning.h"
 
 #if FLINT_BITS == 64
 #define TINY_BITS 74
@@ -74,11 +45,9 @@ static const unsigned long prime_tab[][5] =
 
 #define PTABSIZE (sizeof(prime_tab)/(5*sizeof(unsigned long)))
 
-#define SIEVE_BLOCK 64000
-
-#define SECOND_PRIME 3000 // 3000 6400
-
 #define EXTRA_RELS 64L // number of additional relations to find above the number of primes
+
+#define DOUBLE_LP_BITS 240 // Partials with two large primes are used from this bitsize on
                          
 #define MAX_FACS 60 // Maximum number of different prime factors
                     // a relation can have 25, 30
@@ -103,12 +72,6 @@ typedef struct F_mpz_fact_s
    unsigned long num;         
 } F_mpz_factor_t;
                     
-typedef struct hash_s
-{
-	int offset;
-	char size;
-} hash_entry;
-
 typedef struct prime_s
 {
    uint32_t p; // prime
@@ -125,13 +88,16 @@ typedef struct QS_s
    unsigned long num_primes;
    unsigned long sieve_size;
    unsigned long error_bits;
-   unsigned long sieve_fill;
    unsigned long small_primes;
    unsigned long large_prime;
+   unsigned long large_prime2; // Bound on the cofactor of partials with two large primes, 0 if unused
    prime_t * factor_base; 
    uint32_t * sqrts;
    unsigned char * sizes;
    unsigned long * prime_count;
+   unsigned long A_count; // Number of A values computed so far
+   uint64_t A_rand; // State of the random stream A is chosen from, shared by the sieving threads
+   time_t checkpoint_time; // When the relations found were last checkpointed
 } QS_t;
 
 #endif
@@ -0,0 +1,296 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/****************************************************************************
+
+mpQS-test.c: Test code for mpQS
+
+The makefile builds this with RESIEVE_RATIO set to 1, so that every batch
+of candidates is resieved, which at the default ratio only happens for the
+larger factor bases, and with MPQS_TEST set, so that collect_relations 
+reports each A it chooses to test_A_chosen.
+
+*****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gmp.h>
+
+#include "../flint.h"
+#include "../long_extras.h"
+#include "../test-support.h"
+#include "../memory-manager.h"
+#include "../thread-support.h"
+
+#include "common.h"
+#include "mpQS.h"
+#include "mp_sieve.h"
+#include "mp_poly.h"
+#include "mp_linear_algebra.h"
+
+#define MAX_CHOSEN_A 8192 // Most A values recorded in one run
+
+/*
+   Sets N to a random product of two primes of about half the given number
+   of bits, with exactly that many bits.
+*/
+void random_semiprime(mpz_t N, unsigned long bits)
+{
+   mpz_t p, q;
+   mpz_init(p);
+   mpz_init(q);
+
+   do
+   {
+      mpz_urandomb(p, randstate, bits/2);
+      mpz_setbit(p, bits/2 - 1);
+      mpz_nextprime(p, p);
+      mpz_urandomb(q, randstate, bits - bits/2);
+      mpz_setbit(q, bits - bits/2 - 1);
+      mpz_nextprime(q, q);
+      mpz_mul(N, p, q);
+   } while (mpz_sizeinbase(N, 2) != bits);
+
+   mpz_clear(p);
+   mpz_clear(q);
+}
+
+/*
+   Runs mpQS on N, with its output going to a temporary file, and checks
+   that it succeeds and that each factor it prints is a proper divisor of N.
+*/
+int factor_and_check(mpz_t N, int restart)
+{
+   F_mpz_factor_t factors;
+   FILE * out = tmpfile();
+   char line[1024];
+   mpz_t F;
+   int ok, found = 0, listing = 0;
+
+   factors.fact = (mpz_t *) malloc(64*sizeof(mpz_t));
+   for (unsigned long i = 0; i < 64; i++) mpz_init(factors.fact[i]);
+   factors.num = 0;
+
+   fflush(stdout);
+   int saved = dup(1);
+   dup2(fileno(out), 1);
+
+   ok = (F_mpz_factor_mpQS(&factors, N, restart) != 0);
+
+   fflush(stdout);
+   dup2(saved, 1);
+   close(saved);
+
+   mpz_init(F);
+   rewind(out);
+   while (ok && fgets(line, sizeof(line), out))
+   {
+      if (!strncmp(line, "FACTORS:", 8)) listing = 1;
+      else if (listing && (gmp_sscanf(line, "%Zd", F) == 1))
+      {
+         ok = (mpz_cmp_ui(F, 1) > 0) && (mpz_cmp(F, N) < 0) && mpz_divisible_p(N, F);
+         found = 1;
+      }
+   }
+   ok &= found;
+   if (!ok) gmp_printf("N = %Zd\n", N);
+
+   mpz_clear(F);
+   fclose(out);
+   for (unsigned long i = 0; i < 64; i++) mpz_clear(factors.fact[i]);
+   free(factors.fact);
+
+   return ok;
+}
+
+/*
+   The A values chosen, in order, if chosen_A is set, and the number of 
+   them. When the checkpoint_A'th value is chosen, a checkpoint for 
+   checkpoint_N is written and moved aside, as mpQS removes its checkpoint 
+   when it finishes.
+*/
+
+mpz_t * chosen_A;
+unsigned long num_chosen_A;
+unsigned long checkpoint_A;
+mpz_t checkpoint_N;
+
+char * saved_checkpoint_filename(mpz_t N)
+{
+   char * name = checkpoint_filename(N);
+   char * saved = (char *) malloc(strlen(name) + 7);
+
+   sprintf(saved, "%s.saved", name);
+   free(name);
+
+   return saved;
+}
+
+/*
+   Called by collect_relations, with the relations lock held
+*/
+void test_A_chosen(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf)
+{
+   unsigned long * A = poly_inf->A;
+
+   if (chosen_A && (num_chosen_A < MAX_CHOSEN_A))
+      mpz_import(chosen_A[num_chosen_A], A[0], -1, sizeof(unsigned long), 0, 0, A + 1);
+   num_chosen_A++;
+
+   if (qs_inf->A_count == checkpoint_A)
+   {
+      char * name = checkpoint_filename(checkpoint_N);
+      char * saved = saved_checkpoint_filename(checkpoint_N);
+
+      write_checkpoint(qs_inf, la_inf, checkpoint_N);
+      if (rename(name, saved))
+      {
+         printf("Error: unable to move checkpoint file\n");
+         abort();
+      }
+
+      free(saved);
+      free(name);
+   }
+}
+
+int test_F_mpz_factor_mpQS()
+{
+   mpz_t N;
+   unsigned long bits;
+
+   int result = 1;
+
+   mpz_init(N);
+
+   for (unsigned long count = 0; (count < 20) && (result == 1); count++)
+   {
+      flint_set_num_threads(z_randint(4) + 1);
+      bits = z_randint(50) + 120;
+      random_semiprime(N, bits);
+
+      result = factor_and_check(N, 0);
+   }
+
+   mpz_clear(N);
+   flint_set_num_threads(1);
+
+   return result;
+}
+
+/*
+   Checkpoints a run with several sieving threads after checkpoint_A values
+   of A, and resumes from there with several threads. The resumed run must 
+   carry on with the A values which follow those of the checkpoint in the 
+   first run, else it sieves again families of polynomials which were 
+   sieved before the checkpoint.
+*/
+int test_F_mpz_factor_mpQS_restart()
+{
+   mpz_t run1[MAX_CHOSEN_A], run2[MAX_CHOSEN_A];
+   unsigned long bits, first, num1, num2, i;
+   char * name, * saved;
+
+   int result = 1;
+
+   mpz_init(checkpoint_N);
+   for (i = 0; i < MAX_CHOSEN_A; i++)
+   {
+      mpz_init(run1[i]);
+      mpz_init(run2[i]);
+   }
+
+   for (unsigned long count = 0; (count < 4) && (result == 1); count++)
+   {
+      bits = z_randint(20) + 160;
+      random_semiprime(checkpoint_N, bits);
+      name = checkpoint_filename(checkpoint_N);
+      saved = saved_checkpoint_filename(checkpoint_N);
+
+      flint_set_num_threads(z_randint(3) + 2);
+      chosen_A = run1;
+      num_chosen_A = 0;
+      checkpoint_A = z_randint(20) + 10;
+      result = factor_and_check(checkpoint_N, 0);
+
+      first = checkpoint_A;
+      num1 = FLINT_MIN(num_chosen_A, MAX_CHOSEN_A);
+      if (result) result = (num1 > first) && !rename(saved, name);
+
+      if (result)
+      {
+         flint_set_num_threads(z_randint(3) + 2);
+         chosen_A = run2;
+         num_chosen_A = 0;
+         checkpoint_A = 0; // no further checkpoints
+         result = factor_and_check(checkpoint_N, 1);
+      }
+
+      if (result)
+      {
+         num2 = FLINT_MIN(num_chosen_A, MAX_CHOSEN_A);
+         for (i = 0; (i < num2) && (first + i < num1); i++)
+            if (mpz_cmp(run2[i], run1[first + i])) break;
+         result = (num2 > 0) && ((i == num2) || (first + i == num1));
+         if (!result) gmp_printf("N = %Zd, A value %ld after the checkpoint differs\n", checkpoint_N, i + 1);
+      }
+
+      remove(name);
+      remove(saved);
+      free(saved);
+      free(name);
+   }
+
+   for (i = 0; i < MAX_CHOSEN_A; i++)
+   {
+      mpz_clear(run1[i]);
+      mpz_clear(run2[i]);
+   }
+   mpz_clear(checkpoint_N);
+   chosen_A = NULL;
+   flint_set_num_threads(1);
+
+   return result;
+}
+
+void fmpz_poly_test_all()
+{
+   int success, all_success = 1;
+
+   RUN_TEST(F_mpz_factor_mpQS);
+   RUN_TEST(F_mpz_factor_mpQS_restart);
+
+   printf(all_success ? "\nAll tests passed\n" :
+                        "\nAt least one test FAILED!\n");
+}
+
+int main()
+{
+   test_support_init();
+   fmpz_poly_test_all();
+   test_support_cleanup();
+
+   flint_stack_cleanup();
+
+   return 0;
+}
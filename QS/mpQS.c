@@ -32,12 +32,14 @@
 #include <math.h>
 #include <gmp.h>
 #include <string.h>
+#include <time.h>
 
 #include "../fmpz.h"
 #include "../long_extras.h"
 #include "../memory-manager.h"
 #include "../flint.h"
 #include "../mpn_extras.h"
+#include "../thread-support.h"
 
 #include "common.h"
 #include "mpQS.h"
@@ -46,14 +48,20 @@
 #include "mp_lprels.h"
 #include "mp_sieve.h"
 #include "mp_linear_algebra.h"
+#include "mp_filter.h"
 #include "block_lanczos.h"
 #include "tinyQS.h"
 
+#ifdef MPQS_TEST
+void test_A_chosen(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf); // Defined in mpQS-test.c
+#endif
+
 /*===========================================================================
    Square Root:
 
    Function: Compute the square root of the product of all the partial 
-             relations and take it mod p
+             relations and take it mod p. The columns of the filtered matrix
+             are expanded into the relations they were made from
 
 ===========================================================================*/
 
@@ -66,6 +74,8 @@ static inline void square_root(mpz_t X, mpz_t Y, QS_t * qs_inf, linalg_t * la_in
    unsigned long * prime_count = qs_inf->prime_count;
    unsigned long num_primes = qs_inf->num_primes;
    mpz_t * Y_arr = la_inf->Y_arr;
+   unsigned long num_used = 0;
+   unsigned char * used = (unsigned char *) flint_heap_alloc_bytes(la_inf->num_relations + la_inf->num_merges);
    
    mpz_t pow;
    mpz_init(pow);
@@ -75,21 +85,24 @@ static inline void square_root(mpz_t X, mpz_t Y, QS_t * qs_inf, linalg_t * la_in
    mpz_set_ui(X, 1);
    mpz_set_ui(Y, 1);
    
-   for (unsigned long i = 0; i < ncols; i++)
+   filter_expand(la_inf, used, nullrows, ncols, l);
+   
+   for (unsigned long i = 0; i < la_inf->num_relations; i++)
    {
-      if (get_null_entry(nullrows, i, l)) 
+      if (used[i]) 
       {
-         position = la_inf->matrix[i].orig*2*MAX_FACS;
+         position = i*2*MAX_FACS;
          for (unsigned long j = 0; j < relation[position]; j++)
          {
             prime_count[relation[position+2*j+1]] +=
                (relation[position+2*j+2]);
          }
-         mpz_mul(Y, Y, Y_arr[la_inf->matrix[i].orig]);
-         if (i % 10 == 0) mpz_mod(Y, Y, N);
+         mpz_mul(Y, Y, Y_arr[i]);
+         if (++num_used % 10 == 0) mpz_mod(Y, Y, N);
       }
    }
    mpz_mod(Y, Y, N);
+   flint_heap_free(used);
    
    for (unsigned long i = 0; i < num_primes; i++)
    {
@@ -126,6 +139,157 @@ static inline void square_root(mpz_t X, mpz_t Y, QS_t * qs_inf, linalg_t * la_in
    mpz_clear(pow);
 }
 
+/*===========================================================================
+   Locking:
+
+   Function: When several threads are sieving, relations are committed to
+             the linalg_t they share, which must be locked. These are no-ops 
+             when sieving serially
+
+===========================================================================*/
+
+static inline void lock_relations(linalg_t * la_inf)
+{
+   if (la_inf->shared != la_inf) pthread_mutex_lock(&la_inf->shared->lock);
+}
+
+static inline void unlock_relations(linalg_t * la_inf)
+{
+   if (la_inf->shared != la_inf) pthread_mutex_unlock(&la_inf->shared->lock);
+}
+
+/*
+   Returns 1 once enough relations have been merged into the matrix
+*/
+
+static inline int relations_complete(linalg_t * la_inf, QS_t * qs_inf)
+{
+   lock_relations(la_inf);
+   int done = (la_inf->shared->columns >= qs_inf->num_primes + EXTRA_RELS);
+   unlock_relations(la_inf);
+   
+   return done;
+}
+
+/*===========================================================================
+   Checkpointing:
+
+   Function: The relations found so far, the partials and the parameters 
+             they depend on are written periodically to a file in TMPDIR 
+             named after N, from which the factorisation can be resumed.
+             The random A values already used are skipped on resuming by 
+             computing the same number of A values again
+
+===========================================================================*/
+
+char * checkpoint_filename(mpz_t N)
+{
+   char name[64];
+   sprintf(name, "mpqs.%lx.chk", mpz_fdiv_ui(N, 4294967291UL));
+   
+   return tmp_dir_filename(name);
+}
+
+static void checkpoint_params(unsigned long * params, QS_t * qs_inf)
+{
+   params[0] = CHECKPOINT_MAGIC;
+   params[1] = qs_inf->k;
+   params[2] = qs_inf->num_primes;
+   params[3] = qs_inf->sieve_size;
+   params[4] = qs_inf->small_primes;
+   params[5] = qs_inf->large_prime;
+   params[6] = qs_inf->large_prime2;
+   params[7] = qs_inf->A_count;
+}
+
+void write_checkpoint(QS_t * qs_inf, linalg_t * la_inf, mpz_t N)
+{
+   char * name = checkpoint_filename(N);
+   char * tmp_name = (char *) malloc(strlen(name) + 5);
+   unsigned long params[8];
+   FILE * file;
+   
+   sprintf(tmp_name, "%s.tmp", name);
+   file = fopen(tmp_name, "wb");
+   checkpoint_params(params, qs_inf);
+   if (!file || (fwrite(params, sizeof(unsigned long), 8, file) != 8) || !mpz_out_raw(file, N))
+   {
+      printf("Error: unable to write checkpoint file\n");
+      abort();
+   }
+   linear_algebra_write(la_inf, file);
+   lp_store_write(la_inf->partials, file);
+   
+   if (fclose(file) || rename(tmp_name, name))
+   {
+      printf("Error: unable to write checkpoint file\n");
+      abort();
+   }
+   
+   free(tmp_name);
+   free(name);
+}
+
+/*
+   Resume from the checkpoint for N, if there is one and it matches the 
+   parameters in qs_inf. Returns 1 if the relations were restored.
+*/
+
+int read_checkpoint(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t N)
+{
+   char * name = checkpoint_filename(N);
+   FILE * file = fopen(name, "rb");
+   unsigned long params[8], expected[8];
+   int ok;
+   mpz_t N2;
+   
+   free(name);
+   if (!file) return 0;
+   
+   mpz_init(N2);
+   checkpoint_params(expected, qs_inf);
+   ok = (fread(params, sizeof(unsigned long), 8, file) == 8) && mpz_inp_raw(N2, file) 
+     && (mpz_cmp(N, N2) == 0) && !memcmp(params, expected, 7*sizeof(unsigned long));
+   mpz_clear(N2);
+   
+   if (!ok)
+   {
+      printf("Checkpoint does not match, starting afresh\n");
+      fclose(file);
+      return 0;
+   }
+   
+   if (!linear_algebra_read(la_inf, qs_inf, poly_inf, file) || !lp_store_read(la_inf->partials, file))
+   {
+      printf("Error: checkpoint file is corrupt\n");
+      abort();
+   }
+   fclose(file);
+   
+   for (unsigned long i = 0; i < params[7]; i++) // Skip the A values already sieved
+      compute_A(qs_inf, poly_inf);
+   qs_inf->A_count = params[7];
+   
+   return 1;
+}
+
+/*
+   Write a checkpoint if one is due
+*/
+
+static inline void checkpoint_relations(linalg_t * la_inf, QS_t * qs_inf, mpz_t N)
+{
+   if (!CHECKPOINT_INTERVAL) return;
+   
+   lock_relations(la_inf);
+   if (time(NULL) - qs_inf->checkpoint_time >= CHECKPOINT_INTERVAL)
+   {
+      write_checkpoint(qs_inf, la_inf->shared, N);
+      qs_inf->checkpoint_time = time(NULL);
+   }
+   unlock_relations(la_inf);
+}
+
 /*===========================================================================
    Collect relations:
 
@@ -159,10 +323,17 @@ unsigned long collect_relations(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_
    if ((count & 7) == 0) printf("%ld curves\n", count*((1<<(s-1))-1));
 #endif
    
+   lock_relations(la_inf); // A is chosen from a stream shared by the sieving threads
    compute_A(qs_inf, poly_inf);
+   qs_inf->A_count++;
+#ifdef MPQS_TEST
+   test_A_chosen(qs_inf, la_inf->shared, poly_inf);
+#endif
+   unlock_relations(la_inf);
    compute_B_terms(qs_inf, poly_inf);
    compute_off_adj(qs_inf, poly_inf);
    compute_A_factor_offsets(qs_inf, poly_inf);
+   fill_buckets(qs_inf, poly_inf, 0, NULL);
    compute_B_C(qs_inf, poly_inf);          
       
    for (poly_index = 1; poly_index < (1<<(s-1)); poly_index++)
@@ -182,14 +353,10 @@ unsigned long collect_relations(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_
       }
       else
       {
-
-#define THIRD_PRIME 12000
-
 			unsigned long blocks = sieve_size/SIEVE_BLOCK;
          unsigned long offset = SIEVE_BLOCK;
-         unsigned long sieve_fill = qs_inf->sieve_fill;
+         unsigned long sieve_fill = poly_inf->sieve_fill;
          unsigned long second_prime = FLINT_MIN(SECOND_PRIME, qs_inf->num_primes);
-         unsigned long third_prime = FLINT_MIN(THIRD_PRIME, qs_inf->num_primes);
 			memset(sieve, sieve_fill, sieve_size);
          *(sieve+sieve_size) = 255;
          
@@ -198,12 +365,14 @@ unsigned long collect_relations(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_
             do_sieving(qs_inf, poly_inf, sieve, small_primes, second_prime, offset+SIEVE_BLOCK, 0, 0);
          do_sieving(qs_inf, poly_inf, sieve, small_primes, second_prime, sieve_size, 0, 1);
          
-         do_sieving3(qs_inf, poly_inf, sieve, second_prime, third_prime, sieve_size);
-         do_sieving4(qs_inf, poly_inf, sieve, third_prime, qs_inf->num_primes, sieve_size);
+         sieve_buckets(qs_inf, poly_inf, sieve);
       }
          
       relations += evaluate_sieve(la_inf, qs_inf, poly_inf, sieve);
       
+      // Other threads may have completed the matrix in the meantime
+      if ((la_inf->shared != la_inf) && relations_complete(la_inf, qs_inf)) break;
+      
       update_offsets(poly_add, poly_corr, qs_inf, poly_inf);
       
       limbs2 = B_terms[j*limbs];
@@ -238,11 +407,56 @@ unsigned long collect_relations(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_
       //compute_A_factor_offsets(qs_inf, poly_inf);    
    }
    
-   relations += merge_relations(la_inf);
+   lock_relations(la_inf);
+   relations += merge_relations(la_inf->shared);
+   unlock_relations(la_inf);
    
    return relations;
 }
 
+/*===========================================================================
+   Sieving thread:
+
+   Function: Collects relations from its own A-families, with its own poly_t, 
+             sieve and candidate factorisation arrays, committing them to 
+             the shared linalg_t, until the matrix is complete
+
+===========================================================================*/
+
+typedef struct
+{
+   QS_t * qs_inf;
+   linalg_t * la_inf;
+   mpz_ptr N;
+} sieve_thread_arg_t;
+
+void sieve_thread(void * arg_void)
+{
+   sieve_thread_arg_t * arg = (sieve_thread_arg_t *) arg_void;
+   QS_t * qs_inf = arg->qs_inf;
+   poly_t poly_inf;
+   linalg_t la_loc;
+   
+   poly_init(qs_inf, &poly_inf, arg->N);
+   
+   la_loc.small = (unsigned long *) flint_stack_alloc(qs_inf->small_primes);
+   la_loc.factor = (fac_t *) flint_stack_alloc_bytes(sizeof(fac_t)*MAX_FACS);
+   la_loc.shared = arg->la_inf;
+   
+   unsigned char * sieve = (unsigned char *) flint_stack_alloc_bytes(qs_inf->sieve_size+1);
+   
+   while (!relations_complete(&la_loc, qs_inf))
+   {
+      collect_relations(&la_loc, qs_inf, &poly_inf, sieve);
+      checkpoint_relations(&la_loc, qs_inf, arg->N);
+   }
+   
+   flint_stack_release(); // release sieve
+   flint_stack_release(); // release factor
+   flint_stack_release(); // release small
+   poly_clear(&poly_inf);
+}
+
 /*===========================================================================
    Main Quadratic Sieve Factoring Routine:
 
@@ -251,10 +465,12 @@ unsigned long collect_relations(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_
              Returns 0 if factorisation was unsuccessful
              Returns 1 if factorisation was successful
              If a small factor is found, it is returned and the QS is not run
+             If restart is nonzero, sieving resumes from the checkpoint 
+             left by an earlier run on the same N, if there is one
 
 ===========================================================================*/
 
-int F_mpz_factor_mpQS(F_mpz_factor_t * factors, mpz_t N)
+int F_mpz_factor_mpQS(F_mpz_factor_t * factors, mpz_t N, int restart)
 {
    unsigned long small_factor;
    unsigned long rels_found = 0;
@@ -328,18 +544,44 @@ int F_mpz_factor_mpQS(F_mpz_factor_t * factors, mpz_t N)
    poly_init(&qs_inf, &poly_inf, N);
    linear_algebra_init(&la_inf, &qs_inf, &poly_inf);
    
-   unsigned char * sieve = (unsigned char *) flint_stack_alloc_bytes(qs_inf.sieve_size+1);
-   while (rels_found < qs_inf.num_primes + EXTRA_RELS)
+   qs_inf.A_count = 0;
+   qs_inf.A_rand = 0;
+   if (restart && read_checkpoint(&qs_inf, &la_inf, &poly_inf, N))
    {
-      rels_found += collect_relations(&la_inf, &qs_inf, &poly_inf, sieve);
+      rels_found = la_inf.columns;
+      printf("Resuming with %ld relations and %ld partials\n", rels_found, la_inf.partials->num_partials);
+   }
+   qs_inf.checkpoint_time = time(NULL);
+   
+   const unsigned long num_threads = flint_get_num_threads();
+   if (num_threads > 1) // Each thread sieves its own A-families
+   {
+      sieve_thread_arg_t * args = (sieve_thread_arg_t *) flint_heap_alloc_bytes(num_threads*sizeof(sieve_thread_arg_t));
+      for (unsigned long i = 0; i < num_threads; i++)
+      {
+         args[i].qs_inf = &qs_inf;
+         args[i].la_inf = &la_inf;
+         args[i].N = N;
+      }
+      flint_parallel_do(sieve_thread, args, sizeof(sieve_thread_arg_t), num_threads);
+      flint_heap_free(args);
+      rels_found = la_inf.columns;
+   } else
+   {
+      unsigned char * sieve = (unsigned char *) flint_stack_alloc_bytes(qs_inf.sieve_size+1);
+      while (rels_found < qs_inf.num_primes + EXTRA_RELS)
+      {
+         rels_found += collect_relations(&la_inf, &qs_inf, &poly_inf, sieve);
+         checkpoint_relations(&la_inf, &qs_inf, N);
+      }
+      flint_stack_release(); // release sieve
    }
-   flint_stack_release(); // release sieve
    
    la_col_t * matrix = la_inf.matrix;
-   unsigned long ncols = qs_inf.num_primes + EXTRA_RELS;
+   unsigned long ncols = la_inf.columns;
    unsigned long nrows = qs_inf.num_primes;
 
-   reduce_matrix(&nrows, &ncols, matrix); // Do some filtering on the matrix
+   filter_matrix(&la_inf, &nrows, &ncols); // Remove singletons and cliques, merge light rows
    
    uint64_t* nullrows;
    do {
@@ -398,11 +640,13 @@ int F_mpz_factor_mpQS(F_mpz_factor_t * factors, mpz_t N)
       }
    }
    
-	flint_remove("comb");
-   flint_remove("lprels");
-   flint_remove("lpnew");
-
    free(nullrows);
+   if (CHECKPOINT_INTERVAL)
+   {
+      char * name = checkpoint_filename(N);
+      remove(name);
+      free(name);
+   }
 	small_factor = 1; // sieve was successful
    mpz_clear(Q);
    mpz_clear(R);
@@ -423,6 +667,50 @@ cleanup_2:
    return small_factor;    
 }
 
+#ifndef QS_NO_MAIN
+
+/*===========================================================================
+   Read tuning table:
+
+   Function: Read a table in the format of prime_tab from the given file and
+             use it in place of prime_tab. Each row is given on a line of its 
+             own, either as five numbers or as in the output of QS-tune
+
+===========================================================================*/
+
+static unsigned long tuning_file_tab[MAX_TUNING_ROWS][5];
+
+void read_tuning(char * filename)
+{
+   FILE * file = fopen(filename, "r");
+   unsigned long rows = 0;
+   unsigned long * row;
+   char line[256];
+   
+   if (file == NULL)
+   {
+      printf("Error: unable to open %s\n", filename);
+      abort();
+   }
+   
+   while ((rows < MAX_TUNING_ROWS) && (fgets(line, 256, file) != NULL))
+   {
+      row = tuning_file_tab[rows];
+      if ((sscanf(line, " {%lu ,%lu ,%lu ,%lu ,%lu", row, row + 1, row + 2, row + 3, row + 4) == 5)
+       || (sscanf(line, "%lu %lu %lu %lu %lu", row, row + 1, row + 2, row + 3, row + 4) == 5))
+         rows++;
+   }
+   fclose(file);
+   
+   if (rows == 0)
+   {
+      printf("Error: no tuning table found in %s\n", filename);
+      abort();
+   }
+   
+   qs_set_tuning((const unsigned long (*)[5]) tuning_file_tab, rows);
+}
+
 /*===========================================================================
    Main Program:
 
@@ -441,10 +729,18 @@ int main(int argc, char *argv[])
         mpz_init(factors.fact[i]);
     factors.num = 0;
 
+    int restart = 0;
+    for (int i = 1; i < argc; i++)
+    {
+       if (!strcmp(argv[i], "-r")) restart = 1; // Resume from a checkpoint
+       else if (!strcmp(argv[i], "-t") && (i + 1 < argc)) read_tuning(argv[++i]); // Tuning table
+       else flint_set_num_threads(atol(argv[i])); // Number of sieving threads
+    }
+    
     printf("Input number to factor [ >= 27 bits ] : "); 
     gmp_scanf("%Zd", N); getchar();
     
-    F_mpz_factor_mpQS(&factors, N);
+    F_mpz_factor_mpQS(&factors, N, restart);
     
 	 for(int i=0;i<64;i++)
         mpz_clear(factors.fact[i]);
@@ -489,7 +785,7 @@ int main(int argc, char *argv[])
           gmp_printf("Factoring %Zd\n", N);
 #endif
 
-          factor = F_mpz_factor_mpQS(factors, N);
+          factor = F_mpz_factor_mpQS(factors, N, 0);
           if (!factor) failed++;
           if (factor > 1) small_factors++;
           if (factor == 1) succeed++; 
@@ -501,3 +797,5 @@ int main(int argc, char *argv[])
     
     mpz_clear(N);
 }*/
+
+#endif
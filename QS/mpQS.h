@@ -32,8 +32,21 @@
 #include <gmp.h>
 
 #include "mp_factor_base.h"
+#include "mp_linear_algebra.h"
 #include "common.h"
 
 #define MINBITS 40 // Smallest bits including multiplier that can be factored
 
+#define CHECKPOINT_INTERVAL 600 // Seconds between checkpoints of the relations found, 0 for none
+
+#define CHECKPOINT_MAGIC 0x6D705153UL // Identifies an mpQS checkpoint file
+
+#define MAX_TUNING_ROWS 64 // Largest tuning table which can be read by mpQS -t
+
+int F_mpz_factor_mpQS(F_mpz_factor_t * factors, mpz_t N, int restart);
+
+char * checkpoint_filename(mpz_t N);
+
+void write_checkpoint(QS_t * qs_inf, linalg_t * la_inf, mpz_t N);
+
 #endif
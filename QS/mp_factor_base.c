@@ -39,23 +39,55 @@
 #include "mp_factor_base.h"
 
 /*=========================================================================
-   num_FB_primes:
+   Tuning table:
  
-   Function: retrieve the number of factor base primes to use from table
-             
+   Function: qs_set_tuning replaces prime_tab by the given table, which has 
+             the same format and is sorted by bitsize, until it is called 
+             again. The table must remain valid while it is in use. Passing 
+             NULL restores prime_tab. qs_tuning_row returns the row to use 
+             for kn of the given number of bits
  
 ==========================================================================*/
 
-unsigned long num_FB_primes(unsigned long bits)
+static const unsigned long (* tuning_tab)[5] = prime_tab;
+static unsigned long tuning_tab_size = PTABSIZE;
+
+void qs_set_tuning(const unsigned long (* table)[5], unsigned long rows)
+{
+   if (table == NULL)
+   {
+      tuning_tab = prime_tab;
+      tuning_tab_size = PTABSIZE;
+   } else
+   {
+      tuning_tab = table;
+      tuning_tab_size = rows;
+   }
+}
+
+const unsigned long * qs_tuning_row(unsigned long bits)
 {
    unsigned long i;
    
-   for (i = 0; i < PTABSIZE; i++)
+   for (i = 1; i < tuning_tab_size; i++)
    {
-      if (prime_tab[i][0] > bits) break;
+      if (tuning_tab[i][0] > bits) break;
    }
    
-   return prime_tab[i-1][1];
+   return tuning_tab[i-1];
+}
+
+/*=========================================================================
+   num_FB_primes:
+ 
+   Function: retrieve the number of factor base primes to use from table
+             
+ 
+==========================================================================*/
+
+unsigned long num_FB_primes(unsigned long bits)
+{
+   return qs_tuning_row(bits)[1];
 }
 
 /*=========================================================================
@@ -36,6 +36,10 @@
 
 #define KSMAX 1000
 
+void qs_set_tuning(const unsigned long (* table)[5], unsigned long rows);
+
+const unsigned long * qs_tuning_row(unsigned long bits);
+
 unsigned long num_FB_primes(unsigned long bits);
 
 void sqrts_init(QS_t * qs_inf);
@@ -0,0 +1,507 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/******************************************************************************
+
+ mp_filter.c
+
+ Filtering of the F_2 matrix before the linear algebra
+
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../flint.h"
+#include "../memory-manager.h"
+
+#include "common.h"
+#include "block_lanczos.h"
+#include "mp_linear_algebra.h"
+#include "mp_filter.h"
+
+typedef struct clique_s
+{
+   unsigned long weight;
+   unsigned long root;
+} clique_t;
+
+/*==========================================================================
+   Delete column:
+
+   Function: Delete the given column, updating the row counts
+
+===========================================================================*/
+
+static void filter_delete_col(la_col_t * col, unsigned long * counts)
+{
+   for (unsigned long j = 0; j < col->weight; j++)
+      counts[col->data[j]]--;
+   free_col(col);
+   clear_col(col);
+}
+
+/*==========================================================================
+   Compact columns:
+
+   Function: Remove the deleted (empty) columns from the first num_cols
+             columns, returning the number left
+
+===========================================================================*/
+
+static unsigned long filter_compact(la_col_t * cols, unsigned long num_cols)
+{
+   unsigned long i, j;
+
+   for (i = j = 0; i < num_cols; i++)
+   {
+      if (cols[i].weight)
+      {
+         if (j != i)
+         {
+            copy_col(cols + j, cols + i);
+            clear_col(cols + i);
+         }
+         j++;
+      }
+   }
+
+   return j;
+}
+
+/*==========================================================================
+   Remove singletons:
+
+   Function: Repeatedly delete columns containing the only entry in some
+             row until there are none left. Returns the number of columns
+             remaining
+
+===========================================================================*/
+
+static unsigned long filter_singletons(la_col_t * cols, unsigned long num_cols, unsigned long * counts)
+{
+   unsigned long deleted;
+
+   do
+   {
+      deleted = 0;
+      for (unsigned long i = 0; i < num_cols; i++)
+      {
+         la_col_t * col = cols + i;
+         unsigned long j;
+
+         for (j = 0; (j < col->weight) && (counts[col->data[j]] > 1); j++) ;
+
+         if (j < col->weight)
+         {
+            filter_delete_col(col, counts);
+            deleted++;
+         }
+      }
+      num_cols = filter_compact(cols, num_cols);
+   } while (deleted);
+
+   return num_cols;
+}
+
+/*==========================================================================
+   Remove cliques:
+
+   Function: Delete the num_delete heaviest cliques. The columns are joined
+             into cliques with a union-find structure, each row of weight 2
+             joining its two columns. Columns joined to no other are cliques
+             of their own. Returns the number of columns remaining
+
+===========================================================================*/
+
+static unsigned long clique_find(unsigned long * parent, unsigned long i)
+{
+   while (parent[i] != i)
+   {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+   }
+
+   return i;
+}
+
+static int clique_cmp(const void * a, const void * b)
+{
+   const clique_t * ca = (const clique_t *) a;
+   const clique_t * cb = (const clique_t *) b;
+
+   if (ca->weight > cb->weight) return -1;
+   if (ca->weight < cb->weight) return 1;
+   return 0;
+}
+
+static unsigned long filter_cliques(la_col_t * cols, unsigned long num_cols, unsigned long * counts,
+                                         unsigned long num_rows, unsigned long num_delete)
+{
+   unsigned long * partner = (unsigned long *) flint_heap_alloc(num_rows);
+   unsigned long * parent = (unsigned long *) flint_heap_alloc(num_cols);
+   unsigned long * weight = (unsigned long *) flint_heap_alloc(num_cols);
+   clique_t * cliques = (clique_t *) flint_heap_alloc_bytes(num_cols*sizeof(clique_t));
+   unsigned long num_cliques = 0;
+
+   for (unsigned long r = 0; r < num_rows; r++) partner[r] = -1L;
+
+   for (unsigned long i = 0; i < num_cols; i++)
+   {
+      parent[i] = i;
+      weight[i] = 0;
+   }
+
+   for (unsigned long i = 0; i < num_cols; i++)
+   {
+      for (unsigned long j = 0; j < cols[i].weight; j++)
+      {
+         unsigned long r = cols[i].data[j];
+         if (counts[r] != 2) continue;
+         if (partner[r] == -1L) partner[r] = i;
+         else
+         {
+            unsigned long a = clique_find(parent, i);
+            unsigned long b = clique_find(parent, partner[r]);
+            if (a != b) parent[a] = b;
+         }
+      }
+   }
+
+   for (unsigned long i = 0; i < num_cols; i++)
+      weight[clique_find(parent, i)] += cols[i].weight;
+
+   for (unsigned long i = 0; i < num_cols; i++)
+   {
+      if (parent[i] == i)
+      {
+         cliques[num_cliques].weight = weight[i];
+         cliques[num_cliques].root = i;
+         num_cliques++;
+      }
+   }
+
+   qsort(cliques, num_cliques, sizeof(clique_t), clique_cmp);
+
+   // Mark the roots of the cliques to be deleted, reusing weight
+
+   for (unsigned long i = 0; i < num_cols; i++) weight[i] = 0;
+   if (num_delete > num_cliques) num_delete = num_cliques;
+   for (unsigned long i = 0; i < num_delete; i++) weight[cliques[i].root] = 1;
+
+   for (unsigned long i = 0; i < num_cols; i++)
+   {
+      if (weight[clique_find(parent, i)]) filter_delete_col(cols + i, counts);
+   }
+
+   flint_heap_free(cliques);
+   flint_heap_free(weight);
+   flint_heap_free(parent);
+   flint_heap_free(partner);
+
+   return filter_compact(cols, num_cols);
+}
+
+#if FILTER_MERGE
+
+/*==========================================================================
+   Add columns:
+
+   Function: Set dest to dest + src over F_2, updating the row counts. The
+             array mark must be zero on entry and is left zero
+
+===========================================================================*/
+
+static void filter_add_col(la_col_t * dest, la_col_t * src, unsigned long * counts,
+                                                            unsigned char * mark)
+{
+   unsigned long * data = (unsigned long *) flint_heap_alloc(dest->weight + src->weight);
+   unsigned long weight = 0;
+
+   for (unsigned long j = 0; j < src->weight; j++) mark[src->data[j]] = 1;
+
+   for (unsigned long j = 0; j < dest->weight; j++)
+   {
+      unsigned long r = dest->data[j];
+      if (mark[r])
+      {
+         mark[r] = 0;
+         counts[r]--;
+      } else data[weight++] = r;
+   }
+
+   for (unsigned long j = 0; j < src->weight; j++)
+   {
+      unsigned long r = src->data[j];
+      if (mark[r])
+      {
+         mark[r] = 0;
+         counts[r]++;
+         data[weight++] = r;
+      }
+   }
+
+   free_col(dest);
+   dest->data = data;
+   dest->weight = weight;
+   if (weight == 0) flint_heap_free(data);
+}
+
+/*==========================================================================
+   Record merge:
+
+   Function: Record that the columns for relations a and b were added and
+             return the relation number of the result. Space for the
+             merges is allocated 1024 at a time
+
+===========================================================================*/
+
+static unsigned long filter_record_merge(linalg_t * la_inf, unsigned long a, unsigned long b)
+{
+   unsigned long i = la_inf->num_merges;
+
+   if ((i & 1023) == 0)
+   {
+      if (i) la_inf->merge = (unsigned long *) flint_heap_realloc(la_inf->merge, 2*(i + 1024));
+      else la_inf->merge = (unsigned long *) flint_heap_alloc(2*1024);
+   }
+
+   la_inf->merge[2*i] = a;
+   la_inf->merge[2*i + 1] = b;
+   la_inf->num_merges++;
+
+   return la_inf->num_relations + i;
+}
+
+/*==========================================================================
+   Merge:
+
+   Function: Eliminate rows of weight at most FILTER_MAX_MERGE, lightest
+             first. A row is eliminated by adding its lightest column to
+             each of its other columns, then deleting that column. This
+             removes a row and a column while increasing the total weight
+             by about (k - 2)*w - 2*(k - 1) for a row of weight k whose
+             lightest column has weight w, which is only done when that is
+             less than the average column weight. Each pass eliminates rows
+             none of whose columns have changed earlier in the pass. Returns
+             the number of columns remaining
+
+===========================================================================*/
+
+static unsigned long filter_merge(linalg_t * la_inf, la_col_t * cols, unsigned long num_cols,
+                                              unsigned long * counts, unsigned long num_rows)
+{
+   unsigned long * start = (unsigned long *) flint_heap_alloc(num_rows + 1);
+   unsigned char * mark = (unsigned char *) flint_heap_alloc_bytes(num_rows);
+   unsigned char * touched = (unsigned char *) flint_heap_alloc_bytes(num_cols);
+   unsigned long * row_cols = NULL;
+   unsigned long merged;
+
+   memset(mark, 0, num_rows);
+
+   do
+   {
+      unsigned long total = 0, entries = 0;
+
+      // Store the columns containing each row of weight 2..FILTER_MAX_MERGE
+
+      for (unsigned long r = 0; r < num_rows; r++)
+      {
+         start[r] = entries;
+         if ((counts[r] >= 2) && (counts[r] <= FILTER_MAX_MERGE)) entries += counts[r];
+      }
+      start[num_rows] = entries;
+
+      row_cols = (unsigned long *) flint_heap_alloc(entries + 1);
+
+      for (unsigned long i = 0; i < num_cols; i++)
+      {
+         touched[i] = 0;
+         total += cols[i].weight;
+         for (unsigned long j = 0; j < cols[i].weight; j++)
+         {
+            unsigned long r = cols[i].data[j];
+            if ((counts[r] >= 2) && (counts[r] <= FILTER_MAX_MERGE))
+               row_cols[start[r]++] = i;
+         }
+      }
+
+      for (unsigned long r = num_rows; r > 0; r--) start[r] = start[r - 1];
+      start[0] = 0;
+
+      const unsigned long average = total/num_cols;
+      merged = 0;
+
+      for (unsigned long k = 2; k <= FILTER_MAX_MERGE; k++)
+      {
+         for (unsigned long r = 0; r < num_rows; r++)
+         {
+            if (start[r + 1] - start[r] != k) continue;
+
+            unsigned long * rc = row_cols + start[r];
+            unsigned long pivot = rc[0], j;
+
+            for (j = 0; (j < k) && !touched[rc[j]]; j++)
+               if (cols[rc[j]].weight < cols[pivot].weight) pivot = rc[j];
+            if (j < k) continue;
+
+            if ((k - 2)*cols[pivot].weight >= average + 2*(k - 1)) continue;
+
+            for (j = 0; j < k; j++)
+            {
+               la_col_t * col = cols + rc[j];
+               if (rc[j] == pivot) continue;
+
+               filter_add_col(col, cols + pivot, counts, mark);
+               col->orig = filter_record_merge(la_inf, cols[pivot].orig, col->orig);
+               touched[rc[j]] = 1;
+            }
+
+            filter_delete_col(cols + pivot, counts);
+            touched[pivot] = 1;
+            merged++;
+         }
+      }
+
+      flint_heap_free(row_cols);
+      num_cols = filter_compact(cols, num_cols);
+   } while (merged);
+
+   flint_heap_free(touched);
+   flint_heap_free(mark);
+   flint_heap_free(start);
+
+   return num_cols;
+}
+
+#endif
+
+/*==========================================================================
+   Filter matrix:
+
+   Function: Filter the nrows x ncols matrix la_inf->matrix as described in
+             mp_filter.h, then renumber the rows so that the empty ones are
+             removed. On return nrows and ncols are the dimensions of the
+             filtered matrix
+
+===========================================================================*/
+
+void filter_matrix(linalg_t * la_inf, unsigned long * nrows, unsigned long * ncols)
+{
+   la_col_t * cols = la_inf->matrix;
+   unsigned long num_rows = *nrows;
+   unsigned long num_cols = *ncols;
+   unsigned long * counts = (unsigned long *) flint_heap_alloc(num_rows);
+   unsigned long rows, old_cols;
+
+   memset(counts, 0, num_rows*sizeof(unsigned long));
+   for (unsigned long i = 0; i < num_cols; i++)
+   {
+      for (unsigned long j = 0; j < cols[i].weight; j++)
+         counts[cols[i].data[j]]++;
+   }
+
+   // Deleting cliques can leave singletons and cut the excess by more than one
+   // per clique, so only half the surplus is deleted at a time
+
+   do
+   {
+      old_cols = num_cols;
+      num_cols = filter_singletons(cols, num_cols, counts);
+
+      for (unsigned long r = rows = 0; r < num_rows; r++)
+         if (counts[r]) rows++;
+
+      if (num_cols > rows + EXTRA_RELS)
+         num_cols = filter_cliques(cols, num_cols, counts, num_rows,
+                                             (num_cols - rows - EXTRA_RELS + 1)/2);
+   } while (num_cols != old_cols);
+
+#if DISPLAY
+   unsigned long weight = 0;
+   for (unsigned long i = 0; i < num_cols; i++) weight += cols[i].weight;
+   printf("filtered to %ld x %ld, weight %ld\n", rows, num_cols, weight);
+#endif
+
+#if FILTER_MERGE
+   if (num_cols) num_cols = filter_merge(la_inf, cols, num_cols, counts, num_rows);
+
+#if DISPLAY
+   weight = 0;
+   for (unsigned long i = 0; i < num_cols; i++) weight += cols[i].weight;
+   for (unsigned long r = rows = 0; r < num_rows; r++)
+      if (counts[r]) rows++;
+   printf("merged to %ld x %ld, weight %ld\n", rows, num_cols, weight);
+#endif
+#endif
+
+   // Renumber the nonempty rows consecutively, reusing counts
+
+   for (unsigned long r = rows = 0; r < num_rows; r++)
+   {
+      if (counts[r]) counts[r] = rows++;
+   }
+
+   for (unsigned long i = 0; i < num_cols; i++)
+   {
+      for (unsigned long j = 0; j < cols[i].weight; j++)
+         cols[i].data[j] = counts[cols[i].data[j]];
+   }
+
+   flint_heap_free(counts);
+
+   *nrows = rows;
+   *ncols = num_cols;
+}
+
+/*==========================================================================
+   Expand a nullspace vector:
+
+   Function: Set used[i] to 1 for each relation i used an odd number of times
+             by the combination of columns given by bit l of nullrows, and to
+             0 for the others. The array used must have room for
+             la_inf->num_relations + la_inf->num_merges entries
+
+===========================================================================*/
+
+void filter_expand(linalg_t * la_inf, unsigned char * used, uint64_t * nullrows,
+                                              unsigned long ncols, unsigned long l)
+{
+   const unsigned long num_relations = la_inf->num_relations;
+   unsigned long * merge = la_inf->merge;
+
+   memset(used, 0, num_relations + la_inf->num_merges);
+
+   for (unsigned long i = 0; i < ncols; i++)
+   {
+      if (get_null_entry(nullrows, i, l)) used[la_inf->matrix[i].orig] ^= 1;
+   }
+
+   // A merged column only involves earlier merges, so they can be undone in reverse
+
+   for (unsigned long i = la_inf->num_merges; i > 0; i--)
+   {
+      if (used[num_relations + i - 1])
+      {
+         used[merge[2*i - 2]] ^= 1;
+         used[merge[2*i - 1]] ^= 1;
+      }
+   }
+}
@@ -0,0 +1,54 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+
+#ifndef MPFILTER_H
+#define MPFILTER_H
+
+#include <stdint.h>
+
+#include "block_lanczos.h"
+#include "mp_linear_algebra.h"
+
+#define FILTER_MERGE 1 // Eliminate light rows by merging columns before the linear algebra
+
+#define FILTER_MAX_MERGE 8 // Heaviest row which may be eliminated by merging
+
+/*
+   The matrix is filtered in three stages. Columns containing the only entry
+   of some row are repeatedly deleted. While there are more than EXTRA_RELS
+   excess columns, the heaviest cliques are deleted, a clique being a
+   connected component of the graph whose vertices are the columns and whose
+   edges are the rows of weight 2; deleting a clique of k columns empties
+   at least k - 1 rows. Finally rows of weight up to FILTER_MAX_MERGE are
+   eliminated by adding their lightest column to the others and deleting it,
+   so long as this reduces the estimated cost ncols * weight of block Lanczos.
+
+   A merged column is given the relation number num_relations + i, where
+   la_inf->merge[2*i] and la_inf->merge[2*i + 1] are the relation numbers
+   of the two columns which were added to make it. Duplicate relations
+   never reach the filter, as merge_sort has already removed them.
+*/
+
+void filter_matrix(linalg_t * la_inf, unsigned long * nrows, unsigned long * ncols);
+
+void filter_expand(linalg_t * la_inf, unsigned char * used, uint64_t * nullrows,
+                                              unsigned long ncols, unsigned long l);
+
+#endif
@@ -30,6 +30,8 @@
 #include <gmp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "../flint.h"
 #include "../memory-manager.h"
@@ -64,11 +66,9 @@ void linear_algebra_init(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf)
    Y_arr = la_inf->Y_arr = (mpz_t *) flint_stack_alloc_bytes(sizeof(mpz_t)*buffer_size);
    la_inf->curr_rel = la_inf->relation = (unsigned long *) flint_stack_alloc(buffer_size*MAX_FACS*2);
    la_inf->qsort_arr = (la_col_t **) flint_stack_alloc(200);
-   la_inf->rel_str = (char *) flint_stack_alloc(MPQS_STRING_LENGTH);
    
-   la_inf->lpnew = flint_fopen("lpnew", "w");
-   FILE * lprels = flint_fopen("lprels","w");
-   fclose(lprels);
+   la_inf->partials = (lp_store_t *) flint_heap_alloc_bytes(sizeof(lp_store_t));
+   lp_store_init(la_inf->partials, qs_inf);
     
    for (unsigned long i = 0; i < buffer_size; i++) 
    {
@@ -80,9 +80,13 @@ void linear_algebra_init(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf)
    }
    
    la_inf->num_unmerged = 0;
-   la_inf->num_lp_unmerged = 0;
    la_inf->columns = 0;
    la_inf->num_relations = 0;
+   la_inf->merge = NULL;
+   la_inf->num_merges = 0;
+   
+   la_inf->shared = la_inf;
+   pthread_mutex_init(&la_inf->lock, NULL);
 }
    
 void linear_algebra_clear(linalg_t * la_inf, QS_t * qs_inf)
@@ -107,9 +111,11 @@ void linear_algebra_clear(linalg_t * la_inf, QS_t * qs_inf)
       free_col(unmerged + i);
    }
    
-   fclose(la_inf->lpnew);
+   lp_store_clear(la_inf->partials);
+   flint_heap_free(la_inf->partials);
+   if (la_inf->merge) flint_heap_free(la_inf->merge);
+   pthread_mutex_destroy(&la_inf->lock);
    
-   flint_stack_release(); // Clear rel_str
    flint_stack_release(); // Clear qsort_array
    flint_stack_release(); // Clear relation
    flint_stack_release(); // Clear Y_arr
@@ -270,78 +276,33 @@ unsigned long merge_relations(linalg_t * la_inf)
    return 0;
 }
 
-unsigned long merge_lp_relations(QS_t * qs_inf, poly_t * poly_inf, linalg_t * la_inf)
-{
-   FILE * comb;
-   unsigned long combined;
-   
-   fclose(la_inf->lpnew); 
-   sort_lp_file("lpnew");
-   comb = flint_fopen("comb","w");
-   mergesort_lp_file("lprels", "lpnew", "tmp", comb);
-   fclose(comb);
-   la_inf->lpnew = flint_fopen("lpnew","w");
-   
-   mpz_t factor;
-   mpz_init(factor);
-   comb = flint_fopen("comb", "r");
-   combined = combine_large_primes(qs_inf, la_inf, poly_inf, comb, factor);
-   mpz_clear(factor);
-   fclose(comb);
-     
-   la_inf->num_lp_unmerged = 0;
-   
-   return combined;         
-}
-
 /*==========================================================================
    Insert large prime partial relation:
 
-   Function: Insert the partial relation into the lprels file, return the 
-             number of full relations obtained after any sorting and merging
+   Function: Insert the partial relation with large primes q1 <= q2 (q1 = 1 
+             for a single large prime) into the graph of partials. If it 
+             closes a cycle, combine the cycle into a full relation and 
+             insert that. Return the number of full relations obtained after 
+             any merging
    
 ===========================================================================*/
 
-unsigned long insert_lp_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y, mpz_t res)
+unsigned long insert_lp_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y, 
+                                                       unsigned long q1, unsigned long q2)
 {
-   char * rel_str = la_inf->rel_str;
-   char * rel_ptr = rel_str;
-   char Q_str[200];
-   char Y_str[200];
-   FILE * LPNEW = la_inf->lpnew;
-
-   unsigned long small_primes = qs_inf->small_primes;
-   
-   unsigned long * small = la_inf->small;
-   const unsigned long num_factors = la_inf->num_factors; 
-   fac_t * factor = la_inf->factor;
-      
-   unsigned long fac_num = 0; 
-   
-   for (unsigned long i = 0; i < small_primes; i++)
-   {
-       if (small[i]) add_factor(&rel_ptr, (unsigned long) small[i], (unsigned long) i);
-   }
-   for (unsigned long i = 0; i < num_factors; i++)
-   {
-       add_factor(&rel_ptr, (unsigned long) factor[i].exp, (unsigned long) factor[i].ind);
-   }
-   add_0(&rel_ptr);
-   
-   gmp_sprintf(Y_str, "%Zd\0", Y);
-   gmp_sprintf(Q_str, "%Zd\0", res);
-   
-   fprintf(LPNEW, "%s @ %s :%s\n", Q_str, Y_str, rel_str);
-                          
-   la_inf->num_lp_unmerged++;
-   if ((la_inf->num_lp_unmerged %256) == 0) printf("%ld partials\n", la_inf->num_lp_unmerged);
-   
-   if (la_inf->num_lp_unmerged == 500)
-   {
-      return merge_lp_relations(qs_inf, poly_inf, la_inf);
-   }
-      
-   return 0;
+   lp_store_t * partials = la_inf->partials;
+   unsigned long stored = partials->num_partials;
+   unsigned long relations = 0;
+   mpz_t new_Y;
+   
+   mpz_init(new_Y);
+   if (lp_store_insert(partials, qs_inf, la_inf, q1, q2, Y, new_Y))
+      relations = insert_relation(qs_inf, la_inf, poly_inf, new_Y);
+   else if ((partials->num_partials != stored) && ((partials->num_partials & 255) == 0)) 
+      printf("%ld partials, %ld cycles\n", partials->num_partials, partials->num_cycles);
+   mpz_clear(new_Y);
+   
+   return relations;
 }
 
 /*==========================================================================
@@ -432,3 +393,120 @@ unsigned long insert_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_in
    return 0;
 }
 
+/*==========================================================================
+   Commit relation:
+
+   Function: Insert the relation held in la_inf->small and la_inf->factor
+             (a partial relation with large primes q1 <= q2 unless both 
+             are 1) into la_inf->shared. When that is shared by several sieving
+             threads, each of which has its own small and factor arrays,
+             the relation is copied across and inserted under its lock
+   
+===========================================================================*/
+
+unsigned long commit_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y, 
+                                                       unsigned long q1, unsigned long q2)
+{
+   linalg_t * shared = la_inf->shared;
+   unsigned long relations;
+   
+   if (shared != la_inf)
+   {
+      pthread_mutex_lock(&shared->lock);
+      memcpy(shared->small, la_inf->small, qs_inf->small_primes*sizeof(unsigned long));
+      memcpy(shared->factor, la_inf->factor, la_inf->num_factors*sizeof(fac_t));
+      shared->num_factors = la_inf->num_factors;
+   }
+   
+   if (q2 == 1) relations = insert_relation(qs_inf, shared, poly_inf, Y);
+   else relations = insert_lp_relation(qs_inf, shared, poly_inf, Y, q1, q2);
+   
+   if (shared->num_relations >= 2*(qs_inf->num_primes + EXTRA_RELS + 500))
+   {
+      printf("Error: too many duplicate relations!\n");
+      abort();
+   }
+   
+   if (shared != la_inf) pthread_mutex_unlock(&shared->lock);
+   
+   return relations;
+}
+
+/*==========================================================================
+   Write relations:
+
+   Function: Write the Y values and factorisations of all relations found 
+             so far to the given file, in binary
+   
+===========================================================================*/
+
+void linear_algebra_write(linalg_t * la_inf, FILE * file)
+{
+   unsigned long num_relations = la_inf->num_relations;
+   unsigned long * rel = la_inf->relation;
+   int ok = (fwrite(&num_relations, sizeof(unsigned long), 1, file) == 1);
+   
+   for (unsigned long i = 0; (i < num_relations) && ok; i++, rel += MAX_FACS*2)
+   {
+      ok = (mpz_out_raw(file, la_inf->Y_arr[i]) != 0);
+      if (ok) ok = (fwrite(rel, sizeof(unsigned long), 2*rel[0] + 1, file) == 2*rel[0] + 1);
+   }
+   
+   if (!ok)
+   {
+      printf("Error: unable to write relations\n");
+      abort();
+   }
+}
+
+/*==========================================================================
+   Read relations:
+
+   Function: Read relations written by linear_algebra_write from the given 
+             file and insert them into the matrix. Returns 0 if the file 
+             could not be read
+   
+===========================================================================*/
+
+int linear_algebra_read(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf, FILE * file)
+{
+   unsigned long small_primes = qs_inf->small_primes;
+   unsigned long * small = la_inf->small;
+   fac_t * factor = la_inf->factor;
+   unsigned long num_relations, num_factors, fac_num;
+   unsigned long pairs[MAX_FACS*2];
+   int ok = 1;
+   mpz_t Y;
+   
+   if (fread(&num_relations, sizeof(unsigned long), 1, file) != 1) return 0;
+   if (num_relations >= 2*(qs_inf->num_primes + EXTRA_RELS + 500)) return 0;
+   
+   mpz_init(Y);
+   
+   for (unsigned long i = 0; (i < num_relations) && ok; i++)
+   {
+      ok = (mpz_inp_raw(Y, file) != 0) && (fread(&fac_num, sizeof(unsigned long), 1, file) == 1)
+        && (fac_num < MAX_FACS) && (fread(pairs, sizeof(unsigned long), 2*fac_num, file) == 2*fac_num);
+      
+      for (unsigned long j = 0; j < small_primes; j++) small[j] = 0;
+      num_factors = 0;
+      for (unsigned long j = 0; (j < fac_num) && ok; j++)
+      {
+         if (pairs[2*j] < small_primes) small[pairs[2*j]] = pairs[2*j + 1];
+         else if ((pairs[2*j] < qs_inf->num_primes) && (num_factors < MAX_FACS))
+         {
+            factor[num_factors].ind = pairs[2*j];
+            factor[num_factors].exp = pairs[2*j + 1];
+            num_factors++;
+         } else ok = 0;
+      }
+      la_inf->num_factors = num_factors;
+      
+      if (ok) insert_relation(qs_inf, la_inf, poly_inf, Y);
+   }
+   
+   mpz_clear(Y);
+   if (ok) merge_relations(la_inf);
+   
+   return ok;
+}
@@ -31,6 +31,7 @@
 
 #include <gmp.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "common.h"
 #include "mp_poly.h"
@@ -57,7 +58,6 @@ typedef struct linalg_s
    
    la_col_t * unmerged; // A new list of unmerged F_2 columns
    unsigned long num_unmerged; // The current number of unmerged F_2 relations
-   unsigned long num_lp_unmerged; // The current number of unmerged partial relations
    
    mpz_t * Y_arr; // The Y values corresponding to all relations found
       
@@ -67,8 +67,13 @@ typedef struct linalg_s
 
    la_col_t ** qsort_arr; // An array of pointers to the unmerged relations for quicksort
    
-   char * rel_str;
-   FILE * lpnew;
+   struct lp_store_s * partials; // The partial relations found so far, keyed by large prime
+   
+   unsigned long * merge; // Pairs of relation numbers of columns added by filter_matrix
+   unsigned long num_merges; // The number of merged columns
+   
+   struct linalg_s * shared; // Where relations are committed: this structure itself, or the one shared by all sieving threads
+   pthread_mutex_t lock; // Protects a shared structure while threads commit relations to it
 } linalg_t;
 
 void linear_algebra_init(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf);
@@ -77,12 +82,18 @@ void linear_algebra_clear(linalg_t * la_inf, QS_t * qs_inf);
 
 unsigned long merge_sort(linalg_t * la_inf);
       
-unsigned long merge_lp_relations(QS_t * qs_inf, poly_t * poly_inf, linalg_t * la_inf);
-
 unsigned long merge_relations(linalg_t * la_inf);
 
-unsigned long insert_lp_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y, mpz_t res);
+unsigned long insert_lp_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y, 
+                                                       unsigned long q1, unsigned long q2);
 
 unsigned long insert_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y);
 
+unsigned long commit_relation(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, mpz_t Y, 
+                                                       unsigned long q1, unsigned long q2);
+
+void linear_algebra_write(linalg_t * la_inf, FILE * file);
+
+int linear_algebra_read(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf, FILE * file);
+
 #endif
@@ -20,8 +20,8 @@
 ===============================================================================*/
 
 /* 
-   This code has been adapted for FLINT from mpqs.c in the Pari/GP package. 
-   See http://pari.math.u-bordeaux.fr/
+   The temporary file routines have been adapted for FLINT from mpqs.c in 
+   the Pari/GP package. See http://pari.math.u-bordeaux.fr/
 */
 
 #include <stdlib.h>
@@ -30,15 +30,23 @@
 #include <gmp.h>
 #include <unistd.h>
 
+#include "../flint.h"
+#include "../memory-manager.h"
+
 #include "mp_lprels.h"
 
-#define min_bufspace 120UL  /* use new buffer when < min_bufspace left */
-#define buflist_size 4096UL /* size of list-of-buffers blocks */
-#define sort_table_size 100000UL
+#define LP_TABLE_INIT 1024UL /* initial number of hash table slots and of vertices */
+#define LP_DATA_INIT 4096UL /* initial number of words of packed relations */
+
+#if FLINT_BITS == 64
+#define LP_HASH_MULT 0x9E3779B97F4A7C15UL
+#else
+#define LP_HASH_MULT 0x9E3779B9UL
+#endif
 
 /*********************************************************************
 
-    File based large prime routines
+    Temporary files
     
 *********************************************************************/
 
@@ -72,8 +80,12 @@ char * unique_filename(char *s)
   return buf;
 }
 
+/*
+   Returns the full path of the file with the given name in the directory 
+   for temporary files
+*/
 
-FILE * flint_fopen(char * name, char * mode)
+char * tmp_dir_filename(char * name)
 {
 #if defined(WINCE) || defined(macintosh)
   char * tmp_dir = NULL;
@@ -81,656 +93,565 @@ FILE * flint_fopen(char * name, char * mode)
   char * tmp_dir = getenv("TMPDIR");
 #endif
   if (tmp_dir == NULL) tmp_dir = "./";
+  return get_filename(tmp_dir, name);
+}
+
+/*
+   Returns the full path of the temporary file with the given name, made
+   unique to this process
+*/
+
+static char * temp_filename(char * name)
+{
   char * unique = unique_filename(name);
-  char * full_name = get_filename(tmp_dir, unique);
+  char * full_name = tmp_dir_filename(unique);
+  free(unique);
+  return full_name;
+}
+
+FILE * flint_fopen(char * name, char * mode)
+{
+  char * full_name = temp_filename(name);
   FILE * temp_file = fopen(full_name, mode);
   if (!temp_file)
   {
      printf("Unable to open temporary file\n");
      abort();
   }
-  free(unique);
   free(full_name);
   return temp_file;
 }
 
 void flint_remove(char * name)
 {
-	#if defined(WINCE) || defined(macintosh)
-  char * tmp_dir = NULL;
-#else
-  char * tmp_dir = getenv("TMPDIR");
-#endif
-  if (tmp_dir == NULL) tmp_dir = "./";
-  char * unique = unique_filename(name);
-  char * full_name = get_filename(tmp_dir, unique);
+  char * full_name = temp_filename(name);
   remove(full_name);
-  free(unique);
   free(full_name);
 }
 
-/* 
-    Compares two large prime relations according to their first 
-    element (the large prime). Used by qsort.
-*/
+/*********************************************************************
 
-int lp_relations_cmp(const void *a, const void *b)
+    In memory store of partial relations
+    
+*********************************************************************/
+
+static inline
+unsigned long lp_hash(lp_store_t * store, unsigned long q)
 {
-  char **sa = (char**) a;
-  char **sb = (char**) b;
-  long qa = strtol(*sa, NULL, 10);
-  long qb = strtol(*sb, NULL, 10);
-  
-  if (qa < qb) return -1;
-  else if (qa > qb) return 1;
-  else return strcmp(*sa, *sb);
+   return ((q*LP_HASH_MULT) >> (FLINT_BITS/2)) & (store->table_size - 1);
 }
 
+/*
+   Enter vertex v into the hash table, which must have a free slot
+*/
+
+static void lp_table_insert(lp_store_t * store, unsigned long v)
+{
+   unsigned long * table = store->table;
+   unsigned long i = lp_hash(store, store->vertex[v].prime);
+   
+   while (table[i]) i = ((i + 1) & (store->table_size - 1));
+   table[i] = v + 1;
+}
 
 /*
-    Writes the given string to the given file and aborts upon error
+   Rebuild the hash table with the given number of slots from the vertices
 */
 
-void flint_fputs(char *s, FILE *file)
+static void lp_table_rebuild(lp_store_t * store, unsigned long table_size)
 {
-  if (fputs(s, file) < 0)
-  {
-      printf("Error whilst writing to large prime file!");
-      abort();
-  }
+   if (table_size != store->table_size)
+   {
+      flint_heap_free(store->table);
+      store->table = (unsigned long *) flint_heap_alloc(table_size);
+      store->table_size = table_size;
+   }
+   memset(store->table, 0, table_size*sizeof(unsigned long));
+   
+   for (unsigned long v = 1; v < store->num_vertices; v++)
+      lp_table_insert(store, v);
 }
 
-/* 
-   Given a file "filename" containing full or large prime relations,
-   rearrange the file so that relations are sorted by their first elements.
-   Works in memory, discards duplicate lines, and overwrites the original 
-   file. Returns the number of relations after sorting and discarding.
+/*
+   Remove all partials and all vertices but vertex 0 from the store
 */
 
-long sort_lp_file(char *filename)
+static void lp_store_reset(lp_store_t * store)
 {
-  FILE *TMP;
-  char *old_s, *buf, *cur_line;
-  char **s_table, **sort_table, **buflist, **buflist_head;
-  long i, j, count;
-  size_t length, bufspace;
-  
-  buflist_head = (char**) malloc(buflist_size * sizeof(char*));
-  buflist = buflist_head;
-  
-  *buflist++ = NULL; /* flag this as last and only buflist block */
-  
-  TMP = flint_fopen(filename, "r");
-  
-  /* allocate first buffer and read first line, if any, into it */
-  buf = (char*) malloc(MPQS_STRING_LENGTH * sizeof(char));
-  cur_line = buf;
-  bufspace = MPQS_STRING_LENGTH;
-
-  if (fgets(cur_line, bufspace, TMP) == NULL)
-  { /* file empty */
-    free(buf); free(buflist_head); 
-    fclose(TMP);
-    return 0;
-  }
-  /* enter first buffer into buflist */
-  *buflist++ = buf; /* can't overflow the buflist block */
-  length = strlen(cur_line) + 1; /* count the \0 byte as well */
-  bufspace -= length;
+   lp_vertex_t * vertex = store->vertex;
+   
+   store->length = 0;
+   store->num_partials = 0;
+   store->num_cycles = 0;
+   
+   store->num_vertices = 1;
+   vertex[0].prime = 1;
+   vertex[0].parent = 0;
+   vertex[0].edge = 0;
+   vertex[0].uf_parent = 0;
+   vertex[0].uf_size = 1;
+   vertex[0].mark = 0;
+   store->stamp = 0;
+   
+   lp_table_rebuild(store, store->table_size);
+}
 
-  s_table = (char**) malloc(sort_table_size*sizeof(char*));
-  sort_table = s_table+sort_table_size;
-  
-  /* at start of loop, one line from the file is sitting in cur_line inside buf,
-     the next will go into cur_line + length, and there's room for bufspace
-     further characters in buf. The loop reads another line if one exists, and
-     if this overruns the current buffer, it allocates a fresh one --GN */
-   
-  for (i = 0, sort_table--; /* until end of file */; i++, sort_table--)
-  { 
-       
-    *sort_table = cur_line;
-    cur_line += length;
-
-    /* if little room is left, allocate a fresh buffer before attempting to
-     * read a line, and remember to free it if no further line is forthcoming.
-     * This avoids some copying of partial lines --GN */
-    if (bufspace < min_bufspace)
-    {
-      buf = (char*) malloc(MPQS_STRING_LENGTH * sizeof(char));
-      cur_line = buf;
-      bufspace = MPQS_STRING_LENGTH;
-      if (fgets(cur_line, bufspace, TMP) == NULL) { free(buf); break; }
-
-      if (buflist - buflist_head >= buflist_size) abort();
-      
-      /* remember buffer for later deallocation */
-      *buflist++ = buf;
-      length = strlen(cur_line) + 1;
-      bufspace -= length; continue;
-    }
-
-    /* normal case:  try fitting another line into the current buffer */
-    if (fgets(cur_line, bufspace, TMP) == NULL) break; /* none exists */
-    length = strlen(cur_line) + 1;
-    bufspace -= length;
-
-    /* check whether we got the entire line or only part of it */
-    if (bufspace == 0 && cur_line[length-2] != '\n')
-    {
-      size_t lg1;
-      buf = (char*) malloc(MPQS_STRING_LENGTH * sizeof(char));
-      if (buflist - buflist_head >= buflist_size) abort();
-      /* remember buffer for later deallocation */
-      *buflist++ = buf;
-
-      /* copy what we've got to the new buffer */
-      (void)strcpy(buf, cur_line); /* cannot overflow */
-      cur_line = buf + length - 1; /* point at the \0 byte */
-      bufspace = MPQS_STRING_LENGTH - length + 1;
-      
-      /* read remainder of line */
-      if (fgets(cur_line, bufspace, TMP) == NULL)
-      {
-         printf("MPQS: relations file truncated?!\n");
-         abort();
-      }
-      lg1 = strlen(cur_line);
-      length += lg1; /* we already counted the \0 once */
-      bufspace -= (lg1 + 1); /* but here we must take it into account */
-      cur_line = buf; /* back up to the beginning of the line */
-    }
-  } /* for */
-
-  fclose(TMP);
-
-  /* sort the whole lot in place by swapping pointers */
-  qsort(sort_table, i, sizeof(char*), lp_relations_cmp);
-
-  /* copy results back to the original file, skipping exact duplicates */
-  TMP = flint_fopen(filename, "w");
-  old_s = sort_table[0];
-  flint_fputs(sort_table[0], TMP);
-  count = 1;
-  for(j = 1; j < i; j++)
-  {
-    if (strcmp(old_s, sort_table[j]))
-    {
-      flint_fputs(sort_table[j], TMP);
-      count++;
-    }
-    old_s = sort_table[j];
-  }
-  fflush(TMP);
-  fclose(TMP);
-  /* deallocate buffers */  
-  while (*--buflist)
-  {
-     if (buflist != buflist_head)
-        free(*buflist);   /* free a buffer */
-  }
-  free(buflist_head); 
-  free(s_table);
-  return count;
+void lp_store_init(lp_store_t * store, QS_t * qs_inf)
+{
+   store->data = (unsigned long *) flint_heap_alloc(LP_DATA_INIT);
+   store->alloc = LP_DATA_INIT;
+   
+   store->vertex = (lp_vertex_t *) flint_heap_alloc_bytes(LP_TABLE_INIT*sizeof(lp_vertex_t));
+   store->vertex_alloc = LP_TABLE_INIT;
+   
+   store->table = (unsigned long *) flint_heap_alloc(LP_TABLE_INIT);
+   store->table_size = LP_TABLE_INIT;
+   
+   lp_store_reset(store);
+   
+   store->exps = (unsigned long *) flint_heap_alloc(qs_inf->num_primes);
+   memset(store->exps, 0, qs_inf->num_primes*sizeof(unsigned long));
 }
 
-/* 
-   Appends contents of file fp1 to fp (auxiliary routine for merge sort) and
-   returns number of lines copied. Closes fp afterwards.
+void lp_store_clear(lp_store_t * store)
+{
+   flint_heap_free(store->exps);
+   flint_heap_free(store->table);
+   flint_heap_free(store->vertex);
+   flint_heap_free(store->data);
+}
+
+/*
+   Returns the vertex for the large prime q, creating it as an isolated 
+   vertex if there is none
 */
 
-long append_file(FILE *fp, FILE *fp1)
+static unsigned long lp_vertex(lp_store_t * store, unsigned long q)
 {
-  char line[MPQS_STRING_LENGTH];
-  long c = 0;
-  while (fgets(line, MPQS_STRING_LENGTH, fp1)) { flint_fputs(line, fp); c++; }
-  if (fflush(fp)) 
-  {
-     printf("Error while flushing file.\n");
-     abort();                
-  }                
-  fclose(fp); return c;
+   unsigned long * table = store->table;
+   unsigned long i, v;
+   
+   if (q == 1) return 0;
+   
+   for (i = lp_hash(store, q); table[i]; i = ((i + 1) & (store->table_size - 1)))
+   {
+      if (store->vertex[table[i] - 1].prime == q) return table[i] - 1;
+   }
+   
+   if (store->num_vertices == store->vertex_alloc)
+   {
+      store->vertex_alloc *= 2;
+      store->vertex = (lp_vertex_t *) flint_heap_realloc_bytes(store->vertex, store->vertex_alloc*sizeof(lp_vertex_t));
+   }
+   
+   v = store->num_vertices++;
+   store->vertex[v].prime = q;
+   store->vertex[v].parent = v;
+   store->vertex[v].edge = 0;
+   store->vertex[v].uf_parent = v;
+   store->vertex[v].uf_size = 1;
+   store->vertex[v].mark = 0;
+   
+   if (2*store->num_vertices > store->table_size) lp_table_rebuild(store, 2*store->table_size);
+   else table[i] = v + 1;
+   
+   return v;
 }
 
-/* 
-   Merge-sort on the files LPREL and LPNEW; assumes that LPREL and LPNEW are
-   already sorted. Creates/truncates the TMP file, writes result to it and
-   closes it (via append_file()). Instead of LPREL, LPNEW we may also call
-   this with FREL, FNEW. In the latter case COMB should be NULL (and we
-   return the count of all full relations), in the former case it should be
-   non-NULL (and we return the count of frels we expect to be able to combine 
-   out of the present lprels). If COMB is non-NULL, the combinable lprels 
-   are written out to this separate file.
-   
-   We retain only one occurrence of each large prime in TMP (i.e. in the
-   future LPREL file). --GN 
+/*
+   Union-find: returns the representative of the component containing v
 */
 
-#define swap_lines() { char *line_tmp;\
-  line_tmp = line_new_old; \
-  line_new_old = line_new; \
-  line_new = line_tmp; }
+static unsigned long lp_find(lp_store_t * store, unsigned long v)
+{
+   lp_vertex_t * vertex = store->vertex;
+   
+   while (vertex[v].uf_parent != v)
+   {
+      vertex[v].uf_parent = vertex[vertex[v].uf_parent].uf_parent;
+      v = vertex[v].uf_parent;
+   }
+   
+   return v;
+}
 
-long mergesort_lp_file_internal(FILE *LPREL, FILE *LPNEW, FILE *COMB, FILE *TMP)
+/*
+   Make v the root of its tree in the spanning forest by reversing the 
+   parent pointers along the path from v to the current root
+*/
+
+static void lp_reroot(lp_store_t * store, unsigned long v)
 {
-  char line1[MPQS_STRING_LENGTH], line2[MPQS_STRING_LENGTH];
-  char line[MPQS_STRING_LENGTH];
-  char *line_new = line1, *line_new_old = line2;
-  long q_new, q_new_old = -1, q, i = 0, c = 0;
-  long comb_in_progress;
-
-  if ( !fgets(line_new, MPQS_STRING_LENGTH, LPNEW) )
-  { 
-    /* LPNEW is empty: copy LPREL to TMP. Could be done by a rename if we
-       didn't want to count the lines (again)... however, this case will not
-       normally happen */
-    i = append_file(TMP, LPREL);
-    return COMB ? 0 : i;
-  }
-  /* we now have a line_new from LPNEW */
+   lp_vertex_t * vertex = store->vertex;
+   unsigned long u = v, p = vertex[v].parent, e = vertex[v].edge;
+   unsigned long next_p, next_e;
+   
+   vertex[v].parent = v;
+   while (p != u)
+   {
+      next_p = vertex[p].parent;
+      next_e = vertex[p].edge;
+      vertex[p].parent = u;
+      vertex[p].edge = e;
+      u = p;
+      p = next_p;
+      e = next_e;
+   }
+}
 
-  if (!fgets(line, MPQS_STRING_LENGTH, LPREL))
-  { 
-    /* LPREL is empty: copy LPNEW to TMP... almost. */
-    flint_fputs(line_new, TMP);
-    
-    if (!COMB)
-    { 
-      /* full relations mode */
-      i = append_file(TMP, LPNEW);
-      return i + 1;
-    }
-
-    /* LP mode:  check for combinable relations */
-    q_new_old = atol(line_new);
-    /* we need to retain a copy of the old line just for a moment, because we
-       may yet have to write it to COMB. Do this by swapping the two buffers */
-    swap_lines();
-    comb_in_progress = 0;
-    i = 0;
-
-    while (fgets(line_new, MPQS_STRING_LENGTH, LPNEW))
-    {
-      q_new = atol(line_new);
-      if (q_new_old == q_new)
-      { 
-        /* found combinables, check whether we're already busy on this
-           particular large prime */
-        if (!comb_in_progress)
-        { 
-          /* if not, write first line to COMB, creating and opening the
-             file first if it isn't open yet */
-          flint_fputs(line_new_old, COMB);
-          comb_in_progress = 1;
-        }
-        /* in any case, write the current line, and count it */
-        flint_fputs(line_new, COMB);
-        i++;
-      }
-      else
-      { 
-        /* not combinable */
-        q_new_old = q_new;
-        comb_in_progress = 0;
-        /* and dump it to the TMP file */
-        flint_fputs(line_new, TMP);
-        /* and stash it away for a moment */
-        swap_lines();
-        comb_in_progress = 0;
-      }
-    } /* while */
-    fclose(TMP); return i;
-  }
+/*
+   Join the trees containing u and v, which must be distinct, by the partial 
+   at the given offset into data. The smaller tree is rerooted and hung 
+   below the other.
+*/
 
-  /* normal case: both LPNEW and LPREL are not empty */
-  q_new = atol(line_new);
-  q = atol(line);
-
-  for(;;)
-  { 
-    /* main merging loop */
-    i = comb_in_progress = 0;
-
-    /* first the harder case:  let LPNEW catch up with LPREL, and possibly
-       overtake it, checking for combinables coming from LPNEW alone */
-    while (q > q_new)
-    {
-      if (!COMB || !comb_in_progress) flint_fputs(line_new, TMP);
-      if (!COMB) c++; /* in FREL mode, count lines written */
-      else if (!comb_in_progress)
-      {
-        q_new_old = q_new;
-        swap_lines();
-      }
-      if (!fgets(line_new, MPQS_STRING_LENGTH, LPNEW))
-      {
-        flint_fputs(line, TMP);
-        if (!COMB) c++; else c += i;
-        i = append_file(TMP, LPREL);
-        return COMB ? c : c + i;
-      }
-      q_new = atol(line_new);
-      if (!COMB) continue;
-
-      /* LP mode only: */
-      if (q_new_old != q_new) /* not combinable */
-        comb_in_progress = 0; /* next loop will deal with it, or loop may end */
-      else
-      { 
-        /* found combinables, check whether we're already busy on this
-           large prime */
-        if (!comb_in_progress)
-        {
-          flint_fputs(line_new_old, COMB);
-          comb_in_progress = 1;
-        }
-        /* in any case, write the current line, and count it */
-        flint_fputs(line_new, COMB);
-        i++;
-      }
-    } /* while q > q_new */
+static void lp_link(lp_store_t * store, unsigned long u, unsigned long v, unsigned long offset)
+{
+   lp_vertex_t * vertex = store->vertex;
+   unsigned long ru = lp_find(store, u);
+   unsigned long rv = lp_find(store, v);
+   unsigned long t;
+   
+   if (vertex[ru].uf_size > vertex[rv].uf_size)
+   {
+      t = u; u = v; v = t;
+      t = ru; ru = rv; rv = t;
+   }
+   
+   lp_reroot(store, u);
+   vertex[u].parent = v;
+   vertex[u].edge = offset;
+   
+   vertex[ru].uf_parent = rv;
+   vertex[rv].uf_size += vertex[ru].uf_size;
+}
 
-    /* q <= q_new */
+/*
+   Add the exponents of the packed partial rel to small and exps
+*/
 
-    if (COMB) c += i;    /* accumulate count of combinables */
-    i = 0;               /* and clear it */
-    comb_in_progress = 0;/* redundant */
+static void lp_add_exponents(lp_store_t * store, QS_t * qs_inf, unsigned long * small, unsigned long * rel)
+{
+   unsigned long size = FLINT_ABS((long) rel[2]);
+   unsigned long n = rel[3 + size];
+   unsigned long * pairs = rel + 4 + size;
+   unsigned long small_primes = qs_inf->small_primes;
+   
+   for (unsigned long i = 0; i < n; i++)
+   {
+      if (pairs[2*i] < small_primes) small[pairs[2*i]] += pairs[2*i + 1];
+      else store->exps[pairs[2*i]] += pairs[2*i + 1];
+   }
+}
 
-    /* now let LPREL catch up with LPNEW, and possibly overtake it */
-    while (q < q_new)
-    {
-      flint_fputs(line, TMP);
-      if (!COMB) c++;
-      if (!fgets(line, MPQS_STRING_LENGTH, LPREL))
-      {
-        flint_fputs(line_new, TMP);
-        i = append_file(TMP, LPNEW);
-        return COMB ? c : c + i + 1;
-      }
-      else
-        q = atol(line);
-    }
-
-    /* q >= q_new */
-
-    /* Finally, it may happen that q == q_new, indicating combinables whose
-       large prime is already in LPREL, and appears now one or more times in
-       LPNEW. Thus in this sub-loop we advance LPNEW. The `line' from LPREL is
-       left alone, and will be written to TMP the next time around the main for
-       loop; we only write it to COMB here -- unless all we find is an exact
-       duplicate of the line we already have, that is. (There can be at most
-       one such, and if so it is simply discarded.) */
-    while (q == q_new)
-    {
-      if (!strcmp(line_new, line))
-      { 
-        /* duplicate -- move right ahead to the next LPNEW line */
-        ;/* do nothing here */
-      }
-      else if (!COMB)
-      { /* full relations mode: write line_new out first, keep line */
-        flint_fputs(line_new, TMP);
-        c++;
-      }
-      else
-      { 
-        /* LP mode, and combinable relation */
-        if (!comb_in_progress)
-        {
-          flint_fputs(line, COMB);
-          comb_in_progress = 1;
-        }
-        flint_fputs(line_new, COMB);
-        i++;
-      }
-      /* NB comb_in_progress is cleared by q_new becoming bigger than q, thus
-         the current while loop terminating, the next time through the main for
-         loop */
+/*
+   Append the factors of the packed partial rel with nonzero exponent in 
+   exps to factor, zeroing exps as we go. Returns the new number of 
+   factors, which is only allowed to reach max.
+*/
 
-      /* common ending: get another line_new, if any */
-      if (!fgets(line_new, MPQS_STRING_LENGTH, LPNEW))
+static unsigned long lp_collect_factors(lp_store_t * store, QS_t * qs_inf, fac_t * factor, 
+                               unsigned long num_factors, unsigned long max, unsigned long * rel, int * ok)
+{
+   unsigned long size = FLINT_ABS((long) rel[2]);
+   unsigned long n = rel[3 + size];
+   unsigned long * pairs = rel + 4 + size;
+   unsigned long * exps = store->exps;
+   unsigned long ind;
+   
+   for (unsigned long i = 0; i < n; i++)
+   {
+      ind = pairs[2*i];
+      if (ind >= qs_inf->small_primes && exps[ind])
       {
-        flint_fputs(line, TMP);
-        if (!COMB) c++; else c += i;
-        i = append_file(TMP, LPREL);
-        return COMB ? c : c + i;
+         if (num_factors < max)
+         {
+            factor[num_factors].ind = ind;
+            factor[num_factors].exp = exps[ind];
+            num_factors++;
+         } else *ok = 0;
+         exps[ind] = 0;
       }
-      else
-        q_new = atol(line_new);
-    } /* while */
-
-    if (COMB) c += i; /* accumulate count of combinables */
-  }
+   }
+   
+   return num_factors;
 }
 
-/* 
-   Perform mergesort of large prime files
+/*
+   The partial relation held in la_inf->small and la_inf->factor, with 
+   large primes corresponding to vertices u and v, closes a cycle in the 
+   spanning forest. Combine it with the partials on the path from u to v 
+   in the forest, overwriting la_inf->small and la_inf->factor with the 
+   exponents of the resulting full relation and setting its Y value in 
+   new_Y. Each large prime in the cycle occurs in two of its partials, so
+   is divided out of Y. Returns 0 if no relation is obtained, i.e. if 
+   the partial is a duplicate, a large prime is not invertible modulo N or 
+   the full relation has too many factors.
 */
 
-long mergesort_lp_file(char *REL_str, char *NEW_str, char *TMP_str, FILE *COMB)
+static int lp_build_cycle(lp_store_t * store, QS_t * qs_inf, linalg_t * la_inf, 
+                            unsigned long u, unsigned long v, mpz_t Y, mpz_t new_Y)
 {
-  FILE *NEW = flint_fopen(NEW_str, "r");
-  
-#if defined(WINCE) || defined(macintosh)
-  char * tmp_dir = NULL;
-#else
-  char * tmp_dir = getenv("TMPDIR");
-#endif
-  if (tmp_dir == NULL) tmp_dir = "./";
-  char * unique = unique_filename(TMP_str);
-  char * TMP_name = get_filename(tmp_dir, unique);
-  free(unique);
-  unique = unique_filename(REL_str);
-  char * REL_name = get_filename(tmp_dir, unique);
-  free(unique);
-  FILE * TMP = fopen(TMP_name,"w");
-  FILE * REL = fopen(REL_name,"r");
-  if ((!TMP) || (!REL))
-  {
-     printf("Unable to open temporary file\n");
-     abort();
-  }
-  
-  long tp = mergesort_lp_file_internal(REL, NEW, COMB, TMP);
-  fclose(REL);
-  fclose(NEW);
-  
-  if (rename(TMP_name,REL_name))
-  {
-     printf("Cannot rename file %s to %s", TMP_str, REL_str);
-     abort();
-  } 
-  free(TMP_name);
-  free(REL_name);
-  return tp;
+   lp_vertex_t * vertex = store->vertex;
+   unsigned long small_primes = qs_inf->small_primes;
+   unsigned long * small = la_inf->small;
+   fac_t * factor = la_inf->factor;
+   unsigned long num_factors = la_inf->num_factors;
+   unsigned long * exps = store->exps;
+   unsigned long * rel;
+   unsigned long lca, w, i, size, max;
+   int side, ok = 1;
+   
+   mpz_t Y1, Q;
+   
+   /* Find the lowest common ancestor of u and v */
+   store->stamp++;
+   for (w = u; ; w = vertex[w].parent)
+   {
+      vertex[w].mark = store->stamp;
+      if (vertex[w].parent == w) break;
+   }
+   for (lca = v; vertex[lca].mark != store->stamp; lca = vertex[lca].parent) ;
+   
+   mpz_init(Y1);
+   mpz_init(Q);
+   
+   /* A partial found twice gives a trivial cycle */
+   if ((u != v) && (((lca == v) && (vertex[u].parent == v)) || ((lca == u) && (vertex[v].parent == u))))
+   {
+      rel = store->data + vertex[lca == v ? u : v].edge;
+      size = FLINT_ABS((long) rel[2]);
+      mpz_import(Y1, size, -1, sizeof(unsigned long), 0, 0, rel + 3);
+      if (mpz_cmpabs(Y1, Y) == 0) ok = 0;
+   }
+   
+   mpz_set(new_Y, Y);
+   mpz_set_ui(Q, vertex[lca].prime);
+   for (side = 0; (side < 2) && ok; side++)
+   {
+      for (w = (side ? v : u); w != lca; w = vertex[w].parent)
+      {
+         rel = store->data + vertex[w].edge;
+         size = FLINT_ABS((long) rel[2]);
+         mpz_import(Y1, size, -1, sizeof(unsigned long), 0, 0, rel + 3);
+         if ((long) rel[2] < 0) mpz_neg(Y1, Y1);
+         mpz_mul(new_Y, new_Y, Y1);
+         mpz_mod(new_Y, new_Y, qs_inf->mpz_n);
+         mpz_mul_ui(Q, Q, vertex[w].prime);
+         mpz_mod(Q, Q, qs_inf->mpz_n);
+         lp_add_exponents(store, qs_inf, small, rel);
+      }
+   }
+   
+   if (ok && mpz_invert(Q, Q, qs_inf->mpz_n))
+   {
+      mpz_mul(new_Y, new_Y, Q);
+      mpz_mod(new_Y, new_Y, qs_inf->mpz_n);
+      mpz_sub(Y1, qs_inf->mpz_n, new_Y);
+      if (mpz_cmpabs(Y1, new_Y) < 0) mpz_set(new_Y, Y1);
+   } else ok = 0;
+   
+   mpz_clear(Y1);
+   mpz_clear(Q);
+   
+   /* 
+      Add the exponents of the new partial to those in exps, then collect 
+      the factors with nonzero exponent, zeroing exps again as we go. 
+      Each factor takes two words of the relation list, as do the nonzero
+      small primes.
+   */
+   for (i = 0, max = MAX_FACS - 1; i < small_primes; i++)
+      if (small[i]) max--;
+   
+   for (i = 0; i < num_factors; i++) 
+   {
+      factor[i].exp += exps[factor[i].ind];
+      exps[factor[i].ind] = 0;
+   }
+   if (num_factors > max) ok = 0;
+   for (side = 0; side < 2; side++)
+   {
+      for (w = (side ? v : u); w != lca; w = vertex[w].parent)
+         num_factors = lp_collect_factors(store, qs_inf, factor, num_factors, max, store->data + vertex[w].edge, &ok);
+   }
+   la_inf->num_factors = num_factors;
+   
+   if (ok) store->num_cycles++;
+   
+   return ok;
 }
 
-/*********************************************************************
-
-    Routines for writing relations as strings
-    
-*********************************************************************/
-
-/* 
-    Writes a factor pi^ei into a string as " ei pi" 
+/*
+   Pack the partial relation held in la_inf->small and la_inf->factor, with 
+   large primes q1 and q2, onto the end of data and return its offset
 */
 
-void add_factor(char **last, unsigned long ei, unsigned long pi) 
+static unsigned long lp_pack(lp_store_t * store, QS_t * qs_inf, linalg_t * la_inf, 
+                                 unsigned long q1, unsigned long q2, mpz_t Y)
 {
-  sprintf(*last, " %ld %ld", ei, pi);
-  *last += strlen(*last);
+   unsigned long small_primes = qs_inf->small_primes;
+   unsigned long * small = la_inf->small;
+   fac_t * factor = la_inf->factor;
+   const unsigned long num_factors = la_inf->num_factors;
+   
+   unsigned long offset = store->length;
+   unsigned long needed = offset + 4 + mpz_size(Y) + 2*(small_primes + num_factors);
+   unsigned long * rel, * pairs;
+   unsigned long i, n = 0;
+   size_t count;
+   
+   if (needed > store->alloc)
+   {
+      store->alloc = FLINT_MAX(needed, 2*store->alloc);
+      store->data = (unsigned long *) flint_heap_realloc(store->data, store->alloc);
+   }
+   
+   rel = store->data + offset;
+   rel[0] = q1;
+   rel[1] = q2;
+   mpz_export(rel + 3, &count, -1, sizeof(unsigned long), 0, 0, Y);
+   rel[2] = (mpz_sgn(Y) < 0) ? -count : count;
+   
+   pairs = rel + 4 + count;
+   for (i = 0; i < small_primes; i++)
+   {
+      if (small[i])
+      {
+         pairs[2*n] = i;
+         pairs[2*n + 1] = small[i];
+         n++;
+      }
+   }
+   for (i = 0; i < num_factors; i++)
+   {
+      pairs[2*n] = factor[i].ind;
+      pairs[2*n + 1] = factor[i].exp;
+      n++;
+   }
+   rel[3 + count] = n;
+   
+   store->length = offset + 4 + count + 2*n;
+   store->num_partials++;
+   
+   return offset;
 }
 
 /*
-   Concatenate " 0" to string 
+   Insert the partial relation held in la_inf->small and la_inf->factor, 
+   with large primes q1 and q2 (q1 = 1 for a single large prime), as an edge 
+   of the graph whose vertices are the large primes and 1. If it joins two 
+   components the partial is stored as an edge of the spanning forest. 
+   Otherwise it closes a cycle, which is combined into a full relation by 
+   lp_build_cycle, and 1 is returned if this succeeds. 
 */
 
-void add_0(char **last) 
+int lp_store_insert(lp_store_t * store, QS_t * qs_inf, linalg_t * la_inf, 
+                      unsigned long q1, unsigned long q2, mpz_t Y, mpz_t new_Y)
 {
-  char *s = *last;
-  *s++ = ' ';
-  *s++ = '0';
-  *s++ = 0; *last = s;
+   unsigned long u = lp_vertex(store, q1);
+   unsigned long v = lp_vertex(store, q2);
+   
+   if (lp_find(store, u) == lp_find(store, v))
+      return lp_build_cycle(store, qs_inf, la_inf, u, v, Y, new_Y);
+   
+   lp_link(store, u, v, lp_pack(store, qs_inf, la_inf, q1, q2, Y));
+   
+   return 0;
 }
 
 /*********************************************************************
 
-    Large prime relation combining
+    Saving and restoring partial relations
     
 *********************************************************************/
 
 /*
-   Add to an array of unsigned longs the exponents from a relation string
+   Write the store in binary to the given file
 */
 
-void set_exponents(unsigned long *ei, char *r)
+void lp_store_write(lp_store_t * store, FILE * file)
 {
-  char *s, b[MPQS_STRING_LENGTH];
-  long e;
-
-  strcpy(b, r);
-  s = strtok(b, " \n");
-  while (s != NULL)
-  {
-    e = atol(s); if (!e) break;
-    s = strtok(NULL, " \n");
-    ei[atol(s)] += e;
-    s = strtok(NULL, " \n");
-  }
+   unsigned long header[3];
+   
+   header[0] = store->length;
+   header[1] = store->num_partials;
+   header[2] = store->num_cycles;
+   
+   if ((fwrite(header, sizeof(unsigned long), 3, file) != 3) 
+    || (fwrite(store->data, sizeof(unsigned long), store->length, file) != store->length))
+   {
+      printf("Error: unable to write partial relations\n");
+      abort();
+   }
 }
 
-/* Writes an lp_entry from a string */
+/*
+   Replace the contents of the store with partials read from the given file,
+   as written by lp_store_write, and rebuild the spanning forest from them. 
+   Returns 0 if the file could not be read, in which case the store is left 
+   empty.
+*/
 
-void set_lp_entry(mpqs_lp_entry *e, char *buf)
+int lp_store_read(lp_store_t * store, FILE * file)
 {
-  char *s1, *s2;
-  s1 = buf; s2 = strchr(s1, ' '); *s2 = '\0';
-  e->q = atol(s1);
-  s1 = s2 + 3; s2 = strchr(s1, ' '); *s2 = '\0';
-  strcpy(e->Y, s1);
-  s1 = s2 + 3; s2 = strchr(s1, '\n'); *s2 = '\0';
-  strcpy(e->E, s1);
+   unsigned long header[3];
+   unsigned long offset, size, u, v, * rel;
+   
+   lp_store_reset(store);
+   
+   if (fread(header, sizeof(unsigned long), 3, file) != 3) return 0;
+   
+   if (header[0] > store->alloc)
+   {
+      store->alloc = header[0];
+      store->data = (unsigned long *) flint_heap_realloc(store->data, store->alloc);
+   }
+   if (fread(store->data, sizeof(unsigned long), header[0], file) != header[0]) return 0;
+   
+   for (offset = 0; offset < header[0]; )
+   {
+      rel = store->data + offset;
+      u = lp_vertex(store, rel[0]);
+      v = lp_vertex(store, rel[1]);
+      if (lp_find(store, u) != lp_find(store, v)) lp_link(store, u, v, offset);
+      size = FLINT_ABS((long) rel[2]);
+      offset += 4 + size + 2*rel[3 + size];
+   }
+   
+   store->length = header[0];
+   store->num_partials = header[1];
+   store->num_cycles = header[2];
+   
+   return 1;
 }
 
-/* 
-   Combines the large prime relations in COMB to full relations and inserts them
-   as relations into the matrix, etc. 
+/*
+   Save the store to the temporary file with the given name
 */
 
-unsigned long combine_large_primes(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, 
-                                                       FILE *COMB, mpz_t factor)
+void lp_store_save(lp_store_t * store, char * name)
 {
-  char new_relation[MPQS_STRING_LENGTH], buf[MPQS_STRING_LENGTH];
-  mpqs_lp_entry e[2]; /* we'll use the two alternatingly */
-  unsigned long *ei; 
-  long ei_size = qs_inf->num_primes;
-  mpz_t * N = &qs_inf->mpz_n;
-  long old_q;
-  mpz_t inv_q, Y1, Y2, new_Y, new_Y1;
-  mpz_init(inv_q); mpz_init(Y1); mpz_init(Y2); mpz_init(new_Y); mpz_init(new_Y1);
-  long i, l, c = 0;
-  unsigned long newrels = 0;
-
-  if (!fgets(buf, MPQS_STRING_LENGTH, COMB)) return 0; /* should not happen */
-
-  ei = (unsigned long *) malloc(sizeof(unsigned long)*ei_size);
-  
-  /* put first lp relation in row 0 of e */
-  set_lp_entry(&e[0], buf);
-
-  i = 1; /* second relation will go into row 1 */
-  old_q = e[0].q;
-  mpz_set_ui(inv_q, old_q);
-  while (!mpz_invert(inv_q, inv_q, *N)) /* can happen */
-  {
-    /* We have found a factor. It could be N when N is quite small;  
-       or we might just have found a divisor by sheer luck. */
-    mpz_gcd_ui(inv_q, *N, old_q);
-    if (!mpz_cmp(inv_q, *N)) /* pity */
-    {
-      if (!fgets(buf, MPQS_STRING_LENGTH, COMB)) { return 0; }
-      set_lp_entry(&e[0], buf);
-      old_q = e[0].q; 
-      mpz_set_ui(inv_q, old_q);
-      continue;
-    }
-    mpz_set(factor, inv_q);
-    free(ei);
-    mpz_clear(inv_q); mpz_clear(Y1); mpz_clear(Y2); mpz_clear(new_Y); mpz_clear(new_Y1);
-    return c;
-  }
-  gmp_sscanf(e[0].Y, "%Zd", Y1);
-  
-  while (fgets(buf, MPQS_STRING_LENGTH, COMB))
-  {
-    set_lp_entry(&e[i], buf);
-    if (e[i].q != old_q)
-    {
-      /* switch to combining a new bunch, swapping the rows */
-      old_q = e[i].q;
-      mpz_set_ui(inv_q, old_q);
-      while (!mpz_invert(inv_q, inv_q, *N)) /* can happen */
-      {
-        mpz_gcd_ui(inv_q, *N, old_q);
-        if (!mpz_cmp(inv_q, *N)) /* pity */
-        {
-          old_q = -1; /* sentinel */
-          continue; /* discard this combination */
-        }
-        mpz_set(factor, inv_q);
-        free(ei);
-        mpz_clear(inv_q); mpz_clear(Y1); mpz_clear(Y2); mpz_clear(new_Y); mpz_clear(new_Y1);
-        return c;
-      }
-      gmp_sscanf(e[i].Y, "%Zd", Y1);
-      i = 1 - i; /* subsequent relations go to other row */
-      continue;
-    }
-    /* count and combine the two we've got, and continue in the same row */
-    memset((void *)ei, 0, ei_size * sizeof(long));
-    set_exponents(ei, e[0].E);
-    set_exponents(ei, e[1].E);
-    gmp_sscanf(e[i].Y, "%Zd", Y2);
-    
-    if (mpz_cmpabs(Y1,Y2)!=0)
-    {
-       unsigned long * small = la_inf->small;
-       fac_t * factor = la_inf->factor;
-       unsigned long num_factors = 0;
-       unsigned long small_primes = qs_inf->small_primes;
-       unsigned long num_primes = qs_inf->num_primes;
-       
-       c++;
-       mpz_mul(new_Y, Y1, Y2);
-       mpz_mul(new_Y, new_Y, inv_q);
-       mpz_mod(new_Y, new_Y, *N);
-    
-       mpz_sub(new_Y1, *N, new_Y);
-       if (mpz_cmpabs(new_Y1, new_Y) < 0) mpz_set(new_Y, new_Y1);
-    
-       for (l = 0; l < small_primes; l++)
-       {
-          small[l] = ei[l];
-       }
-       for (l = small_primes; l < num_primes; l++)
-       {
-          if (ei[l])
-          {
-             factor[num_factors].ind = l;
-             factor[num_factors].exp = ei[l];
-             num_factors++;
-          }
-       }
-       la_inf->num_factors = num_factors;
-          
-       newrels += insert_relation(qs_inf, la_inf, poly_inf, new_Y); 
-    }
-  } /* while */
-
-  free(ei);
-  mpz_clear(inv_q); mpz_clear(Y1); mpz_clear(Y2); mpz_clear(new_Y); mpz_clear(new_Y1);
-
-  return newrels;
+   FILE * file = flint_fopen(name, "wb");
+   lp_store_write(store, file);
+   fclose(file);
 }
 
+/*
+   Load the store from the temporary file with the given name. Returns 0 if
+   there is no such file or it could not be read.
+*/
 
+int lp_store_load(lp_store_t * store, char * name)
+{
+   char * full_name = temp_filename(name);
+   FILE * file = fopen(full_name, "rb");
+   int ok;
+   
+   free(full_name);
+   if (!file) return 0;
+   
+   ok = lp_store_read(store, file);
+   fclose(file);
+   
+   return ok;
+}
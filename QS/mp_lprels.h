@@ -22,48 +22,83 @@
 #ifndef LPRELS_H
 #define LPRELS_H
 
+#include <stdio.h>
+
 #include "block_lanczos.h"
 #include "common.h"
 #include "mp_poly.h"
 #include "mp_linear_algebra.h"
 
-#define MPQS_STRING_LENGTH (4 * 1024UL)
-
-typedef struct {
-  long q;
-  char Y[MPQS_STRING_LENGTH];
-  char E[MPQS_STRING_LENGTH];
-} mpqs_lp_entry;
+/*
+   Partial relations with one or two large primes are the edges of a graph
+   whose vertices are the large primes and 1, a partial with a single large 
+   prime q joining q to 1. Cycles in this graph combine to full relations. 
+   Components are tracked with a union-find structure, so that a partial 
+   closing a cycle is detected as it arrives. Only the partials forming a 
+   spanning forest of the graph are stored, each packed into the data array 
+   as the words
+
+      q1, q2, s, |s| limbs of Y, n, ind_1, exp_1, ..., ind_n, exp_n
+
+   where q1 <= q2 are the large primes, s is the signed size of Y in limbs 
+   and the (ind, exp) pairs are the exponents of the factor base primes 
+   dividing the relation (small primes included). The hash table maps each 
+   large prime to one plus its vertex; zero marks an empty slot.
+*/
+
+typedef struct lp_vertex_s
+{
+   unsigned long prime; // The large prime, or 1 for vertex 0
+   unsigned long parent; // Parent in the spanning forest, the vertex itself for a root
+   unsigned long edge; // Offset into data of the partial joining the vertex to its parent
+   unsigned long uf_parent; // Parent in the union-find structure
+   unsigned long uf_size; // Size of the component, if uf_parent is the vertex itself
+   unsigned long mark; // Used for finding paths in the spanning forest
+} lp_vertex_t;
+
+typedef struct lp_store_s
+{
+   unsigned long * data; // The packed partial relations
+   unsigned long length; // Number of words of data in use
+   unsigned long alloc; // Number of words allocated for data
+   
+   lp_vertex_t * vertex; // The vertices of the graph
+   unsigned long num_vertices; // Number of vertices, including vertex 0
+   unsigned long vertex_alloc; // Number of vertices allocated
+   unsigned long stamp; // The last mark used
+   
+   unsigned long * table; // Open addressing hash table keyed by large prime
+   unsigned long table_size; // Number of slots in the table, a power of 2
+   
+   unsigned long num_partials; // Number of partials stored
+   unsigned long num_cycles; // Number of full relations obtained from cycles
+   
+   unsigned long * exps; // Exponent vector of length num_primes used for combining, kept zeroed
+} lp_store_t;
+
+void lp_store_init(lp_store_t * store, QS_t * qs_inf);
+
+void lp_store_clear(lp_store_t * store);
+
+int lp_store_insert(lp_store_t * store, QS_t * qs_inf, linalg_t * la_inf, 
+                      unsigned long q1, unsigned long q2, mpz_t Y, mpz_t new_Y);
+
+void lp_store_write(lp_store_t * store, FILE * file);
+
+int lp_store_read(lp_store_t * store, FILE * file);
+
+void lp_store_save(lp_store_t * store, char * name);
+
+int lp_store_load(lp_store_t * store, char * name);
 
 char * get_filename(char *dir, char *s);
 
-int mpqs_relations_cmp(const void *a, const void *b);
-
-void flint_fputs(char *s, FILE *file);
-
-void flint_remove(char * name);
-
-long sort_lp_file(char *filename);
-
-long append_file(FILE *fp, FILE *fp1);
-
-long mpqs_mergesort_lp_file_internal(FILE *LPREL, FILE *LPNEW, FILE *COMB, FILE *TMP);
-
-long mergesort_lp_file(char *REL_str, char *NEW_str, char *TMP_str, FILE *COMB);
-
-void add_factor(char **last, unsigned long ei, unsigned long pi);
-
-void add_0(char **last);
-
-void set_exponents(unsigned long *ei, char *r);
+char * unique_filename(char *s);
 
-void set_lp_entry(mpqs_lp_entry *e, char *buf);
+char * tmp_dir_filename(char * name);
 
-unsigned long combine_large_primes(QS_t * qs_inf, linalg_t * la_inf, poly_t * poly_inf, 
-                                                       FILE * COMB, mpz_t factor);
-                                                       
 FILE * flint_fopen(char * name, char * mode);
 
-char * unique_filename(char *s);
+void flint_remove(char * name);
 
 #endif
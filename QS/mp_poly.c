@@ -78,6 +78,24 @@ void poly_init(QS_t * qs_inf, poly_t * poly_inf, mpz_t N)
    poly_inf->posn1 = (uint32_t *) flint_stack_alloc_bytes(num_primes*sizeof(uint32_t)); 
    poly_inf->posn2 = (uint32_t *) flint_stack_alloc_bytes(num_primes*sizeof(uint32_t)); 
    
+   if (num_primes > (1UL<<(32-BUCKET_BITS)))
+   {
+      printf("Error: too many primes in the factor base for the bucket sieve\n");
+      abort();
+   }
+   
+   // A root of p hits a region at most ceil(2^BUCKET_BITS/p) times
+   unsigned long num_buckets = (sieve_size + BUCKET_MASK) >> BUCKET_BITS;
+   unsigned long bucket_alloc = 1;
+   for (unsigned long i = FLINT_MIN(SECOND_PRIME, num_primes); i < num_primes; i++)
+      bucket_alloc += 2*(((1UL<<BUCKET_BITS) + factor_base[i].p - 1)/factor_base[i].p);
+   poly_inf->bucket_alloc = bucket_alloc;
+   poly_inf->buckets = (uint32_t *) flint_stack_alloc_bytes(num_buckets*bucket_alloc*sizeof(uint32_t));
+   poly_inf->bucket_count = (unsigned long *) flint_stack_alloc(num_buckets);
+   for (unsigned long i = 0; i < num_buckets; i++) poly_inf->bucket_count[i] = 0;
+   
+   poly_inf->resieved = (uint32_t *) flint_stack_alloc_bytes(RESIEVE_CANDS*RESIEVE_HITS*sizeof(uint32_t));
+   
    uint32_t ** A_inv2B = poly_inf->A_inv2B;
    
    A_inv2B[0] = (uint32_t *) flint_stack_alloc_bytes(num_primes*s*sizeof(uint32_t));
@@ -129,6 +147,9 @@ void poly_clear(poly_t * poly_inf)
    mpz_clear(poly_inf->B_mpz);
    mpz_clear(poly_inf->C);
    flint_stack_release(); // release all A_inv2B[i]
+   flint_stack_release(); // release resieved
+   flint_stack_release(); // release bucket_count
+   flint_stack_release(); // release buckets
    flint_stack_release(); // release posn1
    flint_stack_release(); // release posn2
    flint_stack_release(); // release soln1
@@ -144,11 +165,27 @@ void poly_clear(poly_t * poly_inf)
    flint_stack_release(); // release B
 }
 
+/*
+   Returns a random value in [0, limit) from the stream in qs_inf->A_rand.
+   All the sieving threads choose A from this one stream, so the sequence 
+   of A values does not depend on the number of threads and read_checkpoint 
+   can fast forward it by choosing the A values of the checkpoint again.
+*/
+
+static inline unsigned long A_randint(QS_t * qs_inf, unsigned long limit)
+{
+   qs_inf->A_rand = qs_inf->A_rand*6364136223846793005ULL + 1442695040888963407ULL;
+   
+   return (unsigned long) ((qs_inf->A_rand >> 32) % limit);
+}
+
 /*=========================================================================
    compute_A:
  
    Function: Compute a new polynomial A value
              The function attempts to pick A near to an optimal size
+             When sieving with more than one thread, the caller must hold 
+             the relations lock, as qs_inf->A_rand is shared
  
 ==========================================================================*/
 
@@ -178,7 +215,7 @@ void compute_A(QS_t * qs_inf, poly_t * poly_inf)
       do
       {
          taken = 0;
-         A_ind[i] = ((z_randint(span) + min) | 1);
+         A_ind[i] = ((A_randint(qs_inf, span) + min) | 1);
          if (A_ind[i] == min + span) A_ind[i] -= 2;
          for (j = 0; j < i; j++)
          {
@@ -201,7 +238,7 @@ void compute_A(QS_t * qs_inf, poly_t * poly_inf)
          do
          {
             taken = 0;
-            A_ind[s-3+i] = ((z_randint(span) + min) & -2L);
+            A_ind[s-3+i] = ((A_randint(qs_inf, span) + min) & -2L);
             if (A_ind[s-3+i] < min) A_ind[s-3+i] += 2;
             for (j = 0; j < i; j++)
             {
@@ -516,5 +553,5 @@ void compute_B_C(QS_t * qs_inf, poly_t * poly_inf)
    mpz_clear(temp);
 #endif   
    mpz_divexact(*C, *C, *A_mpz);
-   qs_inf->sieve_fill = 128-mpz_sizeinbase(*C, 2)+qs_inf->error_bits+13;// 16, 20, 20
+   poly_inf->sieve_fill = 128-mpz_sizeinbase(*C, 2)+qs_inf->error_bits+13;// 16, 20, 20
 } 
@@ -41,6 +41,14 @@
 
 #define B_TERMS 0 // Print out the B_terms
 
+#define BUCKET_BITS 15 // Primes from SECOND_PRIME on are bucket sieved, in regions of 2^BUCKET_BITS bytes
+
+#define BUCKET_MASK ((1UL<<BUCKET_BITS)-1)
+
+#define RESIEVE_CANDS 256 // Most sieve candidates resieved together
+
+#define RESIEVE_HITS 32 // Space for resieved primes per candidate
+
 typedef struct poly_s
 {
     unsigned long s;
@@ -51,6 +59,7 @@ typedef struct poly_s
     mpz_t A_mpz;
     mpz_t B_mpz;
     mpz_t C;
+    unsigned long sieve_fill; // Initial value of the sieve entries for the current C
      
     unsigned long * A_ind;
     unsigned long * A_modp;
@@ -63,6 +72,13 @@ typedef struct poly_s
     double * inv_p2;
     
     unsigned long * B_terms;
+    
+    uint32_t * buckets; // Sieve hits of the large primes, stored as (prime << BUCKET_BITS) + offset
+    unsigned long * bucket_count; // Number of hits in each region of the sieve
+    unsigned long bucket_alloc; // Space for hits in each region
+    
+    unsigned long resieve_prime; // The primes from here to SECOND_PRIME are found by resieving
+    uint32_t * resieved; // For each candidate, the number of these primes dividing it, then the primes
 } poly_t;
 
 void poly_init(QS_t * qs_inf, poly_t * poly_inf, mpz_t N);
@@ -36,6 +36,7 @@
 #include "../long_extras.h"
 
 #include "common.h"
+#include "mp_factor_base.h"
 #include "mp_poly.h"
 #include "mp_linear_algebra.h"
 #include "mp_sieve.h"
@@ -43,21 +44,24 @@
 void get_sieve_params(QS_t * qs_inf)
 {
    unsigned long bits = qs_inf->bits;
-   unsigned long i;
+   const unsigned long * row = qs_tuning_row(bits);
    
    prime_t * factor_base = qs_inf->factor_base;
    unsigned long num_primes = qs_inf->num_primes;
-   unsigned long mult = qs_inf->num_primes;
    
-   for (i = 0; i < PTABSIZE; i++)
+   qs_inf->sieve_size = row[2]; 
+   qs_inf->small_primes = row[3]; 
+   qs_inf->large_prime = row[4]*factor_base[num_primes-1].p;
+   if ((bits >= DOUBLE_LP_BITS) && (2*FLINT_BIT_COUNT(qs_inf->large_prime) <= FLINT_BITS))
    {
-      if (prime_tab[i][0] > bits) break;
+      // Let through candidates with cofactors up to about large_prime^1.3 
+      qs_inf->large_prime2 = qs_inf->large_prime*qs_inf->large_prime;
+      qs_inf->error_bits = round(1.3*log(qs_inf->large_prime)/log(2.0))+3;
+   } else
+   {
+      qs_inf->large_prime2 = 0;
+      qs_inf->error_bits = round(log(qs_inf->large_prime)/log(2.0))+3; // 2, 5, 6 
    }
-   
-   qs_inf->sieve_size = prime_tab[i-1][2]; 
-   qs_inf->small_primes = prime_tab[i-1][3]; 
-   qs_inf->large_prime = prime_tab[i-1][4]*factor_base[num_primes-1].p;
-   qs_inf->error_bits = round(log(qs_inf->large_prime)/log(2.0))+3; // 2, 5, 6 
    printf("Error bits = %ld\n", qs_inf->error_bits);
 }
 
@@ -70,7 +74,7 @@ void do_sieving2(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve)
    unsigned long sieve_size = qs_inf->sieve_size;
    unsigned char * end = sieve + sieve_size;
    unsigned char * sizes = qs_inf->sizes;
-   unsigned long sieve_fill = qs_inf->sieve_fill;
+   unsigned long sieve_fill = poly_inf->sieve_fill;
    unsigned long small_primes = qs_inf->small_primes;
    unsigned char * bound;
    unsigned char * pos1;
@@ -111,21 +115,104 @@ void do_sieving2(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve)
       }
    }
    
-   for (unsigned long prime = second_prime; prime < num_primes; prime++) 
+   sieve_buckets(qs_inf, poly_inf, sieve);
+}
+
+/*==========================================================================
+   Bucket sieve:
+
+   Function: the primes from SECOND_PRIME on hit the sieve only a few times 
+             each, so rather than sieving with them directly their hits 
+             are put, once per polynomial, in the bucket for the region of 
+             2^BUCKET_BITS bytes of the sieve which they fall in. The 
+             buckets are then added in one region at a time, so that the 
+             region is in L1 cache, and evaluate_candidate can look up 
+             which of these primes divide an entry in its bucket. If 
+             poly_corr is not NULL, the roots of these primes are first 
+             moved on to the next polynomial, as in update_offsets
+             
+===========================================================================*/
+
+void fill_buckets(QS_t * qs_inf, poly_t * poly_inf, 
+                     unsigned long poly_add, uint32_t * poly_corr)
+{
+   unsigned long num_primes = qs_inf->num_primes;
+   uint32_t * soln1 = poly_inf->soln1;
+   uint32_t * soln2 = poly_inf->soln2;
+   prime_t * factor_base = qs_inf->factor_base;
+   unsigned long sieve_size = qs_inf->sieve_size;
+   unsigned long num_buckets = (sieve_size + BUCKET_MASK) >> BUCKET_BITS;
+   uint32_t * next[num_buckets + 1]; // next free entry in each bucket
+   uint32_t dummy;
+   unsigned long prime, p, off, b, hit, correction;
+   
+   for (b = 0; b < num_buckets; b++) 
+      next[b] = poly_inf->buckets + b*poly_inf->bucket_alloc;
+   next[num_buckets] = &dummy; // hits off the end of the sieve are written here
+   
+   for (prime = FLINT_MIN(SECOND_PRIME, num_primes); prime < num_primes; prime++) 
    {
+      if (soln2[prime] == -1) continue;
       p = factor_base[prime].p;
-      size = sizes[prime];
-      pos1 = sieve + soln1[prime];
-      pos2 = sieve + soln2[prime];
-        
-      if (end - pos2 > 0)
-      { 
-         (*pos2)+=size;
+      if (p >= sieve_size) break;
+      if (poly_corr != NULL) 
+      {
+         correction = (poly_add ? p - poly_corr[prime] : poly_corr[prime]);
+         soln1[prime] += correction;
+         if (soln1[prime] >= p) soln1[prime] -= p;
+         soln2[prime] += correction;
+         if (soln2[prime] >= p) soln2[prime] -= p; 
       }
-      if (end - pos1 > 0)
-      { 
-         (*pos1)+=size;
+      for (off = soln1[prime]; off < sieve_size; off += p)
+         *next[off >> BUCKET_BITS]++ = ((prime << BUCKET_BITS) | (off & BUCKET_MASK));
+      for (off = soln2[prime]; off < sieve_size; off += p)
+         *next[off >> BUCKET_BITS]++ = ((prime << BUCKET_BITS) | (off & BUCKET_MASK));
+   }
+   
+   for ( ; prime < num_primes; prime++) // these primes hit at most once per root
+   {
+      if (soln2[prime] == -1) continue;
+      p = factor_base[prime].p;
+      if (poly_corr != NULL) 
+      {
+         correction = (poly_add ? p - poly_corr[prime] : poly_corr[prime]);
+         soln1[prime] += correction;
+         if (soln1[prime] >= p) soln1[prime] -= p;
+         soln2[prime] += correction;
+         if (soln2[prime] >= p) soln2[prime] -= p; 
       }
+      off = soln1[prime];
+      hit = (off < sieve_size);
+      b = (hit ? (off >> BUCKET_BITS) : num_buckets);
+      *next[b] = ((prime << BUCKET_BITS) | (off & BUCKET_MASK));
+      next[b] += hit;
+      off = soln2[prime];
+      hit = (off < sieve_size);
+      b = (hit ? (off >> BUCKET_BITS) : num_buckets);
+      *next[b] = ((prime << BUCKET_BITS) | (off & BUCKET_MASK));
+      next[b] += hit;
+   }
+   
+   for (b = 0; b < num_buckets; b++) 
+      poly_inf->bucket_count[b] = next[b] - (poly_inf->buckets + b*poly_inf->bucket_alloc);
+}
+
+void sieve_buckets(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve)
+{
+   unsigned long sieve_size = qs_inf->sieve_size;
+   unsigned long num_buckets = (sieve_size + BUCKET_MASK) >> BUCKET_BITS;
+   unsigned char * sizes = qs_inf->sizes;
+   unsigned char * region;
+   uint32_t * entry;
+   uint32_t * last;
+   
+   for (unsigned long b = 0; b < num_buckets; b++)
+   {
+      region = sieve + (b << BUCKET_BITS);
+      entry = poly_inf->buckets + b*poly_inf->bucket_alloc;
+      last = entry + poly_inf->bucket_count[b];
+      for ( ; entry < last; entry++)
+         region[*entry & BUCKET_MASK] += sizes[*entry >> BUCKET_BITS];
    }
 }
 
@@ -138,7 +225,7 @@ void update_offsets(unsigned long poly_add, uint32_t * poly_corr,
    prime_t * factor_base = qs_inf->factor_base;
    unsigned long p, correction;
    
-   for (unsigned long prime = 2; prime < num_primes; prime++) 
+   for (unsigned long prime = 2; prime < FLINT_MIN(SECOND_PRIME, num_primes); prime++) 
    {
       if (soln2[prime] == -1) continue;
       p = factor_base[prime].p;
@@ -149,6 +236,7 @@ void update_offsets(unsigned long poly_add, uint32_t * poly_corr,
       if (soln2[prime] >= p) soln2[prime] -= p; 
    }
    
+   fill_buckets(qs_inf, poly_inf, poly_add, poly_corr); // the remaining primes
 }  
 
 
@@ -217,122 +305,18 @@ void do_sieving(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve,
    
 }
 
-void do_sieving3(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve, 
-                  unsigned long first_prime, unsigned long second_prime, 
-                  unsigned long M)
-{
-   uint32_t * soln1 = poly_inf->soln1;
-   uint32_t * soln2 = poly_inf->soln2;
-   prime_t * factor_base = qs_inf->factor_base;
-   unsigned long p;
-   unsigned char * end = sieve + M;
-   unsigned char * sizes = qs_inf->sizes;
-   register unsigned char * pos1;
-   unsigned char * pos2;
-   unsigned long size;
-	
-   for (unsigned long prime = first_prime; prime < second_prime; prime++) 
-   {
-      if (soln2[prime] == -1) continue;
-      
-      p = factor_base[prime].p;
-      size = sizes[prime];
-      pos1 = sieve + soln1[prime];
-      pos2 = sieve + soln2[prime];
-              
-      while (end - pos2 > 0)
-      { 
-         (*pos2)+=size, pos2+=p;
-      }
-      while (end - pos1 > 0)
-      { 
-         (*pos1)+=size, pos1+=p;
-      } 
-   }  
-}
-
-void do_sieving4(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve, 
-                  unsigned long first_prime, unsigned long second_prime, 
-                  unsigned long M)
-{
-   uint32_t * soln1 = poly_inf->soln1;
-   uint32_t * soln2 = poly_inf->soln2;
-   prime_t * factor_base = qs_inf->factor_base;
-   unsigned long p;
-   unsigned char * start;
-   unsigned char * sizes = qs_inf->sizes;
-   
-	const unsigned long num_blocks = M/SIEVE_BLOCK;
-	hash_entry * hash_tables = (hash_entry *) flint_heap_alloc_bytes(num_blocks*4096*sizeof(hash_entry));
-	unsigned long * counts = (unsigned long *) flint_heap_alloc(num_blocks);
-	for (ulong i = 0; i < num_blocks; i++) counts[i] = 0;
-
-	unsigned long off1;
-   unsigned long off2;
-   unsigned long size;
-	unsigned long index;
-	unsigned long ind;
-   
-   for (unsigned long prime = first_prime; prime < second_prime; prime+=100) 
-   {
-      unsigned long count = 100;
-		if (second_prime - prime < 100) count = second_prime - prime;
-		for (unsigned long i = 0; i < count; i++)
-		{
-		   if (soln2[prime+i] == -1) continue;
-      
-         p = factor_base[prime+i].p;
-         size = sizes[prime+i];
-         off1 = soln1[prime+i];
-         off2 = soln2[prime+i];
-              
-         while (M > off2)
-         { 
-            index = (off2 >> 16); 
-			   ind = (index << 12) + counts[index];
-				hash_tables[ind].offset = (off2 & 65535);
-			   hash_tables[ind].size = size;
-			   counts[index]++;
-			   off2+=p;
-         }
-	
-         while (M > off1)
-         { 
-            index = (off1 >> 16);
-			   ind = (index << 12) + counts[index];
-				hash_tables[ind].offset = (off1 & 65535);
-			   hash_tables[ind].size = size;
-			   counts[index]++;
-			   off1+=p;
-         }
-		}
-
-		for (index = 0; index < num_blocks; index++)
-	   {
-		   start = sieve + 65536*index;
-		   hash_entry * hash_start = hash_tables + (index << 12);
-		   for (unsigned long i = 0; i < counts[index]; i++)
-		   {
-			   start[hash_start[i].offset] += hash_start[i].size;
-		   }
-		   counts[index] = 0;
-	   }
-   
-   }  
-   
-	flint_heap_free(hash_tables);
-	flint_heap_free(counts);
-}
-
 /*==========================================================================
    evaluate_candidate:
 
-   Function: determine whether a given sieve entry is a relation 
+   Function: determine whether a given sieve entry is a relation. If hits
+             is not NULL, it is the list of primes from resieve_prime up to
+             SECOND_PRIME which divide the entry, as made by resieve, and 
+             only the primes below resieve_prime are trial divided
 
 ===========================================================================*/
 
 unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf, 
-                          unsigned long i, unsigned char * sieve)
+                          unsigned long i, unsigned char * sieve, uint32_t * hits)
 {
    unsigned long bits, exp, extra_bits, modp, prime;
    unsigned long num_primes = qs_inf->num_primes;
@@ -340,7 +324,7 @@ unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly
    uint32_t * soln1 = poly_inf->soln1;
    uint32_t * soln2 = poly_inf->soln2;
    unsigned long * small = la_inf->small;
-   unsigned long sieve_fill = qs_inf->sieve_fill;
+   unsigned long sieve_fill = poly_inf->sieve_fill;
    unsigned long sieve_size = qs_inf->sieve_size;
    fac_t * factor = la_inf->factor;
    mpz_t * A = &poly_inf->A_mpz;
@@ -354,6 +338,7 @@ unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly
    unsigned long relations = 0;
    double pinv;
    const unsigned long second_prime = FLINT_MIN(SECOND_PRIME, num_primes);
+   const unsigned long trial_prime = (hits == NULL ? second_prime : poly_inf->resieve_prime);
    
    mpz_t X, Y, res, p;
    mpz_init(X); 
@@ -420,7 +405,7 @@ unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly
    if (extra_bits + sieve[i] > bits+sieve_fill)
    {
       sieve[i] += extra_bits - sieve_fill;
-      for (j = small_primes; (j < second_prime) && (extra_bits < sieve[i]); j++) // pull out remaining primes
+      for (j = small_primes; (j < trial_prime) && (extra_bits < sieve[i]); j++) // pull out remaining primes
       {
          prime = factor_base[j].p;
          pinv = factor_base[j].pinv;
@@ -449,18 +434,51 @@ unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly
 #endif
          }    
       }
-      for ( ; (j < num_primes) && (extra_bits < sieve[i]); j++) // pull out remaining primes
+      if ((j == trial_prime) && (j < second_prime)) // the rest up to second_prime were resieved
       {
-         if ((i == soln1[j]) || (i == soln2[j]))
+         for (unsigned long k = 1; k <= hits[0]; k++)
          {
-            prime = factor_base[j].p;
+            unsigned long ind = hits[k];
+            prime = factor_base[ind].p;
             mpz_set_ui(p, prime);
             exp = mpz_remove(res, res, p);          
 #if RELATIONS
             gmp_printf("%Zd^%ld ", p, exp);
 #endif
-            extra_bits += qs_inf->sizes[j];
-            factor[num_factors].ind = j;
+            extra_bits += qs_inf->sizes[ind];
+            factor[num_factors].ind = ind;
+            factor[num_factors++].exp = exp; 
+         }
+         for (unsigned long k = 0; k < poly_inf->s; k++) // A factors in this range
+         {
+            unsigned long ind = poly_inf->A_ind[k];
+            if ((ind < trial_prime) || (ind >= second_prime)) continue;
+            mpz_set_ui(p, factor_base[ind].p);
+            exp = mpz_remove(res, res, p);
+            factor[num_factors].ind = ind;
+            factor[num_factors++].exp = exp+1; 
+#if RELATIONS
+            if (exp) gmp_printf("%Zd^%ld ", p, exp);
+#endif
+         }
+         j = second_prime;
+      }
+      if (j == second_prime) // the large primes dividing it are those in its bucket
+      {
+         uint32_t * entry = poly_inf->buckets + (i >> BUCKET_BITS)*poly_inf->bucket_alloc;
+         uint32_t * last = entry + poly_inf->bucket_count[i >> BUCKET_BITS];
+         for ( ; (entry < last) && (extra_bits < sieve[i]); entry++)
+         {
+            if ((*entry & BUCKET_MASK) != (i & BUCKET_MASK)) continue;
+            unsigned long ind = (*entry >> BUCKET_BITS);
+            prime = factor_base[ind].p;
+            mpz_set_ui(p, prime);
+            exp = mpz_remove(res, res, p);          
+#if RELATIONS
+            gmp_printf("%Zd^%ld ", p, exp);
+#endif
+            extra_bits += qs_inf->sizes[ind];
+            factor[num_factors].ind = ind;
             factor[num_factors++].exp = exp; 
          }     
       }
@@ -476,12 +494,7 @@ unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly
             }
          }
          la_inf->num_factors = num_factors;
-         relations += insert_relation(qs_inf, la_inf, poly_inf, Y);  // Insert the relation in the matrix
-         if (la_inf->num_relations >= 2*(qs_inf->num_primes + EXTRA_RELS + 500))
-         {
-            printf("Error: too many duplicate relations!\n");
-            abort();
-         }
+         relations += commit_relation(qs_inf, la_inf, poly_inf, Y, 1, 1);  // Insert the relation in the matrix
          goto cleanup;
       } else if(mpz_cmpabs_ui(res, large_prime) < 0) 
       {
@@ -496,7 +509,35 @@ unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly
             }
          }
          la_inf->num_factors = num_factors;
-         relations += insert_lp_relation(qs_inf, la_inf, poly_inf, Y, res);  // Insert the relation in the matrix                    
+         relations += commit_relation(qs_inf, la_inf, poly_inf, Y, 1, mpz_get_ui(res));  // Insert the relation in the matrix                    
+         goto cleanup;
+      } else if (mpz_cmpabs_ui(res, qs_inf->large_prime2) < 0) // Try to split the cofactor into two large primes
+      {
+         unsigned long cofactor = mpz_get_ui(res);
+         unsigned long q1, q2;
+         
+         if (z_isprime(cofactor)) goto cleanup;
+         q1 = z_factor_SQUFOF(cofactor);
+         if (q1 == 0) goto cleanup;
+         q2 = cofactor/q1;
+         if (q1 > q2) 
+         {
+            q2 = q1;
+            q1 = cofactor/q2;
+         }
+         if ((q1 == 1) || (q2 >= large_prime)) goto cleanup;
+         
+         unsigned long * A_ind = poly_inf->A_ind;
+         for (unsigned long i = 0; i < poly_inf->s; i++) // Commit any outstanding A factors
+         {
+            if (A_ind[i] >= j)
+            {
+               factor[num_factors].ind = A_ind[i];
+               factor[num_factors++].exp = 1; 
+            }
+         }
+         la_inf->num_factors = num_factors;
+         relations += commit_relation(qs_inf, la_inf, poly_inf, Y, q1, q2);  // Insert the relation in the matrix                    
          goto cleanup;
       }
    }
@@ -513,6 +554,93 @@ cleanup:
    return relations;
 }
 
+/*==========================================================================
+   Resieving:
+
+   Function: finds which of the primes below SECOND_PRIME, from 
+             resieve_prime on, divide each of the given candidates, by 
+             walking through the sieve with them again. A prime p is 
+             resieved if p*num_cands >= RESIEVE_RATIO*sieve_size, as then 
+             it hits the sieve so few times that this is cheaper than 
+             trial dividing by it those candidates which get that far in 
+             evaluate_candidate. The primes are recorded in 
+             poly_inf->resieved, RESIEVE_HITS entries per candidate
+
+===========================================================================*/
+
+static
+void resieve(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve, 
+                                   unsigned long * cand, unsigned long num_cands)
+{
+   unsigned long num_primes = qs_inf->num_primes;
+   uint32_t * soln1 = poly_inf->soln1;
+   uint32_t * soln2 = poly_inf->soln2;
+   prime_t * factor_base = qs_inf->factor_base;
+   unsigned long sieve_size = qs_inf->sieve_size;
+   uint32_t * resieved = poly_inf->resieved;
+   unsigned long lo = qs_inf->small_primes;
+   unsigned long hi = FLINT_MIN(SECOND_PRIME, num_primes);
+   unsigned long mid, p, off, c, c0, c1;
+   
+   while (lo < hi) // find the first prime to resieve
+   {
+      mid = (lo + hi)/2;
+      if (factor_base[mid].p*num_cands < RESIEVE_RATIO*sieve_size) lo = mid + 1;
+      else hi = mid;
+   }
+   poly_inf->resieve_prime = lo;
+   
+   for (c = 0; c < num_cands; c++) resieved[c*RESIEVE_HITS] = 0;
+   
+   for (unsigned long prime = lo; prime < FLINT_MIN(SECOND_PRIME, num_primes); prime++)
+   {
+      if (soln2[prime] == -1) continue;
+      p = factor_base[prime].p;
+      for (int r = 0; r < 2; r++)
+      {
+         for (off = (r ? soln2[prime] : soln1[prime]); off < sieve_size; off += p)
+         {
+            if (sieve[off] <= 128) continue;
+            
+            c0 = 0; // look for off among the candidates, which are in order
+            c1 = num_cands;
+            while (c0 < c1)
+            {
+               c = (c0 + c1)/2;
+               if (cand[c] < off) c0 = c + 1;
+               else c1 = c;
+            }
+            if ((c0 == num_cands) || (cand[c0] != off)) continue;
+            
+            uint32_t * hits = resieved + c0*RESIEVE_HITS;
+            if (hits[0] < RESIEVE_HITS - 1) hits[++hits[0]] = prime;
+            else hits[0] = RESIEVE_HITS; // no room, so it will be trial divided
+         }
+      }
+   }
+}
+
+static
+unsigned long evaluate_candidates(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf, 
+                    unsigned char * sieve, unsigned long * cand, unsigned long num_cands)
+{
+   unsigned long rels = 0;
+   uint32_t * hits;
+   
+   if (num_cands == 0) return 0;
+   
+   resieve(qs_inf, poly_inf, sieve, cand, num_cands);
+   
+   for (unsigned long c = 0; c < num_cands; c++)
+   {
+      hits = poly_inf->resieved + c*RESIEVE_HITS;
+      if (hits[0] == RESIEVE_HITS) hits = NULL;
+      rels += evaluate_candidate(la_inf, qs_inf, poly_inf, cand[c], sieve, hits);
+   }
+   
+   return rels;
+}
+
 /*==========================================================================
    evaluateSieve:
 
@@ -526,6 +654,8 @@ unsigned long evaluate_sieve(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf
    unsigned long * sieve2 = (unsigned long *) sieve;
    unsigned long sieve_size = qs_inf->sieve_size;
    unsigned long rels = 0;
+   unsigned long cand[RESIEVE_CANDS];
+   unsigned long num_cands = 0;
      
    while (j < sieve_size/sizeof(unsigned long))
    {
@@ -539,11 +669,17 @@ unsigned long evaluate_sieve(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf
       {
          if (sieve[i] > 128) 
          {
-             rels += evaluate_candidate(la_inf, qs_inf, poly_inf, i, sieve);
+             cand[num_cands++] = i;
+             if (num_cands == RESIEVE_CANDS)
+             {
+                rels += evaluate_candidates(la_inf, qs_inf, poly_inf, sieve, cand, num_cands);
+                num_cands = 0;
+             }
          }
          i++;
       }
       j++;
    }
+   rels += evaluate_candidates(la_inf, qs_inf, poly_inf, sieve, cand, num_cands);
    return rels;
 }
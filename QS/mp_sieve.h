@@ -38,6 +38,10 @@
 
 #define POLYS 0 // Print out polynomials and offsets in candidate evaluation
 
+#ifndef RESIEVE_RATIO
+#define RESIEVE_RATIO 16 // Cost of trial division relative to resieving, see resieve
+#endif
+
 void get_sieve_params(QS_t * qs_inf);
 
 void do_sieving(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve, 
@@ -46,13 +50,10 @@ void do_sieving(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve,
                                                   
 void do_sieving2(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve);
 
-void do_sieving3(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve, 
-                  unsigned long first_prime, unsigned long second_prime, 
-                  unsigned long M);
+void fill_buckets(QS_t * qs_inf, poly_t * poly_inf, 
+                     unsigned long poly_add, uint32_t * poly_corr);
 
-void do_sieving4(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve, 
-                  unsigned long first_prime, unsigned long second_prime, 
-                  unsigned long M);
+void sieve_buckets(QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve);
                 
 void update_offsets(unsigned long poly_add, uint32_t * poly_corr, 
                                         QS_t * qs_inf, poly_t * poly_inf);
@@ -60,6 +61,6 @@ void update_offsets(unsigned long poly_add, uint32_t * poly_corr,
 unsigned long evaluate_sieve(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf, unsigned char * sieve);
 
 unsigned long evaluate_candidate(linalg_t * la_inf, QS_t * qs_inf, poly_t * poly_inf, 
-                                     unsigned long i, unsigned char * sieve);
+                        unsigned long i, unsigned char * sieve, uint32_t * hits);
                                      
 #endif
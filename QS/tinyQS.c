@@ -36,6 +36,7 @@
 #include "../fmpz.h"
 #include "../long_extras.h"
 #include "../memory-manager.h"
+#include "../thread-support.h"
 
 #include "tinyQS.h"
 #include "factor_base.h"
@@ -379,6 +380,76 @@ cleanup_2:
    return small_factor;    
 }
 
+/*===========================================================================
+   Batch factoring:
+
+   Function: Factors N[i] for i = 0, ..., num - 1 as 
+             F_mpz_factor_tinyQS_silent does, setting res[i] to its return 
+             value and putting the factors found in factors[i]. Numbers 
+             which fit in FLINT_BITS - 1 bits are tried with SQUFOF first, 
+             which is much quicker for them. The numbers are dealt out in 
+             turn to at most flint_get_num_threads() threads
+
+===========================================================================*/
+
+typedef struct
+{
+   int * res;
+   F_mpz_factor_t * factors;
+   mpz_t * N;
+   unsigned long num;
+   unsigned long start;
+   unsigned long step;
+} tinyQS_batch_arg_t;
+
+void _tinyQS_batch_worker(void * arg_ptr)
+{
+   tinyQS_batch_arg_t * arg = (tinyQS_batch_arg_t *) arg_ptr;
+   unsigned long factor;
+   
+   for (unsigned long i = arg->start; i < arg->num; i += arg->step)
+   {
+      F_mpz_factor_t * factors = arg->factors + i;
+      
+      if (mpz_sizeinbase(arg->N[i], 2) < FLINT_BITS)
+      {
+         factor = z_factor_SQUFOF(mpz_get_ui(arg->N[i]));
+         if (factor)
+         {
+            mpz_set_ui(factors->fact[factors->num], factor);
+            factors->num++;
+            arg->res[i] = 1;
+            continue;
+         }
+      }
+      
+      arg->res[i] = F_mpz_factor_tinyQS_silent(factors, arg->N[i]);
+   }
+}
+
+void F_mpz_factor_tinyQS_batch(int * res, F_mpz_factor_t * factors, mpz_t * N, unsigned long num)
+{
+   unsigned long threads = FLINT_MIN(flint_get_num_threads(), num);
+   if (threads == 0) return;
+   
+   tinyQS_batch_arg_t * args = (tinyQS_batch_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(tinyQS_batch_arg_t));
+   
+   for (unsigned long i = 0; i < threads; i++)
+   {
+      args[i].res = res;
+      args[i].factors = factors;
+      args[i].N = N;
+      args[i].num = num;
+      args[i].start = i;
+      args[i].step = threads;
+   }
+   
+   flint_parallel_do(_tinyQS_batch_worker, args, sizeof(tinyQS_batch_arg_t), threads);
+   
+   flint_heap_free(args);
+}
+
 /*===========================================================================
    Main Program:
 
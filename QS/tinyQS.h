@@ -37,5 +37,6 @@
 
 int F_mpz_factor_tinyQS(F_mpz_factor_t * factors, mpz_t N);
 int F_mpz_factor_tinyQS_silent(F_mpz_factor_t * factors, mpz_t N);
+void F_mpz_factor_tinyQS_batch(int * res, F_mpz_factor_t * factors, mpz_t * N, unsigned long num);
 
 #endif
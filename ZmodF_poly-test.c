@@ -941,6 +941,117 @@ int test_ZmodF_poly_convolution()
    return success;
 }
 
+int test_ZmodF_poly_pointwise_mul_threads()
+{
+   int success = 1;
+
+   for (unsigned long depth = 4; depth <= 10 && success; depth++)
+   {
+      unsigned long size = 1UL << depth;
+      
+      for (unsigned long trial = 0; trial < 10 && success; trial++)
+      {
+         unsigned long n = random_ulong(300) + 1;
+         unsigned long threads = random_ulong(8) + 1;
+         int square = random_ulong(2);
+         
+         ZmodF_poly_t f1, f2, f3, f4;
+         ZmodF_poly_init(f1, depth, n, 1);
+         ZmodF_poly_init(f2, depth, n, 1);
+         ZmodF_poly_init(f3, depth, n, 1);
+         ZmodF_poly_init(f4, depth, n, 1);
+
+         ZmodF_poly_random(f1, 4);
+         ZmodF_poly_random(f2, 4);
+         f1->length = f2->length = random_ulong(size + 1);
+         
+         if (square)
+         {
+            ZmodF_poly_pointwise_mul_threads(f3, f1, f1, 1);
+            ZmodF_poly_pointwise_mul_threads(f4, f1, f1, threads);
+         } else
+         {
+            ZmodF_poly_pointwise_mul_threads(f3, f1, f2, 1);
+            ZmodF_poly_pointwise_mul_threads(f4, f1, f2, threads);
+         }
+         
+         success &= (f3->length == f4->length);
+         
+         for (unsigned long i = 0; i < f3->length && success; i++)
+         {
+            ZmodF_normalise(f3->coeffs[i], n);
+            ZmodF_normalise(f4->coeffs[i], n);
+            if (mpn_cmp(f3->coeffs[i], f4->coeffs[i], n + 1))
+               success = 0;
+         }
+         
+         ZmodF_poly_clear(f4);
+         ZmodF_poly_clear(f3);
+         ZmodF_poly_clear(f2);
+         ZmodF_poly_clear(f1);
+      }
+   }
+
+   return success;
+}
+
+int test_ZmodF_poly_FFT_IFFT_threads()
+{
+   int success = 1;
+
+   for (unsigned long depth = 2; depth <= 12 && success; depth++)
+   {
+      unsigned long size = 1UL << depth;
+      
+      // need 4*n*FLINT_BITS divisible by 2^depth
+      unsigned long n_skip = size / (4*FLINT_BITS);
+      if (n_skip == 0)
+         n_skip = 1;
+      
+      for (unsigned long trial = 0; trial < 6 && success; trial++)
+      {
+         unsigned long n = n_skip*(random_ulong(100/n_skip + 1) + 1);
+         unsigned long threads = random_ulong(8) + 2;
+         
+         ZmodF_poly_t f1, f2;
+         ZmodF_poly_init(f1, depth, n, 1);
+         ZmodF_poly_init(f2, depth, n, 1);
+
+         ZmodF_poly_random(f1, 4);
+         f1->length = random_ulong(size) + 1;
+         ZmodF_poly_set(f2, f1);
+         
+         unsigned long length = random_ulong(size) + 1;
+         ZmodF_poly_FFT_threads(f1, length, 1);
+         ZmodF_poly_FFT_threads(f2, length, threads);
+         
+         for (unsigned long i = 0; i < length && success; i++)
+         {
+            ZmodF_normalise(f1->coeffs[i], n);
+            ZmodF_normalise(f2->coeffs[i], n);
+            if (mpn_cmp(f1->coeffs[i], f2->coeffs[i], n + 1))
+               success = 0;
+         }
+         
+         ZmodF_poly_IFFT_threads(f1, 1);
+         ZmodF_poly_IFFT_threads(f2, threads);
+         
+         for (unsigned long i = 0; i < length && success; i++)
+         {
+            ZmodF_normalise(f1->coeffs[i], n);
+            ZmodF_normalise(f2->coeffs[i], n);
+            if (mpn_cmp(f1->coeffs[i], f2->coeffs[i], n + 1))
+               success = 0;
+         }
+         
+         ZmodF_poly_clear(f2);
+         ZmodF_poly_clear(f1);
+      }
+   }
+
+   return success;
+}
+
 int test_ZmodF_poly_convolution_range()
 {
    mpz_poly_t poly1, poly2, poly3, poly4;
@@ -1199,6 +1310,8 @@ void ZmodF_poly_test_all()
    RUN_TEST(_ZmodF_poly_IFFT_recursive);
    RUN_TEST(_ZmodF_poly_IFFT_iterative);
    RUN_TEST(_ZmodF_poly_IFFT);
+   RUN_TEST(ZmodF_poly_pointwise_mul_threads);
+   RUN_TEST(ZmodF_poly_FFT_IFFT_threads);
    RUN_TEST(ZmodF_poly_convolution);
    RUN_TEST(ZmodF_poly_convolution_range);
    RUN_TEST(ZmodF_poly_negacyclic_convolution);
@@ -36,6 +36,7 @@ Copyright (C) 2007, William Hart and David Harvey
 #include "fmpz_poly.h"
 #include "mpn_extras.h"
 #include "fmpz.h"
+#include "thread-support.h"
 
 /****************************************************************************
 
@@ -100,6 +101,28 @@ void ZmodF_poly_stack_clear(ZmodF_poly_t poly)
    flint_stack_release();
 }
 
+void ZmodF_poly_arena_init(ZmodF_poly_t poly, unsigned long depth, unsigned long n,
+                    unsigned long scratch_count, flint_arena_t arena)
+{
+   poly->n = n;
+   poly->depth = depth;
+   poly->scratch_count = scratch_count;
+   poly->length = 0;
+   
+   unsigned long bufs = (1 << depth) + scratch_count;
+
+   poly->storage = (mp_limb_t*) flint_arena_alloc(arena, bufs * (n+1));
+     
+   // put scratch array immediately after coeffs array
+   poly->coeffs = (ZmodF_t*) flint_arena_alloc_bytes(arena, bufs*sizeof(ZmodF_t));
+   
+   poly->scratch = poly->coeffs + (1 << depth);
+   
+   poly->coeffs[0] = poly->storage;
+   for (unsigned long i = 1; i < bufs; i++)
+      poly->coeffs[i] = poly->coeffs[i-1] + (n+1);
+}
+
 /****************************************************************************
 
    Basic Arithmetic Routines
@@ -119,23 +142,21 @@ void ZmodF_poly_set(ZmodF_poly_t x, ZmodF_poly_t y)
 }
 
 
-void ZmodF_poly_pointwise_mul(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y)
+/*
+   Sets res[i] := x[i]*y[i] for start <= i < stop. 
+*/
+void _ZmodF_poly_pointwise_mul_range(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y,
+                                     unsigned long start, unsigned long stop)
 {
-   FLINT_ASSERT(x->depth == y->depth);
-   FLINT_ASSERT(x->depth == res->depth);
-   FLINT_ASSERT(x->n == y->n);
-   FLINT_ASSERT(x->n == res->n);
-   FLINT_ASSERT(x->length == y->length);
-   
    unsigned long j;
 
    ZmodF_mul_info_t info;
    ZmodF_mul_info_init(info, x->n, x == y);
    
    if (x != y)
-      for (unsigned long i = 0; i < x->length; i++)
+      for (unsigned long i = start; i < stop; i++)
       {
-         if (i+8 < x->length)
+         if (i+8 < stop)
          {
             for (j = 0; j < x->n; j += 8) FLINT_PREFETCH(x->coeffs[i+8], j);
             for (j = 0; j < y->n; j += 8) FLINT_PREFETCH(y->coeffs[i+8], j);
@@ -143,9 +164,9 @@ void ZmodF_poly_pointwise_mul(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y)
          ZmodF_mul_info_mul(info, res->coeffs[i], x->coeffs[i], y->coeffs[i]);
       }
    else
-      for (unsigned long i = 0; i < x->length; i++)
+      for (unsigned long i = start; i < stop; i++)
       {
-         if (i+8 < x->length)
+         if (i+8 < stop)
          {
             for (j = 0; j < x->n; j += 8) FLINT_PREFETCH(x->coeffs[i+8], j);
          }
@@ -153,10 +174,68 @@ void ZmodF_poly_pointwise_mul(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y)
       }
 
    ZmodF_mul_info_clear(info);
+}
+
+typedef struct
+{
+   ZmodF_poly_p res;
+   ZmodF_poly_p x;
+   ZmodF_poly_p y;
+   unsigned long start;
+   unsigned long stop;
+} ZmodF_poly_pointwise_arg_t;
+
+void _ZmodF_poly_pointwise_mul_worker(void * arg_void)
+{
+   ZmodF_poly_pointwise_arg_t * arg = (ZmodF_poly_pointwise_arg_t *) arg_void;
+   
+   _ZmodF_poly_pointwise_mul_range(arg->res, arg->x, arg->y, arg->start, arg->stop);
+}
+
+void ZmodF_poly_pointwise_mul_threads(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y,
+                                      unsigned long threads)
+{
+   FLINT_ASSERT(x->depth == y->depth);
+   FLINT_ASSERT(x->depth == res->depth);
+   FLINT_ASSERT(x->n == y->n);
+   FLINT_ASSERT(x->n == res->n);
+   FLINT_ASSERT(x->length == y->length);
+   
+   // don't use more threads than there is work for
+   unsigned long work = x->length*(x->n + 1)/ZMODF_POLY_THREAD_CUTOFF;
+   if (threads > work) threads = FLINT_MAX(work, 1L);
+   
+   if (threads == 1)
+   {
+      _ZmodF_poly_pointwise_mul_range(res, x, y, 0, x->length);
+   } else
+   {
+      ZmodF_poly_pointwise_arg_t * args = (ZmodF_poly_pointwise_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(ZmodF_poly_pointwise_arg_t));
+      
+      for (unsigned long i = 0; i < threads; i++)
+      {
+         args[i].res = res;
+         args[i].x = x;
+         args[i].y = y;
+         args[i].start = (x->length*i)/threads;
+         args[i].stop = (x->length*(i + 1))/threads;
+      }
+      
+      flint_parallel_do(_ZmodF_poly_pointwise_mul_worker, args, 
+                        sizeof(ZmodF_poly_pointwise_arg_t), threads);
+      
+      flint_heap_free(args);
+   }
 
    res->length = x->length;
 }
 
+void ZmodF_poly_pointwise_mul(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y)
+{
+   ZmodF_poly_pointwise_mul_threads(res, x, y, flint_get_num_threads());
+}
+
 
 void ZmodF_poly_add(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y)
 {
@@ -1357,14 +1436,245 @@ void _ZmodF_poly_IFFT_dual_recursive(
 }
 
 
+/****************************************************************************
+
+   Multithreaded fourier transforms (internal code)
+
+The top level of the matrix fourier decomposition used by _ZmodF_poly_FFT_factor
+and _ZmodF_poly_IFFT_factor is split among threads: each batch of independent
+row or column transforms is divided into contiguous ranges, one per thread.
+Each thread has its own scratch buffer. Exactly the same sub-transforms are
+performed as in the serial code, so the output is identical.
+
+****************************************************************************/
+
+typedef struct
+{
+   ZmodF_t* x;
+   unsigned long depth; // depth of each sub-transform
+   unsigned long skip; // skip within each sub-transform
+   unsigned long step; // distance between the first coefficients of sub-transforms
+   unsigned long nonzero; // sub-transform i has nonzero + (i < nonzero_split) 
+   unsigned long nonzero_split; // nonzero input coefficients
+   unsigned long length;
+   int extra;
+   unsigned long twist; // sub-transform i is twisted by twist + i*twist_step
+   unsigned long twist_step;
+   unsigned long n;
+   int inverse;
+   unsigned long start; // range of sub-transforms handled by this thread
+   unsigned long stop;
+   ZmodF_t scratch[1]; // this thread's scratch buffer
+} ZmodF_poly_transforms_arg_t;
+
+void _ZmodF_poly_transforms_worker(void * arg_void)
+{
+   ZmodF_poly_transforms_arg_t * arg = (ZmodF_poly_transforms_arg_t *) arg_void;
+   
+   for (unsigned long i = arg->start; i < arg->stop; i++)
+   {
+      ZmodF_t* y = arg->x + i*arg->step;
+      unsigned long nonzero = arg->nonzero + (i < arg->nonzero_split);
+      unsigned long twist = arg->twist + i*arg->twist_step;
+      
+      if (arg->inverse)
+         _ZmodF_poly_IFFT(y, arg->depth, arg->skip, nonzero, arg->length, 
+                         arg->extra, twist, arg->n, arg->scratch);
+      else
+         _ZmodF_poly_FFT(y, arg->depth, arg->skip, nonzero, arg->length, 
+                        twist, arg->n, arg->scratch);
+   }
+}
+
+/*
+   Performs the sub-transforms start <= i < stop described by the parameters
+   (see ZmodF_poly_transforms_arg_t), split among the given number of threads.
+   Only the scratch buffers of args are read, all other fields are set here.
+*/
+void _ZmodF_poly_transforms_threads(ZmodF_poly_transforms_arg_t * args, unsigned long threads,
+            int inverse, ZmodF_t* x, unsigned long depth, unsigned long skip, unsigned long step, 
+            unsigned long start, unsigned long stop, unsigned long nonzero, unsigned long nonzero_split,
+            unsigned long length, int extra, unsigned long twist, unsigned long twist_step, unsigned long n)
+{
+   if (start >= stop) return;
+   
+   if (threads > stop - start) threads = stop - start;
+
+   for (unsigned long t = 0; t < threads; t++)
+   {
+      args[t].x = x;
+      args[t].depth = depth;
+      args[t].skip = skip;
+      args[t].step = step;
+      args[t].nonzero = nonzero;
+      args[t].nonzero_split = nonzero_split;
+      args[t].length = length;
+      args[t].extra = extra;
+      args[t].twist = twist;
+      args[t].twist_step = twist_step;
+      args[t].n = n;
+      args[t].inverse = inverse;
+      args[t].start = start + ((stop - start)*t)/threads;
+      args[t].stop = start + ((stop - start)*(t + 1))/threads;
+   }
+
+   flint_parallel_do(_ZmodF_poly_transforms_worker, args, 
+                     sizeof(ZmodF_poly_transforms_arg_t), threads);
+}
+
+/*
+   Allocates a scratch buffer for each thread. 
+*/
+mp_limb_t* _ZmodF_poly_transforms_init(ZmodF_poly_transforms_arg_t * args, 
+                                       unsigned long threads, unsigned long n)
+{
+   mp_limb_t* block = (mp_limb_t*) flint_heap_alloc(threads*(n+1));
+   
+   for (unsigned long t = 0; t < threads; t++)
+      args[t].scratch[0] = block + t*(n+1);
+   
+   return block;
+}
+
+/*
+   The transforms permute the coefficient buffers of x[0], ..., x[len-1] and
+   the thread scratch buffers. Move any coefficients which ended up in the 
+   thread scratch block back into buffers belonging to x, then free the block.
+*/
+void _ZmodF_poly_transforms_clear(ZmodF_poly_transforms_arg_t * args, unsigned long threads,
+                                  mp_limb_t* block, ZmodF_t* x, unsigned long len, unsigned long n)
+{
+   mp_limb_t* block_end = block + threads*(n+1);
+   unsigned long t = 0;
+   
+   for (unsigned long i = 0; i < len; i++)
+   {
+      if (x[i] >= block && x[i] < block_end)
+      {
+         // find a thread whose scratch buffer is one of x's buffers
+         while (args[t].scratch[0] >= block && args[t].scratch[0] < block_end) t++;
+         ZmodF_set(args[t].scratch[0], x[i], n);
+         x[i] = args[t].scratch[0];
+         t++;
+      }
+   }
+   
+   flint_heap_free(block);
+}
+
+void _ZmodF_poly_FFT_factor_threads(
+            ZmodF_t* x, unsigned long rows_depth, unsigned long cols_depth,
+            unsigned long nonzero, unsigned long length, unsigned long n, 
+            unsigned long threads)
+{
+   unsigned long depth = rows_depth + cols_depth;
+   unsigned long root = (4*n*FLINT_BITS) >> depth;
+
+   unsigned long cols = 1UL << cols_depth;
+
+   unsigned long length_rows = length >> cols_depth;
+   unsigned long length_cols = length & (cols-1);
+   unsigned long length_whole_rows = length_cols ?
+                                     (length_rows + 1) : length_rows;
+   unsigned long nonzero_rows = nonzero >> cols_depth;
+   unsigned long nonzero_cols = nonzero & (cols-1);
+
+   ZmodF_poly_transforms_arg_t * args = (ZmodF_poly_transforms_arg_t *) 
+               flint_heap_alloc_bytes(threads*sizeof(ZmodF_poly_transforms_arg_t));
+   mp_limb_t* block = _ZmodF_poly_transforms_init(args, threads, n);
+
+   // column transforms
+   _ZmodF_poly_transforms_threads(args, threads, 0, x, rows_depth, cols, 1, 
+                    0, nonzero_rows ? cols : nonzero_cols, nonzero_rows, nonzero_cols,
+                    length_whole_rows, 0, 0, root, n);
+   
+   if (nonzero_rows) nonzero_cols = cols;
+   
+   // row transforms
+   _ZmodF_poly_transforms_threads(args, threads, 0, x, cols_depth, 1, cols, 
+                    0, length_rows, nonzero_cols, 0, 
+                    cols, 0, 0, 0, n);
+
+   if (length_cols)
+      // The relevant portion of the last row:
+      _ZmodF_poly_FFT(x + (length_rows << cols_depth), cols_depth, 1, nonzero_cols, 
+                     length_cols, 0, n, args[0].scratch);
+
+   _ZmodF_poly_transforms_clear(args, threads, block, x, 1UL << depth, n);
+   flint_heap_free(args);
+}
+
+void _ZmodF_poly_IFFT_factor_threads(
+            ZmodF_t* x, unsigned long rows_depth, unsigned long cols_depth,
+            unsigned long nonzero, unsigned long length, unsigned long n,
+            unsigned long threads)
+{
+   unsigned long depth = rows_depth + cols_depth;
+   unsigned long root = (4*n*FLINT_BITS) >> depth;
+   
+   unsigned long cols = 1UL << cols_depth;
+
+   unsigned long length_rows = length >> cols_depth;
+   unsigned long length_cols = length & (cols-1);
+   unsigned long nonzero_rows = nonzero >> cols_depth;
+   unsigned long nonzero_cols = nonzero & (cols-1);
+
+   ZmodF_poly_transforms_arg_t * args = (ZmodF_poly_transforms_arg_t *) 
+               flint_heap_alloc_bytes(threads*sizeof(ZmodF_poly_transforms_arg_t));
+   mp_limb_t* block = _ZmodF_poly_transforms_init(args, threads, n);
+
+   // row transforms for the rows where we have all fourier coefficients
+   _ZmodF_poly_transforms_threads(args, threads, 1, x, cols_depth, 1, cols, 
+                    0, length_rows, cols, 0, 
+                    cols, 0, 0, 0, n);
+
+   // column transforms where we have enough information
+   _ZmodF_poly_transforms_threads(args, threads, 1, x, rows_depth, cols, 1, 
+                    length_cols, nonzero_rows ? cols : nonzero_cols, nonzero_rows, nonzero_cols,
+                    length_rows, length_cols ? 1 : 0, 0, root, n);
+
+   if (length_cols)
+   {
+      // a single switcheroo row transform
+      _ZmodF_poly_IFFT(x + (length_rows << cols_depth), cols_depth,
+                      1, (nonzero_rows ? cols : nonzero_cols),
+                      length_cols, 0, 0, n, args[0].scratch);
+
+      // remaining column transforms
+      _ZmodF_poly_transforms_threads(args, threads, 1, x, rows_depth, cols, 1, 
+                    0, length_cols, nonzero_rows, nonzero_cols,
+                    length_rows + 1, 0, 0, root, n);
+   }
+
+   _ZmodF_poly_transforms_clear(args, threads, block, x, 1UL << depth, n);
+   flint_heap_free(args);
+}
+
 /****************************************************************************
 
    Fourier Transform Routines
 
 ****************************************************************************/
 
+/*
+   Returns the number of threads (at most the given number) to use for a 
+   transform of the given depth and coefficient length, or 1 if the transform
+   is too small to be worth splitting or would not be factored anyway.
+*/
+unsigned long _ZmodF_poly_transform_threads(unsigned long depth, unsigned long n, 
+                                            unsigned long threads)
+{
+   if (threads <= 1 || depth <= 1 || 
+       ((1UL << depth) + 1) * (n+1) <= ZMODFPOLY_FFT_FACTOR_THRESHOLD)
+      return 1;
+   
+   unsigned long work = ((1UL << depth)*(n+1))/ZMODF_POLY_THREAD_CUTOFF;
+   if (threads > work) threads = FLINT_MAX(work, 1L);
+   
+   return threads;
+}
 
-void ZmodF_poly_FFT(ZmodF_poly_t poly, unsigned long length)
+void ZmodF_poly_FFT_threads(ZmodF_poly_t poly, unsigned long length, unsigned long threads)
 {
    FLINT_ASSERT(length <= (1UL << poly->depth));
    // check the right roots of unity are available
@@ -1381,7 +1691,13 @@ void ZmodF_poly_FFT(ZmodF_poly_t poly, unsigned long length)
       }
       else
       {
-         if (poly->depth >= 1)
+         threads = _ZmodF_poly_transform_threads(poly->depth, poly->n, threads);
+         
+         if (threads > 1)
+            _ZmodF_poly_FFT_factor_threads(poly->coeffs, poly->depth >> 1, 
+                           poly->depth - (poly->depth >> 1), poly->length,
+                           length, poly->n, threads);
+         else if (poly->depth >= 1)
             _ZmodF_poly_FFT(poly->coeffs, poly->depth, 1, poly->length,
                            length, 0, poly->n, poly->scratch);
       }
@@ -1390,16 +1706,34 @@ void ZmodF_poly_FFT(ZmodF_poly_t poly, unsigned long length)
    poly->length = length;
 }
 
+void ZmodF_poly_FFT(ZmodF_poly_t poly, unsigned long length)
+{
+   ZmodF_poly_FFT_threads(poly, length, flint_get_num_threads());
+}
 
-void ZmodF_poly_IFFT(ZmodF_poly_t poly)
+void ZmodF_poly_IFFT_threads(ZmodF_poly_t poly, unsigned long threads)
 {
    // check the right roots of unity are available
    FLINT_ASSERT((4 * poly->n * FLINT_BITS) % (1 << poly->depth) == 0);
    FLINT_ASSERT(poly->scratch_count >= 1);
 
    if (poly->length && poly->depth)
-      _ZmodF_poly_IFFT(poly->coeffs, poly->depth, 1, poly->length,
-                      poly->length, 0, 0, poly->n, poly->scratch);
+   {
+      threads = _ZmodF_poly_transform_threads(poly->depth, poly->n, threads);
+      
+      if (threads > 1)
+         _ZmodF_poly_IFFT_factor_threads(poly->coeffs, poly->depth >> 1, 
+                         poly->depth - (poly->depth >> 1), poly->length,
+                         poly->length, poly->n, threads);
+      else
+         _ZmodF_poly_IFFT(poly->coeffs, poly->depth, 1, poly->length,
+                         poly->length, 0, 0, poly->n, poly->scratch);
+   }
+}
+
+void ZmodF_poly_IFFT(ZmodF_poly_t poly)
+{
+   ZmodF_poly_IFFT_threads(poly, flint_get_num_threads());
 }
 
 
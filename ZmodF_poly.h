@@ -98,6 +98,12 @@ typedef ZmodF_poly_struct ZmodF_poly_t[1];
 
 typedef ZmodF_poly_struct * ZmodF_poly_p;
 
+/*
+   Approximate minimum number of limbs of coefficients each thread should 
+   process when an operation is split across threads.
+*/
+#define ZMODF_POLY_THREAD_CUTOFF 8192
+
 
 
 /****************************************************************************
@@ -124,6 +130,14 @@ void ZmodF_poly_clear(ZmodF_poly_t poly);
 
 void ZmodF_poly_stack_clear(ZmodF_poly_t poly);
 
+/*
+   As for ZmodF_poly_init, but the polynomial is allocated from the given arena.
+   There is no corresponding clear function, the memory is released by 
+   resetting the arena.
+*/
+void ZmodF_poly_arena_init(ZmodF_poly_t poly, unsigned long depth, unsigned long n,
+                    unsigned long scratch_count, flint_arena_t arena);
+
 
 /* 
    Decrease the number of limbs n that are meaningful in a ZmodF_poly_t.
@@ -169,6 +183,17 @@ void ZmodF_poly_set(ZmodF_poly_t x, ZmodF_poly_t y);
 */
 void ZmodF_poly_pointwise_mul(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y);
 
+/*
+   As for ZmodF_poly_pointwise_mul, but the coefficients are divided among at
+   most the given number of threads, each with its own ZmodF_mul_info_t. 
+   Fewer threads are used if there would be less than about 
+   ZMODF_POLY_THREAD_CUTOFF limbs of coefficients for each.
+
+   ZmodF_poly_pointwise_mul uses flint_get_num_threads() threads.
+*/
+void ZmodF_poly_pointwise_mul_threads(ZmodF_poly_t res, ZmodF_poly_t x, ZmodF_poly_t y,
+                                      unsigned long threads);
+
 
 /*
    Sets res := x + y mod p.
@@ -257,6 +282,15 @@ factoring algorithm. It should be set to about the number of limbs in L1 cache.
 */
 void ZmodF_poly_FFT(ZmodF_poly_t poly, unsigned long length);
 
+/*
+   As for ZmodF_poly_FFT, but the independent row and column transforms at the
+   top level of the transform are divided among at most the given number of
+   threads. The output is identical to that of the serial transform.
+
+   ZmodF_poly_FFT uses flint_get_num_threads() threads.
+*/
+void ZmodF_poly_FFT_threads(ZmodF_poly_t poly, unsigned long length, unsigned long threads);
+
 
 /*
    Converts from fourier representation to coefficient representation.
@@ -274,6 +308,12 @@ void ZmodF_poly_FFT(ZmodF_poly_t poly, unsigned long length);
 */
 void ZmodF_poly_IFFT(ZmodF_poly_t poly);
 
+/*
+   As for ZmodF_poly_IFFT, but split among at most the given number of threads,
+   as for ZmodF_poly_FFT_threads.
+*/
+void ZmodF_poly_IFFT_threads(ZmodF_poly_t poly, unsigned long threads);
+
 
 /*
    Computes convolution of x and y, places result in res.
@@ -0,0 +1,143 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/****************************************************************************
+
+binary-io.c: Versioned binary file format for polynomials
+
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <gmp.h>
+#include "flint.h"
+#include "binary-io.h"
+
+static inline void _flint_binary_put_word(unsigned char * buf, uint64_t w)
+{
+   for (int i = 0; i < 8; i++, w >>= 8)
+      buf[i] = (unsigned char) w;
+}
+
+static inline uint64_t _flint_binary_get_word(const unsigned char * buf)
+{
+   uint64_t w = 0;
+   for (int i = 7; i >= 0; i--)
+      w = (w << 8) + buf[i];
+   return w;
+}
+
+void flint_binary_header_pack(unsigned char * buf, const flint_binary_header_t header)
+{
+   _flint_binary_put_word(buf, FLINT_BINARY_MAGIC);
+   _flint_binary_put_word(buf + 8, FLINT_BINARY_VERSION);
+   _flint_binary_put_word(buf + 16, FLINT_BITS);
+   _flint_binary_put_word(buf + 24, header->type);
+   _flint_binary_put_word(buf + 32, header->length);
+   _flint_binary_put_word(buf + 40, (uint64_t) (int64_t) header->bits);
+   _flint_binary_put_word(buf + 48, header->modulus);
+   _flint_binary_put_word(buf + 56, header->limbs);
+}
+
+int flint_binary_header_unpack(flint_binary_header_t header, const unsigned char * buf)
+{
+   if (_flint_binary_get_word(buf) != FLINT_BINARY_MAGIC) return 0;
+   if (_flint_binary_get_word(buf + 8) != FLINT_BINARY_VERSION) return 0;
+   if (_flint_binary_get_word(buf + 16) != FLINT_BITS) return 0;
+
+   header->type = _flint_binary_get_word(buf + 24);
+   header->length = _flint_binary_get_word(buf + 32);
+   header->bits = (int64_t) _flint_binary_get_word(buf + 40);
+   header->modulus = _flint_binary_get_word(buf + 48);
+   header->limbs = _flint_binary_get_word(buf + 56);
+
+   return 1;
+}
+
+int flint_binary_header_fwrite(const flint_binary_header_t header, FILE * f)
+{
+   unsigned char buf[FLINT_BINARY_HEADER_BYTES];
+   
+   flint_binary_header_pack(buf, header);
+   
+   return (fwrite(buf, 1, FLINT_BINARY_HEADER_BYTES, f) == FLINT_BINARY_HEADER_BYTES);
+}
+
+int flint_binary_header_fread(flint_binary_header_t header, FILE * f)
+{
+   unsigned char buf[FLINT_BINARY_HEADER_BYTES];
+   
+   if (fread(buf, 1, FLINT_BINARY_HEADER_BYTES, f) != FLINT_BINARY_HEADER_BYTES) 
+      return 0;
+   
+   return flint_binary_header_unpack(header, buf);
+}
+
+#if FLINT_BIG_ENDIAN
+
+static inline mp_limb_t _flint_binary_swap(mp_limb_t x)
+{
+   mp_limb_t r = 0;
+   for (int i = 0; i < sizeof(mp_limb_t); i++, x >>= 8)
+      r = (r << 8) + (x & 0xFF);
+   return r;
+}
+
+#define FLINT_BINARY_CHUNK 1024
+
+int flint_binary_limbs_fwrite(const mp_limb_t * x, unsigned long n, FILE * f)
+{
+   mp_limb_t buf[FLINT_BINARY_CHUNK];
+
+   while (n)
+   {
+      unsigned long m = FLINT_MIN(n, FLINT_BINARY_CHUNK);
+      for (unsigned long i = 0; i < m; i++)
+         buf[i] = _flint_binary_swap(x[i]);
+      if (fwrite(buf, sizeof(mp_limb_t), m, f) != m) return 0;
+      x += m;
+      n -= m;
+   }
+
+   return 1;
+}
+
+int flint_binary_limbs_fread(mp_limb_t * x, unsigned long n, FILE * f)
+{
+   if (fread(x, sizeof(mp_limb_t), n, f) != n) return 0;
+   
+   for (unsigned long i = 0; i < n; i++)
+      x[i] = _flint_binary_swap(x[i]);
+
+   return 1;
+}
+
+#else
+
+int flint_binary_limbs_fwrite(const mp_limb_t * x, unsigned long n, FILE * f)
+{
+   return (fwrite(x, sizeof(mp_limb_t), n, f) == n);
+}
+
+int flint_binary_limbs_fread(mp_limb_t * x, unsigned long n, FILE * f)
+{
+   return (fread(x, sizeof(mp_limb_t), n, f) == n);
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/****************************************************************************
+
+binary-io.h: Versioned binary file format for polynomials
+
+*****************************************************************************/
+
+#ifndef FLINT_BINARY_IO_H
+#define FLINT_BINARY_IO_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdio.h>
+#include <gmp.h>
+#include "flint.h"
+
+/*
+   A binary file consists of a header of FLINT_BINARY_HEADER_BYTES bytes, 
+   being eight 64 bit little endian words:
+
+      magic, version, bits per limb, type, length, bits, modulus, limbs
+
+   followed by a payload of limbs, each stored little endian. The bits field 
+   is stored in two's complement and is the maximum number of bits of the 
+   absolute value of any coefficient, negated if any coefficient is negative.
+   The layout of the payload depends on the type, see the relevant *_fwrite_binary 
+   function. As the header has a multiple of 8 bytes, the payload of a file 
+   mapped into memory is limb aligned.
+*/
+
+#define FLINT_BINARY_MAGIC 0x6e6962746e696c66ULL // "flintbin" in little endian
+#define FLINT_BINARY_VERSION 1L
+#define FLINT_BINARY_HEADER_BYTES 64
+
+#define FLINT_BINARY_F_MPZ_POLY 1L
+#define FLINT_BINARY_FMPZ_POLY 2L
+#define FLINT_BINARY_ZMOD_POLY 3L
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define FLINT_BIG_ENDIAN 1
+#else
+#define FLINT_BIG_ENDIAN 0
+#endif
+
+typedef struct
+{
+   unsigned long type; // one of FLINT_BINARY_F_MPZ_POLY, etc
+   unsigned long length; // number of coefficients
+   long bits; // maximum bits of coefficients, negative if any are negative
+   unsigned long modulus; // modulus, or 0 if there is none
+   unsigned long limbs; // limbs per coefficient in the payload
+} flint_binary_header_struct;
+
+typedef flint_binary_header_struct flint_binary_header_t[1];
+
+/*
+   Write the given header into the FLINT_BINARY_HEADER_BYTES bytes at buf.
+*/
+void flint_binary_header_pack(unsigned char * buf, const flint_binary_header_t header);
+
+/*
+   Read a header from the FLINT_BINARY_HEADER_BYTES bytes at buf. Returns 0 if 
+   the magic number or version are not recognised or the file was written with
+   a different number of bits per limb, otherwise 1.
+*/
+int flint_binary_header_unpack(flint_binary_header_t header, const unsigned char * buf);
+
+/*
+   Write/read a header to/from the given stream. Return 1 on success, 0 on failure.
+*/
+int flint_binary_header_fwrite(const flint_binary_header_t header, FILE * f);
+int flint_binary_header_fread(flint_binary_header_t header, FILE * f);
+
+/*
+   Write/read n limbs, stored little endian, to/from the given stream. Return 1 
+   on success, 0 on failure.
+*/
+int flint_binary_limbs_fwrite(const mp_limb_t * x, unsigned long n, FILE * f);
+int flint_binary_limbs_fread(mp_limb_t * x, unsigned long n, FILE * f);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
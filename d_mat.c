@@ -31,13 +31,39 @@
 #include "d_mat.h"
 #include "F_mpz_mat.h"
 
+#if D_MAT_USE_AVX2
+#include <immintrin.h>
+#endif
+
+#define D_MAT_ROW_ALIGN (D_MAT_ALIGN/sizeof(double))
+
+int d_simd_disable = 0;
+
+int d_simd_avx2(void)
+{
+#if D_MAT_USE_AVX2
+   static int have_avx2 = -1;
+   
+   if (have_avx2 < 0)
+   {
+      __builtin_cpu_init();
+      have_avx2 = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? 1 : 0;
+   }
+   
+   return have_avx2 && !d_simd_disable;
+#else
+   return 0;
+#endif
+}
+
 double ** d_mat_init(int d, int n)
 {
    double ** B;
+   long stride = (n + D_MAT_ROW_ALIGN - 1) & -D_MAT_ROW_ALIGN;
 
-   B = (double **) malloc (d*sizeof(double*) + n*d*sizeof(double));
-   B[0] = (double *) (B + d);
-	for (long i = 1; i < d; i++) B[i] = B[i-1] + n;
+   B = (double **) malloc (d*sizeof(double*) + (stride*d + D_MAT_ROW_ALIGN)*sizeof(double));
+   B[0] = (double *) (((unsigned long) (B + d) + D_MAT_ALIGN - 1) & -D_MAT_ALIGN);
+	for (long i = 1; i < d; i++) B[i] = B[i-1] + stride;
 
 	return B;
 }
@@ -65,10 +91,63 @@ void d_mat_print(double ** B, int * expo, int d, int n)
    printf("]\n"); 
 }
 
+#if D_MAT_USE_AVX2
+
+static D_MAT_AVX2 
+double d_vec_scalar_product_avx2(double * vec1, double * vec2, int n)
+{
+   __m256d sum0 = _mm256_setzero_pd();
+   __m256d sum1 = _mm256_setzero_pd();
+   __m128d sum;
+   long i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+   {
+      sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(vec1 + i), _mm256_loadu_pd(vec2 + i), sum0);
+      sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(vec1 + i + 4), _mm256_loadu_pd(vec2 + i + 4), sum1);
+   }
+   if (i + 4 <= n)
+   {
+      sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(vec1 + i), _mm256_loadu_pd(vec2 + i), sum0);
+      i += 4;
+   }
+
+   sum0 = _mm256_add_pd(sum0, sum1);
+   sum = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+   sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+   
+   double res = _mm_cvtsd_f64(sum);
+   for ( ; i < n; i++)
+      res += vec1[i] * vec2[i];
+
+   return res;
+}
+
+static D_MAT_AVX2 
+void d_vec_submul_avx2(double * vec1, double * vec2, double c, int n)
+{
+   __m256d cc = _mm256_set1_pd(c);
+   long i;
+
+   for (i = 0; i + 4 <= n; i += 4)
+      _mm256_storeu_pd(vec1 + i, _mm256_fnmadd_pd(cc, _mm256_loadu_pd(vec2 + i), 
+                                                  _mm256_loadu_pd(vec1 + i)));
+
+   for ( ; i < n; i++)
+      vec1[i] -= c * vec2[i];
+}
+
+#endif
+
 double d_vec_scalar_product(double * vec1, double * vec2, int n)
 {
   double sum;
 
+#if D_MAT_USE_AVX2
+  if (n >= 8 && d_simd_avx2()) 
+     return d_vec_scalar_product_avx2(vec1, vec2, n);
+#endif
+
   sum = vec1[0] * vec2[0];
   for (long i = 1; i < n; i++)
      sum += vec1[i] * vec2[i];
@@ -76,6 +155,35 @@ double d_vec_scalar_product(double * vec1, double * vec2, int n)
   return sum;
 } 
 
+void d_vec_submul(double * vec1, double * vec2, double c, int n)
+{
+#if D_MAT_USE_AVX2
+  if (n >= 4 && d_simd_avx2()) 
+  {
+     d_vec_submul_avx2(vec1, vec2, c, n);
+     return;
+  }
+#endif
+
+  for (long i = 0; i < n; i++)
+     vec1[i] -= c * vec2[i];
+}
+
+void d_vec_submul_2exp(double * vec1, double * vec2, double c, int exp, int n)
+{
+  int e;
+
+  frexp(c, &e);
+  if ((c != 0.0) && (e + exp > DBL_MIN_EXP) && (e + exp < DBL_MAX_EXP))
+  {
+     d_vec_submul(vec1, vec2, ldexp(c, exp), n);
+     return;
+  }
+
+  for (long i = 0; i < n; i++)
+     vec1[i] -= ldexp(c * vec2[i], exp);
+}
+
 double d_vec_scalar_product_heuristic(double * vec1, double * vec2, int n, F_mpz_mat_t B, ulong kappa, ulong j, long exp_adj)
 {
   double sum;
@@ -134,14 +242,7 @@ double d_2exp_vec_scalar_product(double * vec1, double * vec2, int n, int *cexpo
 
 double d_vec_norm(double * vec, int n)
 {
-  double sum;
-
-  sum = vec[0] * vec[0];
-  for (long i = 1 ; i < n ; i++)
-     sum += vec[i] * vec[i];
-
-  return sum;
-
+  return d_vec_scalar_product(vec, vec, n);
 } 
 
 double d_2exp_vec_norm(double * vec, int n, int *cexpo)
@@ -19,6 +19,40 @@
 
 #include "F_mpz_mat.h"
 
+/*
+   The rows of a matrix from d_mat_init start on D_MAT_ALIGN byte boundaries,
+   each row being padded to a multiple of D_MAT_ALIGN bytes, so that a row
+   never shares a cache line with another and whole row loads are aligned.
+   The rows may still be permuted by swapping the row pointers.
+*/
+#define D_MAT_ALIGN 64
+
+/*
+   If D_MAT_USE_AVX2 is set, the vector routines below have AVX2/FMA versions,
+   compiled via GCC's target attribute and only called if d_simd_avx2()
+   returns nonzero. Their sums are evaluated in a different order from the 
+   scalar loops (and with fused multiply-adds), so the results may differ in
+   the last bits. Define FLINT_NO_SIMD to compile only the scalar loops.
+*/
+#if !defined (FLINT_NO_SIMD) && defined (__GNUC__) && defined (__x86_64__)  \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define D_MAT_USE_AVX2 1
+#define D_MAT_AVX2 __attribute__ ((target ("avx2,fma")))
+#else
+#define D_MAT_USE_AVX2 0
+#endif
+
+/*
+   Set to nonzero to force the scalar loops
+*/
+extern int d_simd_disable;
+
+/*
+   Returns nonzero if the AVX2 kernels may be used, i.e. they were compiled 
+   in, the processor supports AVX2 and FMA and d_simd_disable is zero
+*/
+int d_simd_avx2(void);
+
 double ** d_mat_init(int d, int n);
 
 void d_mat_clear(double ** B);
@@ -31,6 +65,17 @@ double d_vec_scalar_product_heuristic(double * vec1, double * vec2, int n, F_mpz
 
 double d_vec_norm(double * vec, int n);
 
+/*
+   Sets vec1[i] = vec1[i] - c*vec2[i] for 0 <= i < n
+*/
+void d_vec_submul(double * vec1, double * vec2, double c, int n);
+
+/*
+   Sets vec1[i] = vec1[i] - ldexp(c*vec2[i], exp) for 0 <= i < n. When 
+   c*2^exp is a normal double this is done by d_vec_submul.
+*/
+void d_vec_submul_2exp(double * vec1, double * vec2, double c, int exp, int n);
+
 double d_2exp_vec_scalar_product(double * vec1, double * vec2, int n, int *cexpo, F_mpz_mat_t B, ulong kappa, ulong j);
 
 double d_2exp_vec_norm(double * vec, int n, int *cexpo);
@@ -99,7 +99,10 @@ Cache/branch hints to speed up reads from data in memory/branches
 Thread stuff
 */
 
-#define THREAD
+// storage class for data which each thread needs its own copy of
+#define FLINT_TLS __thread
+
+#define THREAD FLINT_TLS
 
 #ifdef FLINT_TEST_SUPPORT_H 
 #define FLINT_THREAD_CLEANUP \
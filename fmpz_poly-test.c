@@ -1531,6 +1531,57 @@ int test_fmpz_poly_freadprint()
    
    return result; 
 }
+
+int test_fmpz_poly_fwrite_fread_binary()
+{
+   mpz_poly_t test_poly;
+   fmpz_poly_t test_fmpz_poly, test_fmpz_poly2;
+   int result = 1;
+   unsigned long bits, length;
+   
+   mpz_poly_init(test_poly); 
+   
+   for (unsigned long count1 = 1; (count1 < 200) && (result == 1) ; count1++)
+   {
+      bits = random_ulong(200)+ 1;
+      
+      fmpz_poly_init2(test_fmpz_poly, 1, (bits-1)/FLINT_BITS+1+randint(3));
+      fmpz_poly_init2(test_fmpz_poly2, 1, randint(6)+1);
+      FILE * testfile; 
+      
+      for (unsigned long count2 = 0; (count2 < 10) && (result == 1); count2++)
+      { 
+          length = random_ulong(100);        
+#if DEBUG
+          printf("length = %ld, bits = %ld\n",length, bits);
+#endif
+          fmpz_poly_fit_length(test_fmpz_poly, length);
+          randpoly(test_poly, length, bits); 
+
+          mpz_poly_to_fmpz_poly(test_fmpz_poly, test_poly);
+          
+          testfile = fopen("testfile", "wb");
+          fmpz_poly_fwrite_binary(test_fmpz_poly, testfile);
+          fclose(testfile);
+          testfile = fopen("testfile", "rb");
+          result = fmpz_poly_fread_binary(test_fmpz_poly2, testfile);
+          fclose(testfile);
+          if (result)
+          {
+             fmpz_poly_check_normalisation(test_fmpz_poly2);
+             result = _fmpz_poly_equal(test_fmpz_poly2, test_fmpz_poly);
+          }
+      }
+      remove("testfile");
+            
+      fmpz_poly_clear(test_fmpz_poly);
+      fmpz_poly_clear(test_fmpz_poly2);         
+   }
+   
+   mpz_poly_clear(test_poly);
+   
+   return result; 
+}
 #endif
 
 int test_fmpz_poly_tofromstring()
@@ -15145,6 +15196,7 @@ void fmpz_poly_test_all()
 
 #if TESTFILE
    RUN_TEST(fmpz_poly_freadprint); 
+   RUN_TEST(fmpz_poly_fwrite_fread_binary); 
 #endif
 		
 	RUN_TEST(fmpz_poly_tofromstring); 
@@ -43,6 +43,7 @@ Copyright (C) 2009, William Hart and Burcin Erocal
 #include "ZmodF_poly.h"
 #include "long_extras.h"
 #include "zmod_poly.h"
+#include "binary-io.h"
 #include "zn_poly/src/zn_poly.h"
 
 /****************************************************************************
@@ -5046,6 +5047,66 @@ int fmpz_poly_fread(fmpz_poly_t poly, FILE* f)
    return ok;
 }
 
+/*
+   Write poly to f in the binary format of binary-io.h. The payload consists
+   of the coefficients in the fmpz format (a limb giving the signed size
+   followed by the limbs of the absolute value), each padded to the 
+   maximum number of limbs of any coefficient, plus one.
+*/
+
+int fmpz_poly_fwrite_binary(const fmpz_poly_t poly, FILE* f)
+{
+   flint_binary_header_t header;
+   unsigned long limbs = _fmpz_poly_max_limbs(poly);
+   
+   header->type = FLINT_BINARY_FMPZ_POLY;
+   header->length = poly->length;
+   header->bits = _fmpz_poly_max_bits(poly);
+   header->modulus = 0L;
+   header->limbs = limbs + 1;
+
+   if (!flint_binary_header_fwrite(header, f)) return 0;
+
+   if (limbs == poly->limbs) 
+      return flint_binary_limbs_fwrite(poly->coeffs, poly->length*(limbs + 1), f);
+   
+   for (unsigned long i = 0; i < poly->length; i++)
+      if (!flint_binary_limbs_fwrite(poly->coeffs + i*(poly->limbs + 1), limbs + 1, f)) 
+         return 0;
+
+   return 1;
+}
+
+int fmpz_poly_fread_binary(fmpz_poly_t poly, FILE* f)
+{
+   flint_binary_header_t header;
+
+   if (!flint_binary_header_fread(header, f)) return 0;
+   if ((header->type != FLINT_BINARY_FMPZ_POLY) || (header->limbs == 0)) return 0;
+
+   unsigned long limbs = header->limbs - 1;
+   
+   fmpz_poly_fit_length(poly, header->length);
+   fmpz_poly_fit_limbs(poly, limbs);
+   poly->length = 0;
+   
+   if (limbs == poly->limbs)
+   {
+      if (!flint_binary_limbs_fread(poly->coeffs, header->length*(limbs + 1), f)) 
+         return 0;
+   } else
+   {
+      for (unsigned long i = 0; i < header->length; i++)
+         if (!flint_binary_limbs_fread(poly->coeffs + i*(poly->limbs + 1), limbs + 1, f)) 
+            return 0;
+   }
+   
+   poly->length = header->length;
+   _fmpz_poly_normalise(poly);
+
+   return 1;
+}
+
 /****************************************************************************
 
    Scalar multiplications and divisions
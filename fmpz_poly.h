@@ -632,6 +632,10 @@ void fmpz_poly_fprint(const fmpz_poly_t poly, FILE* f);
 
 int fmpz_poly_fread(fmpz_poly_t poly, FILE* f);
 
+int fmpz_poly_fwrite_binary(const fmpz_poly_t poly, FILE* f);
+
+int fmpz_poly_fread_binary(fmpz_poly_t poly, FILE* f);
+
 char* fmpz_poly_to_string_pretty(const fmpz_poly_t poly, const char * x);
 
 void fmpz_poly_fprint_pretty(const fmpz_poly_t poly, FILE* f, const char * x);
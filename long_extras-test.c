@@ -32,6 +32,8 @@ Copyright (C) 2007, William Hart and David Harvey
 #include "long_extras.h"
 #include "test-support.h"
 #include "memory-manager.h"
+#include "thread-support.h"
+#include "QS/tinyQS.h"
 
 #define DEBUG 0 // prints debug information
 #define DEBUG2 1 
@@ -2410,6 +2412,123 @@ int test_z_factor()
    return result;
 }
 
+int test_z_factor_batch()
+{
+   unsigned long n[100], prod, bits, num;
+   factor_t factors[100];
+   int i;
+
+   int result = 1;
+   
+   for (unsigned long count = 0; (count < 100) && (result == 1); count++)
+   { 
+      flint_set_num_threads(z_randint(4) + 1);
+      num = z_randint(100) + 1;
+      
+      for (unsigned long j = 0; j < num; j++)
+      {
+         bits = z_randint(FLINT_BITS-1)+1;
+         n[j] = random_ulong((1UL<<bits)-1)+2;
+      }
+           
+      z_factor_batch(factors, n, num, 1);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         prod = 1;
+         for (i = 0; i < factors[j].num; i++)
+         {
+            prod *= z_pow(factors[j].p[i], factors[j].exp[i]);
+         }
+      
+         result = (prod == n[j]);
+ 
+         if (!result)
+         {
+            printf("n = %ld: [", n[j]);
+            for (i = 0; i < factors[j].num - 1; i++)
+            {
+               printf("%ld, %ld; ", factors[j].p[i], factors[j].exp[i]);
+            }
+            printf("%ld, %ld]\n", factors[j].p[i], factors[j].exp[i]);
+         }
+      }
+   }  
+   
+   flint_set_num_threads(1);
+   
+   return result;
+}
+
+int test_F_mpz_factor_tinyQS_batch()
+{
+   mpz_t N[30], cofactor;
+   F_mpz_factor_t factors[30];
+   int res[30];
+   unsigned long num, bits1, bits2, p, q;
+
+   int result = 1;
+   
+   mpz_init(cofactor);
+   for (unsigned long j = 0; j < 30; j++)
+   {
+      mpz_init(N[j]);
+      factors[j].fact = (mpz_t *) malloc(64*sizeof(mpz_t));
+      for (unsigned long k = 0; k < 64; k++)
+         mpz_init(factors[j].fact[k]);
+   }
+   
+   for (unsigned long count = 0; (count < 20) && (result == 1); count++)
+   { 
+      flint_set_num_threads(z_randint(4) + 1);
+      num = z_randint(30) + 1;
+      
+      /* semiprimes from 28 to 78 bits, so both the SQUFOF front end and the sieve are used */
+      for (unsigned long j = 0; j < num; j++)
+      {
+         bits1 = z_randint(26) + 14;
+         bits2 = z_randint(26) + 14;
+         p = z_randprime(bits1, 0);
+         q = z_randprime(bits2, 0);
+         mpz_set_ui(N[j], p);
+         mpz_mul_ui(N[j], N[j], q);
+         factors[j].num = 0;
+      }
+           
+      F_mpz_factor_tinyQS_batch(res, factors, N, num);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         if (res[j] == 0) continue;
+         
+         result = ((factors[j].num >= 1) && (mpz_cmp_ui(factors[j].fact[0], 1) > 0) 
+                && (mpz_cmp(factors[j].fact[0], N[j]) < 0));
+         if (result)
+         {
+            mpz_tdiv_r(cofactor, N[j], factors[j].fact[0]);
+            result = (mpz_sgn(cofactor) == 0);
+         }
+ 
+         if (!result)
+         {
+            gmp_printf("N = %Zd, factor = %Zd\n", N[j], factors[j].fact[0]);
+         }
+      }
+   }
+   
+   for (unsigned long j = 0; j < 30; j++)
+   {
+      mpz_clear(N[j]);
+      for (unsigned long k = 0; k < 64; k++)
+         mpz_clear(factors[j].fact[k]);
+      free(factors[j].fact);
+   }
+   mpz_clear(cofactor);
+   flint_set_num_threads(1);
+   
+   return result;
+}
+
 int test_z_factor_partial()
 {
    unsigned long n, prod, cofactor, out, orig_n, limit;
@@ -2562,6 +2681,10 @@ void fmpz_poly_test_all()
 #endif
 	RUN_TEST(z_factor_HOLF);
    RUN_TEST(z_factor);
+   RUN_TEST(z_factor_batch);
+#if FLINT_BITS == 64
+   RUN_TEST(F_mpz_factor_tinyQS_batch);
+#endif
    RUN_TEST(z_factor_partial);
    
    printf(all_success ? "\nAll tests passed\n" :
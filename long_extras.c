@@ -38,6 +38,7 @@
 #include "longlong_wrapper.h"
 #include "longlong.h"
 #include "memory-manager.h"
+#include "thread-support.h"
 #include "QS/tinyQS.h"
 
 
@@ -69,18 +70,46 @@ const unsigned int z_primes[] =
 
 
 
+/*
+   The generator state is per thread, so that z_randint may be called from 
+   the batch factoring and sieving threads. Each thread perturbs the seed by 
+   the order in which it first asks for a value, the first thread getting 
+   the original sequence, so that threads do not all draw the same values.
+*/
+
+static unsigned long z_randint_threads = 0;
+
+static FLINT_TLS int z_randint_seeded = 0;
+
 unsigned long z_randint(unsigned long limit) 
 {
 #if FLINT_BITS == 32
-    static uint64_t randval = 4035456057U;
+    static FLINT_TLS uint64_t randval;
+    
+    if (!z_randint_seeded)
+    {
+       unsigned long k = __sync_fetch_and_add(&z_randint_threads, 1UL);
+       randval = ((uint64_t)4035456057U + (uint64_t)k*(uint64_t)2654435761U)%(uint64_t)4294967311U;
+       z_randint_seeded = 1;
+    }
+    
     randval = ((uint64_t)randval*(uint64_t)1025416097U+(uint64_t)286824430U)%(uint64_t)4294967311U;
     
     if (limit == 0L) return (unsigned long) randval;
     
     return (unsigned long)randval%limit;
 #else
-    static unsigned long randval = 4035456057U;
-    static unsigned long randval2 = 6748392731U;
+    static FLINT_TLS unsigned long randval;
+    static FLINT_TLS unsigned long randval2;
+    
+    if (!z_randint_seeded)
+    {
+       unsigned long k = __sync_fetch_and_add(&z_randint_threads, 1UL);
+       randval = (4035456057UL + k*2654435761UL)%4294967311UL;
+       randval2 = (6748392731UL + k*1640531527UL)%4294967357UL;
+       z_randint_seeded = 1;
+    }
+    
     randval = ((unsigned long)randval*(unsigned long)1025416097U+(unsigned long)286824428U)%(unsigned long)4294967311U;
     randval2 = ((unsigned long)randval2*(unsigned long)1647637699U+(unsigned long)286824428U)%(unsigned long)4294967357U;
     
@@ -2567,6 +2596,60 @@ void z_factor(factor_t * factors, unsigned long n, int proved)
     }
 }
 
+typedef struct
+{
+   factor_t * factors;
+   unsigned long * n;
+   unsigned long num;
+   unsigned long start;
+   unsigned long step;
+   int proved;
+} z_factor_batch_arg_t;
+
+void _z_factor_batch_worker(void * arg_ptr)
+{
+   z_factor_batch_arg_t * arg = (z_factor_batch_arg_t *) arg_ptr;
+   
+   for (unsigned long i = arg->start; i < arg->num; i += arg->step)
+      z_factor(arg->factors + i, arg->n[i], arg->proved);
+}
+
+/*
+   Sets factors[i] to the factorisation of n[i], as z_factor does, for 
+   i = 0, ..., num - 1. The values are dealt out in turn to at most 
+   flint_get_num_threads() threads, so that each gets a mix of easy and 
+   hard values.
+*/
+
+void z_factor_batch(factor_t * factors, unsigned long * n, unsigned long num, int proved)
+{
+   unsigned long threads = FLINT_MIN(flint_get_num_threads(), num);
+   
+   if (threads <= 1)
+   {
+      for (unsigned long i = 0; i < num; i++)
+         z_factor(factors + i, n[i], proved);
+      return;
+   }
+   
+   z_factor_batch_arg_t * args = (z_factor_batch_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(z_factor_batch_arg_t));
+   
+   for (unsigned long i = 0; i < threads; i++)
+   {
+      args[i].factors = factors;
+      args[i].n = n;
+      args[i].num = num;
+      args[i].start = i;
+      args[i].step = threads;
+      args[i].proved = proved;
+   }
+   
+   flint_parallel_do(_z_factor_batch_worker, args, sizeof(z_factor_batch_arg_t), threads);
+   
+   flint_heap_free(args);
+}
+
 
 /*
    Finds the smallest primitive root of the prime p
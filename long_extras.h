@@ -272,6 +272,8 @@ unsigned long z_factor_HOLF(unsigned long n, unsigned long iterations);
 
 void z_factor(factor_t * factors, unsigned long n, int proved);
 
+void z_factor_batch(factor_t * factors, unsigned long * n, unsigned long num, int proved);
+
 unsigned long z_factor_partial(factor_t * factors, unsigned long n, unsigned long limit, int proved);
 
 unsigned long z_primitive_root(unsigned long p);
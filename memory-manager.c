@@ -43,8 +43,8 @@ Copyright (C) 2007, William Hart and David Harvey
     
 ------------------------------------------------------------------------------------------------*/
 
-void * mempts[200000];
-unsigned long upto = 0;
+THREAD void * mempts[200000];
+THREAD unsigned long upto = 0;
 
 void * flint_stack_alloc(unsigned long length)
 {
@@ -167,6 +167,8 @@ THREAD limb_mem_t* last_mpn = NULL; //last record in linked list
 THREAD limb_memp_t* top_mpn = NULL; //top of stack of limb_memp_t's
 THREAD limb_memp_t* reservoir_mpn; //array of preallocated limb_memp_t's
 THREAD unsigned int rescount_mpn = 0; //counter for which limb_memp_t we are upto in the reservoir_mpn
+THREAD int initialised_mpn = 0; //has the reservoir_mpn been allocated
+THREAD unsigned int currentalloc_mpn = 0; //total number of limb_memp_t's in reservoir_mpn
    
 // todo: deal with possible out of memory situation when allocating
 
@@ -174,29 +176,27 @@ void* flint_stack_alloc(unsigned long length)
 {
    static THREAD limb_mem_t* curr;
    static THREAD limb_mem_t* temp;
-   static THREAD int initialised = 0; //has limb_alloc been initialised
-   static THREAD unsigned int currentalloc = 0; //total number of limb_memp_t's in reservoir_mpn
    static THREAD limb_memp_t* tempres;
    static THREAD int check=0;
    void* alloc_d;
    
    check++;
    //allocate another block of limb_memp_t's if none are currently allocated, or the reservoir_mpn is depleted
-   if (rescount_mpn==currentalloc) // need more limb_memp_t's
+   if (rescount_mpn==currentalloc_mpn) // need more limb_memp_t's
    {
-      if (!initialised) 
+      if (!initialised_mpn) 
       {
          reservoir_mpn = (limb_memp_t*)malloc(RESALLOC*sizeof(limb_memp_t));
          rescount_mpn=0;
-         initialised = 1;
-         currentalloc = RESALLOC;
+         initialised_mpn = 1;
+         currentalloc_mpn = RESALLOC;
       } else
       {
          //copy old reservoir_mpn into larger one
          tempres = reservoir_mpn;
-         reservoir_mpn = (limb_memp_t*)malloc((currentalloc+RESALLOC)*sizeof(limb_memp_t));  
-         memcpy(reservoir_mpn,tempres,currentalloc*sizeof(limb_memp_t)); 
-         currentalloc+=RESALLOC;
+         reservoir_mpn = (limb_memp_t*)malloc((currentalloc_mpn+RESALLOC)*sizeof(limb_memp_t));  
+         memcpy(reservoir_mpn,tempres,currentalloc_mpn*sizeof(limb_memp_t)); 
+         currentalloc_mpn+=RESALLOC;
          //free old reservoir_mpn
          free(tempres);  
       }       
@@ -400,7 +400,15 @@ void flint_stack_cleanup()
          curr = curr->next;
          free(temp);
       } while (curr != NULL);
+   }
+   
+   if (initialised_mpn)
+   {
       free(reservoir_mpn);
+      initialised_mpn = 0;
+      currentalloc_mpn = 0;
+      rescount_mpn = 0;
+      top_mpn = NULL;
    }
    
    if (block_ptr != NULL)
@@ -413,6 +421,8 @@ void flint_stack_cleanup()
       
       block_ptr -= 2;
       flint_heap_free(block_ptr);           
+      block_ptr = NULL;
+      block_left = 0;
    } 
 }
 
@@ -553,3 +563,98 @@ void flint_heap_free(void* block)
 }
 
 #endif
+
+/*-----------------------------------------------------------------------------------------------
+ 
+    Arena memory manager
+    
+------------------------------------------------------------------------------------------------*/
+
+#define FLINT_ARENA_MIN_CHUNK 1024L // minimum number of limbs in an arena chunk
+
+/*
+   Allocate a new chunk with space for at least the given number of limbs.
+*/
+flint_arena_chunk_t * _flint_arena_chunk_alloc(unsigned long limbs)
+{
+   flint_arena_chunk_t * chunk = (flint_arena_chunk_t *) 
+        flint_heap_alloc_bytes(sizeof(flint_arena_chunk_t) + limbs*sizeof(mp_limb_t));
+   chunk->length = limbs;
+   chunk->next = NULL;
+   
+   return chunk;
+}
+
+void flint_arena_init(flint_arena_t arena, unsigned long limbs)
+{
+   arena->head = _flint_arena_chunk_alloc(FLINT_MAX(limbs, FLINT_ARENA_MIN_CHUNK));
+   arena->curr = arena->head;
+   arena->used = 0;
+}
+
+void * flint_arena_alloc(flint_arena_t arena, unsigned long length)
+{
+   flint_arena_chunk_t * curr = arena->curr;
+   
+   if (arena->used + length > curr->length) // move to the next chunk
+   {
+      // chunks after curr are not in use, discard any which are too small
+      while (curr->next != NULL && curr->next->length < length)
+      {
+         flint_arena_chunk_t * temp = curr->next;
+         curr->next = temp->next;
+         flint_heap_free(temp);
+      }
+      
+      if (curr->next == NULL)
+      {
+         curr->next = _flint_arena_chunk_alloc(FLINT_MAX(length, 2*curr->length));
+      }
+      
+      arena->curr = curr = curr->next;
+      arena->used = 0;
+   }
+   
+   void * alloc_d = (void *) (curr->data + arena->used);
+   arena->used += length;
+   
+   return alloc_d;
+}
+
+void * flint_arena_alloc_bytes(flint_arena_t arena, unsigned long bytes)
+{
+   unsigned long limbs = (bytes + FLINT_BYTES_PER_LIMB - 1)/FLINT_BYTES_PER_LIMB;
+
+   return flint_arena_alloc(arena, limbs ? limbs : 1L); // zero bytes still gets a limb
+}
+
+flint_arena_mark_t flint_arena_mark(flint_arena_t arena)
+{
+   flint_arena_mark_t mark;
+   mark.chunk = arena->curr;
+   mark.used = arena->used;
+   
+   return mark;
+}
+
+void flint_arena_reset(flint_arena_t arena, flint_arena_mark_t mark)
+{
+   arena->curr = mark.chunk;
+   arena->used = mark.used;
+}
+
+void flint_arena_clear(flint_arena_t arena)
+{
+   flint_arena_chunk_t * curr = arena->head;
+   
+   while (curr != NULL)
+   {
+      flint_arena_chunk_t * temp = curr;
+      curr = curr->next;
+      flint_heap_free(temp);
+   }
+   
+   arena->head = NULL;
+   arena->curr = NULL;
+   arena->used = 0;
+}
@@ -31,6 +31,15 @@ Copyright (C) 2007, William Hart and David Harvey
 #ifdef __cplusplus
  extern "C" {
 #endif
+
+#include <gmp.h>
+
+/*
+   The stack based memory managers below keep their state per thread, so each
+   thread gets its own stack. Blocks must be released by the thread which 
+   allocated them, in the reverse order to which they were allocated. A thread
+   should call flint_stack_cleanup before it exits.
+*/
  
 void* flint_stack_alloc(unsigned long length);
 
@@ -54,6 +63,69 @@ void* flint_heap_realloc_bytes(void* block, unsigned long limbs);
 
 void flint_heap_free(void* block);
 
+/*
+   An arena is an explicit handle to a region of scratch memory. Allocations 
+   are carved out of a list of chunks, each at least twice the size of the 
+   previous one, and are released all at once by resetting the arena to a 
+   mark taken earlier. Chunks are retained on reset, so a thread which reuses
+   an arena for computations of similar size does no further malloc's. 
+
+   An arena must only be used by one thread at a time.
+*/
+
+typedef struct flint_arena_chunk_t
+{
+   unsigned long length; // number of limbs in data
+   struct flint_arena_chunk_t * next;
+   mp_limb_t data[];
+} flint_arena_chunk_t;
+
+typedef struct
+{
+   flint_arena_chunk_t * head; // first chunk
+   flint_arena_chunk_t * curr; // chunk from which allocations are being made
+   unsigned long used; // number of limbs of curr which are in use
+} flint_arena_struct;
+
+typedef flint_arena_struct flint_arena_t[1];
+
+typedef struct
+{
+   flint_arena_chunk_t * chunk;
+   unsigned long used;
+} flint_arena_mark_t;
+
+/*
+   Initialise an arena with an initial chunk of (at least) the given number of limbs.
+*/
+void flint_arena_init(flint_arena_t arena, unsigned long limbs);
+
+/*
+   Allocate the given number of limbs from the arena. 
+*/
+void * flint_arena_alloc(flint_arena_t arena, unsigned long length);
+
+/*
+   Allocate the given number of bytes, rounded up to a whole number of limbs
+   (at least one), from the arena.
+*/
+void * flint_arena_alloc_bytes(flint_arena_t arena, unsigned long bytes);
+
+/*
+   Return a mark recording the current top of the arena.
+*/
+flint_arena_mark_t flint_arena_mark(flint_arena_t arena);
+
+/*
+   Release everything allocated from the arena since the given mark was taken.
+*/
+void flint_arena_reset(flint_arena_t arena, flint_arena_mark_t mark);
+
+/*
+   Free all memory held by the arena.
+*/
+void flint_arena_clear(flint_arena_t arena);
+
 #ifdef __cplusplus
  }
 #endif
@@ -74,42 +74,53 @@ void mpfr_mat_print(mpfr_t ** B, int d, int n)
    printf("]\n"); 
 }
 
-int mpfr_vec_scalar_product(mpfr_t sp, mpfr_t * vec1, mpfr_t * vec2, int n)
+/*
+   tmp must point to three mpfr_t's, initialised by the caller. As mpfr's
+   default precision is per thread, this lets other threads work at the 
+   precision of the caller.
+*/
+int _mpfr_vec_scalar_product(mpfr_t sp, mpfr_t * vec1, mpfr_t * vec2, int n, mpfr_t * tmp)
 {
-  mpfr_t tmp, tmp2;
-  mpfr_init(tmp);
-  mpfr_init(tmp2);
-  
   int res;
 
   mpfr_mul(sp, vec1[0], vec2[0], GMP_RNDN);
   
   for (long i = 1; i < n; i++)
   {
-     mpfr_mul(tmp, vec1[i], vec2[i], GMP_RNDN);
-     mpfr_add(sp, sp, tmp, GMP_RNDN);
+     mpfr_mul(tmp[0], vec1[i], vec2[i], GMP_RNDN);
+     mpfr_add(sp, sp, tmp[0], GMP_RNDN);
   }
 
-  mpfr_vec_norm(tmp, vec1, n);
-  mpfr_vec_norm(tmp2, vec2, n);
-  mpfr_mul(tmp, tmp, tmp2, GMP_RNDN);
-  mpfr_div_2ui(tmp, tmp, 70, GMP_RNDN);
-  mpfr_mul(tmp2, sp, sp, GMP_RNDN);
+  _mpfr_vec_norm(tmp[0], vec1, n, tmp[2]);
+  _mpfr_vec_norm(tmp[1], vec2, n, tmp[2]);
+  mpfr_mul(tmp[0], tmp[0], tmp[1], GMP_RNDN);
+  mpfr_div_2ui(tmp[0], tmp[0], 70, GMP_RNDN);
+  mpfr_mul(tmp[1], sp, sp, GMP_RNDN);
 
-  if (mpfr_cmp(tmp2, tmp) <= 0) res = 0;
+  if (mpfr_cmp(tmp[1], tmp[0]) <= 0) res = 0;
   else res = 1;
 
-  mpfr_clear(tmp);
-  mpfr_clear(tmp2);
-
   return res;
 } 
 
-void mpfr_vec_norm(mpfr_t norm, mpfr_t * vec, int n)
+int mpfr_vec_scalar_product(mpfr_t sp, mpfr_t * vec1, mpfr_t * vec2, int n)
 {
-  mpfr_t tmp;
-  mpfr_init(tmp);
+  mpfr_t tmp[3];
+  mpfr_init(tmp[0]);
+  mpfr_init(tmp[1]);
+  mpfr_init(tmp[2]);
   
+  int res = _mpfr_vec_scalar_product(sp, vec1, vec2, n, tmp);
+
+  mpfr_clear(tmp[0]);
+  mpfr_clear(tmp[1]);
+  mpfr_clear(tmp[2]);
+
+  return res;
+} 
+
+void _mpfr_vec_norm(mpfr_t norm, mpfr_t * vec, int n, mpfr_t tmp)
+{
   mpfr_mul(norm, vec[0], vec[0], GMP_RNDN);
   
   for (long i = 1 ; i < n ; i++)
@@ -117,6 +128,14 @@ void mpfr_vec_norm(mpfr_t norm, mpfr_t * vec, int n)
      mpfr_mul(tmp, vec[i], vec[i], GMP_RNDN);
      mpfr_add(norm, norm, tmp, GMP_RNDN);
   }
+}
+
+void mpfr_vec_norm(mpfr_t norm, mpfr_t * vec, int n)
+{
+  mpfr_t tmp;
+  mpfr_init(tmp);
+  
+  _mpfr_vec_norm(norm, vec, n, tmp);
 
   mpfr_clear(tmp);
 
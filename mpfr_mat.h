@@ -29,7 +29,11 @@ void mpfr_mat_print(mpfr_t ** B, int d, int n);
 
 int mpfr_vec_scalar_product(mpfr_t sp, mpfr_t * vec1, mpfr_t * vec2, int n);
 
+int _mpfr_vec_scalar_product(mpfr_t sp, mpfr_t * vec1, mpfr_t * vec2, int n, mpfr_t * tmp);
+
 void mpfr_vec_norm(mpfr_t norm, mpfr_t * vec, int n);
 
+void _mpfr_vec_norm(mpfr_t norm, mpfr_t * vec, int n, mpfr_t tmp);
+
 
 
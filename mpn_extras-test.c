@@ -326,6 +326,71 @@ int test_F_mpn_mul()
    return result;
 }
 
+int test_F_mpn_mul_arena()
+{
+   mp_limb_t * int1, * int2, * product, * product2;
+   mp_limb_t msl, msl2;
+   flint_arena_t arena;
+   int result = 1;
+   
+   flint_arena_init(arena, 0);
+   
+   for (unsigned long count = 0; (count < 30) && (result == 1); count++)
+   {
+      unsigned long limbs2 = randint(2*FLINT_FFT_LIMBS_CROSSOVER)+1;
+      unsigned long limbs1 = limbs2 + randint(1000);
+   
+      int1 = (mp_limb_t *) malloc(sizeof(mp_limb_t)*limbs1);
+
+      mpn_random2(int1, limbs1);
+        
+      for (unsigned long count2 = 0; (count2 < 30) && (result == 1); count2++)
+      {    
+         int2 = (mp_limb_t *) malloc(sizeof(mp_limb_t)*limbs2);
+         product = (mp_limb_t *) malloc(sizeof(mp_limb_t)*(limbs1+limbs2));
+         product2 = (mp_limb_t *) malloc(sizeof(mp_limb_t)*(limbs1+limbs2));
+         
+         F_mpn_clear(int2, limbs2);
+         mpn_random2(int2, randint(limbs2-1)+1);
+      
+         flint_arena_mark_t mark = flint_arena_mark(arena);
+         
+         msl = F_mpn_mul_arena(product, int1, limbs1, int2, limbs2, arena);
+         
+         msl2 = mpn_mul(product2, int1, limbs1, int2, limbs2);
+      
+         for (unsigned long j = 0; j < limbs1+limbs2 - (msl == 0); j++)
+         {
+            if (product[j] != product2[j]) result = 0;
+         }
+         
+         result &= (msl == msl2);
+         
+         // the arena must have been returned to where it was
+         flint_arena_mark_t mark2 = flint_arena_mark(arena);
+         result &= ((mark.chunk == mark2.chunk) && (mark.used == mark2.used));
+         
+         unsigned long trunc = randint(limbs1+limbs2)+1;
+         F_mpn_mul_trunc_arena(product, int1, limbs1, int2, limbs2, trunc, arena);
+         
+         for (unsigned long j = 0; j < trunc; j++)
+         {
+            if (product[j] != product2[j]) result = 0;
+         }
+         
+         free(product2);
+         free(product);
+         free(int2);
+      }
+   
+      free(int1);
+   }   
+   
+   flint_arena_clear(arena);
+   
+   return result;
+}
+
 int test_F_mpn_mul_trunc()
 {
    mp_limb_t * int1, * int2, * product, * product2;
@@ -388,6 +453,7 @@ void F_mpn_test_all()
    RUN_TEST(F_mpn_splitcombine_bits);
    RUN_TEST(F_mpn_mul);
    RUN_TEST(F_mpn_mul_trunc);
+   RUN_TEST(F_mpn_mul_arena);
    RUN_TEST(F_mpn_mul_precache);
    RUN_TEST(F_mpn_mul_precache_trunc);
 
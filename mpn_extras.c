@@ -544,9 +544,18 @@ do { \
    } \
 } while (0)
 
-mp_limb_t __F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
-                                      const mp_limb_t * data2, const unsigned long limbs2, unsigned long log_length)
+/*
+   As per __F_mpn_mul, but the FFT polynomials are allocated from the given 
+   arena, if it is not NULL, otherwise from the heap.
+*/
+
+mp_limb_t __F_mpn_mul_arena(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
+                                      const mp_limb_t * data2, const unsigned long limbs2, unsigned long log_length,
+                                      flint_arena_struct * arena)
 {
+   flint_arena_mark_t mark;
+   if (arena) mark = flint_arena_mark(arena);
+
    unsigned long coeff_limbs = limbs1 + limbs2;
    unsigned long s1 = (FLINT_BIT_COUNT(data1[limbs1-1]) + FLINT_BIT_COUNT(data2[limbs2-1]) <= FLINT_BITS);
    unsigned long total_limbs = coeff_limbs - s1;
@@ -577,7 +586,8 @@ mp_limb_t __F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned l
    printf("%ld, %ld, %ld, %ld, %ld, %ld, %ld\n", bits, length1, length2, output_bits, coeff_limbs, n, log_length);
 #endif   
    ZmodF_poly_t poly1;
-   ZmodF_poly_init(poly1, log_length, n, 1);
+   if (arena) ZmodF_poly_arena_init(poly1, log_length, n, 1, arena);
+   else ZmodF_poly_init(poly1, log_length, n, 1);
    F_mpn_FFT_split_bits(poly1, data1, limbs1, bits, n);
    
    ulong length = length1 + length2 - 1;
@@ -593,13 +603,14 @@ mp_limb_t __F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned l
 	} else
 	{
 		ZmodF_poly_t poly2;
-      ZmodF_poly_init(poly2, log_length, n, 1);
+      if (arena) ZmodF_poly_arena_init(poly2, log_length, n, 1, arena);
+      else ZmodF_poly_init(poly2, log_length, n, 1);
       F_mpn_FFT_split_bits(poly2, data2, limbs2, bits, n);
 
       ZmodF_poly_FFT(poly2, length);
       
       ZmodF_poly_pointwise_mul(poly1, poly1, poly2);
-	   ZmodF_poly_clear(poly2);
+	   if (!arena) ZmodF_poly_clear(poly2);
 	}	
 		
    ZmodF_poly_IFFT(poly1);
@@ -610,15 +621,31 @@ mp_limb_t __F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned l
    F_mpn_clear(res, limbs1+limbs2);
    
    F_mpn_FFT_combine_bits(res, poly1, bits, n, total_limbs);
-   ZmodF_poly_clear(poly1);
+   if (arena) flint_arena_reset(arena, mark);
+   else ZmodF_poly_clear(poly1);
    
    return res[limbs1+limbs2-1];
 }
 
-mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+mp_limb_t __F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
+                                      const mp_limb_t * data2, const unsigned long limbs2, unsigned long log_length)
+{
+   return __F_mpn_mul_arena(res, data1, limbs1, data2, limbs2, log_length, NULL);
+}
+
+/*
+   As per __F_mpn_mul_trunc, but the FFT polynomials are allocated from the 
+   given arena, if it is not NULL, otherwise from the stack.
+*/
+
+mp_limb_t __F_mpn_mul_trunc_arena(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
                                       mp_limb_t * data2, unsigned long limbs2, 
-                                      unsigned long log_length, unsigned long trunc)
+                                      unsigned long log_length, unsigned long trunc,
+                                      flint_arena_struct * arena)
 {
+   flint_arena_mark_t mark;
+   if (arena) mark = flint_arena_mark(arena);
+
    unsigned long length = 1;
    
    unsigned long coeff_limbs = limbs1 + limbs2;
@@ -651,7 +678,8 @@ mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long li
    printf("%ld, %ld, %ld, %ld, %ld, %ld\n", bits, length1, length2, output_bits, coeff_limbs, n);
 #endif   
    ZmodF_poly_t poly1;
-   ZmodF_poly_stack_init(poly1, log_length, n, 1);
+   if (arena) ZmodF_poly_arena_init(poly1, log_length, n, 1, arena);
+   else ZmodF_poly_stack_init(poly1, log_length, n, 1);
    F_mpn_FFT_split_bits(poly1, data1, limbs1, bits, n);
    
    if ((data1 == data2) && (limbs1 == limbs2))
@@ -663,12 +691,13 @@ mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long li
    {
       // distinct operands case
       ZmodF_poly_t poly2;
-      ZmodF_poly_stack_init(poly2, log_length, n, 1);
+      if (arena) ZmodF_poly_arena_init(poly2, log_length, n, 1, arena);
+      else ZmodF_poly_stack_init(poly2, log_length, n, 1);
       F_mpn_FFT_split_bits(poly2, data2, limbs2, bits, n);
 
       ZmodF_poly_convolution_range(poly1, poly1, poly2, 0, (trunc*FLINT_BITS-1)/bits+1);
 
-      ZmodF_poly_stack_clear(poly2);
+      if (!arena) ZmodF_poly_stack_clear(poly2);
    }
    
    poly1->length = FLINT_MIN(poly1->length, (trunc*FLINT_BITS-1)/bits+1);
@@ -677,11 +706,19 @@ mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long li
    F_mpn_clear(res, trunc);
    
    F_mpn_FFT_combine_bits(res, poly1, bits, n, trunc);
-   ZmodF_poly_stack_clear(poly1);
+   if (arena) flint_arena_reset(arena, mark);
+   else ZmodF_poly_stack_clear(poly1);
    
    return res[trunc-1];
 }
 
+mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+                                      mp_limb_t * data2, unsigned long limbs2, 
+                                      unsigned long log_length, unsigned long trunc)
+{
+   return __F_mpn_mul_trunc_arena(res, data1, limbs1, data2, limbs2, log_length, trunc, NULL);
+}
+
 /*
    Multiply two integers in mpn format
    
@@ -693,8 +730,9 @@ mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long li
    Assumes neither of limbs1, limbs2 is zero. 
 */
 
-mp_limb_t F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
-                                      const mp_limb_t * data2, const unsigned long limbs2)
+mp_limb_t F_mpn_mul_arena(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
+                                      const mp_limb_t * data2, const unsigned long limbs2,
+                                      flint_arena_struct * arena)
 {
    unsigned long coeff_limbs = limbs1 + limbs2;
    unsigned long twk;
@@ -729,7 +767,13 @@ mp_limb_t F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned lon
    }
 
 
-   return __F_mpn_mul(res, data1, limbs1, data2, limbs2, twk);
+   return __F_mpn_mul_arena(res, data1, limbs1, data2, limbs2, twk, arena);
+}
+
+mp_limb_t F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
+                                      const mp_limb_t * data2, const unsigned long limbs2)
+{
+   return F_mpn_mul_arena(res, data1, limbs1, data2, limbs2, NULL);
 }
 
 /*
@@ -740,8 +784,9 @@ mp_limb_t F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned lon
    limbs allocated and we must have limbs1 >= limbs2 >= 1.
 */
 
-mp_limb_t F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
-                        mp_limb_t * data2, unsigned long limbs2, unsigned long trunc)
+mp_limb_t F_mpn_mul_trunc_arena(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+                        mp_limb_t * data2, unsigned long limbs2, unsigned long trunc,
+                        flint_arena_struct * arena)
 {
    unsigned long coeff_limbs = limbs1 + limbs2;
    if (trunc > coeff_limbs) trunc = coeff_limbs;
@@ -781,7 +826,13 @@ mp_limb_t F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limb
    }
 
 
-   return __F_mpn_mul_trunc(res, data1, limbs1, data2, limbs2, twk, trunc);
+   return __F_mpn_mul_trunc_arena(res, data1, limbs1, data2, limbs2, twk, trunc, arena);
+}
+
+mp_limb_t F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+                        mp_limb_t * data2, unsigned long limbs2, unsigned long trunc)
+{
+   return F_mpn_mul_trunc_arena(res, data1, limbs1, data2, limbs2, trunc, NULL);
 }
 
 /*   
@@ -177,12 +177,43 @@ mp_limb_t __F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned l
                                       const mp_limb_t * data2, const unsigned long limbs2, 
                                       unsigned long twk);
 
+mp_limb_t __F_mpn_mul_arena(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
+                                      const mp_limb_t * data2, const unsigned long limbs2, 
+                                      unsigned long twk, flint_arena_struct * arena);
+
 mp_limb_t F_mpn_mul(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
                                       const mp_limb_t * data2, const unsigned long limbs2);
+
+/*
+   As per F_mpn_mul, but any scratch space for the FFT is taken from the given 
+   arena (which is returned to its original state) rather than the heap. 
+   If arena is NULL this is the same as F_mpn_mul.
+*/
+mp_limb_t F_mpn_mul_arena(mp_limb_t * res, const mp_limb_t * data1, const unsigned long limbs1, 
+                                      const mp_limb_t * data2, const unsigned long limbs2,
+                                      flint_arena_struct * arena);
                                       
+mp_limb_t __F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+                                      mp_limb_t * data2, unsigned long limbs2, 
+                                      unsigned long twk, unsigned long trunc);
+
+mp_limb_t __F_mpn_mul_trunc_arena(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+                                      mp_limb_t * data2, unsigned long limbs2, 
+                                      unsigned long twk, unsigned long trunc, 
+                                      flint_arena_struct * arena);
+
 mp_limb_t F_mpn_mul_trunc(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
                         mp_limb_t * data2, unsigned long limbs2, unsigned long trunc);
 
+/*
+   As per F_mpn_mul_trunc, but any scratch space for the FFT is taken from the 
+   given arena rather than the flint stack. If arena is NULL this is the same 
+   as F_mpn_mul_trunc.
+*/
+mp_limb_t F_mpn_mul_trunc_arena(mp_limb_t * res, mp_limb_t * data1, unsigned long limbs1, 
+                        mp_limb_t * data2, unsigned long limbs2, unsigned long trunc,
+                        flint_arena_struct * arena);
+
 void F_mpn_mul_precache_init(F_mpn_precache_t precache, mp_limb_t * data1, unsigned long limbs1, unsigned long limbs2);
 
 void F_mpn_mul_precache_clear(F_mpn_precache_t precache);
@@ -0,0 +1,100 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/****************************************************************************
+
+thread-support.c: Support code for multithreaded functions
+
+
+*****************************************************************************/
+
+#include <stdio.h>
+#include <pthread.h>
+#include "flint.h"
+#include "memory-manager.h"
+#include "F_mpz.h"
+#include "thread-support.h"
+
+unsigned long flint_num_threads = 1;
+
+// nonzero if the current thread is running a function for flint_parallel_do
+FLINT_TLS int flint_in_parallel = 0;
+
+void flint_set_num_threads(unsigned long num)
+{
+   flint_num_threads = FLINT_MAX(num, 1L);
+}
+
+unsigned long flint_get_num_threads(void)
+{
+   return flint_in_parallel ? 1 : flint_num_threads;
+}
+
+typedef struct
+{
+   void (*fn)(void *);
+   void * arg;
+} flint_thread_arg_t;
+
+void * _flint_thread_start(void * arg_void)
+{
+   flint_thread_arg_t * arg = (flint_thread_arg_t *) arg_void;
+   
+   flint_in_parallel = 1;
+   arg->fn(arg->arg);
+
+   flint_stack_cleanup();
+   _F_mpz_cleanup_thread();
+
+   return NULL;
+}
+
+void flint_parallel_do(void (*fn)(void *), void * args, size_t size, unsigned long num)
+{
+   if (num <= 1)
+   {
+      if (num == 1) fn(args);
+      return;
+   }
+
+   pthread_t * threads = (pthread_t *) flint_heap_alloc_bytes((num - 1)*sizeof(pthread_t));
+   flint_thread_arg_t * targs = (flint_thread_arg_t *) flint_heap_alloc_bytes((num - 1)*sizeof(flint_thread_arg_t));
+   
+   for (unsigned long i = 1; i < num; i++)
+   {
+      targs[i - 1].fn = fn;
+      targs[i - 1].arg = (char *) args + i*size;
+      if (pthread_create(threads + i - 1, NULL, _flint_thread_start, targs + i - 1))
+      {
+         printf("Error: unable to create thread in flint_parallel_do\n");
+         abort();
+      }
+   }
+
+   int in_parallel = flint_in_parallel;
+   flint_in_parallel = 1;
+   fn(args);
+   flint_in_parallel = in_parallel;
+
+   for (unsigned long i = 1; i < num; i++)
+      pthread_join(threads[i - 1], NULL);
+
+   flint_heap_free(targs);
+   flint_heap_free(threads);
+}
@@ -0,0 +1,62 @@
+/*============================================================================
+
+    This file is part of FLINT.
+
+    FLINT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLINT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLINT; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+
+===============================================================================*/
+/****************************************************************************
+
+thread-support.h: Support code for multithreaded functions
+
+
+*****************************************************************************/
+
+#ifndef FLINT_THREAD_SUPPORT_H
+#define FLINT_THREAD_SUPPORT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdlib.h>
+#include "flint.h"
+
+/*
+   Set the maximum number of threads which FLINT functions with a parallel
+   mode may use. The default is 1, in which case all functions run serially
+   in the calling thread.
+*/
+void flint_set_num_threads(unsigned long num);
+
+/*
+   Returns the number of threads set by flint_set_num_threads, or 1 when 
+   called from a function being run by flint_parallel_do, so that nested
+   parallel code runs serially.
+*/
+unsigned long flint_get_num_threads(void);
+
+/*
+   Calls fn(args + i*size) for i = 0, ..., num - 1, each in its own thread,
+   and waits for all calls to return. Call 0 is made in the calling thread.
+   The other threads release their flint stack and F_mpz pool before exiting.
+*/
+void flint_parallel_do(void (*fn)(void *), void * args, size_t size, unsigned long num);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -35,7 +35,9 @@ Copyright (C) 2008, Richard Howell-Peak
 #include "memory-manager.h"
 #include "test-support.h"
 #include "zmod_poly.h"
+#include "thread-support.h"
 #include "long_extras.h"
+#include "binary-io.h"
 #include "mpz_poly.h"
 
 #define VARY_BITS 1
@@ -381,6 +383,92 @@ int test_zmod_poly_fprint_fread()
    return result; 
 }
   
+int test_zmod_poly_fwrite_fread_binary()
+{
+   zmod_poly_t poly, poly2, poly3;
+   int result = 1;
+   unsigned long bits, length;
+	
+   for (unsigned long count1 = 0; (count1 < 5000) && (result == 1) ; count1++)
+   {
+      bits = randint(FLINT_BITS-1)+2;
+      unsigned long modulus;
+      
+      do {modulus = randbits(bits);} while (modulus < 2);
+      
+      zmod_poly_init(poly, modulus);
+      
+      length = randint(100);
+
+#if DEBUG
+      printf("length = %ld, bits = %ld\n", length, bits);
+#endif
+
+      randpoly(poly, length, modulus); 
+                
+      FILE * file = fopen("tmp", "wb");
+		zmod_poly_fwrite_binary(poly, file);
+		fclose(file);
+      file = fopen("tmp", "rb");
+		result = zmod_poly_fread_binary(poly2, file);
+		fclose(file);
+      
+      if (result)
+      {
+         result = (zmod_poly_equal(poly2, poly) && (poly2->p == modulus));
+		   zmod_poly_clear(poly2);
+      }
+
+      if (result) // attach directly to the file
+      {
+         result = zmod_poly_mmap(poly3, "tmp");
+         if (result)
+         {
+            result = (zmod_poly_equal(poly3, poly) && (poly3->p == modulus));
+            zmod_poly_munmap(poly3);
+         }
+      }
+
+		if (!result)
+		{
+			printf("Error: length = %ld, bits = %ld\n", length, bits);
+		}
+      
+      zmod_poly_clear(poly);
+   }
+   
+   // a modulus below 2 in the header must be rejected
+   for (unsigned long modulus = 0; (modulus < 2) && (result == 1); modulus++)
+   {
+      flint_binary_header_t header;
+      unsigned long data[FLINT_BINARY_HEADER_BYTES/sizeof(unsigned long) + 1];
+      
+      header->type = FLINT_BINARY_ZMOD_POLY;
+      header->length = 1;
+      header->bits = 1;
+      header->modulus = modulus;
+      header->limbs = 1;
+      
+      FILE * file = fopen("tmp", "wb");
+      flint_binary_header_fwrite(header, file);
+      flint_binary_limbs_fwrite(&modulus, 1, file);
+		fclose(file);
+      file = fopen("tmp", "rb");
+		result = !zmod_poly_fread_binary(poly2, file);
+		fclose(file);
+      
+      flint_binary_header_pack((unsigned char *) data, header);
+      if (result) result = !zmod_poly_attach_binary(poly3, data, sizeof(data));
+      
+      if (!result)
+		{
+			printf("Error: modulus = %ld was accepted\n", modulus);
+		}
+   }
+         
+   return result; 
+}
+  
 int test_zmod_poly_addsub()
 {
    int result = 1;
@@ -9125,12 +9213,318 @@ int test_zmod_poly_compose_horner()
    return result;
 }
 
+/* Generate a random batch of num polynomials of length at most length, with
+   random primes of at most FLINT_BITS - 2 bits, and set polys to copies of
+   the polynomials, initialising them */
+
+void randbatch(zmod_poly_batch_t batch, zmod_poly_t * polys, 
+                        unsigned long num, unsigned long length)
+{
+   unsigned long * primes = (unsigned long *) malloc(num*sizeof(unsigned long));
+   
+   for (unsigned long j = 0; j < num; j++)
+   {
+      do {primes[j] = randprime(randint(FLINT_BITS-2)+2);} while (primes[j] < 2);
+      zmod_poly_init(polys[j], primes[j]);
+   }
+   
+   zmod_poly_batch_init(batch, primes, num, randint(length + 1));
+   
+   for (unsigned long j = 0; j < num; j++)
+   {
+      randpoly(polys[j], randint(length + 1), primes[j]);
+      zmod_poly_batch_set_poly(batch, j, polys[j]);
+   }
+   
+   free(primes);
+}
+
+/* Set a batch with the same primes as batch2 to random polynomials of length
+   at most length, and polys to copies of them */
+
+void randbatch_moduli(zmod_poly_batch_t batch, zmod_poly_t * polys, 
+                        zmod_poly_batch_t batch2, unsigned long length)
+{
+   zmod_poly_batch_init_moduli(batch, batch2, 0);
+   
+   for (unsigned long j = 0; j < batch->num; j++)
+   {
+      zmod_poly_init(polys[j], batch->p[j]);
+      randpoly(polys[j], randint(length + 1), batch->p[j]);
+      zmod_poly_batch_set_poly(batch, j, polys[j]);
+   }
+}
+
+int test_zmod_poly_batch_getset_poly()
+{
+   int result = 1;
+   zmod_poly_batch_t batch;
+   zmod_poly_t polys[8];
+   zmod_poly_t poly;
+   
+   for (unsigned long count1 = 0; (count1 < 2000) && (result == 1); count1++)
+   {
+      unsigned long num = randint(8) + 1;
+      
+      randbatch(batch, polys, num, randint(100));
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly, batch->p[j]);
+         zmod_poly_batch_get_poly(poly, batch, j);
+         result &= zmod_poly_equal(poly, polys[j]);
+         zmod_poly_clear(poly);
+      }
+      
+      for (unsigned long j = 0; j < num; j++)
+         zmod_poly_clear(polys[j]);
+      zmod_poly_batch_clear(batch);
+   }
+   
+   return result;
+}
+
+int test_zmod_poly_batch_addsub()
+{
+   int result = 1;
+   zmod_poly_batch_t batch1, batch2, res;
+   zmod_poly_t polys1[8], polys2[8];
+   zmod_poly_t poly1, poly2;
+   
+   for (unsigned long count1 = 0; (count1 < 2000) && (result == 1); count1++)
+   {
+      unsigned long num = randint(8) + 1;
+      
+      randbatch(batch1, polys1, num, randint(100));
+      randbatch_moduli(batch2, polys2, batch1, randint(100));
+      zmod_poly_batch_init_moduli(res, batch1, randint(100));
+      
+      zmod_poly_batch_add(res, batch1, batch2);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly1, batch1->p[j]);
+         zmod_poly_init(poly2, batch1->p[j]);
+         zmod_poly_add(poly1, polys1[j], polys2[j]);
+         zmod_poly_batch_get_poly(poly2, res, j);
+         result &= zmod_poly_equal(poly1, poly2);
+         zmod_poly_clear(poly1);
+         zmod_poly_clear(poly2);
+      }
+      
+      // test aliasing
+      zmod_poly_batch_sub(batch1, batch1, batch2);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly1, batch1->p[j]);
+         zmod_poly_init(poly2, batch1->p[j]);
+         zmod_poly_sub(poly1, polys1[j], polys2[j]);
+         zmod_poly_batch_get_poly(poly2, batch1, j);
+         result &= zmod_poly_equal(poly1, poly2);
+         zmod_poly_clear(poly1);
+         zmod_poly_clear(poly2);
+      }
+      
+      for (unsigned long j = 0; j < num; j++)
+      {
+         zmod_poly_clear(polys1[j]);
+         zmod_poly_clear(polys2[j]);
+      }
+      zmod_poly_batch_clear(batch1);
+      zmod_poly_batch_clear(batch2);
+      zmod_poly_batch_clear(res);
+   }
+   
+   return result;
+}
+
+int test_zmod_poly_batch_mul()
+{
+   int result = 1;
+   zmod_poly_batch_t batch1, batch2, res;
+   zmod_poly_t polys1[8], polys2[8];
+   zmod_poly_t poly1, poly2;
+   
+   for (unsigned long count1 = 0; (count1 < 1000) && (result == 1); count1++)
+   {
+      unsigned long num = randint(8) + 1;
+      
+      flint_set_num_threads(randint(4) + 1);
+      
+      randbatch(batch1, polys1, num, randint(1000));
+      randbatch_moduli(batch2, polys2, batch1, randint(1000));
+      zmod_poly_batch_init_moduli(res, batch1, 0);
+      
+      zmod_poly_batch_mul(res, batch1, batch2);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly1, batch1->p[j]);
+         zmod_poly_init(poly2, batch1->p[j]);
+         zmod_poly_mul(poly1, polys1[j], polys2[j]);
+         zmod_poly_batch_get_poly(poly2, res, j);
+         result &= zmod_poly_equal(poly1, poly2);
+         zmod_poly_clear(poly1);
+         zmod_poly_clear(poly2);
+      }
+      
+      // test aliasing
+      zmod_poly_batch_mul(batch1, batch1, batch1);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly1, batch1->p[j]);
+         zmod_poly_init(poly2, batch1->p[j]);
+         zmod_poly_mul(poly1, polys1[j], polys1[j]);
+         zmod_poly_batch_get_poly(poly2, batch1, j);
+         result &= zmod_poly_equal(poly1, poly2);
+         zmod_poly_clear(poly1);
+         zmod_poly_clear(poly2);
+      }
+      
+      for (unsigned long j = 0; j < num; j++)
+      {
+         zmod_poly_clear(polys1[j]);
+         zmod_poly_clear(polys2[j]);
+      }
+      zmod_poly_batch_clear(batch1);
+      zmod_poly_batch_clear(batch2);
+      zmod_poly_batch_clear(res);
+   }
+   
+   flint_set_num_threads(1);
+   
+   return result;
+}
+
+int test_zmod_poly_batch_mulmod()
+{
+   int result = 1;
+   zmod_poly_batch_t batch1, batch2, f, res;
+   zmod_poly_batch_modulus_t mod;
+   zmod_poly_t polys1[8], polys2[8], fs[8];
+   zmod_poly_t poly1, poly2;
+   
+   for (unsigned long count1 = 0; (count1 < 1000) && (result == 1); count1++)
+   {
+      unsigned long num = randint(8) + 1;
+      
+      flint_set_num_threads(randint(4) + 1);
+      
+      randbatch(f, fs, num, randint(400) + 1);
+      for (unsigned long j = 0; j < num; j++)
+      {
+         while (zmod_poly_is_zero(fs[j]))
+            randpoly(fs[j], randint(400) + 1, f->p[j]);
+         zmod_poly_batch_set_poly(f, j, fs[j]);
+      }
+      zmod_poly_batch_modulus_init(mod, f);
+      
+      randbatch_moduli(batch1, polys1, f, randint(400));
+      randbatch_moduli(batch2, polys2, f, randint(400));
+      zmod_poly_batch_init_moduli(res, f, 0);
+      
+      zmod_poly_batch_mulmod(res, batch1, batch2, mod);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly1, f->p[j]);
+         zmod_poly_init(poly2, f->p[j]);
+         zmod_poly_mulmod(poly1, polys1[j], polys2[j], fs[j]);
+         zmod_poly_batch_get_poly(poly2, res, j);
+         result &= zmod_poly_equal(poly1, poly2);
+         zmod_poly_clear(poly1);
+         zmod_poly_clear(poly2);
+      }
+      
+      for (unsigned long j = 0; j < num; j++)
+      {
+         zmod_poly_clear(polys1[j]);
+         zmod_poly_clear(polys2[j]);
+         zmod_poly_clear(fs[j]);
+      }
+      zmod_poly_batch_modulus_clear(mod);
+      zmod_poly_batch_clear(batch1);
+      zmod_poly_batch_clear(batch2);
+      zmod_poly_batch_clear(f);
+      zmod_poly_batch_clear(res);
+   }
+   
+   flint_set_num_threads(1);
+   
+   return result;
+}
+
+int test_zmod_poly_batch_powmod()
+{
+   int result = 1;
+   zmod_poly_batch_t batch, f;
+   zmod_poly_batch_modulus_t mod;
+   zmod_poly_t polys[8], fs[8];
+   zmod_poly_t poly1, poly2;
+   
+   for (unsigned long count1 = 0; (count1 < 500) && (result == 1); count1++)
+   {
+      unsigned long num = randint(8) + 1;
+      unsigned long exp = randint(1000);
+      
+      flint_set_num_threads(randint(4) + 1);
+      
+      randbatch(f, fs, num, randint(100) + 1);
+      for (unsigned long j = 0; j < num; j++)
+      {
+         while (zmod_poly_is_zero(fs[j]))
+            randpoly(fs[j], randint(100) + 1, f->p[j]);
+         zmod_poly_batch_set_poly(f, j, fs[j]);
+      }
+      zmod_poly_batch_modulus_init(mod, f);
+      
+      randbatch_moduli(batch, polys, f, randint(100));
+      
+      // test aliasing
+      zmod_poly_batch_powmod(batch, batch, exp, mod);
+      
+      for (unsigned long j = 0; (j < num) && (result == 1); j++)
+      {
+         zmod_poly_init(poly1, f->p[j]);
+         zmod_poly_init(poly2, f->p[j]);
+         if (fs[j]->length == 1) zmod_poly_zero(poly1);
+         else
+         {
+            zmod_poly_divrem(poly2, polys[j], polys[j], fs[j]);
+            if ((exp != 0) || (polys[j]->length))
+               zmod_poly_powmod(poly1, polys[j], exp, fs[j]);
+            else zmod_poly_set_coeff_ui(poly1, 0, 1L);
+         }
+         zmod_poly_batch_get_poly(poly2, batch, j);
+         result &= zmod_poly_equal(poly1, poly2);
+         zmod_poly_clear(poly1);
+         zmod_poly_clear(poly2);
+      }
+      
+      for (unsigned long j = 0; j < num; j++)
+      {
+         zmod_poly_clear(polys[j]);
+         zmod_poly_clear(fs[j]);
+      }
+      zmod_poly_batch_modulus_clear(mod);
+      zmod_poly_batch_clear(batch);
+      zmod_poly_batch_clear(f);
+   }
+   
+   flint_set_num_threads(1);
+   
+   return result;
+}
+
 void zmod_poly_test_all()
 {
    int success, all_success = 1;
 
 #if TESTFILE
 	RUN_TEST(zmod_poly_fprint_fread); 
+	RUN_TEST(zmod_poly_fwrite_fread_binary); 
 #endif
    RUN_TEST(zmod_poly_to_from_string); 
    RUN_TEST(__zmod_poly_normalise); 
@@ -9209,6 +9603,11 @@ void zmod_poly_test_all()
    RUN_TEST(zmod_poly_factor); 
    RUN_TEST(zmod_poly_2x2_mat_mul_classical_strassen); 
    RUN_TEST(zmod_poly_2x2_mat_mul);
+   RUN_TEST(zmod_poly_batch_getset_poly);
+   RUN_TEST(zmod_poly_batch_addsub);
+   RUN_TEST(zmod_poly_batch_mul);
+   RUN_TEST(zmod_poly_batch_mulmod);
+   RUN_TEST(zmod_poly_batch_powmod);
    
    printf(all_success ? "\nAll tests passed\n" :
                         "\nAt least one test FAILED!\n");
@@ -27,8 +27,15 @@
    
 *****************************************************************************/
 
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include "zmod_poly.h"
 #include "zmod_mat.h"
+#include "binary-io.h"
+#include "thread-support.h"
 #include "long_extras.h"
 #include "longlong_wrapper.h"
 #include "longlong.h"
@@ -331,6 +338,138 @@ int zmod_poly_read(zmod_poly_t poly)
    return zmod_poly_fread(poly, stdin);
 }
 
+/****************************************************************************
+
+   Binary I/O
+
+****************************************************************************/
+
+/*
+   Write poly to f in the binary format of binary-io.h. The payload consists 
+   of the coefficients, one limb each.
+*/
+
+int zmod_poly_fwrite_binary(zmod_poly_t poly, FILE* f)
+{
+   flint_binary_header_t header;
+   
+   header->type = FLINT_BINARY_ZMOD_POLY;
+   header->length = poly->length;
+   header->bits = zmod_poly_bits(poly);
+   header->modulus = poly->p;
+   header->limbs = 1;
+
+   if (!flint_binary_header_fwrite(header, f)) return 0;
+
+   return flint_binary_limbs_fwrite(poly->coeffs, poly->length, f);
+}
+
+/*
+   Create a zmod_poly from the binary representation in file f. As for 
+   zmod_poly_fread, poly should not be initialised.
+*/
+
+int zmod_poly_fread_binary(zmod_poly_t poly, FILE* f)
+{
+   flint_binary_header_t header;
+
+   if (!flint_binary_header_fread(header, f)) return 0;
+   if ((header->type != FLINT_BINARY_ZMOD_POLY) || (header->limbs != 1)) return 0;
+   if (header->modulus < 2) return 0;
+
+   zmod_poly_init2(poly, header->modulus, FLINT_MAX(header->length, 1));
+   
+   if (!flint_binary_limbs_fread(poly->coeffs, header->length, f)) 
+   {
+      zmod_poly_clear(poly);
+      return 0;
+   }
+   poly->length = header->length;
+
+   __zmod_poly_normalise(poly);
+   
+   return 1;
+}
+
+/*
+   Attach poly to the binary representation of a zmod_poly at data, which is 
+   size bytes long, without copying the coefficients. The data must be limb 
+   aligned and remain valid until poly is detached with zmod_poly_detach_binary. 
+   The poly can be used wherever it is not resized and it must not be cleared 
+   with zmod_poly_clear. Fails if the host is not little endian.
+*/
+
+int zmod_poly_attach_binary(zmod_poly_t poly, void * data, size_t size)
+{
+   flint_binary_header_t header;
+
+   if (FLINT_BIG_ENDIAN) return 0;
+   if (size < FLINT_BINARY_HEADER_BYTES) return 0;
+   if (((size_t) data) % sizeof(unsigned long)) return 0;
+   if (!flint_binary_header_unpack(header, (unsigned char *) data)) return 0;
+   if ((header->type != FLINT_BINARY_ZMOD_POLY) || (header->limbs != 1)) return 0;
+   if (header->modulus < 2) return 0;
+   if ((size - FLINT_BINARY_HEADER_BYTES)/sizeof(unsigned long) < header->length) return 0;
+
+   poly->coeffs = (unsigned long *) ((char *) data + FLINT_BINARY_HEADER_BYTES);
+   poly->p = header->modulus;
+   poly->p_inv = z_precompute_inverse(header->modulus);
+   poly->alloc = (size - FLINT_BINARY_HEADER_BYTES)/sizeof(unsigned long);
+   poly->length = header->length;
+#if USE_ZN_POLY
+   zn_mod_init(poly->mod, poly->p);
+#endif
+
+   return 1;
+}
+
+void zmod_poly_detach_binary(zmod_poly_t poly)
+{
+#if USE_ZN_POLY
+   zn_mod_clear(poly->mod);
+#endif
+}
+
+/*
+   Map the file with the given name into memory and attach poly to it. The
+   mapping is private, so any changes made to the coefficients of poly are 
+   not written back to the file. The poly must be released with 
+   zmod_poly_munmap, and is otherwise subject to the same restrictions as
+   for zmod_poly_attach_binary.
+*/
+
+int zmod_poly_mmap(zmod_poly_t poly, const char * name)
+{
+   int fd = open(name, O_RDONLY);
+   if (fd < 0) return 0;
+   
+   off_t size = lseek(fd, 0, SEEK_END);
+   if (size < FLINT_BINARY_HEADER_BYTES) 
+   {
+      close(fd);
+      return 0;
+   }
+   
+   void * data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED) return 0;
+   
+   if (!zmod_poly_attach_binary(poly, data, size))
+   {
+      munmap(data, size);
+      return 0;
+   }
+
+   return 1;
+}
+
+void zmod_poly_munmap(zmod_poly_t poly)
+{
+   munmap((char *) poly->coeffs - FLINT_BINARY_HEADER_BYTES, 
+          FLINT_BINARY_HEADER_BYTES + poly->alloc*sizeof(unsigned long));
+   zmod_poly_detach_binary(poly);
+}
+
 
 /****************************************************************************
 
@@ -7077,3 +7216,736 @@ void zmod_poly_2x2_mat_mul(zmod_poly_2x2_mat_t R, zmod_poly_2x2_mat_t A,
 	}
 }
 
+/****************************************************************************
+
+   Batches of polynomials over many primes
+
+****************************************************************************/
+
+void zmod_poly_batch_init(zmod_poly_batch_t batch, unsigned long * primes, 
+                                      unsigned long num, unsigned long alloc)
+{
+   FLINT_ASSERT(num >= 1);
+   
+   batch->num = num;
+   batch->alloc = alloc;
+   batch->length = 0;
+   
+   if (alloc) batch->coeffs = (unsigned long *) flint_heap_alloc(num*alloc);
+   else batch->coeffs = NULL;
+   
+   batch->p = (unsigned long *) flint_heap_alloc(num);
+   batch->p_inv = (double *) flint_heap_alloc_bytes(num*sizeof(double));
+#if USE_ZN_POLY
+   batch->mod = (zn_mod_struct *) flint_heap_alloc_bytes(num*sizeof(zn_mod_struct));
+#endif
+
+   for (unsigned long j = 0; j < num; j++)
+   {
+      batch->p[j] = primes[j];
+      batch->p_inv[j] = z_precompute_inverse(primes[j]);
+#if USE_ZN_POLY
+      zn_mod_init(batch->mod + j, primes[j]);
+#endif
+   }
+}
+
+/*
+   Initialise batch with the same primes as batch2, copying the precomputed
+   data for them rather than recomputing it.
+*/
+
+void zmod_poly_batch_init_moduli(zmod_poly_batch_t batch, zmod_poly_batch_t batch2, 
+                                                               unsigned long alloc)
+{
+   unsigned long num = batch2->num;
+   
+   batch->num = num;
+   batch->alloc = alloc;
+   batch->length = 0;
+   
+   if (alloc) batch->coeffs = (unsigned long *) flint_heap_alloc(num*alloc);
+   else batch->coeffs = NULL;
+   
+   batch->p = (unsigned long *) flint_heap_alloc(num);
+   batch->p_inv = (double *) flint_heap_alloc_bytes(num*sizeof(double));
+   memcpy(batch->p, batch2->p, num*sizeof(unsigned long));
+   memcpy(batch->p_inv, batch2->p_inv, num*sizeof(double));
+#if USE_ZN_POLY
+   batch->mod = (zn_mod_struct *) flint_heap_alloc_bytes(num*sizeof(zn_mod_struct));
+   memcpy(batch->mod, batch2->mod, num*sizeof(zn_mod_struct));
+#endif
+}
+
+void zmod_poly_batch_clear(zmod_poly_batch_t batch)
+{
+   if (batch->coeffs) flint_heap_free(batch->coeffs);
+   flint_heap_free(batch->p);
+   flint_heap_free(batch->p_inv);
+#if USE_ZN_POLY
+   for (unsigned long j = 0; j < batch->num; j++)
+      zn_mod_clear(batch->mod + j);
+   flint_heap_free(batch->mod);
+#endif
+}
+
+/*
+   Ensure each polynomial of the batch has space for at least alloc 
+   coefficients. As the polynomials are stored one after the other, they 
+   all have to be moved, so the allocation is at least doubled.
+*/
+
+void zmod_poly_batch_fit_length(zmod_poly_batch_t batch, unsigned long alloc)
+{
+   if (alloc <= batch->alloc) return;
+   
+   if (alloc < 2*batch->alloc) alloc = 2*batch->alloc;
+   
+   unsigned long * coeffs = (unsigned long *) flint_heap_alloc(batch->num*alloc);
+   
+   for (unsigned long j = 0; j < batch->num; j++)
+      memcpy(coeffs + j*alloc, batch->coeffs + j*batch->alloc, batch->length*sizeof(unsigned long));
+   
+   if (batch->coeffs) flint_heap_free(batch->coeffs);
+   batch->coeffs = coeffs;
+   batch->alloc = alloc;
+}
+
+/*
+   Set the length of the batch, padding all the polynomials with zeroes 
+   if it grows.
+*/
+
+void zmod_poly_batch_set_length(zmod_poly_batch_t batch, unsigned long length)
+{
+   zmod_poly_batch_fit_length(batch, length);
+   
+   for (unsigned long j = 0; j < batch->num; j++)
+   {
+      unsigned long * coeffs = batch->coeffs + j*batch->alloc;
+      for (unsigned long i = batch->length; i < length; i++)
+         coeffs[i] = 0L;
+   }
+   
+   batch->length = length;
+}
+
+/*
+   Reduce the length of the batch to that of its longest polynomial.
+*/
+
+void __zmod_poly_batch_normalise(zmod_poly_batch_t batch)
+{
+   while (batch->length)
+   {
+      unsigned long j;
+      for (j = 0; j < batch->num; j++)
+         if (batch->coeffs[j*batch->alloc + batch->length - 1]) break;
+      if (j < batch->num) break;
+      batch->length--;
+   }
+}
+
+void zmod_poly_batch_set(zmod_poly_batch_t res, zmod_poly_batch_t batch)
+{
+   FLINT_ASSERT(res->num == batch->num);
+   
+   if (res == batch) return;
+   
+   zmod_poly_batch_fit_length(res, batch->length);
+   
+   for (unsigned long j = 0; j < batch->num; j++)
+      memcpy(res->coeffs + j*res->alloc, batch->coeffs + j*batch->alloc, 
+                                             batch->length*sizeof(unsigned long));
+   
+   res->length = batch->length;
+}
+
+/*
+   Set polynomial j of the batch to poly, which must be taken modulo p[j].
+*/
+
+void zmod_poly_batch_set_poly(zmod_poly_batch_t batch, unsigned long j, zmod_poly_t poly)
+{
+   FLINT_ASSERT(j < batch->num);
+   FLINT_ASSERT(poly->p == batch->p[j]);
+   
+   if (poly->length > batch->length) 
+      zmod_poly_batch_set_length(batch, poly->length);
+   
+   unsigned long * coeffs = batch->coeffs + j*batch->alloc;
+   unsigned long i;
+   
+   for (i = 0; i < poly->length; i++)
+      coeffs[i] = poly->coeffs[i];
+   for ( ; i < batch->length; i++)
+      coeffs[i] = 0L;
+}
+
+/*
+   Set poly, which must be taken modulo p[j], to polynomial j of the batch.
+*/
+
+void zmod_poly_batch_get_poly(zmod_poly_t poly, zmod_poly_batch_t batch, unsigned long j)
+{
+   FLINT_ASSERT(j < batch->num);
+   FLINT_ASSERT(poly->p == batch->p[j]);
+   
+   zmod_poly_fit_length(poly, batch->length);
+   
+   unsigned long * coeffs = batch->coeffs + j*batch->alloc;
+   
+   for (unsigned long i = 0; i < batch->length; i++)
+      poly->coeffs[i] = coeffs[i];
+   
+   poly->length = batch->length;
+   __zmod_poly_normalise(poly);
+}
+
+/*
+   Attach poly to polynomial j of the batch, normalised. The result must 
+   only be used as an input and does not need to be cleared.
+*/
+
+static inline
+void _zmod_poly_batch_attach(zmod_poly_t poly, zmod_poly_batch_t batch, unsigned long j)
+{
+   poly->coeffs = batch->coeffs + j*batch->alloc;
+   poly->alloc = batch->alloc;
+   poly->length = batch->length;
+   poly->p = batch->p[j];
+   poly->p_inv = batch->p_inv[j];
+#if USE_ZN_POLY
+   poly->mod[0] = batch->mod[j];
+#endif
+   __zmod_poly_normalise(poly);
+}
+
+/*
+   Initialise poly with space for alloc coefficients and the same modulus as
+   like, copying the precomputed data for the modulus rather than 
+   recomputing it.
+*/
+
+static inline
+void _zmod_poly_init2_like(zmod_poly_t poly, zmod_poly_t like, unsigned long alloc)
+{
+   if (alloc == 0) alloc = 1;
+   
+   poly->coeffs = (unsigned long *) flint_heap_alloc(alloc);
+   poly->alloc = alloc;
+   poly->length = 0;
+   poly->p = like->p;
+   poly->p_inv = like->p_inv;
+#if USE_ZN_POLY
+   poly->mod[0] = like->mod[0];
+#endif
+}
+
+/*
+   Set polynomial j of the batch to poly, which must be no longer than the 
+   batch.
+*/
+
+static inline
+void _zmod_poly_batch_store(zmod_poly_batch_t batch, unsigned long j, zmod_poly_t poly)
+{
+   FLINT_ASSERT(poly->length <= batch->length);
+   
+   unsigned long * coeffs = batch->coeffs + j*batch->alloc;
+   unsigned long i;
+   
+   for (i = 0; i < poly->length; i++)
+      coeffs[i] = poly->coeffs[i];
+   for ( ; i < batch->length; i++)
+      coeffs[i] = 0L;
+}
+
+/*
+   The additive kernels run over one polynomial at a time. With zn_poly they
+   use zn_array_add, zn_array_sub and zn_array_neg, which have AVX2 versions 
+   (selected at run time) working on four coefficients at a time.
+*/
+
+void zmod_poly_batch_add(zmod_poly_batch_t res, zmod_poly_batch_t batch1, zmod_poly_batch_t batch2)
+{
+   FLINT_ASSERT(res->num == batch1->num);
+   FLINT_ASSERT(res->num == batch2->num);
+   
+   unsigned long length1 = batch1->length;
+   unsigned long length2 = batch2->length;
+   unsigned long length = FLINT_MAX(length1, length2);
+   unsigned long short_length = FLINT_MIN(length1, length2);
+   
+   zmod_poly_batch_fit_length(res, length);
+   
+   for (unsigned long j = 0; j < res->num; j++)
+   {
+      unsigned long * r = res->coeffs + j*res->alloc;
+      unsigned long * a = batch1->coeffs + j*batch1->alloc;
+      unsigned long * b = batch2->coeffs + j*batch2->alloc;
+      unsigned long i;
+      
+#if USE_ZN_POLY
+      zn_array_add(r, a, b, short_length, res->mod + j);
+      i = short_length;
+#else
+      unsigned long p = res->p[j];
+      for (i = 0; i < short_length; i++)
+         r[i] = z_addmod(a[i], b[i], p);
+#endif
+      for ( ; i < length1; i++)
+         r[i] = a[i];
+      for ( ; i < length2; i++)
+         r[i] = b[i];
+   }
+   
+   res->length = length;
+   __zmod_poly_batch_normalise(res);
+}
+
+void zmod_poly_batch_sub(zmod_poly_batch_t res, zmod_poly_batch_t batch1, zmod_poly_batch_t batch2)
+{
+   FLINT_ASSERT(res->num == batch1->num);
+   FLINT_ASSERT(res->num == batch2->num);
+   
+   unsigned long length1 = batch1->length;
+   unsigned long length2 = batch2->length;
+   unsigned long length = FLINT_MAX(length1, length2);
+   unsigned long short_length = FLINT_MIN(length1, length2);
+   
+   zmod_poly_batch_fit_length(res, length);
+   
+   for (unsigned long j = 0; j < res->num; j++)
+   {
+      unsigned long * r = res->coeffs + j*res->alloc;
+      unsigned long * a = batch1->coeffs + j*batch1->alloc;
+      unsigned long * b = batch2->coeffs + j*batch2->alloc;
+      unsigned long i;
+      
+#if USE_ZN_POLY
+      zn_array_sub(r, a, b, short_length, res->mod + j);
+      for (i = short_length; i < length1; i++)
+         r[i] = a[i];
+      if (length2 > i) 
+         zn_array_neg(r + i, b + i, length2 - i, res->mod + j);
+#else
+      unsigned long p = res->p[j];
+      for (i = 0; i < short_length; i++)
+         r[i] = z_submod(a[i], b[i], p);
+      for ( ; i < length1; i++)
+         r[i] = a[i];
+      for ( ; i < length2; i++)
+         r[i] = z_negmod(b[i], p);
+#endif
+   }
+   
+   res->length = length;
+   __zmod_poly_batch_normalise(res);
+}
+
+/*
+   Arguments for the multiplicative kernels, which call lane(arg, j) for 
+   each polynomial j in [start, stop). Each call reads polynomial j of the 
+   inputs and writes polynomial j of res only.
+*/
+
+typedef struct zmod_poly_batch_arg_s
+{
+   void (*lane)(struct zmod_poly_batch_arg_s *, unsigned long);
+   zmod_poly_batch_p res;
+   zmod_poly_batch_p batch1;
+   zmod_poly_batch_p batch2;
+   zmod_poly_batch_modulus_struct * mod;
+   unsigned long exp;
+   unsigned long start;
+   unsigned long stop;
+} zmod_poly_batch_arg_t;
+
+void _zmod_poly_batch_worker(void * arg_ptr)
+{
+   zmod_poly_batch_arg_t * arg = (zmod_poly_batch_arg_t *) arg_ptr;
+   
+   for (unsigned long j = arg->start; j < arg->stop; j++)
+      arg->lane(arg, j);
+}
+
+/*
+   Run the kernel arg->lane over all polynomials of arg->res, split among at 
+   most flint_get_num_threads() threads. The cost of each polynomial is 
+   taken to be that of work coefficients.
+*/
+
+void _zmod_poly_batch_run(zmod_poly_batch_arg_t * arg, unsigned long work)
+{
+   unsigned long num = arg->res->num;
+   unsigned long threads = flint_get_num_threads();
+   
+   // don't use more threads than there is work for
+   unsigned long max = (num*work)/ZMOD_POLY_BATCH_THREAD_CUTOFF;
+   if (threads > num) threads = num;
+   if (threads > max) threads = FLINT_MAX(max, 1L);
+   
+   if (threads == 1)
+   {
+      arg->start = 0;
+      arg->stop = num;
+      _zmod_poly_batch_worker(arg);
+      return;
+   }
+   
+   zmod_poly_batch_arg_t * args = (zmod_poly_batch_arg_t *) 
+                flint_heap_alloc_bytes(threads*sizeof(zmod_poly_batch_arg_t));
+   
+   for (unsigned long i = 0; i < threads; i++)
+   {
+      args[i] = *arg;
+      args[i].start = (num*i)/threads;
+      args[i].stop = (num*(i + 1))/threads;
+   }
+   
+   flint_parallel_do(_zmod_poly_batch_worker, args, sizeof(zmod_poly_batch_arg_t), threads);
+   
+   flint_heap_free(args);
+}
+
+void _zmod_poly_batch_mul_lane(zmod_poly_batch_arg_t * arg, unsigned long j)
+{
+   zmod_poly_t a, b;
+   _zmod_poly_batch_attach(a, arg->batch1, j);
+   _zmod_poly_batch_attach(b, arg->batch2, j);
+   
+   unsigned long * r = arg->res->coeffs + j*arg->res->alloc;
+   unsigned long length = 0;
+   unsigned long i;
+   
+   if (a->length && b->length)
+   {
+      length = a->length + b->length - 1;
+#if USE_ZN_POLY
+      if (a->length >= b->length) 
+         zn_array_mul(r, a->coeffs, a->length, b->coeffs, b->length, a->mod);
+      else 
+         zn_array_mul(r, b->coeffs, b->length, a->coeffs, a->length, a->mod);
+#else
+      zmod_poly_t prod;
+      _zmod_poly_init2_like(prod, a, length);
+      zmod_poly_mul(prod, a, b);
+      for (i = 0; i < prod->length; i++)
+         r[i] = prod->coeffs[i];
+      for ( ; i < length; i++)
+         r[i] = 0L;
+      zmod_poly_clear(prod);
+#endif
+   }
+   
+   for (i = length; i < arg->res->length; i++)
+      r[i] = 0L;
+}
+
+void zmod_poly_batch_mul(zmod_poly_batch_t res, zmod_poly_batch_t batch1, zmod_poly_batch_t batch2)
+{
+   FLINT_ASSERT(res->num == batch1->num);
+   FLINT_ASSERT(res->num == batch2->num);
+   
+   if ((res == batch1) || (res == batch2))
+   {
+      zmod_poly_batch_t temp;
+      zmod_poly_batch_init_moduli(temp, res, 0);
+      zmod_poly_batch_mul(temp, batch1, batch2);
+      zmod_poly_batch_swap(temp, res);
+      zmod_poly_batch_clear(temp);
+      return;
+   }
+   
+   if ((batch1->length == 0) || (batch2->length == 0))
+   {
+      zmod_poly_batch_zero(res);
+      return;
+   }
+   
+   unsigned long length = batch1->length + batch2->length - 1;
+   zmod_poly_batch_fit_length(res, length);
+   res->length = length;
+   
+   zmod_poly_batch_arg_t arg;
+   arg.lane = _zmod_poly_batch_mul_lane;
+   arg.res = res;
+   arg.batch1 = batch1;
+   arg.batch2 = batch2;
+   arg.mod = NULL;
+   arg.exp = 0;
+   
+   _zmod_poly_batch_run(&arg, length);
+   
+   __zmod_poly_batch_normalise(res);
+}
+
+/*
+   Set R to A modulo f, where finv is the power series inverse of the 
+   reversal of f to f->length - 1 terms. If A->length <= 2*f->length - 2 the 
+   quotient is rev(rev(A)*finv mod x^m) where m = A->length - f->length + 1,
+   otherwise we fall back to zmod_poly_divrem. R must not alias A.
+*/
+
+void _zmod_poly_batch_rem(zmod_poly_t R, zmod_poly_t A, zmod_poly_t f, zmod_poly_t finv)
+{
+   unsigned long n = f->length;
+   
+   if (n == 1)
+   {
+      zmod_poly_zero(R);
+      return;
+   }
+   
+   if (A->length < n)
+   {
+      zmod_poly_set(R, A);
+      return;
+   }
+   
+   unsigned long m = A->length - n + 1;
+   
+   if (m > n - 1)
+   {
+      zmod_poly_t Q;
+      _zmod_poly_init2_like(Q, f, m);
+      zmod_poly_divrem(Q, R, A, f);
+      zmod_poly_clear(Q);
+      return;
+   }
+   
+   unsigned long p = f->p;
+   zmod_poly_t A_rev, finv_m, Q, T;
+   
+   _zmod_poly_init2_like(A_rev, f, m);
+   _zmod_poly_init2_like(Q, f, m);
+   _zmod_poly_init2_like(T, f, n - 1);
+   
+   for (unsigned long i = 0; i < m; i++)
+      A_rev->coeffs[i] = A->coeffs[A->length - i - 1];
+   A_rev->length = m;
+   __zmod_poly_normalise(A_rev);
+   
+   _zmod_poly_attach_truncate(finv_m, finv, m);
+   zmod_poly_mul_trunc_n(Q, A_rev, finv_m, m);
+   zmod_poly_reverse(Q, Q, m);
+   
+   // R = A - Q*f mod x^(n - 1)
+   zmod_poly_mul_trunc_n(T, Q, f, n - 1);
+   
+   zmod_poly_fit_length(R, n - 1);
+   
+   unsigned long i;
+   for (i = 0; i < T->length; i++)
+      R->coeffs[i] = z_submod(A->coeffs[i], T->coeffs[i], p);
+   for ( ; i < n - 1; i++)
+      R->coeffs[i] = A->coeffs[i];
+   
+   R->length = n - 1;
+   __zmod_poly_normalise(R);
+   
+   zmod_poly_clear(T);
+   zmod_poly_clear(Q);
+   zmod_poly_clear(A_rev);
+}
+
+void _zmod_poly_batch_modulus_lane(zmod_poly_batch_arg_t * arg, unsigned long j)
+{
+   zmod_poly_t f, f_rev, finv;
+   _zmod_poly_batch_attach(f, arg->batch1, j);
+   
+   if (f->length == 0)
+   {
+      printf("Error: zero modulus in zmod_poly_batch_modulus_init\n");
+      abort();
+   }
+   
+   _zmod_poly_init2_like(finv, f, f->length);
+   
+   if (f->length > 1)
+   {
+      _zmod_poly_init2_like(f_rev, f, f->length);
+      _zmod_poly_reverse(f_rev, f, f->length);
+      zmod_poly_newton_invert(finv, f_rev, f->length - 1);
+      zmod_poly_clear(f_rev);
+   }
+   
+   _zmod_poly_batch_store(arg->res, j, finv);
+   
+   zmod_poly_clear(finv);
+}
+
+/*
+   Precompute the data for reducing modulo the polynomials of the batch f, 
+   none of which may be zero. 
+*/
+
+void zmod_poly_batch_modulus_init(zmod_poly_batch_modulus_t mod, zmod_poly_batch_t f)
+{
+   if (f->length == 0)
+   {
+      printf("Error: zero modulus in zmod_poly_batch_modulus_init\n");
+      abort();
+   }
+   
+   zmod_poly_batch_init_moduli(mod->f, f, f->length);
+   zmod_poly_batch_set(mod->f, f);
+   
+   zmod_poly_batch_init_moduli(mod->finv, f, f->length - 1);
+   mod->finv->length = f->length - 1;
+   
+   zmod_poly_batch_arg_t arg;
+   arg.lane = _zmod_poly_batch_modulus_lane;
+   arg.res = mod->finv;
+   arg.batch1 = mod->f;
+   arg.batch2 = NULL;
+   arg.mod = NULL;
+   arg.exp = 0;
+   
+   _zmod_poly_batch_run(&arg, f->length);
+}
+
+void zmod_poly_batch_modulus_clear(zmod_poly_batch_modulus_t mod)
+{
+   zmod_poly_batch_clear(mod->f);
+   zmod_poly_batch_clear(mod->finv);
+}
+
+void _zmod_poly_batch_mulmod_lane(zmod_poly_batch_arg_t * arg, unsigned long j)
+{
+   zmod_poly_t a, b, f, finv, prod, rem;
+   _zmod_poly_batch_attach(a, arg->batch1, j);
+   _zmod_poly_batch_attach(b, arg->batch2, j);
+   _zmod_poly_batch_attach(f, arg->mod->f, j);
+   _zmod_poly_batch_attach(finv, arg->mod->finv, j);
+   
+   _zmod_poly_init2_like(prod, f, a->length + b->length);
+   _zmod_poly_init2_like(rem, f, f->length);
+   
+   zmod_poly_mul(prod, a, b);
+   _zmod_poly_batch_rem(rem, prod, f, finv);
+   _zmod_poly_batch_store(arg->res, j, rem);
+   
+   zmod_poly_clear(rem);
+   zmod_poly_clear(prod);
+}
+
+/*
+   Set polynomial j of res to that of batch1 times that of batch2, modulo 
+   polynomial j of the modulus.
+*/
+
+void zmod_poly_batch_mulmod(zmod_poly_batch_t res, zmod_poly_batch_t batch1, 
+                           zmod_poly_batch_t batch2, zmod_poly_batch_modulus_t mod)
+{
+   FLINT_ASSERT(res->num == batch1->num);
+   FLINT_ASSERT(res->num == batch2->num);
+   FLINT_ASSERT(res->num == mod->f->num);
+   
+   if ((res == batch1) || (res == batch2))
+   {
+      zmod_poly_batch_t temp;
+      zmod_poly_batch_init_moduli(temp, res, 0);
+      zmod_poly_batch_mulmod(temp, batch1, batch2, mod);
+      zmod_poly_batch_swap(temp, res);
+      zmod_poly_batch_clear(temp);
+      return;
+   }
+   
+   unsigned long length = mod->f->length - 1;
+   zmod_poly_batch_fit_length(res, length);
+   res->length = length;
+   
+   zmod_poly_batch_arg_t arg;
+   arg.lane = _zmod_poly_batch_mulmod_lane;
+   arg.res = res;
+   arg.batch1 = batch1;
+   arg.batch2 = batch2;
+   arg.mod = mod;
+   arg.exp = 0;
+   
+   _zmod_poly_batch_run(&arg, batch1->length + batch2->length + 2*length);
+   
+   __zmod_poly_batch_normalise(res);
+}
+
+void _zmod_poly_batch_powmod_lane(zmod_poly_batch_arg_t * arg, unsigned long j)
+{
+   zmod_poly_t a, f, finv, y, prod, pow;
+   _zmod_poly_batch_attach(a, arg->batch1, j);
+   _zmod_poly_batch_attach(f, arg->mod->f, j);
+   _zmod_poly_batch_attach(finv, arg->mod->finv, j);
+   
+   _zmod_poly_init2_like(y, f, f->length);
+   _zmod_poly_init2_like(prod, f, 2*f->length);
+   _zmod_poly_init2_like(pow, f, f->length);
+   
+   if (f->length > 1)
+   {
+      unsigned long e = arg->exp;
+      
+      _zmod_poly_batch_rem(y, a, f, finv);
+      zmod_poly_set_coeff_ui(pow, 0, 1L);
+      
+      while (e) 
+      {
+         if (e & 1) 
+         {
+            zmod_poly_mul(prod, pow, y);
+            _zmod_poly_batch_rem(pow, prod, f, finv);
+         }
+         e >>= 1;
+         if (e) 
+         {
+            zmod_poly_mul(prod, y, y);
+            _zmod_poly_batch_rem(y, prod, f, finv);
+         }
+      }
+   }
+   
+   _zmod_poly_batch_store(arg->res, j, pow);
+   
+   zmod_poly_clear(pow);
+   zmod_poly_clear(prod);
+   zmod_poly_clear(y);
+}
+
+/*
+   Set polynomial j of res to that of batch raised to the power exp, modulo
+   polynomial j of the modulus. Each thread runs the whole exponentiation 
+   for its polynomials.
+*/
+
+void zmod_poly_batch_powmod(zmod_poly_batch_t res, zmod_poly_batch_t batch, 
+                                unsigned long exp, zmod_poly_batch_modulus_t mod)
+{
+   FLINT_ASSERT(res->num == batch->num);
+   FLINT_ASSERT(res->num == mod->f->num);
+   
+   if (res == batch)
+   {
+      zmod_poly_batch_t temp;
+      zmod_poly_batch_init_moduli(temp, res, 0);
+      zmod_poly_batch_powmod(temp, batch, exp, mod);
+      zmod_poly_batch_swap(temp, res);
+      zmod_poly_batch_clear(temp);
+      return;
+   }
+   
+   unsigned long length = mod->f->length - 1;
+   zmod_poly_batch_fit_length(res, length);
+   res->length = length;
+   
+   zmod_poly_batch_arg_t arg;
+   arg.lane = _zmod_poly_batch_powmod_lane;
+   arg.res = res;
+   arg.batch1 = batch;
+   arg.batch2 = NULL;
+   arg.mod = mod;
+   arg.exp = exp;
+   
+   _zmod_poly_batch_run(&arg, 4*length*(FLINT_BIT_COUNT(exp) + 1));
+   
+   __zmod_poly_batch_normalise(res);
+}
@@ -187,6 +187,16 @@ void zmod_poly_fprint(zmod_poly_t poly, FILE* f);
 int zmod_poly_read(zmod_poly_t poly);
 int zmod_poly_fread(zmod_poly_t poly, FILE* f);
 
+// ------------------------------------------------------
+// Binary I/O, see binary-io.h
+
+int zmod_poly_fwrite_binary(zmod_poly_t poly, FILE* f);
+int zmod_poly_fread_binary(zmod_poly_t poly, FILE* f);
+int zmod_poly_attach_binary(zmod_poly_t poly, void * data, size_t size);
+void zmod_poly_detach_binary(zmod_poly_t poly);
+int zmod_poly_mmap(zmod_poly_t poly, const char * name);
+void zmod_poly_munmap(zmod_poly_t poly);
+
 
 // ------------------------------------------------------
 // Length and degree
@@ -864,6 +874,91 @@ void zmod_poly_2x2_mat_mul_strassen(zmod_poly_2x2_mat_t R, zmod_poly_2x2_mat_t A
 void zmod_poly_2x2_mat_mul(zmod_poly_2x2_mat_t R, zmod_poly_2x2_mat_t A, 
 									                         zmod_poly_2x2_mat_t B);
 
+/**************************************************************************************************
+
+   Batches of polynomials over many primes
+
+**************************************************************************************************/
+
+/*
+   A batch holds num polynomials of a common length, the j-th of them having
+   its coefficients reduced modulo the prime p[j]. Coefficients are stored 
+   prime major, i.e. polynomial j is the array coeffs + j*alloc, so that the
+   kernels below can run over a whole polynomial with the precomputed data
+   for its prime held in registers. Polynomials shorter than length are 
+   padded with zeroes.
+*/
+
+typedef struct
+{
+   unsigned long * coeffs;
+   unsigned long num;
+   unsigned long alloc;
+   unsigned long length;
+   unsigned long * p;
+   double * p_inv;
+#if USE_ZN_POLY
+   zn_mod_struct * mod;
+#endif
+} zmod_poly_batch_struct;
+
+typedef zmod_poly_batch_struct zmod_poly_batch_t[1];
+typedef zmod_poly_batch_struct * zmod_poly_batch_p;
+
+/*
+   A batch of moduli f[j] together with the power series inverses of their
+   reversals, so that reduction modulo f[j] costs two multiplications.
+*/
+
+typedef struct
+{
+   zmod_poly_batch_t f;
+   zmod_poly_batch_t finv;
+} zmod_poly_batch_modulus_struct;
+
+typedef zmod_poly_batch_modulus_struct zmod_poly_batch_modulus_t[1];
+
+#define ZMOD_POLY_BATCH_THREAD_CUTOFF 4096 // minimum number of coefficients per thread
+
+void zmod_poly_batch_init(zmod_poly_batch_t batch, unsigned long * primes, 
+                                      unsigned long num, unsigned long alloc);
+void zmod_poly_batch_init_moduli(zmod_poly_batch_t batch, zmod_poly_batch_t batch2, 
+                                                               unsigned long alloc);
+void zmod_poly_batch_clear(zmod_poly_batch_t batch);
+void zmod_poly_batch_fit_length(zmod_poly_batch_t batch, unsigned long alloc);
+void zmod_poly_batch_set_length(zmod_poly_batch_t batch, unsigned long length);
+void __zmod_poly_batch_normalise(zmod_poly_batch_t batch);
+
+static inline
+void zmod_poly_batch_zero(zmod_poly_batch_t batch)
+{
+   batch->length = 0;
+}
+
+static inline
+void zmod_poly_batch_swap(zmod_poly_batch_t batch1, zmod_poly_batch_t batch2)
+{
+   zmod_poly_batch_struct temp = *batch1;
+   *batch1 = *batch2;
+   *batch2 = temp;
+}
+
+void zmod_poly_batch_set(zmod_poly_batch_t res, zmod_poly_batch_t batch);
+void zmod_poly_batch_set_poly(zmod_poly_batch_t batch, unsigned long j, zmod_poly_t poly);
+void zmod_poly_batch_get_poly(zmod_poly_t poly, zmod_poly_batch_t batch, unsigned long j);
+
+void zmod_poly_batch_add(zmod_poly_batch_t res, zmod_poly_batch_t batch1, zmod_poly_batch_t batch2);
+void zmod_poly_batch_sub(zmod_poly_batch_t res, zmod_poly_batch_t batch1, zmod_poly_batch_t batch2);
+void zmod_poly_batch_mul(zmod_poly_batch_t res, zmod_poly_batch_t batch1, zmod_poly_batch_t batch2);
+
+void zmod_poly_batch_modulus_init(zmod_poly_batch_modulus_t mod, zmod_poly_batch_t f);
+void zmod_poly_batch_modulus_clear(zmod_poly_batch_modulus_t mod);
+
+void zmod_poly_batch_mulmod(zmod_poly_batch_t res, zmod_poly_batch_t batch1, 
+                           zmod_poly_batch_t batch2, zmod_poly_batch_modulus_t mod);
+void zmod_poly_batch_powmod(zmod_poly_batch_t res, zmod_poly_batch_t batch, 
+                                unsigned long exp, zmod_poly_batch_modulus_t mod);
+
 #ifdef __cplusplus
  }
 #endif
@@ -729,6 +729,16 @@ void
 zn_array_neg (ulong* res, const ulong* op, size_t n, const zn_mod_t mod);
 
 
+/*
+   res := op1 + op2.
+   
+   Inputs and outputs in [0, m).
+*/
+void
+zn_array_add (ulong* res, const ulong* op1, const ulong* op2, size_t n,
+              const zn_mod_t mod);
+
+
 /*
    res := op1 - op2.
    
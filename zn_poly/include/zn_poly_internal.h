@@ -784,6 +784,26 @@ ulong
 pmfvec_mul_fudge (unsigned lgM, int sqr, const zn_mod_t mod);
 
 
+/*
+   Sets res := op1 * op2 mod x^M + 1, for arrays of length M. This is the
+   multiplication of a single pair of fourier coefficients (excluding the
+   biases) in pmfvec_mul() and nuss_pointwise_mul().
+   
+   The output is divided by the fudge factor _zn_array_mul_fudge (M, M,
+   sqr, mod), where sqr = (op1 == op2). The modulus must be odd. temp must
+   have room for 2*M words, and temp[2*M - 1] must be zero.
+   
+   For small M and small moduli this uses the SIMD negacyclic kernels
+   (zn_array_negamul_redc_avx2 etc), otherwise _zn_array_mul() followed by
+   the negacyclic reduction. It's okay for res to alias op1 or op2.
+*/
+#define zn_array_negamul_fastred \
+    ZNP_zn_array_negamul_fastred
+void
+zn_array_negamul_fastred (ulong* res, const ulong* op1, const ulong* op2,
+                          ulong M, ulong* temp, const zn_mod_t mod);
+
+
 /*
    Modifies the op->data and op->skip to make it look as if the first
    coefficient is the one at index n - 1, and the last coefficient is
@@ -1107,6 +1127,146 @@ zn_array_scalar_mul_or_copy (ulong* res, const ulong* op, size_t n,
                              ulong x, const zn_mod_t mod);
 
 
+/*
+   SIMD kernels.
+   
+   If ZNP_USE_AVX2 is set, the innermost loops of the array routines (and of
+   zn_array_unpack) have AVX2 versions. These are compiled via GCC's target
+   attribute, so the rest of the library need not be built with -mavx2, and
+   are only called if zn_simd_avx2() returns nonzero, so the same binary runs
+   on processors without AVX2.
+   
+   Define ZNP_NO_SIMD to compile only the scalar loops.
+*/
+#if !defined (ZNP_NO_SIMD) && defined (__GNUC__) && defined (__x86_64__)  \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define ZNP_USE_AVX2 1
+#define ZNP_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define ZNP_USE_AVX2 0
+#endif
+
+
+/*
+   Likewise, if ZNP_USE_IFMA is set, the pointwise multiplication kernel
+   has a version using the AVX-512 52-bit multiply-accumulate instructions,
+   which is only called if zn_simd_ifma() returns nonzero.
+*/
+#if ZNP_USE_AVX2 && (__GNUC__ >= 6)
+#define ZNP_USE_IFMA 1
+#define ZNP_IFMA __attribute__ ((target ("avx512f,avx512vl,avx512ifma")))
+#else
+#define ZNP_USE_IFMA 0
+#endif
+
+
+/*
+   Set to nonzero to force the scalar loops, e.g. to compare them against
+   the SIMD kernels in the array-profile target.
+*/
+#define zn_simd_disable \
+    ZNP_zn_simd_disable
+extern int zn_simd_disable;
+
+
+/*
+   Returns nonzero if the AVX2 kernels may be used, i.e. if they were
+   compiled in, the processor supports AVX2 (determined via CPUID on the
+   first call), and zn_simd_disable is zero.
+*/
+#define zn_simd_avx2 \
+    ZNP_zn_simd_avx2
+int
+zn_simd_avx2 (void);
+
+
+/*
+   Same as zn_simd_avx2(), for the IFMA kernels (which also need AVX-512VL).
+*/
+#define zn_simd_ifma \
+    ZNP_zn_simd_ifma
+int
+zn_simd_ifma (void);
+
+
+#if ZNP_USE_AVX2
+
+/*
+   AVX2 versions of res := op1 + op2, res := op1 - op2 and res := -op on
+   arrays of length n. Inputs must be in [0, m). The output may coincide
+   with an input.
+*/
+#define zn_array_add_avx2 \
+    ZNP_zn_array_add_avx2
+void
+zn_array_add_avx2 (ulong* res, const ulong* op1, const ulong* op2, size_t n,
+                   const zn_mod_t mod);
+
+#define zn_array_sub_avx2 \
+    ZNP_zn_array_sub_avx2
+void
+zn_array_sub_avx2 (ulong* res, const ulong* op1, const ulong* op2, size_t n,
+                   const zn_mod_t mod);
+
+#define zn_array_neg_avx2 \
+    ZNP_zn_array_neg_avx2
+void
+zn_array_neg_avx2 (ulong* res, const ulong* op, size_t n, const zn_mod_t mod);
+
+
+/*
+   AVX2 version of zn_array_bfly_inplace.
+*/
+#define zn_array_bfly_avx2 \
+    ZNP_zn_array_bfly_avx2
+void
+zn_array_bfly_avx2 (ulong* op1, ulong* op2, size_t n, const zn_mod_t mod);
+
+
+/*
+   AVX2 version of the REDC scalar multiplication for moduli of at most
+   ULONG_BITS/2 bits, where all products fit into 32 x 32 bit multiplies.
+*/
+#define _zn_array_scalar_mul_redc_v1_avx2 \
+    ZNP__zn_array_scalar_mul_redc_v1_avx2
+void
+_zn_array_scalar_mul_redc_v1_avx2 (ulong* res, const ulong* op, size_t n,
+                                   ulong x, const zn_mod_t mod);
+
+
+/*
+   Sets res := -op1 * op2 / B mod m, where the product is taken in
+   Z/mZ[x] / (x^n + 1), i.e. the same thing as a REDC multiplication
+   (fudge factor -B) of the length n inputs followed by the negacyclic
+   reduction, but without computing the length 2n - 1 product first.
+   
+   The modulus must be odd and have at most ULONG_BITS/2 bits. Inputs must
+   be in [0, m). The output may coincide with either input.
+*/
+#define zn_array_negamul_redc_avx2 \
+    ZNP_zn_array_negamul_redc_avx2
+void
+zn_array_negamul_redc_avx2 (ulong* res, const ulong* op1, const ulong* op2,
+                            size_t n, const zn_mod_t mod);
+
+#endif
+
+
+#if ZNP_USE_IFMA
+
+/*
+   Same as zn_array_negamul_redc_avx2, for moduli of at most 52 bits and
+   n <= 4096.
+*/
+#define zn_array_negamul_redc_ifma \
+    ZNP_zn_array_negamul_redc_ifma
+void
+zn_array_negamul_redc_ifma (ulong* res, const ulong* op1, const ulong* op2,
+                            size_t n, const zn_mod_t mod);
+
+#endif
+
+
 /* ============================================================================
 
      stuff in nuss.c
@@ -20,7 +20,7 @@ lib_modules = ["src/" + x for x in lib_modules]
 # in debug mode only.
 test_modules = ["test", "ref_mul", "invert-test", "pmfvec_fft-test",
                 "mulmid_ks-test", "mpn_mulmid-test", "mul_fft-test",
-                "mul_ks-test", "nuss-test", "pack-test"]
+                "mul_ks-test", "nuss-test", "pack-test", "array-test"]
 test_modules = ["test/" + x for x in test_modules]
 
 # These are modules containing various profiling routines. They get compiled
@@ -30,12 +30,13 @@
 
 char* type_str[3] = {"add", "sub", "bfly"};
 char* speed_str[2] = {"safe", "slim"};
+char* simd_str[2] = {"scalar", "SIMD"};
 
 
 void
 prof_main (int argc, char* argv[])
 {
-   ulong type, speed;
+   ulong type, speed, simd;
    double result, spread;
    
    printf ("\n");
@@ -43,15 +44,18 @@ prof_main (int argc, char* argv[])
    // profile various butterfly loops
    for (type = 0; type < 3; type++)
    for (speed = 0; speed < 2; speed++)
+   for (simd = 0; simd < 2; simd++)
    {
-      ulong arg[2];
+      ulong arg[3];
       arg[0] = type;
       arg[1] = speed;
+      arg[2] = simd;
       
       result = profile (&spread, NULL, profile_bfly, arg, 1.0) / 1000;
       
-      printf (" %4s %s, cycles/coeff = %6.2lf (%.1lf%%)\n",
-              type_str[type], speed_str[speed], result, 100 * spread);
+      printf (" %4s %s %6s, cycles/coeff = %6.2lf (%.1lf%%)\n",
+              type_str[type], speed_str[speed], simd_str[simd],
+              result, 100 * spread);
    }
    
    // profile mpn_add_n and mpn_sub_n
@@ -68,8 +72,9 @@ prof_main (int argc, char* argv[])
 
    // profile zn_array_scalar_mul
    {
-      ulong arg[2];
+      ulong arg[3];
       arg[1] = 0;
+      arg[2] = 1;
    
       arg[0] = ULONG_BITS - 1;
       result = profile (&spread, NULL, profile_scalar_mul, arg, 1.0) / 1000;
@@ -84,8 +89,9 @@ prof_main (int argc, char* argv[])
 
    // profile zn_array_scalar_mul with REDC
    {
-      ulong arg[2];
+      ulong arg[3];
       arg[1] = 1;
+      arg[2] = 1;
 
       arg[0] = ULONG_BITS;
       result = profile (&spread, NULL, profile_scalar_mul, arg, 1.0) / 1000;
@@ -99,11 +105,51 @@ prof_main (int argc, char* argv[])
               "cycles/coeff = %6.2lf (%.1lf%%)\n",
               result, 100 * spread);
 
-      arg[0] = ULONG_BITS/2 - 1;
-      result = profile (&spread, NULL, profile_scalar_mul, arg, 1.0) / 1000;
-      printf ("scalar_mul (< half-word, REDC), "
-              "cycles/coeff = %6.2lf (%.1lf%%)\n",
-              result, 100 * spread);
+      for (simd = 0; simd < 2; simd++)
+      {
+         arg[0] = ULONG_BITS/2 - 1;
+         arg[2] = simd;
+         result = profile (&spread, NULL, profile_scalar_mul, arg, 1.0) / 1000;
+         printf ("scalar_mul (< half-word, REDC, %s), "
+                 "cycles/coeff = %6.2lf (%.1lf%%)\n",
+                 simd_str[simd], result, 100 * spread);
+      }
+   }
+
+   // profile zn_array_unpack for a few bit sizes
+   {
+      ulong arg[2];
+      unsigned b;
+      
+      for (b = 7; b < ULONG_BITS; b += 14)
+      for (simd = 0; simd < 2; simd++)
+      {
+         arg[0] = b;
+         arg[1] = simd;
+         result = profile (&spread, NULL, profile_unpack, arg, 1.0) / 1000;
+         printf ("unpack (%2u bits, %s), cycles/coeff = %6.2lf (%.1lf%%)\n",
+                 b, simd_str[simd], result, 100 * spread);
+      }
+   }
+
+   // profile pointwise multiplication of fourier coefficients
+   {
+      ulong arg[3];
+      ulong M;
+      unsigned b;
+      
+      for (b = 30; b <= 50; b += 20)
+      for (M = 4; M <= 128; M *= 2)
+      for (simd = 0; simd < 2; simd++)
+      {
+         arg[0] = b;
+         arg[1] = M;
+         arg[2] = simd;
+         result = profile (&spread, NULL, profile_negamul, arg, 1.0) / M;
+         printf ("negamul (%2u bits, M = %3lu, %s), "
+                 "cycles/coeff = %6.2lf (%.1lf%%)\n",
+                 b, M, simd_str[simd], result, 100 * spread);
+      }
    }
 }
 
@@ -37,6 +37,7 @@ typedef void  (*bfly_func)(ulong*, ulong*, ulong, const zn_mod_t);
    arg points to an array of ulongs:
       * First is 0 for add, 1 for subtract, 2 for inplace butterfly.
       * Second is 0 for safe version, 1 for slim version.
+      * Third is 0 to force the scalar loops, 1 to allow SIMD kernels.
    
    Returns total cycle count for _count_ calls to butterfly of length 1000.
 */
@@ -45,8 +46,11 @@ profile_bfly (void* arg, unsigned long count)
 {
    ulong type = ((ulong*) arg)[0];
    ulong speed = ((ulong*) arg)[1];
+   ulong simd = ((ulong*) arg)[2];
    ulong m = 123 + (1UL << (ULONG_BITS - (speed ? 2 : 1)));
    
+   zn_simd_disable = !simd;
+   
    zn_mod_t mod;
    zn_mod_init (mod, m);
    
@@ -88,6 +92,7 @@ profile_bfly (void* arg, unsigned long count)
    free (buf1);
    
    zn_mod_clear (mod);
+   zn_simd_disable = 0;
 
    return cycle_diff (t0, t1);
 }
@@ -149,6 +154,7 @@ profile_mpn_aors (void* arg, unsigned long count)
    arg points to an array of ulongs:
       * First is modulus size in bits.
       * Second is 0 for regular multiply, 1 for REDC multiply
+      * Third is 0 to force the scalar loops, 1 to allow SIMD kernels.
    
    Returns total cycle count for _count_ calls to zn_array_scalar_mul
    of length 1000.
@@ -158,6 +164,9 @@ profile_scalar_mul (void* arg, unsigned long count)
 {
    int bits = ((ulong*) arg)[0];
    int algo = ((ulong*) arg)[1];
+   int simd = ((ulong*) arg)[2];
+   
+   zn_simd_disable = !simd;
    
    zn_mod_t mod;
    ulong m = random_modulus (bits, 1);
@@ -189,6 +198,119 @@ profile_scalar_mul (void* arg, unsigned long count)
 
    free (buf);
    zn_mod_clear (mod);
+   zn_simd_disable = 0;
+
+   return cycle_diff (t0, t1);
+}
+
+
+
+/*
+   Profiles zn_array_unpack.
+
+   arg points to an array of ulongs:
+      * First is the number of bits per coefficient.
+      * Second is 0 to force the scalar loops, 1 to allow SIMD kernels.
+   
+   Returns total cycle count for _count_ calls to zn_array_unpack
+   of length 1000.
+*/
+double
+profile_unpack (void* arg, unsigned long count)
+{
+   unsigned b = ((ulong*) arg)[0];
+   int simd = ((ulong*) arg)[1];
+   
+   zn_simd_disable = !simd;
+   
+   const ulong n = 1000;
+   size_t size = CEIL_DIV (n * b, GMP_NUMB_BITS);
+
+   // generate random input
+   mp_limb_t* buf = (mp_limb_t*) malloc (sizeof (mp_limb_t) * size);
+   ulong* res = (ulong*) malloc (sizeof (ulong) * n * CEIL_DIV (b, ULONG_BITS));
+   size_t i;
+   for (i = 0; i < size; i++)
+      buf[i] = random_ulong_bits (ULONG_BITS);
+
+   cycle_count_t t0, t1;
+
+   // warm up
+   ulong j;
+   for (j = 0; j < count; j++)
+      zn_array_unpack (res, buf, n, b, 0);
+
+   // do the actual profile
+   t0 = get_cycle_counter ();
+
+   for (j = 0; j < count; j++)
+      zn_array_unpack (res, buf, n, b, 0);
+
+   t1 = get_cycle_counter ();
+
+   free (res);
+   free (buf);
+   zn_simd_disable = 0;
+
+   return cycle_diff (t0, t1);
+}
+
+
+
+/*
+   Profiles zn_array_negamul_fastred.
+
+   arg points to an array of ulongs:
+      * First is modulus size in bits.
+      * Second is the length M.
+      * Third is 0 to force the scalar loops, 1 to allow SIMD kernels.
+   
+   Returns total cycle count for _count_ calls to zn_array_negamul_fastred.
+*/
+double
+profile_negamul (void* arg, unsigned long count)
+{
+   int bits = ((ulong*) arg)[0];
+   ulong M = ((ulong*) arg)[1];
+   int simd = ((ulong*) arg)[2];
+   
+   zn_simd_disable = !simd;
+   
+   zn_mod_t mod;
+   ulong m = random_modulus (bits, 1);
+   zn_mod_init (mod, m);
+   
+   // generate random inputs
+   ulong* buf1 = (ulong*) malloc (sizeof (ulong) * M);
+   ulong* buf2 = (ulong*) malloc (sizeof (ulong) * M);
+   ulong* temp = (ulong*) malloc (sizeof (ulong) * 2 * M);
+   size_t i;
+   for (i = 0; i < M; i++)
+      buf1[i] = random_ulong (m);
+   for (i = 0; i < M; i++)
+      buf2[i] = random_ulong (m);
+   temp[2*M - 1] = 0;
+
+   cycle_count_t t0, t1;
+
+   // warm up
+   ulong j;
+   for (j = 0; j < count; j++)
+      zn_array_negamul_fastred (buf1, buf1, buf2, M, temp, mod);
+
+   // do the actual profile
+   t0 = get_cycle_counter ();
+
+   for (j = 0; j < count; j++)
+      zn_array_negamul_fastred (buf1, buf1, buf2, M, temp, mod);
+
+   t1 = get_cycle_counter ();
+
+   free (temp);
+   free (buf2);
+   free (buf1);
+   zn_mod_clear (mod);
+   zn_simd_disable = 0;
 
    return cycle_diff (t0, t1);
 }
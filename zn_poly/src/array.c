@@ -22,6 +22,398 @@
 
 #include "zn_poly_internal.h"
 
+#if ZNP_USE_AVX2
+#include <immintrin.h>
+#endif
+
+
+int zn_simd_disable = 0;
+
+
+#if ZNP_USE_AVX2
+
+int
+zn_simd_avx2 (void)
+{
+   static int have_avx2 = -1;
+   
+   if (have_avx2 < 0)
+   {
+      __builtin_cpu_init ();
+      have_avx2 = __builtin_cpu_supports ("avx2") ? 1 : 0;
+   }
+   
+   return have_avx2 && !zn_simd_disable;
+}
+
+
+/*
+   Returns a mask of the lanes where x < y, as unsigned integers. AVX2 only
+   has a signed comparison, so the sign bits are flipped first, unless slim
+   is set, in which case both x and y must be less than 2^(ULONG_BITS - 1).
+*/
+static inline ZNP_AVX2 __m256i
+zn_avx2_cmplt (__m256i x, __m256i y, int slim)
+{
+   if (!slim)
+   {
+      const __m256i sign = _mm256_set1_epi64x (1ULL << (ULONG_BITS - 1));
+      x = _mm256_xor_si256 (x, sign);
+      y = _mm256_xor_si256 (y, sign);
+   }
+   return _mm256_cmpgt_epi64 (y, x);
+}
+
+
+/*
+   Lanewise x + y mod m, same algorithm as zn_mod_add.
+*/
+static inline ZNP_AVX2 __m256i
+zn_avx2_add (__m256i x, __m256i y, __m256i m, int slim)
+{
+   __m256i mask = zn_avx2_cmplt (x, _mm256_sub_epi64 (m, y), slim);
+   return _mm256_sub_epi64 (_mm256_add_epi64 (x, y),
+                            _mm256_andnot_si256 (mask, m));
+}
+
+
+/*
+   Lanewise x - y mod m.
+*/
+static inline ZNP_AVX2 __m256i
+zn_avx2_sub (__m256i x, __m256i y, __m256i m, int slim)
+{
+   __m256i mask = zn_avx2_cmplt (x, y, slim);
+   return _mm256_add_epi64 (_mm256_sub_epi64 (x, y),
+                            _mm256_and_si256 (mask, m));
+}
+
+
+#define ZNP_AVX2_LOAD(ptr) \
+   _mm256_loadu_si256 ((const __m256i*) (ptr))
+#define ZNP_AVX2_STORE(ptr, x) \
+   _mm256_storeu_si256 ((__m256i*) (ptr), (x))
+
+
+ZNP_AVX2 void
+zn_array_add_avx2 (ulong* res, const ulong* op1, const ulong* op2, size_t n,
+                   const zn_mod_t mod)
+{
+   __m256i m = _mm256_set1_epi64x (mod->m);
+
+   if (zn_mod_is_slim (mod))
+      for (; n >= 4; n -= 4, res += 4, op1 += 4, op2 += 4)
+         ZNP_AVX2_STORE (res, zn_avx2_add (ZNP_AVX2_LOAD (op1),
+                                           ZNP_AVX2_LOAD (op2), m, 1));
+   else
+      for (; n >= 4; n -= 4, res += 4, op1 += 4, op2 += 4)
+         ZNP_AVX2_STORE (res, zn_avx2_add (ZNP_AVX2_LOAD (op1),
+                                           ZNP_AVX2_LOAD (op2), m, 0));
+
+   for (; n; n--)
+      *res++ = zn_mod_add (*op1++, *op2++, mod);
+}
+
+
+ZNP_AVX2 void
+zn_array_sub_avx2 (ulong* res, const ulong* op1, const ulong* op2, size_t n,
+                   const zn_mod_t mod)
+{
+   __m256i m = _mm256_set1_epi64x (mod->m);
+
+   if (zn_mod_is_slim (mod))
+      for (; n >= 4; n -= 4, res += 4, op1 += 4, op2 += 4)
+         ZNP_AVX2_STORE (res, zn_avx2_sub (ZNP_AVX2_LOAD (op1),
+                                           ZNP_AVX2_LOAD (op2), m, 1));
+   else
+      for (; n >= 4; n -= 4, res += 4, op1 += 4, op2 += 4)
+         ZNP_AVX2_STORE (res, zn_avx2_sub (ZNP_AVX2_LOAD (op1),
+                                           ZNP_AVX2_LOAD (op2), m, 0));
+
+   for (; n; n--)
+      *res++ = zn_mod_sub (*op1++, *op2++, mod);
+}
+
+
+ZNP_AVX2 void
+zn_array_neg_avx2 (ulong* res, const ulong* op, size_t n, const zn_mod_t mod)
+{
+   __m256i m = _mm256_set1_epi64x (mod->m);
+   __m256i zero = _mm256_setzero_si256 ();
+
+   for (; n >= 4; n -= 4, res += 4, op += 4)
+   {
+      __m256i x = ZNP_AVX2_LOAD (op);
+      ZNP_AVX2_STORE (res, _mm256_andnot_si256 (_mm256_cmpeq_epi64 (x, zero),
+                                                _mm256_sub_epi64 (m, x)));
+   }
+
+   for (; n; n--)
+      *res++ = zn_mod_neg (*op++, mod);
+}
+
+
+ZNP_AVX2 void
+zn_array_bfly_avx2 (ulong* op1, ulong* op2, size_t n, const zn_mod_t mod)
+{
+   __m256i m = _mm256_set1_epi64x (mod->m);
+   __m256i x, y;
+
+   if (zn_mod_is_slim (mod))
+      for (; n >= 4; n -= 4, op1 += 4, op2 += 4)
+      {
+         x = ZNP_AVX2_LOAD (op1);
+         y = ZNP_AVX2_LOAD (op2);
+         ZNP_AVX2_STORE (op1, zn_avx2_add (y, x, m, 1));
+         ZNP_AVX2_STORE (op2, zn_avx2_sub (y, x, m, 1));
+      }
+   else
+      for (; n >= 4; n -= 4, op1 += 4, op2 += 4)
+      {
+         x = ZNP_AVX2_LOAD (op1);
+         y = ZNP_AVX2_LOAD (op2);
+         ZNP_AVX2_STORE (op1, zn_avx2_add (y, x, m, 0));
+         ZNP_AVX2_STORE (op2, zn_avx2_sub (y, x, m, 0));
+      }
+
+   for (; n; n--, op1++, op2++)
+   {
+      ulong a = *op1, b = *op2;
+      *op1 = zn_mod_add (b, a, mod);
+      *op2 = zn_mod_sub (b, a, mod);
+   }
+}
+
+
+/*
+   Each lane computes zn_mod_reduce_redc ((*op) * x, mod) exactly as in
+   _zn_array_scalar_mul_redc_v1. AVX2 only has 32 x 32 bit multiplies, so:
+      * z = (*op) * x fits into a word since both are less than 2^32;
+      * y = z * inv3 mod B is assembled from three 32-bit products;
+      * the result floor(y * m / B) is assembled from two, as m < 2^32.
+*/
+ZNP_AVX2 void
+_zn_array_scalar_mul_redc_v1_avx2 (ulong* res, const ulong* op, size_t n,
+                                   ulong x, const zn_mod_t mod)
+{
+   ZNP_ASSERT (mod->bits <= ULONG_BITS/2);
+   ZNP_ASSERT (mod->m & 1);
+   ZNP_ASSERT (x < mod->m);
+
+   __m256i vx = _mm256_set1_epi64x (x);
+   __m256i m = _mm256_set1_epi64x (mod->m);
+   __m256i inv = _mm256_set1_epi64x (mod->inv3);
+   __m256i inv_hi = _mm256_set1_epi64x (mod->inv3 >> 32);
+
+   for (; n >= 4; n -= 4, op += 4, res += 4)
+   {
+      __m256i z = _mm256_mul_epu32 (ZNP_AVX2_LOAD (op), vx);
+      
+      __m256i cross = _mm256_add_epi64 (
+                          _mm256_mul_epu32 (_mm256_srli_epi64 (z, 32), inv),
+                          _mm256_mul_epu32 (z, inv_hi));
+      __m256i y = _mm256_add_epi64 (_mm256_mul_epu32 (z, inv),
+                                    _mm256_slli_epi64 (cross, 32));
+      
+      __m256i t = _mm256_add_epi64 (
+                      _mm256_mul_epu32 (_mm256_srli_epi64 (y, 32), m),
+                      _mm256_srli_epi64 (_mm256_mul_epu32 (y, m), 32));
+      
+      ZNP_AVX2_STORE (res, _mm256_srli_epi64 (t, 32));
+   }
+
+   for (; n; n--, op++, res++)
+      *res = zn_mod_reduce_redc ((*op) * x, mod);
+}
+
+
+/*
+   Setup for the negacyclic kernels. Copies op1 into buf[0, n) (so that the
+   output may alias op1), and writes into buf[n, 3n + 2) the sequence
+   b'[j], -n < j < n, followed by three zeroes, where b'[j] = op2[j] for
+   j >= 0 and b'[j] = m - op2[j + n] for j < 0.
+   
+   Then output coefficient k of the negacyclic product is simply the sum of
+   op1[i] * b'[k - i] over 0 <= i < n, with nothing to subtract, and four
+   consecutive values of k read four consecutive entries of b'.
+*/
+static void
+zn_negamul_setup (ulong* buf, const ulong* op1, const ulong* op2, size_t n,
+                  const zn_mod_t mod)
+{
+   size_t j;
+   for (j = 0; j < n; j++)
+      buf[j] = op1[j];
+   
+   buf += n;
+   for (j = 1; j < n; j++)
+      *buf++ = mod->m - op2[j];
+   for (j = 0; j < n; j++)
+      *buf++ = op2[j];
+   for (j = 0; j < 3; j++)
+      *buf++ = 0;
+}
+
+
+/*
+   The products are less than 2^64, so each lane accumulates their low and
+   high halves separately, giving a 96-bit sum which is REDC-reduced at
+   the end.
+*/
+ZNP_AVX2 void
+zn_array_negamul_redc_avx2 (ulong* res, const ulong* op1, const ulong* op2,
+                            size_t n, const zn_mod_t mod)
+{
+   ZNP_ASSERT (mod->bits <= ULONG_BITS/2);
+   ZNP_ASSERT (mod->m & 1);
+   ZNP_ASSERT (n >= 1);
+
+   ZNP_FASTALLOC (buf, ulong, 6624, 3*n + 4);
+   zn_negamul_setup (buf, op1, op2, n, mod);
+
+   const ulong* a = buf;
+   const ulong* b = buf + 2*n - 1;
+   __m256i mask = _mm256_set1_epi64x (0xFFFFFFFFUL);
+   ulong lo[4], hi[4];
+   size_t i, k, j;
+   
+   for (k = 0; k < n; k += 4, b += 4)
+   {
+      __m256i slo = _mm256_setzero_si256 ();
+      __m256i shi = _mm256_setzero_si256 ();
+      
+      for (i = 0; i < n; i++)
+      {
+         __m256i p = _mm256_mul_epu32 (_mm256_set1_epi64x (a[i]),
+                                       ZNP_AVX2_LOAD (b - i));
+         slo = _mm256_add_epi64 (slo, _mm256_and_si256 (p, mask));
+         shi = _mm256_add_epi64 (shi, _mm256_srli_epi64 (p, 32));
+      }
+      
+      ZNP_AVX2_STORE (lo, slo);
+      ZNP_AVX2_STORE (hi, shi);
+      
+      for (j = 0; j < 4 && k + j < n; j++)
+      {
+         ulong x0 = lo[j] + (hi[j] << 32);
+         ulong x1 = (hi[j] >> 32) + (x0 < lo[j]);
+         res[k + j] = zn_mod_reduce2_redc (x1, x0, mod);
+      }
+   }
+
+   ZNP_FASTFREE (buf);
+}
+
+#else
+
+int
+zn_simd_avx2 (void)
+{
+   return 0;
+}
+
+#endif
+
+
+
+#if ZNP_USE_IFMA
+
+int
+zn_simd_ifma (void)
+{
+   static int have_ifma = -1;
+   
+   if (have_ifma < 0)
+   {
+      __builtin_cpu_init ();
+      have_ifma = (__builtin_cpu_supports ("avx512ifma")
+                   && __builtin_cpu_supports ("avx512vl")) ? 1 : 0;
+   }
+   
+   return have_ifma && !zn_simd_disable;
+}
+
+
+/*
+   Same as zn_array_negamul_redc_avx2, but the accumulators collect bits
+   [0, 52) and [52, 104) of the products. The first is bounded by
+   n * 2^52, hence the restriction on n. The multiply-accumulates have a
+   latency of several cycles, so the even and odd terms go into separate
+   accumulators.
+*/
+ZNP_IFMA void
+zn_array_negamul_redc_ifma (ulong* res, const ulong* op1, const ulong* op2,
+                            size_t n, const zn_mod_t mod)
+{
+   ZNP_ASSERT (mod->bits <= 52);
+   ZNP_ASSERT (mod->m & 1);
+   ZNP_ASSERT (n >= 1 && n <= 4096);
+
+   ZNP_FASTALLOC (buf, ulong, 6624, 3*n + 4);
+   zn_negamul_setup (buf, op1, op2, n, mod);
+
+   const ulong* a = buf;
+   const ulong* b = buf + 2*n - 1;
+   ulong lo[4], hi[4];
+   size_t i, k, j;
+   
+   for (k = 0; k < n; k += 4, b += 4)
+   {
+      __m256i slo = _mm256_setzero_si256 ();
+      __m256i shi = _mm256_setzero_si256 ();
+      __m256i slo1 = _mm256_setzero_si256 ();
+      __m256i shi1 = _mm256_setzero_si256 ();
+      __m256i x, y;
+      
+      for (i = 0; i + 1 < n; i += 2)
+      {
+         x = _mm256_set1_epi64x (a[i]);
+         y = ZNP_AVX2_LOAD (b - i);
+         slo = _mm256_madd52lo_epu64 (slo, x, y);
+         shi = _mm256_madd52hi_epu64 (shi, x, y);
+         
+         x = _mm256_set1_epi64x (a[i + 1]);
+         y = ZNP_AVX2_LOAD (b - i - 1);
+         slo1 = _mm256_madd52lo_epu64 (slo1, x, y);
+         shi1 = _mm256_madd52hi_epu64 (shi1, x, y);
+      }
+      
+      if (i < n)
+      {
+         x = _mm256_set1_epi64x (a[i]);
+         y = ZNP_AVX2_LOAD (b - i);
+         slo = _mm256_madd52lo_epu64 (slo, x, y);
+         shi = _mm256_madd52hi_epu64 (shi, x, y);
+      }
+      
+      slo = _mm256_add_epi64 (slo, slo1);
+      shi = _mm256_add_epi64 (shi, shi1);
+      
+      ZNP_AVX2_STORE (lo, slo);
+      ZNP_AVX2_STORE (hi, shi);
+      
+      for (j = 0; j < 4 && k + j < n; j++)
+      {
+         ulong x0 = lo[j] + (hi[j] << 52);
+         ulong x1 = (hi[j] >> 12) + (x0 < lo[j]);
+         res[k + j] = zn_mod_reduce2_redc (x1, x0, mod);
+      }
+   }
+
+   ZNP_FASTFREE (buf);
+}
+
+#else
+
+int
+zn_simd_ifma (void)
+{
+   return 0;
+}
+
+#endif
+
+
 
 int
 zn_array_cmp (const ulong* op1, const ulong* op2, size_t n)
@@ -45,6 +437,14 @@ zn_array_copy (ulong* res, const ulong* op, size_t n)
 void
 zn_array_neg (ulong* res, const ulong* op, size_t n, const zn_mod_t mod)
 {
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      zn_array_neg_avx2 (res, op, n, mod);
+      return;
+   }
+#endif
+
    for (; n > 0; n--)
       *res++ = zn_mod_neg (*op++, mod);
 }
@@ -78,6 +478,14 @@ _zn_array_scalar_mul_redc_v1 (ulong* res, const ulong* op, size_t n, ulong x,
    ZNP_ASSERT (mod->m & 1);
    ZNP_ASSERT (x < mod->m);
 
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      _zn_array_scalar_mul_redc_v1_avx2 (res, op, n, x, mod);
+      return;
+   }
+#endif
+
    for (; n; n--, op++, res++)
       *res = zn_mod_reduce_redc ((*op) * x, mod);
 }
@@ -246,13 +654,48 @@ void zn_array_scalar_mul (ulong* res, const ulong* op, size_t n, ulong x,
 
 
 
+void
+zn_array_add (ulong* res, const ulong* op1, const ulong* op2, size_t n,
+              const zn_mod_t mod)
+{
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      zn_array_add_avx2 (res, op1, op2, n, mod);
+      return;
+   }
+#endif
+
+   if (zn_mod_is_slim (mod))
+      for (; n; n--)
+         *res++ = zn_mod_add_slim (*op1++, *op2++, mod);
+   else
+      for (; n; n--)
+         *res++ = zn_mod_add (*op1++, *op2++, mod);
+}
+
+
+
 void
 zn_array_sub (ulong* res, const ulong* op1, const ulong* op2, size_t n,
               const zn_mod_t mod)
 {
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      zn_array_sub_avx2 (res, op1, op2, n, mod);
+      return;
+   }
+#endif
+
    if (zn_mod_is_slim (mod))
+      // branch free: for a slim modulus x - y is negative exactly when
+      // its top bit is set
       for (; n; n--)
-         *res++ = zn_mod_sub_slim (*op1++, *op2++, mod);
+      {
+         ulong temp = *op1++ - *op2++;
+         *res++ = temp + (mod->m & -(temp >> (ULONG_BITS - 1)));
+      }
    else
       for (; n; n--)
          *res++ = zn_mod_sub (*op1++, *op2++, mod);
@@ -265,6 +708,35 @@ zn_skip_array_signed_add (ulong* res, ptrdiff_t s, size_t n,
                           const ulong* op2, int neg2,
                           const zn_mod_t mod)
 {
+#if ZNP_USE_AVX2
+   if (s == 1 && zn_simd_avx2 ())
+   {
+      if (neg1)
+      {
+         if (neg2)
+         {
+            // res = -(op1 + op2)
+            zn_array_add_avx2 (res, op1, op2, n, mod);
+            zn_array_neg_avx2 (res, res, n, mod);
+         }
+         else
+            // res = op2 - op1
+            zn_array_sub_avx2 (res, op2, op1, n, mod);
+      }
+      else
+      {
+         if (neg2)
+            // res = op1 - op2
+            zn_array_sub_avx2 (res, op1, op2, n, mod);
+         else
+            // res = op1 + op2
+            zn_array_add_avx2 (res, op1, op2, n, mod);
+      }
+      
+      return res + n;
+   }
+#endif
+
    if (zn_mod_is_slim (mod))
    {
       // slim version
@@ -374,10 +374,8 @@ nuss_pointwise_mul (pmfvec_t res, const pmfvec_t op1, const pmfvec_t op2)
       // add biases
       dest[0] = src1[0] + src2[0];
 
-      // plain multiplication...
-      _zn_array_mul (temp, src1 + 1, M, src2 + 1, M, 1, res->mod);
-      // ... negacyclic reduction.
-      zn_array_sub (dest + 1, temp, temp + M, M, res->mod);
+      zn_array_negamul_fastred (dest + 1, src1 + 1, src2 + 1, M, temp,
+                                res->mod);
    }
 
    ZNP_FASTFREE (temp);
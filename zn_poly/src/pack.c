@@ -171,6 +171,62 @@ zn_array_pack (mp_limb_t* res, const ulong* op, size_t n, ptrdiff_t s,
 
 
 
+#if ZNP_USE_AVX2
+
+#include <immintrin.h>
+
+/*
+   AVX2 version of the main loop of zn_array_unpack1(), for b < ULONG_BITS
+   and k < ULONG_BITS. Coefficients are extracted four at a time from the
+   two limbs they straddle, using gathers and variable shifts.
+   
+   Stops before any gather would read beyond the
+   ceil((k + n * b) / ULONG_BITS) input limbs, and returns the number of
+   coefficients written.
+*/
+static ZNP_AVX2 size_t
+zn_array_unpack1_avx2 (ulong* res, const mp_limb_t* op, size_t n, unsigned b,
+                       unsigned k)
+{
+   ZNP_ASSERT (b < ULONG_BITS && k < ULONG_BITS && n >= 1);
+
+   size_t limbs = CEIL_DIV (k + n * b, ULONG_BITS);
+   size_t i;
+
+   __m256i mask = _mm256_set1_epi64x ((1UL << b) - 1);
+   __m256i width = _mm256_set1_epi64x (ULONG_BITS);
+   __m256i step = _mm256_set1_epi64x (4 * (ulong) b);
+   // bit positions of the current four coefficients
+   __m256i pos = _mm256_set_epi64x (k + 3 * b, k + 2 * b, k + b, k);
+
+   // the last lane reads limbs up to (k + (i + 3) * b) / ULONG_BITS + 1
+   for (i = 0; i + 4 <= n && (k + (i + 3) * b) / ULONG_BITS + 1 < limbs;
+        i += 4)
+   {
+      // ULONG_BITS == 64 on x86_64
+      __m256i index = _mm256_srli_epi64 (pos, 6);
+      __m256i shift = _mm256_and_si256 (pos,
+                                  _mm256_set1_epi64x (ULONG_BITS - 1));
+
+      __m256i lo = _mm256_i64gather_epi64 ((const long long*) op, index, 8);
+      __m256i hi = _mm256_i64gather_epi64 ((const long long*) op + 1,
+                                           index, 8);
+
+      // a shift by ULONG_BITS gives zero, so shift == 0 needs no special case
+      __m256i x = _mm256_or_si256 (_mm256_srlv_epi64 (lo, shift),
+                     _mm256_sllv_epi64 (hi, _mm256_sub_epi64 (width, shift)));
+
+      _mm256_storeu_si256 ((__m256i*) (res + i), _mm256_and_si256 (x, mask));
+      pos = _mm256_add_epi64 (pos, step);
+   }
+
+   return i;
+}
+
+#endif
+
+
+
 /*
    Same as zn_array_unpack(), but requires b <= ULONG_BITS
    (i.e. writes one word per coefficient)
@@ -197,6 +253,19 @@ zn_array_unpack1 (ulong* res, const mp_limb_t* op, size_t n, unsigned b,
       op++;
    }
 
+#if ZNP_USE_AVX2
+   if (b < ULONG_BITS && n >= 8 && zn_simd_avx2 ())
+   {
+      // do as much as possible with AVX2, then finish with the loops below
+      size_t done = zn_array_unpack1_avx2 (res, op, n, b, k);
+      size_t bits = k + done * b;
+      res += done;
+      n -= done;
+      op += bits / ULONG_BITS;
+      k = bits % ULONG_BITS;
+   }
+#endif
+
    if (k)
    {
       buf = *op++;
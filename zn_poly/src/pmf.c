@@ -185,6 +185,14 @@ zn_array_bfly_inplace (ulong* op1, ulong* op2, ulong n, const zn_mod_t mod)
 {
    ulong x, y;
    
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      zn_array_bfly_avx2 (op1, op2, n, mod);
+      return;
+   }
+#endif
+
    if (zn_mod_is_slim (mod))
    {
       // slim version
@@ -256,6 +264,14 @@ void
 zn_array_add_inplace (ulong* op1, const ulong* op2, ulong n,
                       const zn_mod_t mod)
 {
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      zn_array_add_avx2 (op1, op1, op2, n, mod);
+      return;
+   }
+#endif
+
    if (zn_mod_is_slim (mod))
    {
       // slim version
@@ -312,6 +328,14 @@ void
 zn_array_sub_inplace (ulong* op1, const ulong* op2, ulong n,
                       const zn_mod_t mod)
 {
+#if ZNP_USE_AVX2
+   if (zn_simd_avx2 ())
+   {
+      zn_array_sub_avx2 (op1, op1, op2, n, mod);
+      return;
+   }
+#endif
+
    if (zn_mod_is_slim (mod))
    {
       // slim version
@@ -533,6 +557,54 @@ pmfvec_mul_fudge (unsigned lgM, int sqr, const zn_mod_t mod)
 }
 
 
+/*
+   Largest M for which zn_array_negamul_fastred() uses the IFMA and AVX2
+   kernels respectively. These are quadratic, so beyond this KS
+   multiplication is faster (see the negamul lines of the array-profile
+   target).
+*/
+#define ZNP_NEGAMUL_IFMA_THRESH 128
+#define ZNP_NEGAMUL_AVX2_THRESH 64
+
+
+void
+zn_array_negamul_fastred (ulong* res, const ulong* op1, const ulong* op2,
+                          ulong M, ulong* temp, const zn_mod_t mod)
+{
+   ZNP_ASSERT (mod->m & 1);
+
+   tuning_info_t* i = &tuning_info[mod->bits];
+   int sqr = (op1 == op2);
+
+   // The SIMD kernels have the same fudge factor as the KS multiplications,
+   // so may only be used where _zn_array_mul() would not use the FFT.
+   if (M < (sqr ? i->sqr_fft_thresh : i->mul_fft_thresh))
+   {
+#if ZNP_USE_IFMA
+      if (M <= ZNP_NEGAMUL_IFMA_THRESH  &&  mod->bits <= 52  &&
+          zn_simd_ifma ())
+      {
+         zn_array_negamul_redc_ifma (res, op1, op2, M, mod);
+         return;
+      }
+#endif
+#if ZNP_USE_AVX2
+      if (M <= ZNP_NEGAMUL_AVX2_THRESH  &&  mod->bits <= ULONG_BITS/2  &&
+          zn_simd_avx2 ())
+      {
+         zn_array_negamul_redc_avx2 (res, op1, op2, M, mod);
+         return;
+      }
+#endif
+   }
+
+   // ordinary multiplication...
+   _zn_array_mul (temp, op1, M, op2, M, 1, mod);
+   // ... negacyclic reduction
+   zn_array_sub (res, temp, temp + M, M, mod);
+}
+
+
 void
 pmfvec_mul (pmfvec_t res, const pmfvec_t op1, const pmfvec_t op2, ulong n,
             int special_first_two)
@@ -627,10 +699,7 @@ pmfvec_mul (pmfvec_t res, const pmfvec_t op1, const pmfvec_t op2, ulong n,
          // add biases
          p3[0] = p1[0] + p2[0];
          
-         // ordinary multiplication...
-         _zn_array_mul (temp, p1 + 1, M, p2 + 1, M, 1, mod);
-         // ... negacyclic reduction
-         zn_array_sub (p3 + 1, temp, temp + M, M, mod);
+         zn_array_negamul_fastred (p3 + 1, p1 + 1, p2 + 1, M, temp, mod);
       }
 
       ZNP_FASTFREE (temp);
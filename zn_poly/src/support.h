@@ -428,6 +428,12 @@ profile_mpn_aors (void* arg, unsigned long count);
 double
 profile_scalar_mul (void* arg, unsigned long count);
 
+double
+profile_unpack (void* arg, unsigned long count);
+
+double
+profile_negamul (void* arg, unsigned long count);
+
 
 void 
 prof_main (int argc, char* argv[]);
@@ -0,0 +1,316 @@
+/*
+   array-test.c:  test code for functions in array.c
+   
+   Copyright (C) 2007, 2008, David Harvey
+   
+   This file is part of the zn_poly library (version 0.9).
+   
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) version 3 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "support.h"
+#include "zn_poly_internal.h"
+
+
+/*
+   Fills res with n random residues mod m, with extra weight on 0 and m - 1
+   (the boundary cases for the reductions).
+*/
+void
+random_residues (ulong* res, size_t n, const zn_mod_t mod)
+{
+   for (; n; n--)
+   {
+      ulong r = random_ulong (8);
+      *res++ = (r == 0) ? 0 : (r == 1) ? mod->m - 1 : random_ulong (mod->m);
+   }
+}
+
+
+/*
+   tests zn_array_add_inplace, zn_array_sub_inplace, zn_array_bfly_inplace,
+   zn_array_add, zn_array_sub, zn_array_neg and zn_skip_array_signed_add
+   once for the given length and modulus, against the zn_mod_* routines
+*/
+int
+testcase_zn_array_addsub (size_t n, const zn_mod_t mod)
+{
+   ulong* op1 = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong* op2 = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong* res = (ulong*) malloc (sizeof (ulong) * (n + 2));
+   ulong* ref = (ulong*) malloc (sizeof (ulong) * (n + 2));
+   size_t i;
+   int neg1, neg2;
+   
+   int success = 1;
+   
+   random_residues (op1, n, mod);
+   random_residues (op2, n, mod);
+   
+   // sentries to check buffer overflow
+   res[n] = ref[n] = 0x1234;
+
+   zn_array_copy (res, op1, n);
+   zn_array_add_inplace (res, op2, n, mod);
+   for (i = 0; i < n; i++)
+      ref[i] = zn_mod_add (op1[i], op2[i], mod);
+   success = success && !zn_array_cmp (res, ref, n + 1);
+
+   zn_array_add (res, op1, op2, n, mod);
+   success = success && !zn_array_cmp (res, ref, n + 1);
+
+   zn_array_copy (res, op1, n);
+   zn_array_sub_inplace (res, op2, n, mod);
+   for (i = 0; i < n; i++)
+      ref[i] = zn_mod_sub (op1[i], op2[i], mod);
+   success = success && !zn_array_cmp (res, ref, n + 1);
+
+   zn_array_sub (res, op1, op2, n, mod);
+   success = success && !zn_array_cmp (res, ref, n + 1);
+
+   zn_array_neg (res, op1, n, mod);
+   for (i = 0; i < n; i++)
+      ref[i] = zn_mod_neg (op1[i], mod);
+   success = success && !zn_array_cmp (res, ref, n + 1);
+   
+   for (neg1 = 0; neg1 < 2; neg1++)
+   for (neg2 = 0; neg2 < 2; neg2++)
+   {
+      zn_skip_array_signed_add (res, 1, n, op1, neg1, op2, neg2, mod);
+      for (i = 0; i < n; i++)
+      {
+         ulong x = neg1 ? zn_mod_neg (op1[i], mod) : op1[i];
+         ulong y = neg2 ? zn_mod_neg (op2[i], mod) : op2[i];
+         ref[i] = zn_mod_add (x, y, mod);
+      }
+      success = success && !zn_array_cmp (res, ref, n + 1);
+   }
+   
+   // butterfly: op1 := op2 + op1, op2 := op2 - op1
+   for (i = 0; i < n; i++)
+   {
+      ref[i] = zn_mod_add (op2[i], op1[i], mod);
+      res[i] = zn_mod_sub (op2[i], op1[i], mod);
+   }
+   zn_array_bfly_inplace (op1, op2, n, mod);
+   success = success && !zn_array_cmp (op1, ref, n);
+   success = success && !zn_array_cmp (op2, res, n);
+   
+   free (ref);
+   free (res);
+   free (op2);
+   free (op1);
+   
+   return success;
+}
+
+
+/*
+   tests the add/sub routines on a range of lengths and moduli, including
+   slim and non-slim moduli
+*/
+int
+test_zn_array_addsub (int quick)
+{
+   int success = 1;
+   unsigned b;
+   size_t n;
+   int i;
+
+   // run once with the SIMD kernels (if available) and once without
+   for (zn_simd_disable = 0; zn_simd_disable < 2 && success; zn_simd_disable++)
+   for (b = 2; b <= ULONG_BITS && success; b++)
+   for (i = 0; i < (quick ? 2 : 10) && success; i++)
+   {
+      zn_mod_t mod;
+      zn_mod_init (mod, random_modulus (b, 0));
+      
+      for (n = 0; n < 40 && success; n++)
+         success = success && testcase_zn_array_addsub (n, mod);
+      
+      zn_mod_clear (mod);
+   }
+   zn_simd_disable = 0;
+   
+   return success;
+}
+
+
+/*
+   tests zn_array_scalar_mul once for the given length and modulus, against
+   the reference implementation
+*/
+int
+testcase_zn_array_scalar_mul (size_t n, const zn_mod_t mod)
+{
+   ulong* op = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong* res = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong* ref = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong x;
+   
+   random_residues (op, n, mod);
+   random_residues (&x, 1, mod);
+   
+   // sentries to check buffer overflow
+   res[n] = ref[n] = 0x1234;
+   
+   zn_array_scalar_mul (res, op, n, x, mod);
+   ref_zn_array_scalar_mul (ref, op, n, x, mod);
+   
+   int success = !zn_array_cmp (res, ref, n + 1);
+   
+   // in place
+   zn_array_scalar_mul (op, op, n, x, mod);
+   success = success && !zn_array_cmp (op, ref, n);
+   
+   free (ref);
+   free (res);
+   free (op);
+   
+   return success;
+}
+
+
+/*
+   tests zn_array_scalar_mul on a range of lengths and moduli, with odd and
+   even moduli so that both REDC and plain reduction get used
+*/
+int
+test_zn_array_scalar_mul (int quick)
+{
+   int success = 1;
+   unsigned b;
+   size_t n;
+   int i;
+
+   for (b = 2; b <= ULONG_BITS && success; b++)
+   for (i = 0; i < (quick ? 2 : 10) && success; i++)
+   {
+      zn_mod_t mod;
+      zn_mod_init (mod, random_modulus (b, i & 1));
+      
+      for (n = 0; n < 40 && success; n++)
+         success = success && testcase_zn_array_scalar_mul (n, mod);
+      
+      zn_mod_clear (mod);
+   }
+   
+   return success;
+}
+
+
+/*
+   tests zn_array_negamul_fastred, and the SIMD kernels directly, once for
+   the given length and modulus, against ref_zn_array_negamul (after
+   removing the fudge factors), for distinct inputs and squaring, with the
+   output aliasing an input
+*/
+int
+testcase_zn_array_negamul (size_t n, const zn_mod_t mod)
+{
+   ulong* op1 = (ulong*) malloc (sizeof (ulong) * n);
+   ulong* op2 = (ulong*) malloc (sizeof (ulong) * n);
+   ulong* res = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong* ref = (ulong*) malloc (sizeof (ulong) * (n + 1));
+   ulong* temp = (ulong*) malloc (sizeof (ulong) * 2 * n);
+   int sqr, simd, success = 1;
+   
+   random_residues (op1, n, mod);
+   random_residues (op2, n, mod);
+
+   // sentries to check buffer overflow
+   res[n] = ref[n] = 0x1234;
+   
+   for (sqr = 0; sqr < 2; sqr++)
+   {
+      const ulong* op = sqr ? op1 : op2;
+      ref_zn_array_negamul (ref, op1, op, n, mod);
+      
+      for (simd = 0; simd < 2; simd++)
+      {
+         zn_simd_disable = !simd;
+         temp[2*n - 1] = 0;
+         zn_array_negamul_fastred (res, op1, op, n, temp, mod);
+         zn_array_scalar_mul (res, res, n,
+                              _zn_array_mul_fudge (n, n, sqr, mod), mod);
+         success = success && !zn_array_cmp (res, ref, n + 1);
+      }
+      
+      // in place
+      zn_array_copy (res, op1, n);
+      temp[2*n - 1] = 0;
+      zn_array_negamul_fastred (res, res, sqr ? res : op, n, temp, mod);
+      zn_array_scalar_mul (res, res, n,
+                           _zn_array_mul_fudge (n, n, sqr, mod), mod);
+      success = success && !zn_array_cmp (res, ref, n + 1);
+
+#if ZNP_USE_AVX2
+      if (mod->bits <= ULONG_BITS/2 && zn_simd_avx2 ())
+      {
+         zn_array_negamul_redc_avx2 (res, op1, op, n, mod);
+         zn_array_scalar_mul (res, res, n, mod->m - mod->B, mod);
+         success = success && !zn_array_cmp (res, ref, n + 1);
+      }
+#endif
+#if ZNP_USE_IFMA
+      if (mod->bits <= 52 && zn_simd_ifma ())
+      {
+         zn_array_negamul_redc_ifma (res, op1, op, n, mod);
+         zn_array_scalar_mul (res, res, n, mod->m - mod->B, mod);
+         success = success && !zn_array_cmp (res, ref, n + 1);
+      }
+#endif
+   }
+   
+   free (temp);
+   free (ref);
+   free (res);
+   free (op2);
+   free (op1);
+   
+   return success;
+}
+
+
+/*
+   tests zn_array_negamul_fastred on a range of lengths and odd moduli,
+   covering the AVX2 (half-word) and IFMA (52-bit) kernels where the
+   processor has them
+*/
+int
+test_zn_array_negamul (int quick)
+{
+   int success = 1;
+   unsigned b;
+   size_t n;
+   int i;
+
+   for (b = 2; b <= ULONG_BITS && success; b++)
+   for (i = 0; i < (quick ? 1 : 5) && success; i++)
+   {
+      zn_mod_t mod;
+      zn_mod_init (mod, random_modulus (b, 1));
+      
+      for (n = 1; n <= 130 && success; n++)
+         success = success && testcase_zn_array_negamul (n, mod);
+      
+      zn_mod_clear (mod);
+   }
+   
+   return success;
+}
+
+
+// end of file ****************************************************************
@@ -52,6 +52,9 @@ extern int test_zn_array_mulmid_KS2 (int quick);
 extern int test_zn_array_mulmid_KS3 (int quick);
 extern int test_zn_array_mulmid_KS4 (int quick);
 extern int test_zn_array_recover_reduce (int quick);
+extern int test_zn_array_addsub (int quick);
+extern int test_zn_array_scalar_mul (int quick);
+extern int test_zn_array_negamul (int quick);
 extern int test_zn_array_pack (int quick);
 extern int test_zn_array_unpack (int quick);
 extern int test_zn_array_mul_fft (int quick);
@@ -90,6 +93,15 @@ test_target_t targets[] = {
    {"zn_array_recover_reduce",
     test_zn_array_recover_reduce},
     
+   {"zn_array_addsub",
+    test_zn_array_addsub},
+    
+   {"zn_array_scalar_mul",
+    test_zn_array_scalar_mul},
+    
+   {"zn_array_negamul",
+    test_zn_array_negamul},
+    
    {"zn_array_pack",
     test_zn_array_pack},
     